@@ -0,0 +1,306 @@
+/*
+ * json.c
+ *
+ * Streaming JSON writer for systool
+ *
+ * Copyright (C) IBM Corp. 2003-2005
+ *
+ *	This program is free software; you can redistribute it and/or modify it
+ *	under the terms of the GNU General Public License as published by the
+ *	Free Software Foundation version 2 of the License.
+ *
+ *	This program is distributed in the hope that it will be useful, but
+ *	WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *	General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License along
+ *	with this program; if not, write to the Free Software Foundation, Inc.,
+ *	675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include "json.h"
+#include "output.h"
+
+/**
+ * write_string: writes a quoted, escaped JSON string
+ * @str: UTF-8 text, need not be NUL terminated
+ * @len: length of str
+ */
+static void write_string(const char *str, size_t len)
+{
+	const char *run = str, *end = str + len;
+	unsigned char c;
+
+	out_char('"');
+	for (; str < end; str++) {
+		c = (unsigned char)*str;
+		if (c >= 0x20 && c != '"' && c != '\\')
+			continue;
+		out_write(run, str - run);
+		run = str + 1;
+		out_char('\\');
+		switch (c) {
+		case '"':
+		case '\\':
+			out_char(c);
+			break;
+		case '\b':
+			out_char('b');
+			break;
+		case '\f':
+			out_char('f');
+			break;
+		case '\n':
+			out_char('n');
+			break;
+		case '\r':
+			out_char('r');
+			break;
+		case '\t':
+			out_char('t');
+			break;
+		default:
+			out_printf("u%04x", c);
+			break;
+		}
+	}
+	out_write(run, end - run);
+	out_char('"');
+}
+
+/**
+ * is_text: tells whether a value can be written as a JSON string, that
+ * 	is, whether it is valid UTF-8 without NUL bytes
+ */
+static int is_text(const char *value, size_t len)
+{
+	const unsigned char *p = (const unsigned char *)value;
+	const unsigned char *end = p + len;
+	static const unsigned int least[] = { 0, 0x80, 0x800, 0x10000 };
+	unsigned int cp;
+	int more, need;
+
+	while (p < end) {
+		if (*p == 0)
+			return 0;
+		if (*p < 0x80) {
+			p++;
+			continue;
+		}
+		if ((*p & 0xe0) == 0xc0) {
+			cp = *p & 0x1f;
+			more = 1;
+		} else if ((*p & 0xf0) == 0xe0) {
+			cp = *p & 0x0f;
+			more = 2;
+		} else if ((*p & 0xf8) == 0xf0) {
+			cp = *p & 0x07;
+			more = 3;
+		} else
+			return 0;
+		if (end - p <= more)
+			return 0;
+		need = more;
+		for (p++; more > 0; more--, p++) {
+			if ((*p & 0xc0) != 0x80)
+				return 0;
+			cp = (cp << 6) | (*p & 0x3f);
+		}
+		/* overlong forms, surrogates and beyond U+10FFFF */
+		if (cp < least[need] || (cp >= 0xd800 && cp <= 0xdfff) ||
+				cp > 0x10ffff)
+			return 0;
+	}
+	return 1;
+}
+
+/**
+ * json_member: starts a member of the current object or array, writing
+ * 	the separator and, in an object, the key
+ */
+static void json_member(struct json_writer *json, const char *key)
+{
+	if (!json->first[json->depth])
+		out_char(',');
+	json->first[json->depth] = 0;
+	if (key) {
+		write_string(key, strlen(key));
+		out_char(':');
+	}
+}
+
+/* opens a level of nesting */
+static void json_push(struct json_writer *json, char open)
+{
+	out_char(open);
+	if (json->depth < JSON_DEPTH - 1)
+		json->depth++;
+	json->first[json->depth] = 1;
+}
+
+/* closes a level of nesting */
+static void json_pop(struct json_writer *json, char close)
+{
+	out_char(close);
+	if (json->depth > 0)
+		json->depth--;
+}
+
+/**
+ * json_begin: starts the output
+ * @json: writer to set up
+ * @layout: JSON_ARRAY or JSON_LINES
+ */
+void json_begin(struct json_writer *json, int layout)
+{
+	memset(json, 0, sizeof(struct json_writer));
+	json->layout = layout;
+	if (layout == JSON_ARRAY)
+		out_char('[');
+}
+
+/**
+ * json_begin_part: starts a writer for records that are written apart
+ * 	and later put into another writer's output with json_splice()
+ * @json: writer to set up
+ * @layout: layout of the writer the records go to
+ */
+void json_begin_part(struct json_writer *json, int layout)
+{
+	memset(json, 0, sizeof(struct json_writer));
+	json->layout = layout;
+}
+
+/**
+ * json_splice: accounts for records written by a part, writing what is
+ * 	due before them. The part's output is to be written right after.
+ * @json: writer the records go to
+ * @part: writer they were written with
+ */
+void json_splice(struct json_writer *json, const struct json_writer *part)
+{
+	/* the part's first record came with the separator of a first one */
+	if (json->layout == JSON_ARRAY && json->records && part->records)
+		out_char(',');
+	json->records += part->records;
+}
+
+/**
+ * json_end: finishes the output
+ */
+void json_end(struct json_writer *json)
+{
+	if (json->layout == JSON_ARRAY)
+		out_str(json->records ? "\n]\n" : "]\n");
+	out_flush();
+}
+
+/**
+ * json_record_start: starts a top level object
+ * @json: writer
+ * @type: what the record describes, written as its "type" member
+ */
+void json_record_start(struct json_writer *json, const char *type)
+{
+	if (json->layout == JSON_ARRAY)
+		out_str(json->records ? ",\n" : "\n");
+	json->records++;
+	json->depth = 0;
+	json_push(json, '{');
+	json_string(json, "type", type);
+}
+
+/**
+ * json_record_end: finishes a top level object
+ */
+void json_record_end(struct json_writer *json)
+{
+	json_pop(json, '}');
+	if (json->layout == JSON_LINES)
+		out_char('\n');
+}
+
+/**
+ * json_object_start: starts an object
+ * @json: writer
+ * @key: member name, NULL inside an array
+ */
+void json_object_start(struct json_writer *json, const char *key)
+{
+	json_member(json, key);
+	json_push(json, '{');
+}
+
+void json_object_end(struct json_writer *json)
+{
+	json_pop(json, '}');
+}
+
+/**
+ * json_array_start: starts an array
+ * @json: writer
+ * @key: member name, NULL inside an array
+ */
+void json_array_start(struct json_writer *json, const char *key)
+{
+	json_member(json, key);
+	json_push(json, '[');
+}
+
+void json_array_end(struct json_writer *json)
+{
+	json_pop(json, ']');
+}
+
+/**
+ * json_string: writes a string
+ * @json: writer
+ * @key: member name, NULL inside an array
+ * @value: NUL terminated UTF-8 text, NULL for null
+ */
+void json_string(struct json_writer *json, const char *key, const char *value)
+{
+	json_member(json, key);
+	if (value)
+		write_string(value, strlen(value));
+	else
+		out_write("null", 4);
+}
+
+/**
+ * json_value: writes an attribute value. Text loses its trailing newline
+ * 	and is written as a string. Binary values, and values that are
+ * 	not valid UTF-8, are written as {"hex": "..."}.
+ * @json: writer
+ * @key: member name, NULL inside an array
+ * @value: value as read, NULL for null
+ * @len: length of value
+ * @binary: write value in hex even if it looks like text
+ */
+void json_value(struct json_writer *json, const char *key,
+		const char *value, size_t len, int binary)
+{
+	if (!value) {
+		json_string(json, key, NULL);
+		return;
+	}
+	if (!binary && is_text(value, len)) {
+		if (len > 0 && value[len - 1] == '\n')
+			len--;
+		json_member(json, key);
+		write_string(value, len);
+		return;
+	}
+	json_object_start(json, key);
+	json_member(json, "hex");
+	out_char('"');
+	out_hex((const unsigned char *)value, len);
+	out_char('"');
+	json_object_end(json);
+}
@@ -0,0 +1,61 @@
+/*
+ * json.h
+ *
+ * Streaming JSON writer for systool
+ *
+ * Copyright (C) IBM Corp. 2003-2005
+ *
+ *	This program is free software; you can redistribute it and/or modify it
+ *	under the terms of the GNU General Public License as published by the
+ *	Free Software Foundation version 2 of the License.
+ *
+ *	This program is distributed in the hope that it will be useful, but
+ *	WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *	General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License along
+ *	with this program; if not, write to the Free Software Foundation, Inc.,
+ *	675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#ifndef _JSON_H_
+#define _JSON_H_
+
+#include <stddef.h>
+
+/* how records are laid out */
+#define JSON_ARRAY	1	/* one array holding all records */
+#define JSON_LINES	2	/* one record per line */
+
+#define JSON_DEPTH	16	/* deepest nesting of objects and arrays */
+
+/*
+ * Values are written as soon as they are given; nothing is kept but
+ * whether a separator is due at each level of nesting.
+ */
+struct json_writer {
+	int layout;
+	int records;
+	int depth;
+	int first[JSON_DEPTH];
+};
+
+extern void json_begin(struct json_writer *json, int layout);
+extern void json_begin_part(struct json_writer *json, int layout);
+extern void json_splice(struct json_writer *json,
+		const struct json_writer *part);
+extern void json_end(struct json_writer *json);
+extern void json_record_start(struct json_writer *json, const char *type);
+extern void json_record_end(struct json_writer *json);
+extern void json_object_start(struct json_writer *json, const char *key);
+extern void json_object_end(struct json_writer *json);
+extern void json_array_start(struct json_writer *json, const char *key);
+extern void json_array_end(struct json_writer *json);
+extern void json_string(struct json_writer *json, const char *key,
+		const char *value);
+extern void json_value(struct json_writer *json, const char *key,
+		const char *value, size_t len, int binary);
+
+#endif /* _JSON_H_ */
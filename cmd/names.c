@@ -1,6 +1,8 @@
 /*
  *	The PCI Library -- ID to Name Translation
  *
+ *	Works on any ID list in the format of pci.ids, such as usb.ids.
+ *
  *	Copyright (c) 1997--2002 Martin Mares <mj@ucw.cz>
  *
  *	Can be freely distributed and used under the terms of the GNU GPL.
@@ -14,6 +16,7 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <errno.h>
 
 #include "names.h"
@@ -34,6 +37,68 @@ struct nl_entry {
 
 #define HASH_SIZE 1024
 
+/*
+ * Compiled form of an ID list, written by id_compile_name_list() next to
+ * the text file and mapped instead of parsing it: the entries sorted by
+ * key, then their NUL terminated names. It is only used as long as the
+ * text file has the size and modification time recorded in the header.
+ */
+#define NL_DB_MAGIC "HWIDS\0\0"
+#define NL_DB_VERSION 1
+#define NL_DB_SUFFIX ".bin"
+
+struct nl_db_header {
+  char magic[8];
+  unsigned int version;
+  unsigned int count;			/* entries */
+  unsigned long long src_size;		/* of the text file compiled */
+  long long src_mtime;
+  long long src_mtime_nsec;
+  unsigned int entries;			/* offset of the entries */
+  unsigned int strings;			/* offset of the names */
+  unsigned int size;			/* of the whole file */
+  unsigned int reserved;
+};
+
+struct nl_db_entry {
+  unsigned long long key;		/* cat, id1, id2 */
+  unsigned int key2;			/* id3, id4 */
+  unsigned int name;			/* offset in the names */
+};
+
+static inline unsigned long long nl_db_key(int cat, int id1, int id2)
+{
+  return ((unsigned long long)cat << 32) | ((unsigned int)id1 << 16) | (id2 & 0xffff);
+}
+
+static inline unsigned int nl_db_key2(int id3, int id4)
+{
+  return ((unsigned int)id3 << 16) | (id4 & 0xffff);
+}
+
+static char *nl_db_lookup(struct id_list *a, int cat, int id1, int id2, int id3, int id4)
+{
+  struct nl_db_header *h = (struct nl_db_header *)a->nl_db;
+  struct nl_db_entry *e = (struct nl_db_entry *)(a->nl_db + h->entries);
+  unsigned long long key = nl_db_key(cat, id1, id2);
+  unsigned int key2 = nl_db_key2(id3, id4);
+  unsigned int lo = 0, hi = h->count, mid;
+
+  while (lo < hi)
+    {
+      mid = lo + (hi - lo) / 2;
+      if (e[mid].key < key || (e[mid].key == key && e[mid].key2 < key2))
+	lo = mid + 1;
+      else
+	hi = mid;
+    }
+  if (lo == h->count || e[lo].key != key || e[lo].key2 != key2)
+    return NULL;
+  if (e[lo].name >= h->size - h->strings)
+    return NULL;
+  return a->nl_db + h->strings + e[lo].name;
+}
+
 static inline unsigned int nl_calc_hash(int cat, int id1, int id2, int id3, int id4)
 {
   unsigned int h;
@@ -43,22 +108,27 @@ static inline unsigned int nl_calc_hash(int cat, int id1, int id2, int id3, int
   return h & (HASH_SIZE-1);
 }
 
-static struct nl_entry *nl_lookup(struct pci_access *a, int num, int cat, int id1, int id2, int id3, int id4)
+static void nl_need(struct id_list *a, int cat, int id1);
+
+static char *nl_lookup(struct id_list *a, int num, int cat, int id1, int id2, int id3, int id4)
 {
   unsigned int h;
   struct nl_entry *n;
 
   if (num)
     return NULL;
+  if (a->nl_db)
+    return nl_db_lookup(a, cat, id1, id2, id3, id4);
+  nl_need(a, cat, id1);
   h = nl_calc_hash(cat, id1, id2, id3, id4);
   n = a->nl_hash[h];
   while (n && (n->id1 != id1 || n->id2 != id2 || n->id3 != id3 || n->id4 != id4 || n->cat != cat))
 	 n = n->next;
 
-  return n;
+  return n ? n->name : NULL;
 }
 
-static int nl_add(struct pci_access *a, int cat, int id1, int id2, int id3, int id4, char *text)
+static int nl_add(struct id_list *a, int cat, int id1, int id2, int id3, int id4, char *text)
 {
   unsigned int h = nl_calc_hash(cat, id1, id2, id3, id4);
   struct nl_entry *n = a->nl_hash[h];
@@ -81,33 +151,79 @@ static int nl_add(struct pci_access *a, int cat, int id1, int id2, int id3, int
 }
 
 static void
-err_name_list(struct pci_access *a, char *msg)
+err_name_list(struct id_list *a, char *msg)
+{
+  fprintf(stderr, "%s: %s: %s\n", a->id_file_name, msg, strerror(errno));
+}
+
+/*
+ * The list is mapped and only indexed up front: where each vendor's and
+ * each class' block of lines starts. A block is parsed the first time a
+ * lookup needs it, so a run only pays for the vendors it looks up.
+ */
+struct nl_section {
+  unsigned int key;			/* cat << 16 | id1 */
+  unsigned int start, end;		/* offsets of the block's lines */
+  unsigned int lino;			/* line number of its first line */
+  int parsed;
+};
+
+static inline int
+hex_digit(unsigned char c)
+{
+  unsigned int d = c - '0';
+  unsigned int l = (c | 0x20) - 'a';
+
+  if (d < 10)
+    return d;
+  if (l < 6)
+    return l + 10;
+  return -1;
+}
+
+/* parses exactly n hex digits followed by a space */
+static int
+parse_hex(const char *p, const char *end, int n, unsigned int *val)
 {
-  fprintf(stderr, "%s: %s: %s\n", a->pci_id_file_name, msg, strerror(errno));
+  unsigned int v = 0;
+  int bad = 0, d;
+
+  if (end - p <= n || p[n] != ' ')
+    return -1;
+  while (n--)
+    {
+      d = hex_digit(*p++);
+      bad |= d;
+      v = (v << 4) | (d & 0xf);
+    }
+  *val = v;
+  return bad < 0 ? -1 : 0;
 }
 
 static void
-parse_name_list(struct pci_access *a)
+parse_section(struct id_list *a, struct nl_section *sec)
 {
-  char *p = (char *)a->nl_list;
-  char *q, *r;
-  int lino = 0;
+  char *p = a->nl_list + sec->start;
+  char *end = a->nl_list + sec->end;
+  char *q, *r, *eol;
+  int lino = sec->lino - 1;
   unsigned int id1=0, id2=0, id3=0, id4=0;
   int cat = -1;
 
-  while (*p)
+  sec->parsed = 1;
+  for (; p < end; p = eol + 1)
     {
       lino++;
       q = p;
-      while (*p && *p != '\n')
-	p++;
-      if (*p == '\n')
-	*p++ = 0;
-      if (!*q || *q == '#')
+      eol = memchr(p, '\n', end - p);
+      if (!eol)
+	eol = end;
+      if (q == eol || *q == '#')
 	continue;
-      r = p;
+      r = eol;
       while (r > q && r[-1] == ' ')
-	*--r = 0;
+	r--;
+      *r = 0;
       r = q;
       while (*q == '\t')
 	q++;
@@ -115,22 +231,19 @@ parse_name_list(struct pci_access *a)
 	{
 	  if (q[0] == 'C' && q[1] == ' ')
 	    {
-	      if (strlen(q+2) < 3 ||
-		  q[4] != ' ' ||
-		  sscanf(q+2, "%x", &id1) != 1)
+	      if (parse_hex(q+2, eol, 2, &id1))
 		goto parserr;
 	      cat = NL_CLASS;
+	      q += 5;
 	    }
 	  else
 	    {
-	      if (strlen(q) < 5 ||
-		  q[4] != ' ' ||
-		  sscanf(q, "%x", &id1) != 1)
+	      if (parse_hex(q, eol, 4, &id1))
 		goto parserr;
 	      cat = NL_VENDOR;
+	      q += 5;
 	    }
 	  id2 = id3 = id4 = 0;
-	  q += 4;
 	}
       else if (q == r+1)
 	switch (cat)
@@ -138,7 +251,7 @@ parse_name_list(struct pci_access *a)
 	  case NL_VENDOR:
 	  case NL_DEVICE:
 	  case NL_SUBSYSTEM:
-	    if (sscanf(q, "%x", &id2) != 1 || q[4] != ' ')
+	    if (parse_hex(q, eol, 4, &id2))
 	      goto parserr;
 	    q += 5;
 	    cat = NL_DEVICE;
@@ -147,7 +260,7 @@ parse_name_list(struct pci_access *a)
 	  case NL_CLASS:
 	  case NL_SUBCLASS:
 	  case NL_PROGIF:
-	    if (sscanf(q, "%x", &id2) != 1 || q[2] != ' ')
+	    if (parse_hex(q, eol, 2, &id2))
 	      goto parserr;
 	    q += 3;
 	    cat = NL_SUBCLASS;
@@ -161,7 +274,10 @@ parse_name_list(struct pci_access *a)
 	  {
 	  case NL_DEVICE:
 	  case NL_SUBSYSTEM:
-	    if (sscanf(q, "%x%x", &id3, &id4) != 2 || q[9] != ' ')
+	    /* usb.ids names interfaces here, they aren't looked up */
+	    if (parse_hex(q, eol, 4, &id3) && !parse_hex(q, eol, 2, &id3))
+	      continue;
+	    if (parse_hex(q, eol, 4, &id3) || parse_hex(q+5, eol, 4, &id4))
 	      goto parserr;
 	    q += 10;
 	    cat = NL_SUBSYSTEM;
@@ -169,7 +285,7 @@ parse_name_list(struct pci_access *a)
 	  case NL_CLASS:
 	  case NL_SUBCLASS:
 	  case NL_PROGIF:
-	    if (sscanf(q, "%x", &id3) != 1 || q[2] != ' ')
+	    if (parse_hex(q, eol, 2, &id3))
 	      goto parserr;
 	    q += 3;
 	    cat = NL_PROGIF;
@@ -185,21 +301,202 @@ parse_name_list(struct pci_access *a)
       if (!*q)
 	goto parserr;
       if (nl_add(a, cat, id1, id2, id3, id4, q))
-	fprintf(stderr, "%s, line %d: duplicate entry", a->pci_id_file_name, lino);
+	fprintf(stderr, "%s, line %d: duplicate entry\n", a->id_file_name, lino);
+      continue;
+
+    parserr:
+      fprintf(stderr, "%s, line %d: parse error\n", a->id_file_name, lino);
+      /* the rest of the block belongs to the broken line */
+      return;
     }
-  return;
+}
+
+static int
+nl_section_cmp(const void *x, const void *y)
+{
+  const struct nl_section *s1 = x, *s2 = y;
 
-parserr:
-  fprintf(stderr, "%s, line %d: parse error", a->pci_id_file_name, lino);
+  if (s1->key != s2->key)
+    return s1->key < s2->key ? -1 : 1;
+  return s1->start < s2->start ? -1 : 1;
 }
 
+/*
+ * Finds where the blocks start, touching little more than the newlines.
+ * Other top level lines, like the HID and language tables of usb.ids,
+ * end the block before them and are skipped with what follows them.
+ */
 static void
-load_name_list(struct pci_access *a)
+index_name_list(struct id_list *a)
+{
+  char *list = a->nl_list, *p = list, *end = list + a->nl_list_size, *nl;
+  struct nl_section *sec, *more;
+  unsigned int count = 0, size = 0, lino = 1, id;
+  int cat, open = 0;
+
+  while (p < end)
+    {
+      cat = -1;
+      if (*p == '\t' || *p == '#' || *p == '\n')
+	;
+      else if (p[0] == 'C' && end - p > 1 && p[1] == ' ')
+	{
+	  if (!parse_hex(p+2, end, 2, &id))
+	    cat = NL_CLASS;
+	}
+      else if (!parse_hex(p, end, 4, &id))
+	cat = NL_VENDOR;
+      if (open && (cat >= 0 || (*p != '\t' && *p != '#' && *p != '\n')))
+	{
+	  a->nl_sections[count-1].end = p - list;
+	  open = 0;
+	}
+      if (cat >= 0)
+	{
+	  if (count == size)
+	    {
+	      size = size ? 2 * size : 1024;
+	      more = realloc(a->nl_sections, size * sizeof(struct nl_section));
+	      if (!more)
+		break;
+	      a->nl_sections = more;
+	    }
+	  sec = &a->nl_sections[count++];
+	  sec->key = (cat << 16) | id;
+	  sec->start = p - list;
+	  sec->end = a->nl_list_size;
+	  sec->lino = lino;
+	  sec->parsed = 0;
+	  open = 1;
+	}
+      nl = memchr(p, '\n', end - p);
+      if (!nl)
+	break;
+      p = nl + 1;
+      lino++;
+    }
+  a->nl_section_count = count;
+  if (count)
+    qsort(a->nl_sections, count, sizeof(struct nl_section), nl_section_cmp);
+}
+
+/* parses the blocks an entry can be in, unless that has been done */
+static void
+nl_need(struct id_list *a, int cat, int id1)
+{
+  unsigned int key, lo = 0, hi = a->nl_section_count, mid;
+
+  key = ((cat >= NL_CLASS ? NL_CLASS : NL_VENDOR) << 16) | id1;
+  while (lo < hi)
+    {
+      mid = lo + (hi - lo) / 2;
+      if (a->nl_sections[mid].key < key)
+	lo = mid + 1;
+      else
+	hi = mid;
+    }
+  for (; lo < a->nl_section_count && a->nl_sections[lo].key == key; lo++)
+    if (!a->nl_sections[lo].parsed)
+      parse_section(a, &a->nl_sections[lo]);
+}
+
+static char *
+db_name(struct id_list *a)
+{
+  char *path = malloc(strlen(a->id_file_name) + sizeof(NL_DB_SUFFIX));
+
+  if (path)
+    {
+      strcpy(path, a->id_file_name);
+      strcat(path, NL_DB_SUFFIX);
+    }
+  return path;
+}
+
+/* maps the compiled list if there is one that matches the text file */
+static int
+load_name_db(struct id_list *a, struct stat *src)
+{
+  struct nl_db_header *h;
+  struct stat st;
+  char *path, *db;
+  int fd;
+
+  path = db_name(a);
+  if (!path)
+    return -1;
+  fd = open(path, O_RDONLY | O_CLOEXEC);
+  free(path);
+  if (fd < 0)
+    return -1;
+  if (fstat(fd, &st) < 0 || st.st_size < (off_t)sizeof(struct nl_db_header))
+    {
+      close(fd);
+      return -1;
+    }
+  db = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (db == MAP_FAILED)
+    return -1;
+  h = (struct nl_db_header *)db;
+  if (memcmp(h->magic, NL_DB_MAGIC, sizeof(h->magic)) ||
+      h->version != NL_DB_VERSION ||
+      h->size != (unsigned long long)st.st_size ||
+      h->src_size != (unsigned long long)src->st_size ||
+      h->src_mtime != (long long)src->st_mtim.tv_sec ||
+      h->src_mtime_nsec != (long long)src->st_mtim.tv_nsec ||
+      h->entries < sizeof(struct nl_db_header) ||
+      h->entries > h->strings ||
+      (h->strings - h->entries) / sizeof(struct nl_db_entry) < h->count ||
+      h->strings >= h->size || db[h->size - 1])
+    {
+      munmap(db, st.st_size);
+      return -1;
+    }
+  a->nl_db = db;
+  a->nl_db_size = st.st_size;
+  return 0;
+}
+
+static void
+read_name_list(struct id_list *a, int fd, struct stat *st)
+{
+  char *list;
+
+  a->nl_hash = malloc(sizeof(struct nl_entry *) * HASH_SIZE);
+  bzero(a->nl_hash, sizeof(struct nl_entry *) * HASH_SIZE);
+  /*
+   * Private and writable, as parsing terminates names in place. The file
+   * goes over zeroed memory one byte longer, so the last line is followed
+   * by a NUL even if the file ends exactly at a page.
+   */
+  list = mmap(NULL, st->st_size + 1, PROT_READ | PROT_WRITE,
+	      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (list == MAP_FAILED)
+    {
+      err_name_list(a, "mmap");
+      return;
+    }
+  if (st->st_size &&
+      mmap(list, st->st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED,
+	   fd, 0) == MAP_FAILED)
+    {
+      err_name_list(a, "mmap");
+      munmap(list, st->st_size + 1);
+      return;
+    }
+  a->nl_list = list;
+  a->nl_list_size = st->st_size;
+  index_name_list(a);
+}
+
+static void
+load_name_list(struct id_list *a)
 {
   int fd;
   struct stat st;
 
-  fd = open(a->pci_id_file_name, O_RDONLY);
+  fd = open(a->id_file_name, O_RDONLY);
   if (fd < 0)
     {
       a->numeric_ids = 1;
@@ -207,24 +504,170 @@ load_name_list(struct pci_access *a)
     }
   if (fstat(fd, &st) < 0)
     err_name_list(a, "stat");
-  a->nl_list = malloc(st.st_size + 1);
-  if (read(fd, a->nl_list, st.st_size) != st.st_size)
-    err_name_list(a, "read");
-  a->nl_list[st.st_size] = 0;
-  a->nl_hash = malloc(sizeof(struct nl_entry *) * HASH_SIZE);
-  bzero(a->nl_hash, sizeof(struct nl_entry *) * HASH_SIZE);
-  parse_name_list(a);
+  else if (load_name_db(a, &st) == 0)
+    {
+      close(fd);
+      return;
+    }
+  read_name_list(a, fd, &st);
+  close(fd);
+}
+
+static int
+nl_entry_cmp(const void *x, const void *y)
+{
+  const struct nl_db_entry *e1 = x, *e2 = y;
+
+  if (e1->key != e2->key)
+    return e1->key < e2->key ? -1 : 1;
+  if (e1->key2 != e2->key2)
+    return e1->key2 < e2->key2 ? -1 : 1;
+  return 0;
+}
+
+static int
+write_all(int fd, const void *buf, size_t len)
+{
+  const char *p = buf;
+  ssize_t n;
+
+  while (len > 0)
+    {
+      n = write(fd, p, len);
+      if (n < 0 && errno == EINTR)
+	continue;
+      if (n <= 0)
+	return -1;
+      p += n;
+      len -= n;
+    }
+  return 0;
+}
+
+/*
+ * Parses an ID list and writes its compiled form next to it, in a
+ * temporary file renamed into place so readers see either file whole.
+ * Returns 0 on success and -1 on error with errno set.
+ */
+int
+id_compile_name_list(struct id_list *a)
+{
+  struct nl_db_header h;
+  struct nl_db_entry *entries = NULL;
+  struct nl_entry *n;
+  struct stat st;
+  char *path = NULL, *tmp = NULL;
+  unsigned int count = 0, strings = 0, i;
+  int fd = -1, made = 0, err;
+
+  id_free_name_list(a);
+  fd = open(a->id_file_name, O_RDONLY);
+  if (fd < 0 || fstat(fd, &st) < 0)
+    goto fail;
+  read_name_list(a, fd, &st);
   close(fd);
+  fd = -1;
+  for (i = 0; i < a->nl_section_count; i++)
+    if (!a->nl_sections[i].parsed)
+      parse_section(a, &a->nl_sections[i]);
+  for (i = 0; i < HASH_SIZE; i++)
+    for (n = a->nl_hash[i]; n; n = n->next)
+      {
+	count++;
+	strings += strlen(n->name) + 1;
+      }
+  entries = malloc((count ? count : 1) * sizeof(struct nl_db_entry));
+  if (!entries)
+    goto fail;
+  count = strings = 0;
+  for (i = 0; i < HASH_SIZE; i++)
+    for (n = a->nl_hash[i]; n; n = n->next)
+      {
+	entries[count].key = nl_db_key(n->cat, n->id1, n->id2);
+	entries[count].key2 = nl_db_key2(n->id3, n->id4);
+	entries[count].name = strings;
+	strings += strlen(n->name) + 1;
+	count++;
+      }
+  qsort(entries, count, sizeof(struct nl_db_entry), nl_entry_cmp);
+
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, NL_DB_MAGIC, sizeof(h.magic));
+  h.version = NL_DB_VERSION;
+  h.count = count;
+  h.src_size = st.st_size;
+  h.src_mtime = st.st_mtim.tv_sec;
+  h.src_mtime_nsec = st.st_mtim.tv_nsec;
+  h.entries = sizeof(h);
+  h.strings = h.entries + count * sizeof(struct nl_db_entry);
+  /* an empty list still ends in a NUL */
+  h.size = h.strings + (strings ? strings : 1);
+
+  path = db_name(a);
+  tmp = path ? malloc(strlen(path) + 8) : NULL;
+  if (!tmp)
+    goto fail;
+  sprintf(tmp, "%s.XXXXXX", path);
+  fd = mkstemp(tmp);
+  if (fd < 0)
+    goto fail;
+  made = 1;
+  if (write_all(fd, &h, sizeof(h)) ||
+      write_all(fd, entries, count * sizeof(struct nl_db_entry)))
+    goto fail;
+  /* names in the order of the offsets handed out above */
+  for (i = 0; i < HASH_SIZE; i++)
+    for (n = a->nl_hash[i]; n; n = n->next)
+      if (write_all(fd, n->name, strlen(n->name) + 1))
+	goto fail;
+  if (!strings && write_all(fd, "", 1))
+    goto fail;
+  if (fchmod(fd, 0644) || close(fd))
+    {
+      fd = -1;
+      goto fail;
+    }
+  fd = -1;
+  if (rename(tmp, path))
+    goto fail;
+  free(tmp);
+  free(path);
+  free(entries);
+  id_free_name_list(a);
+  return 0;
+
+fail:
+  err = errno;
+  if (fd >= 0)
+    close(fd);
+  if (made)
+    unlink(tmp);
+  free(tmp);
+  free(path);
+  free(entries);
+  id_free_name_list(a);
+  errno = err;
+  return -1;
 }
 
 void
-pci_free_name_list(struct pci_access *a)
+id_free_name_list(struct id_list *a)
 {
   int i = 0;
   struct nl_entry *n = NULL, *temp = NULL;
 
-  free(a->nl_list);
+  if (a->nl_db)
+    munmap(a->nl_db, a->nl_db_size);
+  a->nl_db = NULL;
+  a->nl_db_size = 0;
+
+  if (a->nl_list)
+    munmap(a->nl_list, a->nl_list_size + 1);
   a->nl_list = NULL;
+  a->nl_list_size = 0;
+  free(a->nl_sections);
+  a->nl_sections = NULL;
+  a->nl_section_count = 0;
   if (a->nl_hash != NULL) {
     for (i = 0; i < HASH_SIZE; i++) {
       if (a->nl_hash[i] != NULL) {
@@ -242,70 +685,70 @@ pci_free_name_list(struct pci_access *a)
 }
 
 char *
-pci_lookup_name(struct pci_access *a, char *buf, int size, int flags, unsigned int arg1, unsigned int arg2, unsigned int arg3, unsigned int arg4)
+id_lookup_name(struct id_list *a, char *buf, int size, int flags, unsigned int arg1, unsigned int arg2, unsigned int arg3, unsigned int arg4)
 {
   int num = a->numeric_ids;
   int res;
-  struct nl_entry *n;
+  char *n;
 
-  if (flags & PCI_LOOKUP_NUMERIC)
+  if (flags & ID_LOOKUP_NUMERIC)
     {
-      flags &= PCI_LOOKUP_NUMERIC;
+      flags &= ID_LOOKUP_NUMERIC;
       num = 1;
     }
-  if (!a->nl_hash && !num)
+  if (!a->nl_hash && !a->nl_db && !num)
     {
       load_name_list(a);
       num = a->numeric_ids;
     }
   switch (flags)
     {
-    case PCI_LOOKUP_VENDOR:
+    case ID_LOOKUP_VENDOR:
       if ((n = nl_lookup(a, num, NL_VENDOR, arg1, 0, 0, 0)))
-	return n->name;
+	return n;
       else
 	res = snprintf(buf, size, "%04x", arg1);
       break;
-    case PCI_LOOKUP_DEVICE:
+    case ID_LOOKUP_DEVICE:
       if ((n = nl_lookup(a, num, NL_DEVICE, arg1, arg2, 0, 0)))
-	return n->name;
+	return n;
       else
 	res = snprintf(buf, size, "%04x", arg2);
       break;
-    case PCI_LOOKUP_VENDOR | PCI_LOOKUP_DEVICE:
+    case ID_LOOKUP_VENDOR | ID_LOOKUP_DEVICE:
       if (!num)
 	{
-	  struct nl_entry *e, *e2;
+	  char *e, *e2;
 	  e = nl_lookup(a, 0, NL_VENDOR, arg1, 0, 0, 0);
 	  e2 = nl_lookup(a, 0, NL_DEVICE, arg1, arg2, 0, 0);
 	  if (!e)
 	    res = snprintf(buf, size, "Unknown device %04x:%04x", arg1, arg2);
 	  else if (!e2)
-	    res = snprintf(buf, size, "%s: Unknown device %04x", e->name, arg2);
+	    res = snprintf(buf, size, "%s: Unknown device %04x", e, arg2);
 	  else
-	    res = snprintf(buf, size, "%s %s", e->name, e2->name);
+	    res = snprintf(buf, size, "%s %s", e, e2);
 	}
       else
 	res = snprintf(buf, size, "%04x:%04x", arg1, arg2);
       break;
-    case PCI_LOOKUP_VENDOR | PCI_LOOKUP_SUBSYSTEM:
+    case ID_LOOKUP_VENDOR | ID_LOOKUP_SUBSYSTEM:
       if ((n = nl_lookup(a, num, NL_VENDOR, arg3, 0, 0, 0)))
-	return n->name;
+	return n;
       else
 	res = snprintf(buf, size, "%04x", arg2);
       break;
-    case PCI_LOOKUP_DEVICE | PCI_LOOKUP_SUBSYSTEM:
+    case ID_LOOKUP_DEVICE | ID_LOOKUP_SUBSYSTEM:
       if ((n = nl_lookup(a, num, NL_SUBSYSTEM, arg1, arg2, arg3, arg4)))
-	return n->name;
+	return n;
       else if (arg1 == arg3 && arg2 == arg4 && (n = nl_lookup(a, num, NL_DEVICE, arg1, arg2, 0, 0)))
-	return n->name;
+	return n;
       else
 	res = snprintf(buf, size, "%04x", arg4);
       break;
-    case PCI_LOOKUP_VENDOR | PCI_LOOKUP_DEVICE | PCI_LOOKUP_SUBSYSTEM:
+    case ID_LOOKUP_VENDOR | ID_LOOKUP_DEVICE | ID_LOOKUP_SUBSYSTEM:
       if (!num)
 	{
-	  struct nl_entry *e, *e2;
+	  char *e, *e2;
 	  e = nl_lookup(a, 0, NL_VENDOR, arg3, 0, 0, 0);
 	  e2 = nl_lookup(a, 0, NL_SUBSYSTEM, arg1, arg2, arg3, arg4);
 	  if (!e2 && arg1 == arg3 && arg2 == arg4)
@@ -314,24 +757,24 @@ pci_lookup_name(struct pci_access *a, char *buf, int size, int flags, unsigned i
 	  if (!e)
 	    res = snprintf(buf, size, "Unknown device %04x:%04x", arg3, arg4);
 	  else if (!e2)
-	    res = snprintf(buf, size, "%s: Unknown device %04x", e->name, arg4);
+	    res = snprintf(buf, size, "%s: Unknown device %04x", e, arg4);
 	  else
-	    res = snprintf(buf, size, "%s %s", e->name, e2->name);
+	    res = snprintf(buf, size, "%s %s", e, e2);
 	}
       else
 	res = snprintf(buf, size, "%04x:%04x", arg3, arg4);
       break;
-    case PCI_LOOKUP_CLASS:
+    case ID_LOOKUP_CLASS:
       if ((n = nl_lookup(a, num, NL_SUBCLASS, arg1 >> 8, arg1 & 0xff, 0, 0)))
-	return n->name;
+	return n;
       else if ((n = nl_lookup(a, num, NL_CLASS, arg1, 0, 0, 0)))
-	res = snprintf(buf, size, "%s [%04x]", n->name, arg1);
+	res = snprintf(buf, size, "%s [%04x]", n, arg1);
       else
 	res = snprintf(buf, size, "Class %04x", arg1);
       break;
-    case PCI_LOOKUP_PROGIF:
+    case ID_LOOKUP_PROGIF:
       if ((n = nl_lookup(a, num, NL_PROGIF, arg1 >> 8, arg1 & 0xff, arg2, 0)))
-	return n->name;
+	return n;
       if (arg1 == 0x0101)
 	{
 	  /* IDE controllers have complex prog-if semantics */
@@ -349,7 +792,7 @@ pci_lookup_name(struct pci_access *a, char *buf, int size, int flags, unsigned i
 	}
       return NULL;
     default:
-      return "<pci_lookup_name: invalid request>";
+      return "<id_lookup_name: invalid request>";
     }
     if (res == size)
       return "<too-large>";
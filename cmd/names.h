@@ -1,5 +1,5 @@
 /*
- *      The PCI Library
+ *      The PCI Library -- ID to Name Translation
  *
  *      Copyright (c) 1997--2002 Martin Mares <mj@ucw.cz>
  *
@@ -9,26 +9,36 @@
 #ifndef _NAMES_H_
 #define _NAMES_H_
 
-#define PCI_LOOKUP_VENDOR 1
-#define PCI_LOOKUP_DEVICE 2
-#define PCI_LOOKUP_CLASS 4
-#define PCI_LOOKUP_SUBSYSTEM 8
-#define PCI_LOOKUP_PROGIF 16
-#define PCI_LOOKUP_NUMERIC 0x10000
+/*
+ * Lookups in an ID list in the format of pci.ids. In usb.ids, the device
+ * is the product, and class, subclass and prog-if are the class, subclass
+ * and protocol.
+ */
+#define ID_LOOKUP_VENDOR 1
+#define ID_LOOKUP_DEVICE 2
+#define ID_LOOKUP_CLASS 4
+#define ID_LOOKUP_SUBSYSTEM 8
+#define ID_LOOKUP_PROGIF 16
+#define ID_LOOKUP_NUMERIC 0x10000
 
-#define PCI_VENDOR_ID	0x00
-#define PCI_DEVICE_ID	0x02
+#include <stddef.h>
 
-struct pci_access {
+struct id_list {
         unsigned int numeric_ids;
-        char *pci_id_file_name;
-        char *nl_list;
+        char *id_file_name;
+        char *nl_list;			/* text file, mapped */
+        size_t nl_list_size;
+        struct nl_section *nl_sections;	/* where its blocks are */
+        unsigned int nl_section_count;
         struct nl_entry **nl_hash;
+        char *nl_db;			/* compiled list, mapped */
+        size_t nl_db_size;
 };
 
-extern char *pci_lookup_name(struct pci_access *a, char *buf,
+extern char *id_lookup_name(struct id_list *a, char *buf,
 		int size, int flags, unsigned int arg1, unsigned int arg2,
 		unsigned int arg3, unsigned int arg4);
-extern void pci_free_name_list(struct pci_access *a);
+extern void id_free_name_list(struct id_list *a);
+extern int id_compile_name_list(struct id_list *a);
 
 #endif /* _NAMES_H_ */
@@ -0,0 +1,316 @@
+/*
+ * output.c
+ *
+ * Buffered standard output for systool
+ *
+ * Copyright (C) IBM Corp. 2003-2005
+ *
+ *	This program is free software; you can redistribute it and/or modify it
+ *	under the terms of the GNU General Public License as published by the
+ *	Free Software Foundation version 2 of the License.
+ *
+ *	This program is distributed in the hope that it will be useful, but
+ *	WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *	General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License along
+ *	with this program; if not, write to the Free Software Foundation, Inc.,
+ *	675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/uio.h>
+
+#include "output.h"
+
+#define HEX_ROW(h) \
+	h "0" h "1" h "2" h "3" h "4" h "5" h "6" h "7" \
+	h "8" h "9" h "a" h "b" h "c" h "d" h "e" h "f"
+
+const char hex_pairs[] =
+	HEX_ROW("0") HEX_ROW("1") HEX_ROW("2") HEX_ROW("3")
+	HEX_ROW("4") HEX_ROW("5") HEX_ROW("6") HEX_ROW("7")
+	HEX_ROW("8") HEX_ROW("9") HEX_ROW("a") HEX_ROW("b")
+	HEX_ROW("c") HEX_ROW("d") HEX_ROW("e") HEX_ROW("f");
+
+static char buffer[OUT_BUFFER_SIZE];
+static size_t used;
+static int line_mode;		/* a terminal: hand out every line */
+static int failed;		/* a write failed, the rest is dropped */
+static SYSTOOL_TLS struct out_buf *capture;	/* this thread's, if any */
+
+/**
+ * write_iov: writes all of an iovec array to standard output
+ * @iov: data to write, changed as it is written
+ * @count: number of entries
+ */
+static void write_iov(struct iovec *iov, int count)
+{
+	ssize_t n;
+
+	while (count > 0 && !failed) {
+		n = writev(STDOUT_FILENO, iov, count);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			failed = 1;
+			break;
+		}
+		while (count > 0 && (size_t)n >= iov->iov_len) {
+			n -= iov->iov_len;
+			iov++;
+			count--;
+		}
+		if (count > 0) {
+			iov->iov_base = (char *)iov->iov_base + n;
+			iov->iov_len -= n;
+		}
+	}
+}
+
+/**
+ * capture_room: makes room for more captured output
+ * @len: number of bytes to make room for
+ * returns where to put them or NULL if out of memory
+ */
+static char *capture_room(size_t len)
+{
+	size_t size;
+	char *data;
+
+	if (capture->size - capture->len >= len)
+		return capture->data + capture->len;
+	size = capture->size ? capture->size : 4096;
+	while (size - capture->len < len)
+		size *= 2;
+	data = (char *)realloc(capture->data, size);
+	if (!data)
+		return NULL;
+	capture->data = data;
+	capture->size = size;
+	return data + capture->len;
+}
+
+/**
+ * out_init: sets up standard output; what is buffered is written out
+ * 	when the program exits
+ */
+void out_init(void)
+{
+	line_mode = isatty(STDOUT_FILENO);
+	atexit(out_flush);
+}
+
+/**
+ * out_flush: writes out what is buffered
+ */
+void out_flush(void)
+{
+	struct iovec iov;
+
+	if (used == 0)
+		return;
+	iov.iov_base = buffer;
+	iov.iov_len = used;
+	write_iov(&iov, 1);
+	used = 0;
+}
+
+/**
+ * out_capture: collects what the calling thread writes from now on in a
+ * 	buffer instead of writing it to standard output
+ * @buf: buffer to append to, NULL to write to standard output again
+ */
+void out_capture(struct out_buf *buf)
+{
+	capture = buf;
+}
+
+/**
+ * out_write: writes data to standard output. Data that doesn't fit the
+ * 	buffer goes out with it in one writev().
+ * @data: what to write, need not be NUL terminated
+ * @len: length of data
+ */
+void out_write(const char *data, size_t len)
+{
+	struct iovec iov[2];
+	char *p;
+
+	if (capture) {
+		p = capture_room(len);
+		if (p) {
+			memcpy(p, data, len);
+			capture->len += len;
+		}
+		return;
+	}
+	if (len <= OUT_BUFFER_SIZE - used) {
+		memcpy(buffer + used, data, len);
+		used += len;
+	} else {
+		iov[0].iov_base = buffer;
+		iov[0].iov_len = used;
+		iov[1].iov_base = (void *)data;
+		iov[1].iov_len = len;
+		write_iov(iov, 2);
+		used = 0;
+	}
+	if (line_mode && memchr(data, '\n', len))
+		out_flush();
+}
+
+/**
+ * out_str: writes a NUL terminated string
+ */
+void out_str(const char *str)
+{
+	out_write(str, strlen(str));
+}
+
+/**
+ * out_char: writes a single character
+ */
+void out_char(char c)
+{
+	char *p;
+
+	if (capture) {
+		p = capture_room(1);
+		if (p) {
+			*p = c;
+			capture->len++;
+		}
+		return;
+	}
+	if (used == OUT_BUFFER_SIZE)
+		out_flush();
+	buffer[used++] = c;
+	if (line_mode && c == '\n')
+		out_flush();
+}
+
+/**
+ * out_spaces: writes count spaces
+ */
+void out_spaces(int count)
+{
+	size_t len;
+	char *p;
+
+	if (capture) {
+		p = count > 0 ? capture_room(count) : NULL;
+		if (p) {
+			memset(p, ' ', count);
+			capture->len += count;
+		}
+		return;
+	}
+	while (count > 0) {
+		if (used == OUT_BUFFER_SIZE)
+			out_flush();
+		len = OUT_BUFFER_SIZE - used;
+		if (len > (size_t)count)
+			len = count;
+		memset(buffer + used, ' ', len);
+		used += len;
+		count -= len;
+	}
+}
+
+/**
+ * out_hex: writes data as two lower case hex digits per byte
+ */
+void out_hex(const unsigned char *data, size_t len)
+{
+	size_t i;
+	char *p;
+
+	if (capture) {
+		p = capture_room(2 * len);
+		if (!p)
+			return;
+		for (i = 0; i < len; i++)
+			memcpy(p + 2 * i, hex_pairs + 2 * data[i], 2);
+		capture->len += 2 * len;
+		return;
+	}
+	for (i = 0; i < len; i++) {
+		if (OUT_BUFFER_SIZE - used < 2)
+			out_flush();
+		memcpy(buffer + used, hex_pairs + 2 * data[i], 2);
+		used += 2;
+	}
+}
+
+/**
+ * out_printf: writes formatted text, formatting it in place in the buffer
+ * 	where it fits
+ */
+void out_printf(const char *format, ...)
+{
+	va_list ap;
+	char *vbuf;
+	int len;
+
+	if (capture) {
+		if (!capture_room(1))
+			return;
+		va_start(ap, format);
+		len = vsnprintf(capture->data + capture->len,
+				capture->size - capture->len, format, ap);
+		va_end(ap);
+		if (len < 0)
+			return;
+		if ((size_t)len >= capture->size - capture->len) {
+			if (!capture_room(len + 1))
+				return;
+			va_start(ap, format);
+			vsnprintf(capture->data + capture->len, len + 1,
+					format, ap);
+			va_end(ap);
+		}
+		capture->len += len;
+		return;
+	}
+	va_start(ap, format);
+	len = vsnprintf(buffer + used, OUT_BUFFER_SIZE - used, format, ap);
+	va_end(ap);
+	if (len < 0)
+		return;
+	if ((size_t)len < OUT_BUFFER_SIZE - used) {
+		used += len;
+		if (line_mode && memchr(buffer + used - len, '\n', len))
+			out_flush();
+		return;
+	}
+
+	/* didn't fit, the buffer's tail is scratch space */
+	out_flush();
+	if (len < OUT_BUFFER_SIZE) {
+		va_start(ap, format);
+		vsnprintf(buffer, OUT_BUFFER_SIZE, format, ap);
+		va_end(ap);
+		used = len;
+		if (line_mode && memchr(buffer, '\n', len))
+			out_flush();
+		return;
+	}
+	vbuf = (char *)malloc(len + 1);
+	if (!vbuf)
+		return;
+	va_start(ap, format);
+	vsnprintf(vbuf, len + 1, format, ap);
+	va_end(ap);
+	out_write(vbuf, len);
+	free(vbuf);
+}
@@ -0,0 +1,57 @@
+/*
+ * output.h
+ *
+ * Buffered standard output for systool
+ *
+ * Copyright (C) IBM Corp. 2003-2005
+ *
+ *	This program is free software; you can redistribute it and/or modify it
+ *	under the terms of the GNU General Public License as published by the
+ *	Free Software Foundation version 2 of the License.
+ *
+ *	This program is distributed in the hope that it will be useful, but
+ *	WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *	General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License along
+ *	with this program; if not, write to the Free Software Foundation, Inc.,
+ *	675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#ifndef _OUTPUT_H_
+#define _OUTPUT_H_
+
+#include <stddef.h>
+
+#define OUT_BUFFER_SIZE		65536
+
+#ifdef SYSFS_THREAD_SAFE
+#define SYSTOOL_TLS		__thread
+#else
+#define SYSTOOL_TLS
+#endif
+
+/* output of a thread collected by out_capture() instead of written */
+struct out_buf {
+	char *data;
+	size_t len;
+	size_t size;
+};
+
+/* two lower case hex digits for each byte value, at hex_pairs[2 * byte] */
+extern const char hex_pairs[];
+
+extern void out_init(void);
+extern void out_flush(void);
+extern void out_capture(struct out_buf *buf);
+extern void out_write(const char *data, size_t len);
+extern void out_str(const char *str);
+extern void out_char(char c);
+extern void out_spaces(int count);
+extern void out_hex(const unsigned char *data, size_t len);
+extern void out_printf(const char *format, ...)
+		__attribute__((format(printf, 1, 2)));
+
+#endif /* _OUTPUT_H_ */
@@ -0,0 +1,234 @@
+/*
+ * pci.c
+ *
+ * Reading PCI config space for systool
+ *
+ * Copyright (C) IBM Corp. 2003-2005
+ *
+ *	This program is free software; you can redistribute it and/or modify it
+ *	under the terms of the GNU General Public License as published by the
+ *	Free Software Foundation version 2 of the License.
+ *
+ *	This program is distributed in the hope that it will be useful, but
+ *	WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *	General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License along
+ *	with this program; if not, write to the Free Software Foundation, Inc.,
+ *	675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pci.h"
+
+/*
+ * Only the bytes needed are read from the config attribute: its first
+ * 256 bytes at most, and a few at a time from the extended space, where
+ * a full read would be 4 KiB of config cycles.
+ */
+
+static const char *link_speeds[] = {
+	NULL, "2.5 GT/s", "5.0 GT/s", "8.0 GT/s", "16.0 GT/s", "32.0 GT/s",
+	"64.0 GT/s",
+};
+
+#define NUM_LINK_SPEEDS	(sizeof(link_speeds) / sizeof(link_speeds[0]))
+
+static unsigned int get_word(const unsigned char *buf)
+{
+	return buf[0] | (buf[1] << 8);
+}
+
+static unsigned int get_long(const unsigned char *buf)
+{
+	return get_word(buf) | (get_word(buf + 2) << 16);
+}
+
+/**
+ * open_config: opens a device's config attribute
+ * returns the attribute or NULL if it can't be opened
+ */
+static struct sysfs_attribute *open_config(struct sysfs_device *device)
+{
+	char path[SYSFS_PATH_MAX];
+
+	if (strlen(device->path) + sizeof("/config") > SYSFS_PATH_MAX)
+		return NULL;
+	strcpy(path, device->path);
+	strcat(path, "/config");
+	return sysfs_open_attribute(path);
+}
+
+/**
+ * read_config: reads len bytes of config space at offset
+ * returns 0 on success and -1 if they can't all be read
+ */
+static int read_config(struct sysfs_attribute *config, unsigned int offset,
+		unsigned char *buf, size_t len)
+{
+	ssize_t n;
+
+	n = sysfs_read_attribute_at(config, buf, len, offset);
+	return n == (ssize_t)len ? 0 : -1;
+}
+
+/**
+ * find_capability: walks the capability list in the first 256 bytes of
+ * 	config space
+ * @config: the bytes, as many as could be read
+ * @len: number of bytes
+ * @id: capability ID to look for
+ * returns the capability's offset or 0 if it isn't there
+ */
+static unsigned int find_capability(const unsigned char *config, size_t len,
+		unsigned int id)
+{
+	unsigned int pos, ttl = 48;
+
+	if (len < 64 || !(get_word(config + PCI_STATUS) & PCI_STATUS_CAP_LIST))
+		return 0;
+	if ((config[PCI_HEADER_TYPE] & 0x7f) == 2)
+		pos = config[PCI_CB_CAPABILITY_LIST];
+	else
+		pos = config[PCI_CAPABILITY_LIST];
+	while (ttl-- > 0) {
+		pos &= ~3;
+		if (pos < 64 || pos + 2 > len)
+			break;
+		if (config[pos] == 0xff)
+			break;
+		if (config[pos] == id)
+			return pos;
+		pos = config[pos + 1];
+	}
+	return 0;
+}
+
+/**
+ * find_ext_capability: walks the extended capability list, reading each
+ * 	header on its own
+ * @config: config attribute
+ * @id: extended capability ID to look for
+ * returns the capability's offset or 0 if it isn't there
+ */
+static unsigned int find_ext_capability(struct sysfs_attribute *config,
+		unsigned int id)
+{
+	unsigned char buf[4];
+	unsigned int pos = PCI_STD_CONFIG_SIZE, header;
+	int ttl = (4096 - PCI_STD_CONFIG_SIZE) / 8;
+
+	while (ttl-- > 0 && pos >= PCI_STD_CONFIG_SIZE) {
+		if (read_config(config, pos, buf, sizeof(buf)))
+			break;
+		header = get_long(buf);
+		if (header == 0 || header == 0xffffffff)
+			break;
+		if ((header & 0xffff) == id)
+			return pos;
+		pos = (header >> 20) & 0xffc;
+	}
+	return 0;
+}
+
+/**
+ * pci_read_ids: reads the vendor and device IDs of a PCI device, the
+ * 	first 4 bytes of its config space
+ * returns 0 on success and -1 on error
+ */
+int pci_read_ids(struct sysfs_device *device, unsigned int *vendor_id,
+		unsigned int *device_id)
+{
+	struct sysfs_attribute *config;
+	unsigned char buf[4];
+	int ret;
+
+	config = open_config(device);
+	if (!config)
+		return -1;
+	ret = read_config(config, PCI_VENDOR_ID, buf, sizeof(buf));
+	if (ret == 0) {
+		*vendor_id = get_word(buf + PCI_VENDOR_ID);
+		*device_id = get_word(buf + PCI_DEVICE_ID);
+	}
+	sysfs_close_attribute(config);
+	return ret;
+}
+
+/**
+ * pci_read_info: reads the link, NUMA node and SR-IOV details of a PCI
+ * 	device. What can't be read, such as capabilities past the first
+ * 	64 bytes without privileges, is left out.
+ * returns 0 on success and -1 if the config space can't be read at all
+ */
+int pci_read_info(struct sysfs_device *device, struct pci_info *info)
+{
+	struct sysfs_attribute *config, *attr;
+	unsigned char buf[PCI_STD_CONFIG_SIZE];
+	char path[SYSFS_PATH_MAX], node[16];
+	unsigned int pos;
+	ssize_t len;
+
+	memset(info, 0, sizeof(struct pci_info));
+	info->numa_node = -1;
+	info->total_vfs = -1;
+
+	config = open_config(device);
+	if (!config)
+		return -1;
+	len = sysfs_read_attribute_at(config, buf, sizeof(buf), 0);
+	if (len < 64) {
+		sysfs_close_attribute(config);
+		return -1;
+	}
+	pos = find_capability(buf, len, PCI_CAP_ID_EXP);
+	if (pos && pos + PCI_EXP_LNKSTA + 2 <= (size_t)len) {
+		info->max_link_speed = get_long(buf + pos + PCI_EXP_LNKCAP) & 0xf;
+		info->max_link_width =
+			(get_long(buf + pos + PCI_EXP_LNKCAP) >> 4) & 0x3f;
+		info->link_speed = get_word(buf + pos + PCI_EXP_LNKSTA) & 0xf;
+		info->link_width =
+			(get_word(buf + pos + PCI_EXP_LNKSTA) >> 4) & 0x3f;
+	}
+	/* only PCI Express devices have the extended space */
+	if (pos && (pos = find_ext_capability(config, PCI_EXT_CAP_ID_SRIOV)) &&
+	    read_config(config, pos + PCI_SRIOV_TOTAL_VF, buf, 4) == 0) {
+		info->total_vfs = get_word(buf);
+		info->num_vfs = get_word(buf + 2);
+	}
+	sysfs_close_attribute(config);
+
+	if (strlen(device->path) + sizeof("/numa_node") <= SYSFS_PATH_MAX) {
+		strcpy(path, device->path);
+		strcat(path, "/numa_node");
+		attr = sysfs_open_attribute(path);
+		if (attr) {
+			len = sysfs_read_attribute_at(attr, node,
+					sizeof(node) - 1, 0);
+			if (len > 0) {
+				node[len] = '\0';
+				info->numa_node = atoi(node);
+			}
+			sysfs_close_attribute(attr);
+		}
+	}
+	return 0;
+}
+
+/**
+ * pci_link_speed: names a PCI Express link speed
+ * returns the name or NULL if the speed is unknown
+ */
+const char *pci_link_speed(int speed)
+{
+	if (speed <= 0 || (size_t)speed >= NUM_LINK_SPEEDS)
+		return NULL;
+	return link_speeds[speed];
+}
@@ -0,0 +1,62 @@
+/*
+ * pci.h
+ *
+ * Reading PCI config space for systool
+ *
+ * Copyright (C) IBM Corp. 2003-2005
+ *
+ *	This program is free software; you can redistribute it and/or modify it
+ *	under the terms of the GNU General Public License as published by the
+ *	Free Software Foundation version 2 of the License.
+ *
+ *	This program is distributed in the hope that it will be useful, but
+ *	WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *	General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License along
+ *	with this program; if not, write to the Free Software Foundation, Inc.,
+ *	675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#ifndef _PCI_H_
+#define _PCI_H_
+
+#include "libsysfs.h"
+
+#define PCI_VENDOR_ID		0x00
+#define PCI_DEVICE_ID		0x02
+#define PCI_STATUS		0x06
+#define  PCI_STATUS_CAP_LIST	0x10
+#define PCI_HEADER_TYPE		0x0e
+#define PCI_CAPABILITY_LIST	0x34	/* header types 0 and 1 */
+#define PCI_CB_CAPABILITY_LIST	0x14	/* header type 2, CardBus */
+
+#define PCI_STD_CONFIG_SIZE	256	/* ahead of the extended space */
+
+#define PCI_CAP_ID_EXP		0x10	/* PCI Express */
+#define PCI_EXP_LNKCAP		0x0c
+#define PCI_EXP_LNKSTA		0x12
+
+#define PCI_EXT_CAP_ID_SRIOV	0x10
+#define PCI_SRIOV_TOTAL_VF	0x0e
+#define PCI_SRIOV_NUM_VF	0x10
+
+/* what systool tells about a device besides its attributes */
+struct pci_info {
+	int link_speed;			/* 0 if not PCI Express */
+	int link_width;
+	int max_link_speed;
+	int max_link_width;
+	int numa_node;			/* -1 if unknown */
+	int total_vfs;			/* -1 without SR-IOV */
+	int num_vfs;
+};
+
+extern int pci_read_ids(struct sysfs_device *device, unsigned int *vendor_id,
+		unsigned int *device_id);
+extern int pci_read_info(struct sysfs_device *device, struct pci_info *info);
+extern const char *pci_link_speed(int speed);
+
+#endif /* _PCI_H_ */
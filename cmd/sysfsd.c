@@ -0,0 +1,180 @@
+/*
+ * sysfsd.c
+ *
+ * Daemon keeping a shared snapshot of sysfs for libsysfs clients
+ *
+ * Copyright (C) IBM Corp. 2003-2005
+ *
+ *	This program is free software; you can redistribute it and/or modify it
+ *	under the terms of the GNU General Public License as published by the
+ *	Free Software Foundation version 2 of the License.
+ *
+ *	This program is distributed in the hope that it will be useful, but
+ *	WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *	General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License along
+ *	with this program; if not, write to the Free Software Foundation, Inc.,
+ *	675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <signal.h>
+#include <poll.h>
+#include <errno.h>
+
+#include "libsysfs.h"
+
+#define DEFAULT_INTERVAL	30	/* seconds between snapshots */
+#define SETTLE_MSEC		200	/* quiet time closing a uevent burst */
+
+static char cmd_options[] = "c:fhi:n:";
+
+static volatile sig_atomic_t quit = 0;
+
+/*
+ * usage: prints utility usage.
+ */
+static void usage(void)
+{
+	fprintf(stdout, "Usage: sysfsd [<options>]\n");
+	fprintf(stdout, "\t-c <file>\t\tAlso keep this cache file up to "
+			"date\n");
+	fprintf(stdout, "\t-f\t\t\tStay in the foreground\n");
+	fprintf(stdout, "\t-h\t\t\tShow usage\n");
+	fprintf(stdout, "\t-i <seconds>\t\tPublish at least this often "
+			"(default %d)\n", DEFAULT_INTERVAL);
+	fprintf(stdout, "\t-n <name>\t\tShared memory segment name "
+			"(default %s)\n", SYSFS_SNAPSHOT_NAME);
+}
+
+static void handle_quit(int sig)
+{
+	(void)sig;
+	quit = 1;
+}
+
+/* SIGHUP only needs to interrupt the wait for a new snapshot */
+static void handle_hup(int sig)
+{
+	(void)sig;
+}
+
+/*
+ * drain_events: reads the uevents queued on the monitor. Their contents
+ * don't matter, every snapshot is taken from scratch.
+ */
+static void drain_events(struct sysfs_monitor *mon)
+{
+	struct sysfs_event event;
+
+	while (sysfs_monitor_receive(mon, &event) > 0)
+		;
+}
+
+/*
+ * wait_for_change: sleeps until uevents arrive and stop arriving, a
+ * signal comes in or the interval is over. Returns 1 if uevents arrived.
+ */
+static int wait_for_change(struct sysfs_monitor *mon, int interval)
+{
+	struct pollfd pfd;
+
+	pfd.fd = mon ? sysfs_monitor_get_fd(mon) : -1;
+	pfd.events = POLLIN;
+	if (poll(&pfd, 1, interval * 1000) <= 0 || !mon)
+		return 0;
+	do {
+		drain_events(mon);
+	} while (!quit && poll(&pfd, 1, SETTLE_MSEC) > 0);
+	return 1;
+}
+
+int main(int argc, char *argv[])
+{
+	struct sysfs_snapshot *snap;
+	struct sysfs_monitor *mon;
+	struct sigaction sa;
+	const char *name = SYSFS_SNAPSHOT_NAME, *cache = NULL;
+	int foreground = 0, interval = DEFAULT_INTERVAL;
+	int opt, changed = 1;
+
+	while((opt = getopt(argc, argv, cmd_options)) != EOF) {
+		switch(opt) {
+		case 'c':
+			cache = optarg;
+			break;
+		case 'f':
+			foreground = 1;
+			break;
+		case 'h':
+			usage();
+			exit(0);
+			break;
+		case 'i':
+			interval = atoi(optarg);
+			if (interval <= 0) {
+				fprintf(stderr, "Invalid interval %s\n",
+						optarg);
+				exit(1);
+			}
+			break;
+		case 'n':
+			name = optarg;
+			break;
+		default:
+			usage();
+			exit(1);
+		}
+	}
+	if (optind < argc) {
+		usage();
+		exit(1);
+	}
+
+	snap = sysfs_open_snapshot(name);
+	if (!snap) {
+		fprintf(stderr, "Error creating snapshot %s: %s\n", name,
+				strerror(errno));
+		exit(1);
+	}
+	mon = sysfs_open_monitor();
+	if (!mon)
+		fprintf(stderr, "No uevents, taking a snapshot every %d "
+				"seconds only\n", interval);
+	if (!foreground && daemon(0, 0)) {
+		fprintf(stderr, "Error detaching: %s\n", strerror(errno));
+		sysfs_close_monitor(mon);
+		sysfs_close_snapshot(snap);
+		exit(1);
+	}
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = handle_quit;
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+	sa.sa_handler = handle_hup;
+	sigaction(SIGHUP, &sa, NULL);
+
+	while (!quit) {
+		if (sysfs_publish_snapshot(snap))
+			fprintf(stderr, "Error taking snapshot: %s\n",
+					strerror(errno));
+		/* the cache holds static values only, uevents are enough */
+		if (cache && changed && sysfs_write_cache(cache))
+			fprintf(stderr, "Error writing cache file %s: %s\n",
+					cache, strerror(errno));
+		changed = wait_for_change(mon, interval);
+	}
+
+	sysfs_close_monitor(mon);
+	sysfs_close_snapshot(snap);
+	exit(0);
+}
@@ -31,9 +31,20 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <ctype.h>
+#include <getopt.h>
+#include <time.h>
+#include <sys/resource.h>
+#include <regex.h>
+#ifdef SYSFS_THREAD_SAFE
+#include <pthread.h>
+#endif
 
 #include "libsysfs.h"
 #include "names.h"
+#include "pci.h"
+#include "json.h"
+#include "table.h"
+#include "output.h"
 
 extern char *my_strncpy(char *to, const char *from, size_t max);
 #define safestrcpy(to, from)		my_strncpy(to, from, sizeof(to))
@@ -50,12 +61,29 @@ do { \
 
 /* Command Options */
 static int show_options = 0;		/* bitmask of show options */
-static char *attribute_to_show = NULL;	/* show value for this attribute */
+static const char **attribute_names;	/* show values of these, -A */
+static int attribute_count;
 static char *device_to_show = NULL;	/* show only this bus device */
+static struct device_match *matches;	/* show only matching devices */
+static int match_count;
 static char sysfs_mnt_path[SYSFS_PATH_MAX]; /* sysfs mount point */
-struct pci_access *pacc = NULL;
+static int output_format = 0;		/* JSON_ARRAY, JSON_LINES or 0 */
+static SYSTOOL_TLS struct json_writer json; /* for --format=json/ndjson */
+static int table_format = 0;		/* TABLE_COLUMNS, TABLE_CSV or 0 */
+static SYSTOOL_TLS struct table_writer table; /* for --format=table/csv */
+static int jobs = 0;			/* threads showing objects, -j */
+static int show_pci = 0;		/* PCI link and more, --pci-info */
+static double watch_interval = 0;	/* seconds between reads, -w */
+struct id_list *bus_ids = NULL;		/* names devices of show_bus */
 char *show_bus = NULL;
 
+/* a --match, handed to the iterators so others are never opened */
+struct device_match {
+	const char *key;
+	const char *pattern;
+	unsigned int flags;		/* SYSFS_MATCH_* */
+};
+
 static void show_device(struct sysfs_device *device, int level);
 static void show_class_device(struct sysfs_class_device *dev, int level);
 
@@ -70,7 +98,24 @@ static void show_class_device(struct sysfs_class_device *dev, int level);
 
 #define SHOW_ALL		0xff
 
-static char cmd_options[] = "aA:b:c:dDhm:pP:v";
+static char cmd_options[] = "aA:b:c:dDhj:m:pP:vw:";
+
+#define OPT_FORMAT		256
+#define OPT_COMPILE_IDS		257
+#define OPT_TABLE		258
+#define OPT_CSV			259
+#define OPT_MATCH		260
+#define OPT_PCI_INFO		261
+
+static struct option long_options[] = {
+	{ "format",	required_argument,	NULL,	OPT_FORMAT },
+	{ "compile-ids", no_argument,		NULL,	OPT_COMPILE_IDS },
+	{ "table",	no_argument,		NULL,	OPT_TABLE },
+	{ "csv",	no_argument,		NULL,	OPT_CSV },
+	{ "match",	required_argument,	NULL,	OPT_MATCH },
+	{ "pci-info",	no_argument,		NULL,	OPT_PCI_INFO },
+	{ NULL,		0,			NULL,	0 }
+};
 
 /*
  * binary_files - defines existing sysfs binary files. These files will be
@@ -83,11 +128,98 @@ static char *binary_files[] = {
 
 static int binfiles = 2;
 
-static unsigned int get_pciconfig_word(int offset, unsigned char *buf)
+/*
+ * id_files - ID lists naming the devices of the buses that have one
+ */
+static struct id_file {
+	const char *bus;
+	char *path;
+} id_files[] = {
+	{ "pci", PCI_IDS_PATHNAME },
+	{ "usb", USB_IDS_PATHNAME },
+};
+
+#define NUM_ID_FILES	(sizeof(id_files) / sizeof(id_files[0]))
+
+#ifdef SYSFS_THREAD_SAFE
+static pthread_mutex_t names_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+/**
+ * read_hex_attribute: reads a device attribute holding a hex number
+ * @device: device to read it from
+ * @name: attribute name
+ * @val: where to put the number
+ * returns 0 on success and -1 on error
+ */
+static int read_hex_attribute(struct sysfs_device *device, const char *name,
+		unsigned int *val)
+{
+	struct sysfs_attribute *attr;
+	char path[SYSFS_PATH_MAX], *end;
+	int ret = -1;
+
+	safestrcpy(path, device->path);
+	safestrcat(path, "/");
+	safestrcat(path, name);
+	attr = sysfs_open_attribute(path);
+	if (!attr)
+		return -1;
+	if (!sysfs_read_attribute(attr)) {
+		*val = strtoul(attr->value, &end, 16);
+		if (end != attr->value && (*end == '\n' || *end == '\0'))
+			ret = 0;
+	}
+	sysfs_close_attribute(attr);
+	return ret;
+}
+
+/**
+ * read_device_ids: reads the vendor and device ids of a device on a bus
+ * 	with an ID list
+ * @device: device to read them from
+ * returns 0 on success and -1 if the device has none or they can't be read
+ */
+static int read_device_ids(struct sysfs_device *device,
+		unsigned int *vendor_id, unsigned int *device_id)
+{
+	if (strcmp(show_bus, "usb") == 0) {
+		/* interfaces have neither */
+		if (read_hex_attribute(device, "idVendor", vendor_id) ||
+		    read_hex_attribute(device, "idProduct", device_id))
+			return -1;
+		return 0;
+	}
+	return pci_read_ids(device, vendor_id, device_id);
+}
+
+/**
+ * device_description: looks up the vendor and device name of a device in
+ * 	the ID list of its bus. The list is loaded on first use, so lookups
+ * 	are serialized.
+ * @device: device to name
+ * @buf: where to put the name
+ * @size: size of buf
+ * returns the name or NULL if the device's ids can't be read
+ */
+static char *device_description(struct sysfs_device *device, char *buf,
+		int size)
 {
-        unsigned short val = (unsigned char)buf[offset] |
-	                ((unsigned char)buf[offset+1] << 8);
-        return val;
+	unsigned int vendor_id, device_id;
+	char *name;
+
+	if (read_device_ids(device, &vendor_id, &device_id))
+		return NULL;
+#ifdef SYSFS_THREAD_SAFE
+	pthread_mutex_lock(&names_lock);
+#endif
+	name = id_lookup_name(bus_ids, buf, size,
+			ID_LOOKUP_VENDOR | ID_LOOKUP_DEVICE,
+			vendor_id, device_id, 0, 0);
+#ifdef SYSFS_THREAD_SAFE
+	pthread_mutex_unlock(&names_lock);
+#endif
+	return name;
 }
 
 /**
@@ -95,18 +227,31 @@ static unsigned int get_pciconfig_word(int offset, unsigned char *buf)
  */
 static void usage(void)
 {
-	fprintf(stdout, "Usage: systool [<options> [device]]\n");
-	fprintf(stdout, "\t-a\t\t\tShow attributes\n");
-	fprintf(stdout, "\t-b <bus_name>\t\tShow a specific bus\n");
-	fprintf(stdout, "\t-c <class_name>\t\tShow a specific class\n");
-	fprintf(stdout, "\t-d\t\t\tShow only devices\n");
-	fprintf(stdout, "\t-h\t\t\tShow usage\n");
-	fprintf(stdout, "\t-m <module_name>\tShow a specific module\n");
-	fprintf(stdout, "\t-p\t\t\tShow path to device/driver\n");
-	fprintf(stdout, "\t-v\t\t\tShow all attributes with values\n");
-	fprintf(stdout, "\t-A <attribute_name>\tShow attribute value\n");
-	fprintf(stdout, "\t-D\t\t\tShow only drivers\n");
-	fprintf(stdout, "\t-P\t\t\tShow device's parent\n");
+	out_str("Usage: systool [<options> [device]]\n");
+	out_str("\t-a\t\t\tShow attributes\n");
+	out_str("\t-b <bus_name>\t\tShow a specific bus\n");
+	out_str("\t-c <class_name>\t\tShow a specific class\n");
+	out_str("\t-d\t\t\tShow only devices\n");
+	out_str("\t-h\t\t\tShow usage\n");
+	out_str("\t-j <jobs>\t\tShow objects with jobs threads\n");
+	out_str("\t-m <module_name>\tShow a specific module\n");
+	out_str("\t-p\t\t\tShow path to device/driver\n");
+	out_str("\t-v\t\t\tShow all attributes with values\n");
+	out_str("\t-w <seconds>\t\tShow attribute changes every seconds\n");
+	out_str("\t-A <names>\t\tShow attribute values, names separated "
+			"by commas\n");
+	out_str("\t-D\t\t\tShow only drivers\n");
+	out_str("\t-P\t\t\tShow device's parent\n");
+	out_str("\t--format=<format>\tOutput text (default), json, "
+			"ndjson, table or csv\n");
+	out_str("\t--table, --csv\t\tShow -A attributes as a table\n");
+	out_str("\t--match <key>=<glob>\tShow only devices whose name, "
+			"link or attribute\n\t\t\t\tkey matches, "
+			"<key>~<regex> for a regex\n");
+	out_str("\t--pci-info\t\tShow PCI devices' link, NUMA node and "
+			"SR-IOV VFs\n");
+	out_str("\t--compile-ids\t\tCompile the PCI and USB ID databases "
+			"for faster lookups\n");
 }
 
 /**
@@ -116,10 +261,7 @@ static void usage(void)
  */
 static void indent(int level)
 {
-	int i;
-
-	for (i = 0; i < level; i++)
-		fprintf(stdout, " ");
+	out_spaces(level);
 }
 
 /**
@@ -164,26 +306,169 @@ static void show_attribute_value(struct sysfs_attribute *attr, int level)
 
 	if (attr->method & SYSFS_METHOD_SHOW) {
 		if (isbinaryvalue(attr)) {
-			int i;
+			/* " xx" per byte, a gap after eight, 16 to a line */
+			char line[16 * 3 + 2];
+			unsigned char byte;
+			int i, len = 0;
+
 			for (i = 0; i < attr->len; i++) {
 				if (!(i % 16) && (i != 0)) {
-					fprintf(stdout, "\n");
+					line[len++] = '\n';
+					out_write(line, len);
 					indent(level+22);
+					len = 0;
 				} else if (!(i % 8) && (i != 0))
-					fprintf(stdout, " ");
-				fprintf(stdout, " %02x",
-					(unsigned char)attr->value[i]);
+					line[len++] = ' ';
+				byte = (unsigned char)attr->value[i];
+				line[len++] = ' ';
+				line[len++] = hex_pairs[2 * byte];
+				line[len++] = hex_pairs[2 * byte + 1];
 			}
-			fprintf(stdout, "\n");
+			line[len++] = '\n';
+			out_write(line, len);
 
 		} else if (attr->value && strlen(attr->value) > 0) {
 			remove_end_newline(attr->value);
-			fprintf(stdout, "\"%s\"\n", attr->value);
+			out_char('"');
+			out_str(attr->value);
+			out_str("\"\n");
 		} else
-			fprintf(stdout, "\n");
+			out_char('\n');
 	} else {
-		fprintf(stdout, "<store method only>\n");
+		out_str("<store method only>\n");
+	}
+}
+
+/**
+ * attribute_requested: tells whether an attribute was named with -A
+ * @name: attribute name
+ */
+static int attribute_requested(const char *name)
+{
+	int i;
+
+	for (i = 0; i < attribute_count; i++)
+		if (strcmp(name, attribute_names[i]) == 0)
+			return 1;
+	return 0;
+}
+
+/**
+ * add_attribute_names: adds the comma separated attribute names of a -A
+ * @list: names, split up in place
+ * returns 0 with success and -1 with error
+ */
+static int add_attribute_names(char *list)
+{
+	const char **names;
+	char *name;
+
+	for (name = strtok(list, ","); name; name = strtok(NULL, ",")) {
+		if ((strlen(name) + 1) > SYSFS_NAME_LEN) {
+			fprintf(stderr, "Attribute name %s is too long\n",
+					name);
+			return -1;
+		}
+		if (attribute_requested(name))
+			continue;
+		names = (const char **)realloc(attribute_names,
+				(attribute_count + 2) * sizeof(char *));
+		if (!names) {
+			fprintf(stderr, "Out of memory\n");
+			return -1;
+		}
+		attribute_names = names;
+		attribute_names[attribute_count++] = name;
+		attribute_names[attribute_count] = NULL;
+	}
+	if (!attribute_count) {
+		fprintf(stderr, "No attribute name given\n");
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * add_match: adds a --match filter
+ * @arg: key=glob or key~regex, split up in place
+ * returns 0 with success and -1 with error
+ */
+static int add_match(char *arg)
+{
+	struct device_match *m;
+	regex_t regex;
+	size_t len;
+
+	len = strcspn(arg, "=~");
+	if (!len || !arg[len] || len >= SYSFS_NAME_LEN ||
+	    memchr(arg, '/', len)) {
+		fprintf(stderr, "Invalid match %s\n", arg);
+		return -1;
+	}
+	m = (struct device_match *)realloc(matches,
+			(match_count + 1) * sizeof(struct device_match));
+	if (!m) {
+		fprintf(stderr, "Out of memory\n");
+		return -1;
+	}
+	matches = m;
+	m = &matches[match_count];
+	m->flags = arg[len] == '~' ? SYSFS_MATCH_REGEX : SYSFS_MATCH_GLOB;
+	arg[len] = '\0';
+	m->key = arg;
+	m->pattern = arg + len + 1;
+	/* checked here, not once per bus or class */
+	if (m->flags & SYSFS_MATCH_REGEX) {
+		if (regcomp(&regex, m->pattern, REG_EXTENDED | REG_NOSUB)) {
+			fprintf(stderr, "Invalid regular expression %s\n",
+					m->pattern);
+			return -1;
+		}
+		regfree(&regex);
 	}
+	match_count++;
+	return 0;
+}
+
+/**
+ * filter_devices: limits a device or class device iterator to the device
+ * 	named on the command line and to --match, so that the library
+ * 	skips other entries before opening them
+ * @iter: iterator, closed on error
+ * returns the iterator with success and NULL with error
+ */
+static struct sysfs_iter *filter_devices(struct sysfs_iter *iter)
+{
+	char pattern[2 * SYSFS_NAME_LEN], *p;
+	const char *c;
+	int i;
+
+	if (!iter)
+		return NULL;
+	if (device_to_show) {
+		/* an exact name, so no glob characters */
+		p = pattern;
+		for (c = device_to_show; *c; c++) {
+			if (strchr("*?[\\", *c))
+				*p++ = '\\';
+			*p++ = *c;
+		}
+		*p = '\0';
+		if (sysfs_iter_add_match(iter, SYSFS_NAME_ATTRIBUTE, pattern,
+					SYSFS_MATCH_GLOB))
+			goto error;
+	}
+	for (i = 0; i < match_count; i++) {
+		if (sysfs_iter_add_match(iter, matches[i].key,
+					matches[i].pattern, matches[i].flags))
+			goto error;
+	}
+	return iter;
+
+error:
+	fprintf(stderr, "Unable to filter devices: %s\n", strerror(errno));
+	sysfs_close_iter(iter);
+	return NULL;
 }
 
 /**
@@ -197,22 +482,34 @@ static void show_attribute(struct sysfs_attribute *attr, int level)
 
 	if (show_options & SHOW_ALL_ATTRIB_VALUES) {
 		indent(level);
-		fprintf(stdout, "%-20s= ", attr->name);
+		out_printf("%-20s= ", attr->name);
 		show_attribute_value(attr, level);
 	} else if ((show_options & SHOW_ATTRIBUTES) || ((show_options
-	    & SHOW_ATTRIBUTE_VALUE) && (strcmp(attr->name, attribute_to_show)
-	    == 0))) {
+	    & SHOW_ATTRIBUTE_VALUE) && attribute_requested(attr->name))) {
 		indent(level);
-		fprintf (stdout, "%-20s", attr->name);
+		out_printf("%-20s", attr->name);
 		if (show_options & SHOW_ATTRIBUTE_VALUE && attr->value
-		    != NULL && (strcmp(attr->name, attribute_to_show)) == 0) {
-			fprintf(stdout, "= ");
+		    != NULL && attribute_requested(attr->name)) {
+			out_str("= ");
 			show_attribute_value(attr, level);
 		} else
-			fprintf(stdout, "\n");
+			out_char('\n');
 	}
 }
 
+/**
+ * attribute_projection: with only -A given there is no need to read all
+ * 	attributes of an object, just the ones that are to be shown.
+ * returns the names to read or NULL if all attributes are needed.
+ */
+static const char * const *attribute_projection(void)
+{
+	if ((show_options & SHOW_ATTRIBUTE_VALUE) && !(show_options
+	    & (SHOW_ATTRIBUTES | SHOW_ALL_ATTRIB_VALUES)))
+		return attribute_names;
+	return NULL;
+}
+
 /**
  * show_attributes: prints out a list of attributes.
  * @attributes: print this dlist of attributes/files.
@@ -221,8 +518,9 @@ static void show_attributes(struct dlist *attributes, int level)
 {
 	if (attributes) {
 		struct sysfs_attribute *cur;
+		struct dl_node *node;
 
-		dlist_for_each_data(attributes, cur,
+		dlist_for_each_data_nomark(attributes, node, cur,
 				struct sysfs_attribute) {
 			show_attribute(cur, level);
 		}
@@ -239,13 +537,46 @@ static void show_device_parent(struct sysfs_device *device, int level)
 
 	parent = sysfs_get_device_parent(device);
 	if (parent) {
-		fprintf(stdout, "\n");
+		out_char('\n');
 		indent(level);
-		fprintf(stdout, "Device \"%s\"'s parent\n", device->name);
+		out_printf("Device \"%s\"'s parent\n", device->name);
 		show_device(parent, (level+2));
 	}
 }
 
+/**
+ * show_pci_info: prints what a PCI device's config space tells besides
+ * 	its attributes: its PCI Express link, NUMA node and SR-IOV VFs
+ * @device: PCI device
+ * @level: indentation
+ */
+static void show_pci_info(struct sysfs_device *device, int level)
+{
+	struct pci_info info;
+	const char *speed, *max_speed;
+
+	if (pci_read_info(device, &info))
+		return;
+	speed = pci_link_speed(info.link_speed);
+	if (speed) {
+		max_speed = pci_link_speed(info.max_link_speed);
+		indent(level);
+		out_printf("Link = \"%s x%d (max %s x%d)\"\n", speed,
+				info.link_width,
+				max_speed ? max_speed : "unknown",
+				info.max_link_width);
+	}
+	if (info.numa_node >= 0) {
+		indent(level);
+		out_printf("NUMA node = \"%d\"\n", info.numa_node);
+	}
+	if (info.total_vfs >= 0) {
+		indent(level);
+		out_printf("SR-IOV VFs = \"%d of %d\"\n", info.num_vfs,
+				info.total_vfs);
+	}
+}
+
 /**
  * show_device: prints out device information.
  * @device: device to print.
@@ -253,47 +584,31 @@ static void show_device_parent(struct sysfs_device *device, int level)
 static void show_device(struct sysfs_device *device, int level)
 {
 	struct dlist *attributes;
-        unsigned int vendor_id, device_id;
-        char buf[128], value[256], path[SYSFS_PATH_MAX];
+	char buf[128], *name;
 
 	if (device) {
 		indent(level);
-		if (show_bus && (!(strcmp(show_bus, "pci")))) {
-			fprintf(stdout, "%s ", device->bus_id);
-			memset(path, 0, SYSFS_PATH_MAX);
-			memset(value, 0, SYSFS_PATH_MAX);
-			safestrcpy(path, device->path);
-			safestrcat(path, "/config");
-			struct sysfs_attribute *attr;
-			attr = sysfs_open_attribute(path);
-			if (attr) {
-				if (!sysfs_read_attribute(attr)) {
-					vendor_id = get_pciconfig_word(PCI_VENDOR_ID,
-						       	(unsigned char *)attr->value);
-					device_id = get_pciconfig_word(PCI_DEVICE_ID,
-						       	(unsigned char *)attr->value);
-					fprintf(stdout, "%s\n",
-						pci_lookup_name(pacc,
-						buf, 128,
-						PCI_LOOKUP_VENDOR |
-						PCI_LOOKUP_DEVICE,
-						vendor_id, device_id, 0, 0));
-				}
-				sysfs_close_attribute(attr);
-			} else
-				fprintf(stdout, "\n");
+		if (bus_ids) {
+			name = device_description(device, buf, sizeof(buf));
+			out_printf("%s %s\n", device->bus_id, name ? name : "");
 		} else
-			fprintf(stdout, "Device = \"%s\"\n", device->bus_id);
+			out_printf("Device = \"%s\"\n", device->bus_id);
 
 		if (show_options & (SHOW_PATH | SHOW_ALL_ATTRIB_VALUES)) {
 			indent(level);
-			fprintf(stdout, "Device path = \"%s\"\n",
+			out_printf("Device path = \"%s\"\n",
 							device->path);
 		}
+		if (show_pci && show_bus && strcmp(show_bus, "pci") == 0)
+			show_pci_info(device, level);
 
 		if (show_options & (SHOW_ATTRIBUTES | SHOW_ATTRIBUTE_VALUE |
 					SHOW_ALL_ATTRIB_VALUES)) {
-			attributes = sysfs_get_device_attributes(device);
+			if (attribute_projection())
+				attributes = sysfs_get_device_attrs(device,
+						attribute_projection());
+			else
+				attributes = sysfs_get_device_attributes(device);
 			if (attributes)
 				show_attributes(attributes, (level+2));
 		}
@@ -304,7 +619,7 @@ static void show_device(struct sysfs_device *device, int level)
 		}
 		if (show_options ^ SHOW_DEVICES)
 			if (!(show_options & SHOW_DRIVERS))
-				fprintf(stdout, "\n");
+				out_char('\n');
 	}
 }
 
@@ -320,12 +635,13 @@ static void show_driver_attributes(struct sysfs_driver *driver, int level)
 		attributes = sysfs_get_driver_attributes(driver);
 		if (attributes) {
 			struct sysfs_attribute *cur;
+			struct dl_node *node;
 
-			dlist_for_each_data(attributes, cur,
+			dlist_for_each_data_nomark(attributes, node, cur,
 					struct sysfs_attribute) {
 				show_attribute(cur, (level));
 			}
-			fprintf(stdout, "\n");
+			out_char('\n');
 		}
 	}
 }
@@ -340,10 +656,10 @@ static void show_driver(struct sysfs_driver *driver, int level)
 
 	if (driver) {
 		indent(level);
-		fprintf(stdout, "Driver = \"%s\"\n", driver->name);
+		out_printf("Driver = \"%s\"\n", driver->name);
 		if (show_options & (SHOW_PATH | SHOW_ALL_ATTRIB_VALUES)) {
 			indent(level);
-			fprintf(stdout, "Driver path = \"%s\"\n",
+			out_printf("Driver path = \"%s\"\n",
 							driver->path);
 		}
 		if (show_options & (SHOW_ATTRIBUTES | SHOW_ATTRIBUTE_VALUE
@@ -352,25 +668,574 @@ static void show_driver(struct sysfs_driver *driver, int level)
 		devlist = sysfs_get_driver_devices(driver);
 		if (devlist) {
 			struct sysfs_device *cur;
+			struct dl_node *node;
 
 			indent(level+2);
-			fprintf(stdout, "Devices using \"%s\" are:\n",
+			out_printf("Devices using \"%s\" are:\n",
 								driver->name);
-			dlist_for_each_data(devlist, cur,
+			dlist_for_each_data_nomark(devlist, node, cur,
 					struct sysfs_device) {
 				if (show_options & SHOW_DRIVERS) {
 					show_device(cur, (level+4));
-					fprintf(stdout, "\n");
+					out_char('\n');
 				} else {
 					indent(level+4);
-					fprintf(stdout, "\"%s\"\n", cur->name);
+					out_printf("\"%s\"\n", cur->name);
 				}
 			}
 		}
-		fprintf(stdout, "\n");
+		out_char('\n');
 	}
 }
 
+/**
+ * json_attribute: writes an attribute as a member of an object. The same
+ * 	options as for text decide which attributes are there and which
+ * 	have their value; the others are null.
+ * @attr: attribute to write
+ */
+static void json_attribute(struct sysfs_attribute *attr)
+{
+	int value;
+
+	if (!attr)
+		return;
+	if (show_options & SHOW_ALL_ATTRIB_VALUES)
+		value = 1;
+	else if ((show_options & SHOW_ATTRIBUTE_VALUE) &&
+			attribute_requested(attr->name))
+		value = 1;
+	else if (show_options & SHOW_ATTRIBUTES)
+		value = 0;
+	else
+		return;
+	if (value && (attr->method & SYSFS_METHOD_SHOW))
+		json_value(&json, attr->name, attr->value, attr->len,
+							isbinaryvalue(attr));
+	else
+		json_string(&json, attr->name, NULL);
+}
+
+/**
+ * json_attributes: writes a list of attributes as an object
+ * @key: member name
+ * @attributes: list of sysfs_attribute, may be NULL
+ */
+static void json_attributes(const char *key, struct dlist *attributes)
+{
+	struct sysfs_attribute *cur;
+	struct dl_node *node;
+
+	json_object_start(&json, key);
+	if (attributes) {
+		dlist_for_each_data_nomark(attributes, node, cur,
+				struct sysfs_attribute) {
+			json_attribute(cur);
+		}
+	}
+	json_object_end(&json);
+}
+
+/* a name, or null if the library doesn't know of one */
+static void json_name(const char *key, const char *name)
+{
+	if (name && (!*name || strcmp(name, SYSFS_UNKNOWN) == 0))
+		name = NULL;
+	json_string(&json, key, name);
+}
+
+/**
+ * json_number: writes a member holding a number, as a string like the
+ * 	attribute values
+ */
+static void json_number(const char *key, int value)
+{
+	char buf[16];
+
+	snprintf(buf, sizeof(buf), "%d", value);
+	json_string(&json, key, buf);
+}
+
+/**
+ * json_pci_info: writes what show_pci_info() prints as a "pci" object
+ * @device: PCI device
+ */
+static void json_pci_info(struct sysfs_device *device)
+{
+	struct pci_info info;
+	const char *speed;
+
+	if (pci_read_info(device, &info))
+		return;
+	speed = pci_link_speed(info.link_speed);
+	if (!speed && info.numa_node < 0 && info.total_vfs < 0)
+		return;
+	json_object_start(&json, "pci");
+	if (speed) {
+		json_string(&json, "link_speed", speed);
+		json_number("link_width", info.link_width);
+		json_string(&json, "max_link_speed",
+				pci_link_speed(info.max_link_speed));
+		json_number("max_link_width", info.max_link_width);
+	}
+	if (info.numa_node >= 0)
+		json_number("numa_node", info.numa_node);
+	if (info.total_vfs >= 0) {
+		json_number("sriov_total_vfs", info.total_vfs);
+		json_number("sriov_num_vfs", info.num_vfs);
+	}
+	json_object_end(&json);
+}
+
+/**
+ * json_device: writes a device's members into the current object
+ * @device: device to write
+ */
+static void json_device(struct sysfs_device *device)
+{
+	struct sysfs_device *parent;
+	char buf[128], *name;
+	struct dlist *attributes;
+
+	json_string(&json, "name", device->bus_id);
+	json_string(&json, "path", device->path);
+	json_name("subsystem", sysfs_get_device_subsystem(device));
+	json_name("driver", sysfs_get_device_driver_name(device));
+	if (bus_ids) {
+		name = device_description(device, buf, sizeof(buf));
+		if (name)
+			json_string(&json, "description", name);
+	}
+	if (show_bus && strcmp(show_bus, "pci") == 0 && (show_pci ||
+			(show_options & SHOW_ALL_ATTRIB_VALUES)))
+		json_pci_info(device);
+	if (show_options & (SHOW_ATTRIBUTES | SHOW_ATTRIBUTE_VALUE |
+				SHOW_ALL_ATTRIB_VALUES)) {
+		if (attribute_projection())
+			attributes = sysfs_get_device_attrs(device,
+					attribute_projection());
+		else
+			attributes = sysfs_get_device_attributes(device);
+		json_attributes("attributes", attributes);
+	}
+	if ((device_to_show) && (show_options & SHOW_PARENT)) {
+		show_options &= ~SHOW_PARENT;
+		parent = sysfs_get_device_parent(device);
+		if (parent) {
+			json_object_start(&json, "parent");
+			json_device(parent);
+			json_object_end(&json);
+		}
+	}
+}
+
+/**
+ * json_driver: writes a driver's members into the current object
+ * @driver: driver to write
+ */
+static void json_driver(struct sysfs_driver *driver)
+{
+	struct sysfs_device *cur;
+	struct dl_node *node;
+	struct dlist *devlist;
+
+	json_string(&json, "name", driver->name);
+	json_string(&json, "path", driver->path);
+	json_name("bus", driver->bus);
+	if (show_options & (SHOW_ATTRIBUTES | SHOW_ATTRIBUTE_VALUE
+		    | SHOW_ALL_ATTRIB_VALUES))
+		json_attributes("attributes",
+				sysfs_get_driver_attributes(driver));
+	json_array_start(&json, "devices");
+	devlist = sysfs_get_driver_devices(driver);
+	if (devlist) {
+		dlist_for_each_data_nomark(devlist, node, cur,
+				struct sysfs_device) {
+			json_object_start(&json, NULL);
+			json_device(cur);
+			json_object_end(&json);
+		}
+	}
+	json_array_end(&json);
+}
+
+/**
+ * json_class_device: writes a class device's members into the current
+ * 	object
+ * @dev: class device to write
+ */
+static void json_class_device(struct sysfs_class_device *dev)
+{
+	struct sysfs_class_device *parent;
+	struct sysfs_device *device;
+	struct dlist *attributes;
+
+	json_string(&json, "name", dev->name);
+	json_string(&json, "path", dev->path);
+	json_name("class", dev->classname);
+	if (show_options & (SHOW_ATTRIBUTES | SHOW_ATTRIBUTE_VALUE
+	    | SHOW_ALL_ATTRIB_VALUES)) {
+		if (attribute_projection())
+			attributes = sysfs_get_classdev_attrs(dev,
+					attribute_projection());
+		else
+			attributes = sysfs_get_classdev_attributes(dev);
+		json_attributes("attributes", attributes);
+	}
+	if (show_options & (SHOW_DEVICES | SHOW_ALL_ATTRIB_VALUES)) {
+		device = sysfs_get_classdev_device(dev);
+		if (device) {
+			json_object_start(&json, "device");
+			json_device(device);
+			json_object_end(&json);
+		}
+	}
+	if ((device_to_show) && (show_options & SHOW_PARENT)) {
+		show_options &= ~SHOW_PARENT;
+		parent = sysfs_get_classdev_parent(dev);
+		if (parent) {
+			json_object_start(&json, "parent");
+			json_class_device(parent);
+			json_object_end(&json);
+		}
+	}
+}
+
+/**
+ * json_module: writes a module as a record
+ * @mod: module to write
+ */
+static void json_module(struct sysfs_module *mod)
+{
+	struct dlist *attributes;
+
+	json_record_start(&json, "module");
+	json_string(&json, "name", mod->name);
+	json_string(&json, "path", mod->path);
+	if (show_options & (SHOW_ATTRIBUTES | SHOW_ATTRIBUTE_VALUE
+	    | SHOW_ALL_ATTRIB_VALUES)) {
+		if (attribute_projection())
+			attributes = sysfs_get_module_attrs(mod,
+					attribute_projection());
+		else
+			attributes = sysfs_get_module_attributes(mod);
+		json_attributes("attributes", attributes);
+		json_attributes("parameters", sysfs_get_module_parms(mod));
+		json_attributes("sections", sysfs_get_module_sections(mod));
+	}
+	json_record_end(&json);
+}
+
+/* kinds of objects shown by show_object() */
+#define OBJ_DEVICE		1
+#define OBJ_DRIVER		2
+#define OBJ_CLASS_DEVICE	3
+
+/**
+ * table_object: writes an object's row: its name, then the value of each
+ * 	attribute named with -A, empty where it has none. Only those
+ * 	attributes are read.
+ * @type: OBJ_DEVICE, OBJ_DRIVER or OBJ_CLASS_DEVICE
+ * @obj: object to write
+ */
+static void table_object(int type, void *obj)
+{
+	struct dlist *attributes = NULL;
+	struct sysfs_attribute *attr, *cur;
+	struct dl_node *node;
+	const char *name = NULL;
+	int i;
+
+	switch (type) {
+	case OBJ_DEVICE:
+		name = ((struct sysfs_device *)obj)->bus_id;
+		attributes = sysfs_get_device_attrs((struct sysfs_device *)obj,
+				attribute_names);
+		break;
+	case OBJ_DRIVER:
+		name = ((struct sysfs_driver *)obj)->name;
+		attributes = sysfs_get_driver_attrs((struct sysfs_driver *)obj,
+				attribute_names);
+		break;
+	case OBJ_CLASS_DEVICE:
+		name = ((struct sysfs_class_device *)obj)->name;
+		attributes = sysfs_get_classdev_attrs(
+				(struct sysfs_class_device *)obj,
+				attribute_names);
+		break;
+	}
+	table_cell(&table, name, strlen(name), 0);
+	for (i = 0; i < attribute_count; i++) {
+		attr = NULL;
+		if (attributes)
+			dlist_for_each_data_nomark(attributes, node, cur,
+					struct sysfs_attribute)
+				if (strcmp(cur->name, attribute_names[i]) == 0)
+					attr = cur;
+		if (attr && (attr->method & SYSFS_METHOD_SHOW) && attr->value)
+			table_cell(&table, attr->value, attr->len,
+					isbinaryvalue(attr));
+		else
+			table_cell(&table, NULL, 0, 0);
+	}
+	table_row_end(&table);
+}
+
+/**
+ * render_object: prints out an object handed out by a bus or class
+ * 	iterator
+ * @type: OBJ_DEVICE, OBJ_DRIVER or OBJ_CLASS_DEVICE
+ * @obj: object to print
+ */
+static void render_object(int type, void *obj)
+{
+	if (table_format) {
+		table_object(type, obj);
+		return;
+	}
+	switch (type) {
+	case OBJ_DEVICE:
+		if (output_format) {
+			json_record_start(&json, "device");
+			json_device((struct sysfs_device *)obj);
+			json_record_end(&json);
+		} else
+			show_device((struct sysfs_device *)obj, 2);
+		break;
+	case OBJ_DRIVER:
+		if (output_format) {
+			json_record_start(&json, "driver");
+			json_driver((struct sysfs_driver *)obj);
+			json_record_end(&json);
+		} else
+			show_driver((struct sysfs_driver *)obj, 2);
+		break;
+	case OBJ_CLASS_DEVICE:
+		if (output_format) {
+			json_record_start(&json, "class_device");
+			json_class_device((struct sysfs_class_device *)obj);
+			json_record_end(&json);
+		} else
+			show_class_device((struct sysfs_class_device *)obj, 2);
+		break;
+	}
+}
+
+#ifdef SYSFS_THREAD_SAFE
+/*
+ * With -j the main thread keeps walking the iterators, in order, and
+ * hands each object to a pool of workers. A worker prints into the
+ * object's slot in a ring instead of to stdout; the main thread writes
+ * the slots out oldest first as they complete, so the output is the
+ * same as when the objects are shown one after the other.
+ */
+#define SLOT_FREE	0
+#define SLOT_QUEUED	1
+#define SLOT_DONE	2
+
+struct slot {
+	int state;
+	int type;			/* OBJ_* */
+	void *obj;			/* referenced, closed by the worker */
+	struct out_buf out;		/* what showing it printed */
+	struct json_writer part;	/* records in out, with a format */
+};
+
+static struct slot *ring;
+static unsigned int ring_size;
+static unsigned int ring_head;		/* oldest slot not written out */
+static unsigned int ring_run;		/* next slot for a worker */
+static unsigned int ring_tail;		/* next slot to fill */
+static int pool_stopping;
+static pthread_t *workers;
+static int nworkers;
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pool_work = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t pool_done = PTHREAD_COND_INITIALIZER;
+
+/* drops the reference a slot holds on its object */
+static void close_object(int type, void *obj)
+{
+	switch (type) {
+	case OBJ_DEVICE:
+		sysfs_close_device((struct sysfs_device *)obj);
+		break;
+	case OBJ_DRIVER:
+		sysfs_close_driver((struct sysfs_driver *)obj);
+		break;
+	case OBJ_CLASS_DEVICE:
+		sysfs_close_class_device((struct sysfs_class_device *)obj);
+		break;
+	}
+}
+
+/**
+ * pool_worker: shows queued objects into their slots until the pool is
+ * 	stopped
+ */
+static void *pool_worker(void *arg)
+{
+	struct slot *slot;
+
+	(void)arg;
+	pthread_mutex_lock(&pool_lock);
+	for (;;) {
+		while (ring_run == ring_tail && !pool_stopping)
+			pthread_cond_wait(&pool_work, &pool_lock);
+		if (ring_run == ring_tail)
+			break;
+		slot = &ring[ring_run++ % ring_size];
+		pthread_mutex_unlock(&pool_lock);
+
+		out_capture(&slot->out);
+		if (output_format)
+			json_begin_part(&json, output_format);
+		if (table_format)
+			table_begin_part(&table, table_format);
+		render_object(slot->type, slot->obj);
+		if (output_format)
+			slot->part = json;
+		out_capture(NULL);
+		close_object(slot->type, slot->obj);
+
+		pthread_mutex_lock(&pool_lock);
+		slot->state = SLOT_DONE;
+		pthread_cond_signal(&pool_done);
+	}
+	pthread_mutex_unlock(&pool_lock);
+	return NULL;
+}
+
+/**
+ * pool_write: writes out completed slots, oldest first
+ * @all: wait for and write out every slot, otherwise only wait while
+ * 	the ring is full
+ */
+static void pool_write(int all)
+{
+	struct slot *slot;
+
+	pthread_mutex_lock(&pool_lock);
+	while (ring_head != ring_tail) {
+		slot = &ring[ring_head % ring_size];
+		if (slot->state != SLOT_DONE) {
+			if (!all && ring_tail - ring_head < ring_size)
+				break;
+			pthread_cond_wait(&pool_done, &pool_lock);
+			continue;
+		}
+		pthread_mutex_unlock(&pool_lock);
+		if (output_format)
+			json_splice(&json, &slot->part);
+		out_write(slot->out.data, slot->out.len);
+		slot->out.len = 0;
+		pthread_mutex_lock(&pool_lock);
+		slot->state = SLOT_FREE;
+		ring_head++;
+	}
+	pthread_mutex_unlock(&pool_lock);
+}
+
+/**
+ * pool_start: starts the workers
+ * @count: number of workers
+ * returns 0 with success and -1 with error
+ */
+static int pool_start(int count)
+{
+	ring_size = 4 * count;
+	ring = (struct slot *)calloc(ring_size, sizeof(struct slot));
+	workers = (pthread_t *)calloc(count, sizeof(pthread_t));
+	if (!ring || !workers)
+		return -1;
+	for (nworkers = 0; nworkers < count; nworkers++)
+		if (pthread_create(&workers[nworkers], NULL, pool_worker,
+					NULL))
+			break;
+	return nworkers > 0 ? 0 : -1;
+}
+
+/**
+ * pool_stop: writes out what is left and waits for the workers to exit
+ */
+static void pool_stop(void)
+{
+	unsigned int i;
+	int n;
+
+	pool_write(1);
+	pthread_mutex_lock(&pool_lock);
+	pool_stopping = 1;
+	pthread_cond_broadcast(&pool_work);
+	pthread_mutex_unlock(&pool_lock);
+	for (n = 0; n < nworkers; n++)
+		pthread_join(workers[n], NULL);
+	nworkers = 0;
+	for (i = 0; i < ring_size; i++)
+		free(ring[i].out.data);
+	free(ring);
+	free(workers);
+}
+
+/**
+ * pool_queue: hands an object to the workers, writing out completed
+ * 	slots first if the ring is full
+ * @type: OBJ_*
+ * @obj: object to show, a reference is taken
+ */
+static void pool_queue(int type, void *obj)
+{
+	struct slot *slot;
+
+	pool_write(0);
+	switch (type) {
+	case OBJ_DEVICE:
+		sysfs_ref_device((struct sysfs_device *)obj);
+		break;
+	case OBJ_DRIVER:
+		sysfs_ref_driver((struct sysfs_driver *)obj);
+		break;
+	case OBJ_CLASS_DEVICE:
+		sysfs_ref_class_device((struct sysfs_class_device *)obj);
+		break;
+	}
+	pthread_mutex_lock(&pool_lock);
+	slot = &ring[ring_tail++ % ring_size];
+	slot->type = type;
+	slot->obj = obj;
+	slot->state = SLOT_QUEUED;
+	pthread_cond_signal(&pool_work);
+	pthread_mutex_unlock(&pool_lock);
+}
+#endif /* SYSFS_THREAD_SAFE */
+
+/**
+ * show_object: prints out an object, or with -j has it printed in turn
+ * @type: OBJ_DEVICE, OBJ_DRIVER or OBJ_CLASS_DEVICE
+ * @obj: object to print, only valid for the duration of the call
+ */
+static void show_object(int type, void *obj)
+{
+#ifdef SYSFS_THREAD_SAFE
+	if (nworkers > 0) {
+		pool_queue(type, obj);
+		return;
+	}
+#endif
+	render_object(type, obj);
+}
+
+/**
+ * show_objects_done: with -j, writes out all objects handed out so far
+ */
+static void show_objects_done(void)
+{
+#ifdef SYSFS_THREAD_SAFE
+	if (nworkers > 0)
+		pool_write(1);
+#endif
+}
+
 /**
  * show_sysfs_bus: prints out everything on a bus.
  * @busname: bus to print.
@@ -381,8 +1246,7 @@ static int show_sysfs_bus(char *busname)
 	struct sysfs_bus *bus;
 	struct sysfs_device *curdev;
 	struct sysfs_driver *curdrv;
-	struct dlist *devlist;
-	struct dlist *drvlist;
+	struct sysfs_iter *iter;
 
 	if (!busname) {
 		errno = EINVAL;
@@ -394,29 +1258,34 @@ static int show_sysfs_bus(char *busname)
 		return 1;
 	}
 
-	fprintf(stdout, "Bus = \"%s\"\n", busname);
-	if (show_options ^ (SHOW_DEVICES | SHOW_DRIVERS))
-		fprintf(stdout, "\n");
+	if (!output_format && !table_format) {
+		out_printf("Bus = \"%s\"\n", busname);
+		if (show_options ^ (SHOW_DEVICES | SHOW_DRIVERS))
+			out_char('\n');
+	}
+	/*
+	 * Walk the bus with iterators so that each device is printed as
+	 * soon as it is opened, and closed before the next one is opened.
+	 */
 	if (show_options & SHOW_DEVICES) {
-		devlist = sysfs_get_bus_devices(bus);
-		if (devlist) {
-			dlist_for_each_data(devlist, curdev,
-						struct sysfs_device) {
-				if (!device_to_show || (strcmp(device_to_show,
-							curdev->bus_id) == 0))
-					show_device(curdev, 2);
-			}
+		iter = filter_devices(sysfs_open_bus_device_iter(bus,
+					SYSFS_ITER_SORTED));
+		if (iter) {
+			while ((curdev = sysfs_bus_device_iter_next(iter)))
+				show_object(OBJ_DEVICE, curdev);
+			sysfs_close_iter(iter);
 		}
 	}
 	if (show_options & SHOW_DRIVERS) {
-		drvlist = sysfs_get_bus_drivers(bus);
-		if (drvlist) {
-			dlist_for_each_data(drvlist, curdrv,
-					struct sysfs_driver) {
-				show_driver(curdrv, 2);
+		iter = sysfs_open_bus_driver_iter(bus, SYSFS_ITER_SORTED);
+		if (iter) {
+			while ((curdrv = sysfs_bus_driver_iter_next(iter))) {
+				show_object(OBJ_DRIVER, curdrv);
 			}
+			sysfs_close_iter(iter);
 		}
 	}
+	show_objects_done();
 	sysfs_close_bus(bus);
 	return 0;
 }
@@ -431,9 +1300,9 @@ static void show_classdev_parent(struct sysfs_class_device *dev, int level)
 
 	parent = sysfs_get_classdev_parent(dev);
 	if (parent) {
-		fprintf(stdout, "\n");
+		out_char('\n');
 		indent(level);
-		fprintf(stdout, "Class device \"%s\"'s parent is\n",
+		out_printf("Class device \"%s\"'s parent is\n",
 								dev->name);
 		show_class_device(parent, level+2);
 	}
@@ -450,18 +1319,22 @@ static void show_class_device(struct sysfs_class_device *dev, int level)
 
 	if (dev) {
 		indent(level);
-		fprintf(stdout, "Class Device = \"%s\"\n", dev->name);
+		out_printf("Class Device = \"%s\"\n", dev->name);
 		if (show_options & (SHOW_PATH | SHOW_ALL_ATTRIB_VALUES)) {
 			indent(level);
-			fprintf(stdout, "Class Device path = \"%s\"\n",
+			out_printf("Class Device path = \"%s\"\n",
 								dev->path);
 		}
 		if (show_options & (SHOW_ATTRIBUTES | SHOW_ATTRIBUTE_VALUE
 		    | SHOW_ALL_ATTRIB_VALUES)) {
-			attributes = sysfs_get_classdev_attributes(dev);
+			if (attribute_projection())
+				attributes = sysfs_get_classdev_attrs(dev,
+						attribute_projection());
+			else
+				attributes = sysfs_get_classdev_attributes(dev);
 			if (attributes)
 				show_attributes(attributes, (level+2));
-			fprintf(stdout, "\n");
+			out_char('\n');
 		}
 		if (show_options & (SHOW_DEVICES | SHOW_ALL_ATTRIB_VALUES)) {
 			device = sysfs_get_classdev_device(dev);
@@ -475,7 +1348,7 @@ static void show_class_device(struct sysfs_class_device *dev, int level)
 		}
 		if (show_options & ~(SHOW_ATTRIBUTES | SHOW_ATTRIBUTE_VALUE
 		    | SHOW_ALL_ATTRIB_VALUES))
-			fprintf(stdout, "\n");
+			out_char('\n');
 	}
 }
 
@@ -488,7 +1361,7 @@ static int show_sysfs_class(char *classname)
 {
 	struct sysfs_class *cls;
 	struct sysfs_class_device *cur;
-	struct dlist *clsdevlist;
+	struct sysfs_iter *iter;
 
 	if (!classname) {
 		errno = EINVAL;
@@ -499,17 +1372,17 @@ static int show_sysfs_class(char *classname)
 		fprintf(stderr, "Error opening class %s\n", classname);
 		return 1;
 	}
-	fprintf(stdout, "Class = \"%s\"\n\n", classname);
-	clsdevlist = sysfs_get_class_devices(cls);
-	if (clsdevlist) {
-		dlist_for_each_data(clsdevlist, cur,
-				struct sysfs_class_device) {
-			if (device_to_show == NULL || (strcmp(device_to_show,
-			    cur->name) == 0))
-				show_class_device(cur, 2);
-		}
+	if (!output_format && !table_format)
+		out_printf("Class = \"%s\"\n\n", classname);
+	iter = filter_devices(sysfs_open_class_device_iter(cls,
+				SYSFS_ITER_SORTED));
+	if (iter) {
+		while ((cur = sysfs_class_device_iter_next(iter)))
+			show_object(OBJ_CLASS_DEVICE, cur);
+		sysfs_close_iter(iter);
 	}
 
+	show_objects_done();
 	sysfs_close_class(cls);
 	return 0;
 }
@@ -528,20 +1401,30 @@ static int show_sysfs_module(char *module)
 		fprintf(stderr, "Error opening module %s\n", module);
 		return 1;
 	}
-	fprintf(stdout, "Module = \"%s\"\n\n", module);
+	if (output_format) {
+		json_module(mod);
+		sysfs_close_module(mod);
+		return 0;
+	}
+	out_printf("Module = \"%s\"\n\n", module);
 	if (show_options & (SHOW_ATTRIBUTES | SHOW_ATTRIBUTE_VALUE
 	    | SHOW_ALL_ATTRIB_VALUES)) {
 		struct dlist *attributes = NULL;
 		struct sysfs_attribute *cur;
+		struct dl_node *node;
 
-		attributes = sysfs_get_module_attributes(mod);
+		if (attribute_projection())
+			attributes = sysfs_get_module_attrs(mod,
+					attribute_projection());
+		else
+			attributes = sysfs_get_module_attributes(mod);
 		if (attributes) {
 			if (show_options & (SHOW_ATTRIBUTES
 			    | SHOW_ALL_ATTRIB_VALUES)) {
 				indent(2);
-				fprintf(stdout, "Attributes:\n");
+				out_str("Attributes:\n");
 			}
-			dlist_for_each_data(attributes, cur,
+			dlist_for_each_data_nomark(attributes, node, cur,
 					struct sysfs_attribute) {
 				show_attribute(cur, (4));
 			}
@@ -550,11 +1433,11 @@ static int show_sysfs_module(char *module)
 		if (attributes) {
 			if (show_options & (SHOW_ATTRIBUTES
 			    | SHOW_ALL_ATTRIB_VALUES)) {
-				fprintf(stdout, "\n");
+				out_char('\n');
 				indent(2);
-				fprintf(stdout, "Parameters:\n");
+				out_str("Parameters:\n");
 			}
-			dlist_for_each_data(attributes, cur,
+			dlist_for_each_data_nomark(attributes, node, cur,
 					struct sysfs_attribute) {
 				show_attribute(cur, (4));
 			}
@@ -563,15 +1446,15 @@ static int show_sysfs_module(char *module)
 		if (attributes) {
 			if (show_options & (SHOW_ATTRIBUTES
 			    | SHOW_ALL_ATTRIB_VALUES)) {
-				fprintf(stdout, "\n");
+				out_char('\n');
 				indent(2);
-				fprintf(stdout, "Sections:\n");
+				out_str("Sections:\n");
 			}
-			dlist_for_each_data(attributes, cur,
+			dlist_for_each_data_nomark(attributes, node, cur,
 					struct sysfs_attribute) {
 				show_attribute(cur, (4));
 			}
-			fprintf(stdout, "\n");
+			out_char('\n');
 		}
 	}
 
@@ -579,6 +1462,30 @@ static int show_sysfs_module(char *module)
 	return 0;
 }
 
+/**
+ * show_name_list: prints the names of what sysfs supports of one kind
+ * @list: names
+ * @heading: text heading the names
+ * @type: record type for each name in JSON
+ */
+static void show_name_list(struct dlist *list, const char *heading,
+			const char *type)
+{
+	struct dl_node *node;
+	char *cur;
+
+	if (!output_format)
+		out_printf("%s\n", heading);
+	dlist_for_each_data_nomark(list, node, cur, char) {
+		if (output_format) {
+			json_record_start(&json, type);
+			json_string(&json, "name", cur);
+			json_record_end(&json);
+		} else
+			out_printf("\t%s\n", cur);
+	}
+}
+
 /**
  * show_default_info: prints current buses, classes, and root devices
  *	supported by sysfs.
@@ -588,7 +1495,6 @@ static int show_default_info(void)
 {
 	char subsys[SYSFS_NAME_LEN];
 	struct dlist *list;
-	char *cur;
 	int retval = 0;
 
 	safestrcpy(subsys, sysfs_mnt_path);
@@ -596,9 +1502,7 @@ static int show_default_info(void)
 	safestrcat(subsys, SYSFS_BUS_NAME);
 	list = sysfs_open_directory_list(subsys);
 	if (list) {
-		fprintf(stdout, "Supported sysfs buses:\n");
-		dlist_for_each_data(list, cur, char)
-			fprintf(stdout, "\t%s\n", cur);
+		show_name_list(list, "Supported sysfs buses:", "bus");
 		sysfs_close_list(list);
 	}
 
@@ -607,9 +1511,7 @@ static int show_default_info(void)
 	safestrcat(subsys, SYSFS_CLASS_NAME);
 	list = sysfs_open_directory_list(subsys);
 	if (list) {
-		fprintf(stdout, "Supported sysfs classes:\n");
-		dlist_for_each_data(list, cur, char)
-			fprintf(stdout, "\t%s\n", cur);
+		show_name_list(list, "Supported sysfs classes:", "class");
 		sysfs_close_list(list);
 	}
 
@@ -618,9 +1520,7 @@ static int show_default_info(void)
 	safestrcat(subsys, SYSFS_DEVICES_NAME);
 	list = sysfs_open_directory_list(subsys);
 	if (list) {
-		fprintf(stdout, "Supported sysfs devices:\n");
-		dlist_for_each_data(list, cur, char)
-			fprintf(stdout, "\t%s\n", cur);
+		show_name_list(list, "Supported sysfs devices:", "root_device");
 		sysfs_close_list(list);
 	}
 
@@ -629,9 +1529,7 @@ static int show_default_info(void)
 	safestrcat(subsys, SYSFS_MODULE_NAME);
 	list = sysfs_open_directory_list(subsys);
 	if (list) {
-		fprintf(stdout, "Supported sysfs modules:\n");
-		dlist_for_each_data(list, cur, char)
-			fprintf(stdout, "\t%s\n", cur);
+		show_name_list(list, "Supported sysfs modules:", "module");
 		sysfs_close_list(list);
 	}
 
@@ -649,6 +1547,293 @@ static int check_sysfs_is_mounted(void)
 	return 1;
 }
 
+/*
+ * With -w the attributes that are shown stay open and are read again
+ * every interval through a descriptor kept for each; only the values
+ * that changed are printed. Counters also get how much they moved.
+ */
+struct watch_attr {
+	struct sysfs_attribute *attr;
+	int object;			/* index in watch_objects */
+	int fd;				/* kept open, -1 to open on each read */
+	char *last;			/* value as last printed */
+	size_t last_len;
+};
+
+static struct watch_attr *watch_attrs;
+static int watch_count;
+static char **watch_objects;		/* heading of each object */
+static int watch_object_count;
+
+/**
+ * watch_add: adds an object's attributes to those watched
+ * @heading: line printed above the object's values
+ * @attributes: attributes of the object, may be NULL
+ */
+static void watch_add(const char *heading, struct dlist *attributes)
+{
+	struct sysfs_attribute *cur;
+	struct watch_attr *wa;
+	struct dl_node *node;
+	char **objects;
+
+	if (!attributes)
+		return;
+	objects = (char **)realloc(watch_objects,
+			(watch_object_count + 1) * sizeof(char *));
+	if (!objects)
+		return;
+	watch_objects = objects;
+	watch_objects[watch_object_count] = strdup(heading);
+	if (!watch_objects[watch_object_count])
+		return;
+
+	dlist_for_each_data_nomark(attributes, node, cur,
+			struct sysfs_attribute) {
+		if (!(cur->method & SYSFS_METHOD_SHOW))
+			continue;
+		if (attribute_projection() &&
+				!attribute_requested(cur->name))
+			continue;
+		wa = (struct watch_attr *)realloc(watch_attrs,
+				(watch_count + 1) * sizeof(struct watch_attr));
+		if (!wa)
+			break;
+		watch_attrs = wa;
+		wa = &watch_attrs[watch_count++];
+		wa->attr = cur;
+		wa->object = watch_object_count;
+		/* static values are shown once and not read again */
+		if (cur->attr_class == SYSFS_ATTR_STATIC && cur->value)
+			wa->fd = -2;
+		else
+			wa->fd = open(cur->path, O_RDONLY | O_CLOEXEC);
+		wa->last = NULL;
+		wa->last_len = 0;
+	}
+	watch_object_count++;
+}
+
+/**
+ * watch_counter_delta: prints how much a counter moved, for each of the
+ * 	numbers in its value
+ * @last: previous value
+ * @value: current value
+ * @seconds: time between the two reads
+ * @level: indent of the attribute line
+ */
+static void watch_counter_delta(const char *last, const char *value,
+		double seconds, int level)
+{
+	long long delta[32];
+	unsigned long long a, b;
+	char *enda, *endb;
+	int n = 0, i;
+
+	while (n < 32) {
+		errno = 0;
+		a = strtoull(last, &enda, 10);
+		b = strtoull(value, &endb, 10);
+		if (enda == last || endb == value || errno)
+			break;
+		/* wrapped counters come out right as long as they wrap once */
+		delta[n++] = (long long)(b - a);
+		last = enda;
+		value = endb;
+	}
+	while (isspace(*last))
+		last++;
+	while (isspace(*value))
+		value++;
+	if (n == 0 || *last || *value)
+		return;
+
+	indent(level + 22);
+	for (i = 0; i < n; i++)
+		out_printf(i ? " %+lld" : "%+lld", delta[i]);
+	if (n == 1 && seconds > 0)
+		out_printf(" (%.1f/s)\n", delta[0] / seconds);
+	else
+		out_printf(" in %.2fs\n", seconds);
+}
+
+/**
+ * watch_tick: reads the watched attributes again and prints those that
+ * 	changed, all of them the first time
+ * @seconds: time since the last tick, 0 for the first
+ */
+static void watch_tick(double seconds)
+{
+	struct watch_attr *wa;
+	int i, object = -1;
+	char stamp[32], *prev;
+	time_t now;
+
+	for (i = 0; i < watch_count; i++) {
+		wa = &watch_attrs[i];
+		if (wa->last) {
+			if (wa->fd == -2)
+				continue;
+			if (wa->fd >= 0 ?
+			    sysfs_read_attribute_fd(wa->attr, wa->fd) :
+			    sysfs_read_attribute(wa->attr))
+				continue;
+			if (wa->attr->len == wa->last_len && !memcmp(
+			    wa->attr->value, wa->last, wa->last_len))
+				continue;
+		}
+		/* show_attribute() trims the value, keep it as read */
+		prev = wa->last;
+		wa->last = (char *)malloc(wa->attr->len + 1);
+		if (!wa->last) {
+			wa->last = prev;
+			continue;
+		}
+		memcpy(wa->last, wa->attr->value, wa->attr->len);
+		wa->last[wa->attr->len] = '\0';
+		wa->last_len = wa->attr->len;
+
+		if (object < 0 && seconds > 0) {
+			now = time(NULL);
+			strftime(stamp, sizeof(stamp), "%H:%M:%S",
+					localtime(&now));
+			out_printf("--- %s\n", stamp);
+		}
+		if (wa->object != object) {
+			object = wa->object;
+			indent(2);
+			out_printf("%s\n", watch_objects[object]);
+		}
+		show_attribute(wa->attr, 4);
+		if (prev && wa->attr->attr_class == SYSFS_ATTR_COUNTER)
+			watch_counter_delta(prev, wa->last, seconds, 4);
+		free(prev);
+	}
+	if (object >= 0)
+		out_char('\n');
+	out_flush();
+}
+
+/**
+ * watch_open: opens what is to be watched and prints the heading
+ * returns 0 with success and 1 with error
+ */
+static int watch_open(char *busname, char *classname, char *module)
+{
+	struct sysfs_device *dev;
+	struct sysfs_class_device *clsdev;
+	struct sysfs_module *mod;
+	struct sysfs_bus *bus;
+	struct sysfs_class *cls;
+	struct sysfs_iter *iter;
+	struct dlist *attributes;
+	char heading[SYSFS_PATH_MAX];
+	struct rlimit rlim;
+
+	/* a descriptor is kept for each attribute */
+	if (!getrlimit(RLIMIT_NOFILE, &rlim) && rlim.rlim_cur < rlim.rlim_max) {
+		rlim.rlim_cur = rlim.rlim_max;
+		setrlimit(RLIMIT_NOFILE, &rlim);
+	}
+	/* objects stay open for as long as the watch goes on */
+	if (busname) {
+		bus = sysfs_open_bus(busname);
+		if (!bus) {
+			fprintf(stderr, "Error opening bus %s\n", busname);
+			return 1;
+		}
+		out_printf("Bus = \"%s\"\n\n", busname);
+		iter = filter_devices(sysfs_open_bus_device_iter(bus,
+					SYSFS_ITER_SORTED));
+		if (iter) {
+			while ((dev = sysfs_bus_device_iter_next(iter))) {
+				/* the iterator closes what it hands out */
+				sysfs_ref_device(dev);
+				if (attribute_projection())
+					attributes = sysfs_get_device_attrs(dev,
+							attribute_projection());
+				else
+					attributes =
+						sysfs_get_device_attributes(dev);
+				snprintf(heading, sizeof(heading),
+					"Device = \"%s\"", dev->bus_id);
+				watch_add(heading, attributes);
+			}
+			sysfs_close_iter(iter);
+		}
+	}
+	if (classname) {
+		cls = sysfs_open_class(classname);
+		if (!cls) {
+			fprintf(stderr, "Error opening class %s\n",
+					classname);
+			return 1;
+		}
+		out_printf("Class = \"%s\"\n\n", classname);
+		iter = filter_devices(sysfs_open_class_device_iter(cls,
+					SYSFS_ITER_SORTED));
+		if (iter) {
+			while ((clsdev = sysfs_class_device_iter_next(iter))) {
+				sysfs_ref_class_device(clsdev);
+				if (attribute_projection())
+					attributes = sysfs_get_classdev_attrs(
+						clsdev, attribute_projection());
+				else
+					attributes =
+					sysfs_get_classdev_attributes(clsdev);
+				snprintf(heading, sizeof(heading),
+					"Class Device = \"%s\"", clsdev->name);
+				watch_add(heading, attributes);
+			}
+			sysfs_close_iter(iter);
+		}
+	}
+	if (module) {
+		mod = sysfs_open_module(module);
+		if (!mod) {
+			fprintf(stderr, "Error opening module %s\n", module);
+			return 1;
+		}
+		out_printf("Module = \"%s\"\n\n", module);
+		if (attribute_projection())
+			attributes = sysfs_get_module_attrs(mod,
+					attribute_projection());
+		else
+			attributes = sysfs_get_module_attributes(mod);
+		watch_add("Attributes:", attributes);
+		watch_add("Parameters:", sysfs_get_module_parms(mod));
+	}
+	return 0;
+}
+
+/**
+ * watch: prints the watched attributes, then what changes in them every
+ * 	interval, until interrupted
+ * @interval: seconds between reads
+ */
+static void watch(double interval)
+{
+	struct timespec next, last, now;
+	long long step;
+
+	step = (long long)(interval * 1000000000.0);
+	clock_gettime(CLOCK_MONOTONIC, &last);
+	next = last;
+	watch_tick(0);
+	for (;;) {
+		/* ticks are kept on a fixed schedule however long they take */
+		next.tv_sec += (next.tv_nsec + step) / 1000000000;
+		next.tv_nsec = (next.tv_nsec + step) % 1000000000;
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME,
+					&next, NULL) == EINTR)
+			;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		watch_tick((now.tv_sec - last.tv_sec) +
+				(now.tv_nsec - last.tv_nsec) / 1e9);
+		last = now;
+	}
+}
+
 /* MAIN */
 int main(int argc, char *argv[])
 {
@@ -657,21 +1842,20 @@ int main(int argc, char *argv[])
 	char *show_root = NULL;
 	int retval = 0;
 	int opt;
-	char *pci_id_file = PCI_IDS_PATHNAME;
+	char *end;
+	int compile_ids = 0;
+	size_t i;
 
-	while((opt = getopt(argc, argv, cmd_options)) != EOF) {
+	out_init();
+	while((opt = getopt_long(argc, argv, cmd_options, long_options,
+						NULL)) != EOF) {
 		switch(opt) {
 		case 'a':
 			show_options |= SHOW_ATTRIBUTES;
 			break;
 		case 'A':
-			if ((strlen(optarg) + 1) > SYSFS_NAME_LEN) {
-				fprintf(stderr,
-					"Attribute name %s is too long\n",
-					optarg);
+			if (add_attribute_names(optarg))
 				exit(1);
-			}
-			attribute_to_show = optarg;
 			show_options |= SHOW_ATTRIBUTE_VALUE;
 			break;
 		case 'b':
@@ -690,6 +1874,14 @@ int main(int argc, char *argv[])
 			usage();
 			exit(0);
 			break;
+		case 'j':
+			jobs = atoi(optarg);
+			if (jobs < 1 || jobs > 256) {
+				fprintf(stderr, "Invalid number of jobs %s\n",
+						optarg);
+				exit(1);
+			}
+			break;
 		case 'm':
 			show_module = optarg;
 			/* FALLTHRU */
@@ -702,6 +1894,52 @@ int main(int argc, char *argv[])
 		case 'v':
 			show_options |= SHOW_ALL_ATTRIB_VALUES;
 			break;
+		case 'w':
+			watch_interval = strtod(optarg, &end);
+			if (*end || !(watch_interval >= 0.01 &&
+						watch_interval <= 86400)) {
+				fprintf(stderr, "Invalid interval %s\n",
+						optarg);
+				exit(1);
+			}
+			break;
+		case OPT_FORMAT:
+			output_format = table_format = 0;
+			if (strcmp(optarg, "text") == 0)
+				;
+			else if (strcmp(optarg, "json") == 0)
+				output_format = JSON_ARRAY;
+			else if (strcmp(optarg, "ndjson") == 0)
+				output_format = JSON_LINES;
+			else if (strcmp(optarg, "table") == 0)
+				table_format = TABLE_COLUMNS;
+			else if (strcmp(optarg, "csv") == 0)
+				table_format = TABLE_CSV;
+			else {
+				fprintf(stderr, "Unknown format %s\n",
+						optarg);
+				exit(1);
+			}
+			break;
+		case OPT_TABLE:
+			output_format = 0;
+			table_format = TABLE_COLUMNS;
+			break;
+		case OPT_CSV:
+			output_format = 0;
+			table_format = TABLE_CSV;
+			break;
+		case OPT_MATCH:
+			if (add_match(optarg))
+				exit(1);
+			show_options |= SHOW_DEVICES;
+			break;
+		case OPT_COMPILE_IDS:
+			compile_ids = 1;
+			break;
+		case OPT_PCI_INFO:
+			show_pci = 1;
+			break;
 		default:
 			usage();
 			exit(1);
@@ -729,6 +1967,31 @@ int main(int argc, char *argv[])
 		exit(1);
 	}
 
+	if (compile_ids) {
+		struct id_list ids;
+		int compiled = 0;
+
+		/* those not installed are skipped */
+		for (i = 0; i < NUM_ID_FILES; i++) {
+			memset(&ids, 0, sizeof(struct id_list));
+			ids.id_file_name = id_files[i].path;
+			if (id_compile_name_list(&ids) == 0)
+				compiled++;
+			else if (errno != ENOENT) {
+				fprintf(stderr, "Unable to compile %s: %s\n",
+						id_files[i].path,
+						strerror(errno));
+				exit(1);
+			}
+		}
+		if (!compiled) {
+			fprintf(stderr, "Unable to compile %s: %s\n",
+					id_files[0].path, strerror(ENOENT));
+			exit(1);
+		}
+		exit(0);
+	}
+
 	if (check_sysfs_is_mounted() == 0) {
 		fprintf(stderr, "Unable to find sysfs mount point!\n");
 		exit(1);
@@ -743,16 +2006,64 @@ int main(int argc, char *argv[])
 		usage();
 		exit(1);
 	}
+	if (table_format) {
+		if (!attribute_count) {
+			fprintf(stderr, "Tables need attributes named "
+					"with -A\n");
+			exit(1);
+		}
+		if ((!show_bus && !show_class) || show_module ||
+				watch_interval > 0) {
+			fprintf(stderr, "Tables only show a bus or class\n");
+			exit(1);
+		}
+	}
+	if (watch_interval > 0) {
+		if (output_format) {
+			fprintf(stderr, "Watching only supports text output\n");
+			exit(1);
+		}
+		if (!show_bus && !show_class && !show_module) {
+			fprintf(stderr,
+				"Please specify a bus, class, or module\n");
+			usage();
+			exit(1);
+		}
+		/* changes are only seen in values */
+		if (!attribute_projection())
+			show_options |= SHOW_ALL_ATTRIB_VALUES;
+		if (watch_open(show_bus, show_class, show_module))
+			exit(1);
+		watch(watch_interval);
+	}
 	/* default is to print devices */
 	if (!(show_options & (SHOW_DEVICES | SHOW_DRIVERS)))
 		show_options |= SHOW_DEVICES;
+	if (output_format)
+		json_begin(&json, output_format);
+	if (table_format) {
+		table_begin(&table, table_format);
+		table_cell(&table, "name", 4, 0);
+		for (i = 0; i < (size_t)attribute_count; i++)
+			table_cell(&table, attribute_names[i],
+					strlen(attribute_names[i]), 0);
+		table_row_end(&table);
+	}
+#ifdef SYSFS_THREAD_SAFE
+	/* a single device isn't worth the threads */
+	if (jobs > 1 && !device_to_show && pool_start(jobs))
+		fprintf(stderr, "Unable to start threads, showing "
+				"objects one by one\n");
+#endif
 
 	if (show_bus) {
-		if ((!(strcmp(show_bus, "pci"))))  {
-			pacc = (struct pci_access *)
-				calloc(1, sizeof(struct pci_access));
-			pacc->pci_id_file_name = pci_id_file;
-			pacc->numeric_ids = 0;
+		for (i = 0; i < NUM_ID_FILES; i++) {
+			if (strcmp(show_bus, id_files[i].bus))
+				continue;
+			bus_ids = (struct id_list *)
+				calloc(1, sizeof(struct id_list));
+			bus_ids->id_file_name = id_files[i].path;
+			bus_ids->numeric_ids = 0;
 		}
 		retval = show_sysfs_bus(show_bus);
 	}
@@ -764,16 +2075,22 @@ int main(int argc, char *argv[])
 
 	if (!show_bus && !show_class && !show_module && !show_root)
 		retval = show_default_info();
-
-	if (show_bus) {
-		if ((!(strcmp(show_bus, "pci"))))  {
-			pci_free_name_list(pacc);
-			free (pacc);
-			pacc = NULL;
-		}
+#ifdef SYSFS_THREAD_SAFE
+	if (nworkers > 0)
+		pool_stop();
+#endif
+
+	if (bus_ids) {
+		id_free_name_list(bus_ids);
+		free(bus_ids);
+		bus_ids = NULL;
 	}
-	if (!(show_options ^ SHOW_DEVICES))
-		fprintf(stdout, "\n");
+	if (output_format)
+		json_end(&json);
+	else if (table_format)
+		table_end(&table);
+	else if (!(show_options ^ SHOW_DEVICES))
+		out_char('\n');
 
 	exit(retval);
 }
@@ -0,0 +1,212 @@
+/*
+ * table.c
+ *
+ * Tables of attribute values for systool
+ *
+ * Copyright (C) IBM Corp. 2003-2005
+ *
+ *	This program is free software; you can redistribute it and/or modify it
+ *	under the terms of the GNU General Public License as published by the
+ *	Free Software Foundation version 2 of the License.
+ *
+ *	This program is distributed in the hope that it will be useful, but
+ *	WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *	General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License along
+ *	with this program; if not, write to the Free Software Foundation, Inc.,
+ *	675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "table.h"
+#include "output.h"
+
+#define COLUMN_GAP	2		/* spaces between aligned columns */
+
+/* rows of an aligned table, cells separated by tabs, until table_end() */
+static struct out_buf rows;
+
+/**
+ * write_csv: writes a CSV field, quoted if it has to be
+ */
+static void write_csv(const char *value, size_t len)
+{
+	const char *run = value, *end = value + len, *p;
+
+	if (!memchr(value, ',', len) && !memchr(value, '"', len) &&
+	    !memchr(value, '\n', len) && !memchr(value, '\r', len)) {
+		out_write(value, len);
+		return;
+	}
+	out_char('"');
+	for (p = value; p < end; p++) {
+		if (*p != '"')
+			continue;
+		out_write(run, p + 1 - run);
+		out_char('"');
+		run = p + 1;
+	}
+	out_write(run, end - run);
+	out_char('"');
+}
+
+/**
+ * write_column: writes an aligned table's cell, with control characters,
+ * 	the tabs and newlines among them, as spaces
+ */
+static void write_column(const char *value, size_t len)
+{
+	const char *run = value, *end = value + len, *p;
+
+	for (p = value; p < end; p++) {
+		if ((unsigned char)*p >= 0x20 && *p != 0x7f)
+			continue;
+		out_write(run, p - run);
+		out_char(' ');
+		run = p + 1;
+	}
+	out_write(run, end - run);
+}
+
+/**
+ * text_width: counts the characters of UTF-8 text
+ */
+static size_t text_width(const char *text, size_t len)
+{
+	size_t width = 0;
+
+	while (len-- > 0)
+		if ((*text++ & 0xc0) != 0x80)
+			width++;
+	return width;
+}
+
+/**
+ * table_begin: starts a table
+ * @layout: TABLE_COLUMNS or TABLE_CSV
+ */
+void table_begin(struct table_writer *table, int layout)
+{
+	table_begin_part(table, layout);
+	if (layout == TABLE_COLUMNS) {
+		rows.len = 0;
+		out_capture(&rows);
+	}
+}
+
+/**
+ * table_begin_part: starts writing rows of a table begun by another
+ * 	thread
+ * @layout: the table's layout
+ */
+void table_begin_part(struct table_writer *table, int layout)
+{
+	table->layout = layout;
+	table->cells = 0;
+}
+
+/**
+ * table_end: ends a table; aligned columns are written out now
+ */
+void table_end(struct table_writer *table)
+{
+	size_t *widths = NULL, *more, width, pad;
+	char *p, *end, *cell, *eol;
+	int count = 0, i;
+
+	if (table->layout != TABLE_COLUMNS)
+		return;
+	out_capture(NULL);
+
+	/* the widest cell of each column */
+	end = rows.data + rows.len;
+	for (p = rows.data; p < end; p = eol + 1) {
+		eol = (char *)memchr(p, '\n', end - p);
+		if (!eol)
+			eol = end;
+		for (i = 0, cell = p; cell <= eol; i++) {
+			for (p = cell; p < eol && *p != '\t'; p++)
+				;
+			if (i == count) {
+				more = (size_t *)realloc(widths,
+						(count + 1) * sizeof(size_t));
+				if (!more)
+					goto out;
+				widths = more;
+				widths[count++] = 0;
+			}
+			width = text_width(cell, p - cell);
+			if (width > widths[i])
+				widths[i] = width;
+			cell = p + 1;
+		}
+	}
+
+	/* padding is held back so that empty cells don't end lines in it */
+	for (p = rows.data; p < end; p = eol + 1) {
+		eol = (char *)memchr(p, '\n', end - p);
+		if (!eol)
+			eol = end;
+		pad = 0;
+		for (i = 0, cell = p; cell <= eol; i++) {
+			for (p = cell; p < eol && *p != '\t'; p++)
+				;
+			if (p > cell) {
+				out_spaces(pad);
+				out_write(cell, p - cell);
+				pad = 0;
+			}
+			pad += widths[i] - text_width(cell, p - cell) +
+				COLUMN_GAP;
+			cell = p + 1;
+		}
+		out_char('\n');
+	}
+out:
+	free(widths);
+	free(rows.data);
+	rows.data = NULL;
+	rows.len = rows.size = 0;
+}
+
+/**
+ * table_cell: writes the next cell of the current row
+ * @value: cell text, need not be NUL terminated; a trailing newline is
+ * 	left out
+ * @len: length of value
+ * @binary: write the value as hex digits
+ */
+void table_cell(struct table_writer *table, const char *value, size_t len,
+		int binary)
+{
+	if (table->cells++ > 0)
+		out_char(table->layout == TABLE_CSV ? ',' : '\t');
+	if (!value)
+		return;
+	if (binary) {
+		out_hex((const unsigned char *)value, len);
+		return;
+	}
+	if (len > 0 && value[len - 1] == '\n')
+		len--;
+	if (table->layout == TABLE_CSV)
+		write_csv(value, len);
+	else
+		write_column(value, len);
+}
+
+/**
+ * table_row_end: ends the current row
+ */
+void table_row_end(struct table_writer *table)
+{
+	out_char('\n');
+	table->cells = 0;
+}
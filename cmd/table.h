@@ -0,0 +1,50 @@
+/*
+ * table.h
+ *
+ * Tables of attribute values for systool
+ *
+ * Copyright (C) IBM Corp. 2003-2005
+ *
+ *	This program is free software; you can redistribute it and/or modify it
+ *	under the terms of the GNU General Public License as published by the
+ *	Free Software Foundation version 2 of the License.
+ *
+ *	This program is distributed in the hope that it will be useful, but
+ *	WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *	General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License along
+ *	with this program; if not, write to the Free Software Foundation, Inc.,
+ *	675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#ifndef _TABLE_H_
+#define _TABLE_H_
+
+#include <stddef.h>
+
+/* how rows are laid out */
+#define TABLE_COLUMNS	1	/* aligned columns, written at the end */
+#define TABLE_CSV	2	/* comma separated values, as they come */
+
+/*
+ * Rows go through the out_*() functions like any other output, so a
+ * thread can capture its rows. Aligned columns need every row to size
+ * them: table_begin() captures what the calling thread writes until
+ * table_end().
+ */
+struct table_writer {
+	int layout;
+	int cells;			/* in the current row so far */
+};
+
+extern void table_begin(struct table_writer *table, int layout);
+extern void table_begin_part(struct table_writer *table, int layout);
+extern void table_end(struct table_writer *table);
+extern void table_cell(struct table_writer *table, const char *value,
+		size_t len, int binary);
+extern void table_row_end(struct table_writer *table);
+
+#endif /* _TABLE_H_ */
@@ -150,7 +150,8 @@ void *_dlist_insert_dlnode(struct dlist *list,struct dl_node *new_node,int direc
  * iterator: dl_node pointer to iterate
  */
 #define dlist_for_each_nomark(list,iterator) \
-	for((iterator)=(list)->head->next; (iterator)!=(list)->head; \
+	for((iterator)=(list)->head->next; \
+		(iterator)!=NULL && (iterator)!=(list)->head; \
 		(iterator)=(iterator)->next)
 
 /**
@@ -160,7 +161,8 @@ void *_dlist_insert_dlnode(struct dlist *list,struct dl_node *new_node,int direc
  * iterator: dl_node pointer to iterate
  */
 #define dlist_for_each_nomark_rev(list,iterator) \
-	for((iterator)=(list)->head->prev; (iterator)!=(list)->head; \
+	for((iterator)=(list)->head->prev; \
+		(iterator)!=NULL && (iterator)!=(list)->head; \
 		(iterator)=(iterator)->prev)
 /**
  * provide for loop header which iterates through the list providing a
@@ -187,7 +189,8 @@ void *_dlist_insert_dlnode(struct dlist *list,struct dl_node *new_node,int direc
 
 /**
  * provide for loop header which iterates through the list providing a
- * data iterator without moving the mark
+ * data iterator without moving the mark. As the list is not modified,
+ * several threads may walk the same list at once this way.
  * list: the dlist pointer
  * iterator: the dl_node pointer to iterate
  * data_iterator: the pointer of type datatype to iterate
@@ -195,8 +198,10 @@ void *_dlist_insert_dlnode(struct dlist *list,struct dl_node *new_node,int direc
  */
 
 #define dlist_for_each_data_nomark(list,iterator,data_iterator,datatype) \
-	for((iterator)=(list)->head->next, (data_iterator)=(datatype *) (iterator)->data; \
-	(iterator)!=(list)->head;(iterator)=(iterator)->next,(data_iterator)=(datatype *) (iterator))
+	for((iterator)=(list)->head->next; \
+	(iterator)!=NULL && (iterator)!=(list)->head && \
+	((data_iterator)=(datatype *) (iterator)->data, 1); \
+	(iterator)=(iterator)->next)
 
 /**
  * provide for loop header which iterates through the list providing a
@@ -207,8 +212,10 @@ void *_dlist_insert_dlnode(struct dlist *list,struct dl_node *new_node,int direc
  * datatype:  actual type of the contents in the dl_node->data
  */
 #define dlist_for_each_data_nomark_rev(list,iterator, data_iterator,datatype) \
-	for((iterator)=(list)->head->prev, (data_iterator)=(datatype *) (iterator)->data; \
-	(iterator)!=(list)->head;(iterator)=(iterator)->prev,(data_iterator)=(datatype *) (iterator))
+	for((iterator)=(list)->head->prev; \
+	(iterator)!=NULL && (iterator)!=(list)->head && \
+	((data_iterator)=(datatype *) (iterator)->data, 1); \
+	(iterator)=(iterator)->prev)
 
 
 #ifdef __cplusplus
@@ -40,6 +40,15 @@
 #define SYSFS_MOD_SECT_NAME	"sections"
 #define SYSFS_UNKNOWN		"unknown"
 #define SYSFS_PATH_ENV		"SYSFS_PATH"
+#define SYSFS_SNAPSHOT_ENV	"SYSFS_SNAPSHOT"
+
+/* shared memory segment sysfsd publishes snapshots in */
+#define SYSFS_SNAPSHOT_NAME	"/libsysfs"
+
+/* names the topology cache file to use, see sysfs_attach_cache() */
+#define SYSFS_CACHE_ENV		"SYSFS_CACHE"
+
+#define SYSFS_CACHE_PATH	"/run/libsysfs.cache"
 
 #define SYSFS_PATH_MAX		256
 #define	SYSFS_NAME_LEN		64
@@ -48,11 +57,66 @@
 /* mount path for sysfs, can be overridden by exporting SYSFS_PATH */
 #define SYSFS_MNT_PATH		"/sys"
 
+/* flags for sysfs_open_*_iter() */
+#define SYSFS_ITER_SORTED	0x01	/* hand out entries in sorted order */
+
+/* sysfs_iter_add_match() flags */
+#define SYSFS_MATCH_GLOB	0x00	/* pattern is a glob, see fnmatch(3) */
+#define SYSFS_MATCH_REGEX	0x01	/* extended regular expression */
+
+/* sysfs_walk() visitor return values */
+#define SYSFS_WALK_CONTINUE	0	/* visit the node's subdirectories */
+#define SYSFS_WALK_SKIP		1	/* prune the node's subdirectories */
+#define SYSFS_WALK_STOP		2	/* end the walk */
+
+/* flags for struct sysfs_walk_opts */
+#define SYSFS_WALK_ALL_DIRS	0x01	/* also visit non-device directories */
+
+/* fields sysfs_open_device_path_flags() looks up right away */
+#define SYSFS_OPEN_BUS		0x01	/* bus */
+#define SYSFS_OPEN_DRIVER	0x02	/* driver_name */
+#define SYSFS_OPEN_SUBSYSTEM	0x04	/* subsystem */
+#define SYSFS_OPEN_ALL		(SYSFS_OPEN_BUS | SYSFS_OPEN_DRIVER | \
+				SYSFS_OPEN_SUBSYSTEM)
+
+/* device number types, as in /sys/dev/block and /sys/dev/char */
+#define SYSFS_DEVNUM_BLOCK	1
+#define SYSFS_DEVNUM_CHAR	2
+
+/* flags for sysfs_index_get_device_classdevs() */
+#define SYSFS_INDEX_BELOW	0x01	/* whole subtree, not just the device */
+
 enum sysfs_attribute_method {
 	SYSFS_METHOD_SHOW =	0x01,	/* attr can be read by user */
 	SYSFS_METHOD_STORE =	0x02,	/* attr can be changed by user */
 };
 
+/* how an attribute's value changes, see sysfs_get_attribute_class() */
+enum sysfs_attribute_class {
+	SYSFS_ATTR_CONFIG =	0,	/* when written or reconfigured */
+	SYSFS_ATTR_STATIC =	1,	/* never, while the object is there */
+	SYSFS_ATTR_COUNTER =	2,	/* all the time */
+};
+
+/* uevent actions, see sysfs_monitor_receive() */
+enum sysfs_event_action {
+	SYSFS_EVENT_UNKNOWN =	0,
+	SYSFS_EVENT_ADD =	1,
+	SYSFS_EVENT_REMOVE =	2,
+	SYSFS_EVENT_CHANGE =	3,
+	SYSFS_EVENT_MOVE =	4,
+	SYSFS_EVENT_ONLINE =	5,
+	SYSFS_EVENT_OFFLINE =	6,
+	SYSFS_EVENT_BIND =	7,
+	SYSFS_EVENT_UNBIND =	8,
+};
+
+/* Names in an object's directory, kept to answer repeated misses */
+struct sysfs_dirlist;
+
+/* Publisher of shared sysfs snapshots */
+struct sysfs_snapshot;
+
 /*
  * NOTE:
  * 1. We have the statically allocated "name" as the first element of all
@@ -66,6 +130,34 @@ struct sysfs_attribute {
 	char *value;
 	unsigned short len;			/* value length */
 	enum sysfs_attribute_method method;	/* show and store */
+	enum sysfs_attribute_class attr_class;
+	unsigned int generation;		/* value read at this one */
+};
+
+/*
+ * One KEY=value line of a uevent file. key and value point into the
+ * parsed buffer and are NUL terminated.
+ */
+struct sysfs_uevent_var {
+	const char *key;
+	size_t key_len;
+	const char *value;
+	size_t value_len;
+};
+
+/*
+ * A parsed uevent file. One replaced after a refresh stays valid until
+ * the thread that got it calls sysfs_thread_quiescent(), or the device
+ * or class device it came from is closed.
+ */
+struct sysfs_uevent {
+	int count;
+	struct sysfs_uevent_var *vars;	/* sorted by key */
+
+	/* Private: for internal use only */
+	char *buf;
+	size_t len;
+	int stale;			/* to be read again on next use */
 };
 
 struct sysfs_driver {
@@ -77,6 +169,8 @@ struct sysfs_driver {
 	/* Private: for internal use only */
 	struct sysfs_module *module;
 	struct dlist *devices;
+	int refcount;
+	struct sysfs_dirlist *dirlist;	/* listing taken on the first miss */
 };
 
 struct sysfs_device {
@@ -92,6 +186,10 @@ struct sysfs_device {
 	struct sysfs_device *parent;
 	/* NOTE - we still don't populate this */
 	struct dlist *children;
+	int refcount;
+	unsigned int resolved;		/* SYSFS_OPEN_* fields looked up */
+	struct sysfs_uevent *uevent;
+	struct sysfs_dirlist *dirlist;	/* listing taken on the first miss */
 };
 
 struct sysfs_bus {
@@ -102,6 +200,7 @@ struct sysfs_bus {
 	/* Private: for internal use only */
 	struct dlist *drivers;
 	struct dlist *devices;
+	int refcount;
 };
 
 struct sysfs_class_device {
@@ -113,6 +212,9 @@ struct sysfs_class_device {
 	/* Private: for internal use only */
 	struct sysfs_class_device *parent;
 	struct sysfs_device *sysdevice;		/* NULL if virtual */
+	int refcount;
+	struct sysfs_uevent *uevent;
+	struct sysfs_dirlist *dirlist;	/* listing taken on the first miss */
 };
 
 struct sysfs_class {
@@ -122,6 +224,7 @@ struct sysfs_class {
 
 	/* Private: for internal use only */
 	struct dlist *devices;
+	int refcount;
 };
 
 struct sysfs_module {
@@ -130,8 +233,61 @@ struct sysfs_module {
 	struct dlist *attrlist;
 	struct dlist *parmlist;
 	struct dlist *sections;
+
+	/* Private: for internal use only */
+	int refcount;
+	struct sysfs_dirlist *dirlist;	/* listing taken on the first miss */
 };
 
+/* Opaque cursor over a bus or class directory, see sysfs_iter.c */
+struct sysfs_iter;
+
+/* A device number, as found in st_rdev or /proc/diskstats */
+struct sysfs_devnum {
+	int type;			/* SYSFS_DEVNUM_BLOCK or _CHAR */
+	unsigned int major;
+	unsigned int minor;
+};
+
+/* Opaque reverse indexes over class devices, see sysfs_index.c */
+struct sysfs_index;
+
+/* Opaque kernel uevent listener, see sysfs_monitor.c */
+struct sysfs_monitor;
+
+/* A kernel uevent as read by sysfs_monitor_receive() */
+struct sysfs_event {
+	enum sysfs_event_action action;
+	char path[SYSFS_PATH_MAX];	/* absolute, like the objects' path */
+	char old_path[SYSFS_PATH_MAX];	/* before a move, empty otherwise */
+	char subsystem[SYSFS_NAME_LEN];
+	char driver[SYSFS_NAME_LEN];	/* set for bind */
+	unsigned long long seqnum;
+};
+
+/*
+ * A directory visited by sysfs_walk(). Only valid during the visitor call.
+ * attrlist holds the attributes named in the walk's projection list.
+ */
+struct sysfs_walk_node {
+	char name[SYSFS_NAME_LEN];
+	char path[SYSFS_PATH_MAX];
+	struct dlist *attrlist;
+	int depth;			/* levels below the walk's root */
+	int is_device;			/* directory has a uevent file */
+
+	/* Private: for internal use only */
+	struct sysfs_device *device;
+};
+
+struct sysfs_walk_opts {
+	const char * const *attrs;	/* NULL terminated, read per node */
+	int max_depth;			/* don't descend below, 0: no limit */
+	unsigned int flags;		/* SYSFS_WALK_* */
+};
+
+typedef int (*sysfs_walk_fn)(struct sysfs_walk_node *node, void *data);
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -154,9 +310,17 @@ extern void sysfs_close_list(struct dlist *list);
 extern void sysfs_close_attribute(struct sysfs_attribute *sysattr);
 extern struct sysfs_attribute *sysfs_open_attribute(const char *path);
 extern int sysfs_read_attribute(struct sysfs_attribute *sysattr);
+extern int sysfs_read_attribute_fd(struct sysfs_attribute *sysattr, int fd);
+extern ssize_t sysfs_read_attribute_at(struct sysfs_attribute *sysattr,
+		void *buf, size_t len, off_t offset);
 extern int sysfs_write_attribute(struct sysfs_attribute *sysattr,
 		const char *new_value, size_t len);
 extern struct sysfs_device *sysfs_read_dir_subdirs(const char *path);
+extern int sysfs_get_list_attrs(struct dlist *list, const char * const *names);
+extern enum sysfs_attribute_class sysfs_get_attribute_class(const char *name);
+extern int sysfs_set_attribute_class(const char *pattern,
+		enum sysfs_attribute_class attr_class);
+extern unsigned int sysfs_get_generation(void);
 /* sysfs driver access */
 extern void sysfs_close_driver(struct sysfs_driver *driver);
 extern struct sysfs_driver *sysfs_open_driver
@@ -165,6 +329,8 @@ extern struct sysfs_driver *sysfs_open_driver_path(const char *path);
 extern struct sysfs_attribute *sysfs_get_driver_attr
 	(struct sysfs_driver *drv, const char *name);
 extern struct dlist *sysfs_get_driver_attributes(struct sysfs_driver *drv);
+extern struct dlist *sysfs_get_driver_attrs
+	(struct sysfs_driver *drv, const char * const *names);
 extern struct dlist *sysfs_get_driver_devices(struct sysfs_driver *drv);
 extern struct sysfs_module *sysfs_get_driver_module(struct sysfs_driver *drv);
 
@@ -176,11 +342,19 @@ extern struct sysfs_device *sysfs_open_device
 	(const char *bus, const char *bus_id);
 extern struct sysfs_device *sysfs_get_device_parent(struct sysfs_device *dev);
 extern struct sysfs_device *sysfs_open_device_path(const char *path);
+extern struct sysfs_device *sysfs_open_device_path_flags(const char *path,
+		unsigned int flags);
+extern const char *sysfs_get_device_bus_name(struct sysfs_device *dev);
+extern const char *sysfs_get_device_driver_name(struct sysfs_device *dev);
+extern const char *sysfs_get_device_subsystem(struct sysfs_device *dev);
+extern struct sysfs_uevent *sysfs_get_device_uevent(struct sysfs_device *dev);
 extern int sysfs_get_device_bus(struct sysfs_device *dev);
 extern struct sysfs_attribute *sysfs_get_device_attr
 	(struct sysfs_device *dev, const char *name);
 extern struct dlist *sysfs_get_device_attributes
 	(struct sysfs_device *dev);
+extern struct dlist *sysfs_get_device_attrs
+	(struct sysfs_device *dev, const char * const *names);
 
 /* generic sysfs class access */
 extern void sysfs_close_class_device(struct sysfs_class_device *dev);
@@ -188,12 +362,21 @@ extern struct sysfs_class_device *sysfs_open_class_device_path
 	(const char *path);
 extern struct sysfs_class_device *sysfs_open_class_device
 	(const char *classname, const char *name);
+extern struct sysfs_class_device *sysfs_open_class_device_devnum(int type,
+		unsigned int major, unsigned int minor);
+extern int sysfs_open_class_devices_devnum
+	(const struct sysfs_devnum *devnums,
+	 struct sysfs_class_device **clsdevs, int count);
 extern struct sysfs_class_device *sysfs_get_classdev_parent
 	(struct sysfs_class_device *clsdev);
+extern struct sysfs_uevent *sysfs_get_classdev_uevent
+	(struct sysfs_class_device *clsdev);
 extern struct sysfs_attribute *sysfs_get_classdev_attr
 	(struct sysfs_class_device *clsdev, const char *name);
 extern struct dlist *sysfs_get_classdev_attributes
 	(struct sysfs_class_device *clsdev);
+extern struct dlist *sysfs_get_classdev_attrs
+	(struct sysfs_class_device *clsdev, const char * const *names);
 extern struct sysfs_device *sysfs_get_classdev_device
 	(struct sysfs_class_device *clsdev);
 extern void sysfs_close_class(struct sysfs_class *cls);
@@ -219,6 +402,8 @@ extern struct sysfs_module *sysfs_open_module(const char *name);
 extern struct dlist *sysfs_get_module_parms(struct sysfs_module *module);
 extern struct dlist *sysfs_get_module_sections(struct sysfs_module *module);
 extern struct dlist *sysfs_get_module_attributes(struct sysfs_module *module);
+extern struct dlist *sysfs_get_module_attrs
+	(struct sysfs_module *module, const char * const *names);
 extern struct sysfs_attribute *sysfs_get_module_attr
 	(struct sysfs_module *module, const char *name);
 extern struct sysfs_attribute *sysfs_get_module_parm
@@ -226,6 +411,84 @@ extern struct sysfs_attribute *sysfs_get_module_parm
 extern struct sysfs_attribute *sysfs_get_module_section
 	(struct sysfs_module *module, const char *section);
 
+/* streaming bus and class iterators */
+extern void sysfs_close_iter(struct sysfs_iter *iter);
+extern struct sysfs_iter *sysfs_open_bus_device_iter
+	(struct sysfs_bus *bus, unsigned int flags);
+extern struct sysfs_device *sysfs_bus_device_iter_next
+	(struct sysfs_iter *iter);
+extern struct sysfs_iter *sysfs_open_bus_driver_iter
+	(struct sysfs_bus *bus, unsigned int flags);
+extern struct sysfs_driver *sysfs_bus_driver_iter_next
+	(struct sysfs_iter *iter);
+extern struct sysfs_iter *sysfs_open_class_device_iter
+	(struct sysfs_class *cls, unsigned int flags);
+extern struct sysfs_class_device *sysfs_class_device_iter_next
+	(struct sysfs_iter *iter);
+extern int sysfs_iter_add_match(struct sysfs_iter *iter, const char *key,
+	const char *pattern, unsigned int flags);
+
+/* device tree walk */
+extern int sysfs_walk(const char *root, sysfs_walk_fn visitor,
+		const struct sysfs_walk_opts *opts, void *data);
+extern struct sysfs_attribute *sysfs_walk_node_attr
+	(struct sysfs_walk_node *node, const char *name);
+extern struct sysfs_device *sysfs_walk_node_device
+	(struct sysfs_walk_node *node);
+
+/* uevent variables */
+extern const struct sysfs_uevent_var *sysfs_uevent_find
+	(const struct sysfs_uevent *uevent, const char *key);
+
+/* reference counting for objects shared between threads */
+extern struct sysfs_bus *sysfs_ref_bus(struct sysfs_bus *bus);
+extern struct sysfs_class *sysfs_ref_class(struct sysfs_class *cls);
+extern struct sysfs_device *sysfs_ref_device(struct sysfs_device *dev);
+extern struct sysfs_class_device *sysfs_ref_class_device
+	(struct sysfs_class_device *dev);
+extern struct sysfs_driver *sysfs_ref_driver(struct sysfs_driver *driver);
+extern struct sysfs_module *sysfs_ref_module(struct sysfs_module *module);
+extern void sysfs_thread_quiescent(void);
+
+/* bringing open objects up to date */
+extern int sysfs_refresh_bus(struct sysfs_bus *bus);
+extern int sysfs_refresh_class(struct sysfs_class *cls);
+extern int sysfs_refresh_class_device(struct sysfs_class_device *dev);
+extern int sysfs_refresh_device(struct sysfs_device *dev);
+extern int sysfs_refresh_driver(struct sysfs_driver *drv);
+
+/* kernel uevent monitor */
+extern struct sysfs_monitor *sysfs_open_monitor(void);
+extern struct sysfs_monitor *sysfs_open_monitor_fd(int fd);
+extern void sysfs_close_monitor(struct sysfs_monitor *mon);
+extern int sysfs_monitor_get_fd(struct sysfs_monitor *mon);
+extern int sysfs_monitor_watch_bus(struct sysfs_monitor *mon,
+		struct sysfs_bus *bus);
+extern int sysfs_monitor_watch_class(struct sysfs_monitor *mon,
+		struct sysfs_class *cls);
+extern int sysfs_monitor_receive(struct sysfs_monitor *mon,
+		struct sysfs_event *event);
+
+/* snapshots shared between processes */
+extern struct sysfs_snapshot *sysfs_open_snapshot(const char *name);
+extern void sysfs_close_snapshot(struct sysfs_snapshot *snap);
+extern int sysfs_publish_snapshot(struct sysfs_snapshot *snap);
+extern int sysfs_attach_snapshot(const char *name);
+extern void sysfs_detach_snapshot(void);
+extern int sysfs_write_cache(const char *path);
+extern int sysfs_attach_cache(const char *path);
+
+/* reverse indexes */
+extern void sysfs_close_index(struct sysfs_index *index);
+extern struct sysfs_index *sysfs_open_index(void);
+extern struct dlist *sysfs_index_get_device_classdevs
+	(struct sysfs_index *index, const char *devpath, unsigned int flags);
+extern struct sysfs_class_device *sysfs_index_get_devnum_classdev
+	(struct sysfs_index *index, int type, unsigned int major,
+	 unsigned int minor);
+extern const char *sysfs_index_get_driver_module(struct sysfs_index *index,
+		const char *bus, const char *driver);
+
 /**
  * sort_list: sorter function to keep list elements sorted in alphabetical
  * 	order. Just does a strncmp as you can see :)
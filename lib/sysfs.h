@@ -49,11 +49,88 @@ do { \
 /* Private routine for dlist integration. */
 extern void sysfs_close_dev_tree(void *dev);
 
-extern struct sysfs_attribute *get_attribute(void *dev, const char *name);
+extern struct sysfs_attribute *get_attribute(void *dev, const char *name,
+		struct sysfs_dirlist **dirlist);
+extern struct sysfs_attribute *get_attribute_at(void *dev, int dfd,
+		const char *name, struct sysfs_dirlist **dirlist);
 extern struct dlist *read_dir_subdirs(const char *path);
 extern struct dlist *read_dir_links(const char *path);
 extern struct dlist *get_dev_attributes_list(void *dev);
+extern struct dlist *get_dev_attributes_named(void *dev,
+		const char * const *names, struct sysfs_dirlist **dirlist);
 extern struct dlist *get_attributes_list(struct dlist *alist, const char *path);
+extern void free_uevent(struct sysfs_uevent *uevent);
+extern void stale_uevent(struct sysfs_uevent **slot);
+extern void free_dirlist(struct sysfs_dirlist *dirlist);
+extern int dirlist_type(struct sysfs_dirlist **dirlist, const char *name);
+extern void dirlist_load(struct sysfs_dirlist **dirlist, const char *path);
+extern int refresh_attributes(void *dev);
+extern void bump_generation(void);
+extern int drop_entries(struct dlist **list, void **gone,
+		unsigned long count);
+extern int refresh_list(struct dlist **list, struct dlist *names,
+		int (*refresh)(void *));
+extern int resolve_link_target(const char *dir, char *linkpath, char *target,
+		size_t len);
+
+/*
+ * Answers from an attached snapshot, see sysfs_snapshot.c. They return 1
+ * when there is no snapshot or it doesn't cover the path, and the caller
+ * is to ask sysfs itself.
+ */
+struct sysfs_dirstream;
+extern int snapshot_attached(void);
+extern int snapshot_stat(const char *path, int follow, int *type,
+		unsigned short *method);
+extern int snapshot_readlink(const char *path, char *target, size_t len);
+extern int snapshot_read(const char *path, char **value, size_t *len);
+extern struct sysfs_dirstream *dirstream_open(const char *path);
+extern struct dirent *dirstream_read(struct sysfs_dirstream *ds);
+extern int dirstream_fd(struct sysfs_dirstream *ds);
+extern void dirstream_close(struct sysfs_dirstream *ds);
+
+/*
+ * Lists held by objects (attributes, bus, class and driver devices...) are
+ * walked by callers without any lock, so a list once handed out is never
+ * changed. Additions and removals are made on a copy under the library
+ * wide recursive lock, and the copy then replaces the list whole. The
+ * lists it replaced and the entries dropped, like replaced attribute
+ * values and uevents, are kept until no thread can be using them or the
+ * holding object is closed, see sysfs_utils.c.
+ * Object reference counts hold the number of extra holders, so a freshly
+ * opened object is at 0 and the close that takes it below 0 frees it.
+ */
+extern struct dlist *shared_list_new(size_t size, void (*del_func)(void *));
+extern struct dlist *shared_list_get(struct dlist **list);
+extern void *shared_list_find(struct dlist **list, const char *name);
+extern void *shared_list_add(struct dlist **list, void *data, size_t size,
+		void (*del_func)(void *));
+extern int shared_list_merge(struct dlist **list, struct dlist *fresh);
+extern int shared_list_drop(struct dlist **list, int (*dead)(void *, void *),
+		void *arg);
+extern void shared_list_destroy(struct dlist *list);
+extern void reader_online(void);
+extern void retire_data(const void *owner, void *data,
+		void (*release)(void *), int self_done);
+extern void purge_retired(const void *owner);
+
+#ifdef SYSFS_THREAD_SAFE
+extern void sysfs_lock(void);
+extern void sysfs_unlock(void);
+#define sysfs_get_ref(obj) \
+	__atomic_add_fetch(&(obj)->refcount, 1, __ATOMIC_RELAXED)
+#define sysfs_put_ref(obj) \
+	(__atomic_fetch_sub(&(obj)->refcount, 1, __ATOMIC_ACQ_REL) > 0)
+#define load_acquire(p)		__atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define store_release(p, v)	__atomic_store_n(p, v, __ATOMIC_RELEASE)
+#else
+#define sysfs_lock()	do { } while (0)
+#define sysfs_unlock()	do { } while (0)
+#define sysfs_get_ref(obj)	(++(obj)->refcount)
+#define sysfs_put_ref(obj)	((obj)->refcount-- > 0)
+#define load_acquire(p)		(*(p))
+#define store_release(p, v)	(*(p) = (v))
+#endif
 
 /* Debugging */
 #ifdef DEBUG
@@ -32,40 +32,193 @@ static int sort_char(void *new, void *old)
 			strlen((char *)new))) < 0 ? 1 : 0);
 }
 
+/*
+ * How attribute values change, by name. A '*' in a pattern matches any
+ * run of characters. The first matching pattern wins, and attributes
+ * matching none are taken to be SYSFS_ATTR_CONFIG.
+ */
+struct attr_class_pattern {
+	const char *pattern;
+	enum sysfs_attribute_class attr_class;
+};
+
+static const struct attr_class_pattern builtin_classes[] = {
+	/* identity */
+	{ "bcdDevice",		SYSFS_ATTR_STATIC },
+	{ "class",		SYSFS_ATTR_STATIC },
+	{ "dev",		SYSFS_ATTR_STATIC },
+	{ "dev_id",		SYSFS_ATTR_STATIC },
+	{ "dev_port",		SYSFS_ATTR_STATIC },
+	{ "device",		SYSFS_ATTR_STATIC },
+	{ "idProduct",		SYSFS_ATTR_STATIC },
+	{ "idVendor",		SYSFS_ATTR_STATIC },
+	{ "ifindex",		SYSFS_ATTR_STATIC },
+	{ "local_cpulist",	SYSFS_ATTR_STATIC },
+	{ "local_cpus",		SYSFS_ATTR_STATIC },
+	{ "manufacturer",	SYSFS_ATTR_STATIC },
+	{ "modalias",		SYSFS_ATTR_STATIC },
+	{ "numa_node",		SYSFS_ATTR_STATIC },
+	{ "product",		SYSFS_ATTR_STATIC },
+	{ "removable",		SYSFS_ATTR_STATIC },
+	{ "revision",		SYSFS_ATTR_STATIC },
+	{ "serial",		SYSFS_ATTR_STATIC },
+	{ "subsystem_device",	SYSFS_ATTR_STATIC },
+	{ "subsystem_vendor",	SYSFS_ATTR_STATIC },
+	{ "vendor",		SYSFS_ATTR_STATIC },
+	/* statistics */
+	{ "carrier_changes",	SYSFS_ATTR_COUNTER },
+	{ "carrier_down_count",	SYSFS_ATTR_COUNTER },
+	{ "carrier_up_count",	SYSFS_ATTR_COUNTER },
+	{ "collisions",		SYSFS_ATTR_COUNTER },
+	{ "energy_uj",		SYSFS_ATTR_COUNTER },
+	{ "inflight",		SYSFS_ATTR_COUNTER },
+	{ "multicast",		SYSFS_ATTR_COUNTER },
+	{ "stat",		SYSFS_ATTR_COUNTER },
+	{ "tx_queue_len",	SYSFS_ATTR_CONFIG },
+	{ "rx_*",		SYSFS_ATTR_COUNTER },
+	{ "tx_*",		SYSFS_ATTR_COUNTER },
+	{ "*_input",		SYSFS_ATTR_COUNTER },	/* hwmon readings */
+	{ "*cur_freq",		SYSFS_ATTR_COUNTER },
+	{ NULL,			SYSFS_ATTR_CONFIG }
+};
+
+/* set with sysfs_set_attribute_class(), looked at before the above */
+static struct attr_class_pattern *user_classes;
+static int user_class_count;
+
+/* counts changes the library knows of, see sysfs_get_generation() */
+static unsigned int generation;
+
 /**
- * sysfs_del_name: free function for sysfs_open_subsystem_list
- * @name: memory area to be freed
+ * class_match: matches an attribute name against a pattern with at most
+ * 	one '*'
+ * returns 1 if they match and 0 if not
  */
-static void sysfs_del_name(void *name)
+static int class_match(const char *pattern, const char *name)
 {
-	free(name);
+	const char *star = strchr(pattern, '*');
+	size_t plen, nlen, slen;
+
+	if (!star)
+		return strcmp(pattern, name) == 0;
+	plen = star - pattern;
+	slen = strlen(star + 1);
+	nlen = strlen(name);
+	return nlen >= plen + slen && strncmp(pattern, name, plen) == 0 &&
+		strcmp(star + 1, name + nlen - slen) == 0;
 }
 
 /**
- * sysfs_del_attribute: routine for dlist integration
+ * sysfs_get_attribute_class: tells how an attribute's value changes
+ * @name: attribute name
+ * returns the class set with sysfs_set_attribute_class() for a pattern
+ * 	matching name, or else the library's own idea of it
  */
-static void sysfs_del_attribute(void *attr)
+enum sysfs_attribute_class sysfs_get_attribute_class(const char *name)
 {
-	sysfs_close_attribute((struct sysfs_attribute *)attr);
+	const struct attr_class_pattern *cls;
+	enum sysfs_attribute_class ret = SYSFS_ATTR_CONFIG;
+	int i;
+
+	if (!name)
+		return SYSFS_ATTR_CONFIG;
+	if (__atomic_load_n(&user_class_count, __ATOMIC_ACQUIRE)) {
+		sysfs_lock();
+		for (i = user_class_count - 1; i >= 0; i--) {
+			if (class_match(user_classes[i].pattern, name)) {
+				ret = user_classes[i].attr_class;
+				sysfs_unlock();
+				return ret;
+			}
+		}
+		sysfs_unlock();
+	}
+	for (cls = builtin_classes; cls->pattern; cls++) {
+		if (class_match(cls->pattern, name))
+			return cls->attr_class;
+	}
+	return ret;
 }
 
 /**
- * attr_name_equal: compares attributes by name
- * @a: attribute name for comparison
- * @b: sysfs_attribute to be compared.
- * returns 1 if a==b->name or 0 if not equal
+ * sysfs_set_attribute_class: overrides how attributes matching a pattern
+ * 	are taken to change, for attributes opened from now on. Later
+ * 	overrides win over earlier ones.
+ * @pattern: attribute name, a '*' in it matches any run of characters
+ * @attr_class: SYSFS_ATTR_STATIC, SYSFS_ATTR_CONFIG or SYSFS_ATTR_COUNTER
+ * returns 0 with success and -1 with error
  */
-static int attr_name_equal(void *a, void *b)
+int sysfs_set_attribute_class(const char *pattern,
+		enum sysfs_attribute_class attr_class)
 {
-	if (!a || !b)
-		return 0;
-
-	if (strcmp(((char *)a), ((struct sysfs_attribute *)b)->name) == 0)
-		return 1;
+	struct attr_class_pattern *vbuf;
+	const char *star = pattern ? strchr(pattern, '*') : NULL;
+	char *copy;
 
+	if (!pattern || !*pattern || (star && strchr(star + 1, '*')) ||
+			(attr_class != SYSFS_ATTR_STATIC &&
+			attr_class != SYSFS_ATTR_CONFIG &&
+			attr_class != SYSFS_ATTR_COUNTER)) {
+		errno = EINVAL;
+		return -1;
+	}
+	copy = strdup(pattern);
+	if (!copy)
+		return -1;
+	sysfs_lock();
+	vbuf = (struct attr_class_pattern *)realloc(user_classes,
+			(user_class_count + 1) *
+			sizeof(struct attr_class_pattern));
+	if (!vbuf) {
+		sysfs_unlock();
+		free(copy);
+		return -1;
+	}
+	user_classes = vbuf;
+	user_classes[user_class_count].pattern = copy;
+	user_classes[user_class_count].attr_class = attr_class;
+	__atomic_store_n(&user_class_count, user_class_count + 1,
+							__ATOMIC_RELEASE);
+	sysfs_unlock();
 	return 0;
 }
 
+/**
+ * sysfs_get_generation: returns the library's generation, which moves on
+ * 	whenever it learns that sysfs may have changed: with each uevent
+ * 	sysfs_monitor_receive() reads and each attribute written. Every
+ * 	attribute records the generation its value was read at.
+ */
+unsigned int sysfs_get_generation(void)
+{
+	return __atomic_load_n(&generation, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * bump_generation: moves the library's generation on
+ */
+void bump_generation(void)
+{
+	__atomic_add_fetch(&generation, 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * sysfs_del_name: free function for sysfs_open_subsystem_list
+ * @name: memory area to be freed
+ */
+static void sysfs_del_name(void *name)
+{
+	free(name);
+}
+
+/**
+ * sysfs_del_attribute: routine for dlist integration
+ */
+static void sysfs_del_attribute(void *attr)
+{
+	sysfs_close_attribute((struct sysfs_attribute *)attr);
+}
+
 /**
  * sysfs_close_attribute: closes and cleans up attribute
  * @sysattr: attribute to close.
@@ -73,6 +226,7 @@ static int attr_name_equal(void *a, void *b)
 void sysfs_close_attribute(struct sysfs_attribute *sysattr)
 {
 	if (sysattr) {
+		purge_retired(sysattr);
 		if (sysattr->value)
 			free(sysattr->value);
 		free(sysattr);
@@ -98,6 +252,8 @@ struct sysfs_attribute *sysfs_open_attribute(const char *path)
 {
 	struct sysfs_attribute *sysattr = NULL;
 	struct stat fileinfo;
+	unsigned short method = 0;
+	int ret, type;
 
 	if (!path) {
 		errno = EINVAL;
@@ -115,33 +271,121 @@ struct sysfs_attribute *sysfs_open_attribute(const char *path)
 		return NULL;
 	}
 	safestrcpy(sysattr->path, path);
-	if ((stat(sysattr->path, &fileinfo)) != 0) {
+	ret = snapshot_stat(sysattr->path, 1, &type, &method);
+	if (ret > 0) {
+		ret = stat(sysattr->path, &fileinfo);
+		if (ret == 0 && (fileinfo.st_mode & S_IRUSR))
+			method |= SYSFS_METHOD_SHOW;
+		if (ret == 0 && (fileinfo.st_mode & S_IWUSR))
+			method |= SYSFS_METHOD_STORE;
+	}
+	if (ret != 0) {
 		dbg_printf("Stat failed: No such attribute?\n");
-		sysattr->method = 0;
 		free(sysattr);
-		sysattr = NULL;
-	} else {
-		if (fileinfo.st_mode & S_IRUSR)
-			sysattr->method |= SYSFS_METHOD_SHOW;
-		if (fileinfo.st_mode & S_IWUSR)
-			sysattr->method |= SYSFS_METHOD_STORE;
+		return NULL;
 	}
+	sysattr->method = method;
+	sysattr->attr_class = sysfs_get_attribute_class(sysattr->name);
 
 	return sysattr;
 }
 
 /**
- * sysfs_read_attribute: reads value from attribute
- * @sysattr: attribute to read
+ * set_attribute_value: swaps a newly read value into the attribute. The
+ * 	old value is freed once other threads can't be reading it.
+ * @sysattr: attribute read
+ * @vbuf: malloc()ed value, NUL terminated, owned by the attribute after
+ * @length: value length
+ */
+static void set_attribute_value(struct sysfs_attribute *sysattr, char *vbuf,
+				size_t length)
+{
+	char *old;
+
+	/* this thread holds the new value from here on */
+	reader_online();
+	/* the read may block, only swapping in the value needs the lock */
+	sysfs_lock();
+	sysattr->generation = sysfs_get_generation();
+	old = sysattr->value;
+	if (old && sysattr->len == length && !strncmp(old, vbuf, length)) {
+		sysfs_unlock();
+		free(vbuf);
+		return;
+	}
+	sysattr->len = length;
+	store_release(&sysattr->value, vbuf);
+	if (old)
+		retire_data(sysattr, old, free, 1);
+	sysfs_unlock();
+}
+
+/**
+ * read_attribute_fd: reads value from an attribute already opened as fd.
+ * 	Reads from offset 0, sysfs hands out a fresh value each time.
+ * @sysattr: attribute to read into
+ * @fd: open descriptor for the attribute, left open
  * returns 0 with success and -1 with error.
  */
-int sysfs_read_attribute(struct sysfs_attribute *sysattr)
+static int read_attribute_fd(struct sysfs_attribute *sysattr, int fd)
 {
 	char *fbuf = NULL;
 	char *vbuf = NULL;
 	ssize_t length = 0;
 	long pgsize = 0;
-	int fd;
+
+	pgsize = getpagesize();
+	fbuf = (char *)calloc(1, pgsize+1);
+	if (!fbuf) {
+		dbg_printf("calloc failed\n");
+		return -1;
+	}
+	length = pread(fd, fbuf, pgsize, 0);
+	if (length < 0) {
+		dbg_printf("Error reading from attribute %s\n", sysattr->path);
+		free(fbuf);
+		return -1;
+	}
+	vbuf = (char *)realloc(fbuf, length+1);
+	if (!vbuf) {
+		dbg_printf("realloc failed\n");
+		free(fbuf);
+		return -1;
+	}
+	set_attribute_value(sysattr, vbuf, length);
+
+	return 0;
+}
+
+/**
+ * read_attribute_file: reads the attribute's value from sysfs itself
+ * @sysattr: attribute to read
+ * returns 0 with success and -1 with error.
+ */
+static int read_attribute_file(struct sysfs_attribute *sysattr)
+{
+	int fd, ret;
+
+	if ((fd = open(sysattr->path, O_RDONLY)) < 0) {
+		dbg_printf("Error reading attribute %s\n", sysattr->path);
+		return -1;
+	}
+	ret = read_attribute_fd(sysattr, fd);
+	close(fd);
+
+	return ret;
+}
+
+/**
+ * sysfs_read_attribute: reads value from attribute
+ * @sysattr: attribute to read
+ * returns 0 with success and -1 with error.
+ */
+int sysfs_read_attribute(struct sysfs_attribute *sysattr)
+{
+	char *vbuf;
+	size_t length;
+	int ret;
 
 	if (!sysattr) {
 		errno = EINVAL;
@@ -153,44 +397,102 @@ int sysfs_read_attribute(struct sysfs_attribute *sysattr)
 		errno = EACCES;
 		return -1;
 	}
-	pgsize = getpagesize();
-	fbuf = (char *)calloc(1, pgsize+1);
-	if (!fbuf) {
-		dbg_printf("calloc failed\n");
+	ret = snapshot_read(sysattr->path, &vbuf, &length);
+	if (ret > 0)
+		return read_attribute_file(sysattr);
+	if (ret == 0)
+		set_attribute_value(sysattr, vbuf, length);
+
+	return ret;
+}
+
+/**
+ * sysfs_read_attribute_fd: reads value from attribute through a
+ * 	descriptor the caller keeps open, so that an attribute read over
+ * 	and over isn't opened each time
+ * @sysattr: attribute to read
+ * @fd: descriptor opened read only on sysattr->path
+ * returns 0 with success and -1 with error.
+ */
+int sysfs_read_attribute_fd(struct sysfs_attribute *sysattr, int fd)
+{
+	if (!sysattr || fd < 0) {
+		errno = EINVAL;
 		return -1;
 	}
-	if ((fd = open(sysattr->path, O_RDONLY)) < 0) {
-		dbg_printf("Error reading attribute %s\n", sysattr->path);
-		free(fbuf);
+	if (!(sysattr->method & SYSFS_METHOD_SHOW)) {
+		dbg_printf("Show method not supported for attribute %s\n",
+			sysattr->path);
+		errno = EACCES;
 		return -1;
 	}
-	length = read(fd, fbuf, pgsize);
-	if (length < 0) {
-		dbg_printf("Error reading from attribute %s\n", sysattr->path);
-		close(fd);
-		free(fbuf);
+	return read_attribute_fd(sysattr, fd);
+}
+
+/**
+ * sysfs_read_attribute_at: reads part of an attribute straight into the
+ * 	caller's buffer, such as a few bytes of a binary attribute. The
+ * 	attribute's value is left as it is.
+ * @sysattr: attribute to read
+ * @buf: where to put what is read
+ * @len: number of bytes to read
+ * @offset: where in the attribute to start
+ * returns the number of bytes read, less than len only at the end of
+ * 	the attribute, and -1 with error.
+ */
+ssize_t sysfs_read_attribute_at(struct sysfs_attribute *sysattr, void *buf,
+		size_t len, off_t offset)
+{
+	char *vbuf;
+	size_t length, done = 0;
+	ssize_t n;
+	int fd, ret;
+
+	if (!sysattr || !buf || offset < 0) {
+		errno = EINVAL;
 		return -1;
 	}
-	if (sysattr->len > 0) {
-		if ((sysattr->len == length) &&
-				(!(strncmp(sysattr->value, fbuf, length)))) {
-			close(fd);
-			free(fbuf);
-			return 0;
+	if (!(sysattr->method & SYSFS_METHOD_SHOW)) {
+		dbg_printf("Show method not supported for attribute %s\n",
+			sysattr->path);
+		errno = EACCES;
+		return -1;
+	}
+	ret = snapshot_read(sysattr->path, &vbuf, &length);
+	if (ret < 0)
+		return -1;
+	if (ret == 0) {
+		if ((size_t)offset < length) {
+			done = length - offset;
+			if (done > len)
+				done = len;
+			memcpy(buf, vbuf + offset, done);
 		}
-		free(sysattr->value);
+		free(vbuf);
+		return done;
 	}
-	sysattr->len = length;
-	close(fd);
-	vbuf = (char *)realloc(fbuf, length+1);
-	if (!vbuf) {
-		dbg_printf("realloc failed\n");
-		free(fbuf);
+
+	if ((fd = open(sysattr->path, O_RDONLY)) < 0) {
+		dbg_printf("Error opening attribute %s\n", sysattr->path);
 		return -1;
 	}
-	sysattr->value = vbuf;
+	while (done < len) {
+		n = pread(fd, (char *)buf + done, len - done, offset + done);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n < 0) {
+			dbg_printf("Error reading from attribute %s\n",
+				sysattr->path);
+			close(fd);
+			return -1;
+		}
+		if (n == 0)
+			break;
+		done += n;
+	}
+	close(fd);
 
-	return 0;
+	return done;
 }
 
 /**
@@ -203,6 +505,7 @@ int sysfs_read_attribute(struct sysfs_attribute *sysattr)
 int sysfs_write_attribute(struct sysfs_attribute *sysattr,
 		const char *new_value, size_t len)
 {
+	char *vbuf;
 	int fd;
 	int length;
 
@@ -217,18 +520,22 @@ int sysfs_write_attribute(struct sysfs_attribute *sysattr,
 		errno = EACCES;
 		return -1;
 	}
+	sysfs_lock();
 	if (sysattr->method & SYSFS_METHOD_SHOW) {
 		/*
-		 * read attribute again to see if we can get an updated value
+		 * read attribute again to see if we can get an updated value,
+		 * from sysfs since a snapshot may lag behind
 		 */
-		if ((sysfs_read_attribute(sysattr))) {
+		if ((read_attribute_file(sysattr))) {
 			dbg_printf("Error reading attribute\n");
+			sysfs_unlock();
 			return -1;
 		}
 		if ((strncmp(sysattr->value, new_value, sysattr->len)) == 0 &&
 				(len == sysattr->len)) {
 			dbg_printf("Attr %s already has the requested value %s\n",
 					sysattr->name, new_value);
+			sysfs_unlock();
 			return 0;
 		}
 	}
@@ -238,6 +545,7 @@ int sysfs_write_attribute(struct sysfs_attribute *sysattr,
 	 */
 	if ((fd = open(sysattr->path, O_WRONLY)) < 0) {
 		dbg_printf("Error reading attribute %s\n", sysattr->path);
+		sysfs_unlock();
 		return -1;
 	}
 
@@ -246,6 +554,7 @@ int sysfs_write_attribute(struct sysfs_attribute *sysattr,
 		dbg_printf("Error writing to the attribute %s - invalid value?\n",
 			sysattr->name);
 		close(fd);
+		sysfs_unlock();
 		return -1;
 	} else if ((unsigned int)length != len) {
 		dbg_printf("Could not write %zd bytes to attribute %s\n",
@@ -257,6 +566,7 @@ int sysfs_write_attribute(struct sysfs_attribute *sysattr,
 		if (sysattr->method & SYSFS_METHOD_SHOW) {
 			length = write(fd, sysattr->value, sysattr->len);
 			close(fd);
+			sysfs_unlock();
 			return -1;
 		}
 	}
@@ -266,30 +576,28 @@ int sysfs_write_attribute(struct sysfs_attribute *sysattr,
 	 * in sysfs_attribute. Verify first if the attribute supports reading
 	 * (show method). If it does not, do not bother
 	 */
-	if (sysattr->method & SYSFS_METHOD_SHOW) {
-		if (length != sysattr->len) {
-			sysattr->value = (char *)realloc
-				(sysattr->value, length);
-			sysattr->len = length;
-			safestrcpymax(sysattr->value, new_value, length);
-		} else {
-			/*"length" of the new value is same as old one */
-			safestrcpymax(sysattr->value, new_value, length);
+	if ((sysattr->method & SYSFS_METHOD_SHOW) && length > 0) {
+		/* readers may hold the old value, it is swapped, not reused */
+		vbuf = (char *)calloc(1, length + 1);
+		if (vbuf) {
+			safestrcpymax(vbuf, new_value, length);
+			set_attribute_value(sysattr, vbuf, length);
 		}
 	}
+	bump_generation();
+	sysattr->generation = sysfs_get_generation();
 
 	close(fd);
+	sysfs_unlock();
 	return 0;
 }
 
 /**
- * add_attribute_to_list: open and add attribute at path to given dlist
- * @list: dlist attribute is to be added
+ * read_new_attribute: opens and reads the attribute at path
  * @path: path to attribute
- * returns pointer to attr added with success and NULL with error.
+ * returns the attribute, not on any list yet, and NULL with error
  */
-static struct sysfs_attribute *add_attribute_to_list(struct dlist *alist,
-							const char *path)
+static struct sysfs_attribute *read_new_attribute(const char *path)
 {
 	struct sysfs_attribute *attr;
 
@@ -305,80 +613,482 @@ static struct sysfs_attribute *add_attribute_to_list(struct dlist *alist,
 			return NULL;
 		}
 	}
-
-	if (!alist) {
-		alist = dlist_new_with_delete
-			(sizeof(struct sysfs_attribute), sysfs_del_attribute);
-	}
-	dlist_unshift_sorted(alist, attr, sort_list);
 	return attr;
 }
 
 /**
- * add_attribute: open and add attribute at path to given directory
- * @dev: device whose attribute is to be added
+ * add_attribute_to_list: open and add attribute at path to given dlist
+ * @list: dlist attribute is to be added
  * @path: path to attribute
  * returns pointer to attr added with success and NULL with error.
  */
-static struct sysfs_attribute *add_attribute(void *dev, const char *path)
+static struct sysfs_attribute *add_attribute_to_list(struct dlist *alist,
+							const char *path)
 {
 	struct sysfs_attribute *attr;
 
-	attr = sysfs_open_attribute(path);
-	if (!attr) {
-		dbg_printf("Error opening attribute %s\n",	path);
+	attr = read_new_attribute(path);
+	if (attr)
+		dlist_unshift_sorted(alist, attr, sort_list);
+	return attr;
+}
+
+/**
+ * attach_attribute: adds an attribute to the object's attrlist unless one
+ * 	with the same name got there first
+ * @dev: object the attribute belongs to
+ * @attr: freshly opened attribute, closed if it loses the race
+ * returns the attribute in the list
+ */
+static struct sysfs_attribute *attach_attribute(void *dev,
+					struct sysfs_attribute *attr)
+{
+	if (!attr)
+		return NULL;
+	/* another thread may have read it while we did */
+	return (struct sysfs_attribute *)shared_list_add
+		(&((struct sysfs_device *)dev)->attrlist, attr,
+		 sizeof(struct sysfs_attribute), sysfs_del_attribute);
+}
+
+/**
+ * find_attribute: looks up an already read attribute by name
+ * @dev: object whose attrlist is searched
+ * @name: attribute name
+ * returns the attribute or NULL if it hasn't been read yet
+ */
+static struct sysfs_attribute *find_attribute(void *dev, const char *name)
+{
+	return (struct sysfs_attribute *)shared_list_find
+			(&((struct sysfs_device *)dev)->attrlist, name);
+}
+
+/*
+ * A directory listing taken the first time a lookup in an object's
+ * directory misses. Names are kept sorted in one buffer so that the next
+ * misses are answered by a binary search instead of a failed stat().
+ */
+struct dirlist_entry {
+	const char *name;
+	size_t offset;			/* of name in buf, while reading */
+	unsigned char type;		/* d_type, DT_UNKNOWN if not given */
+};
+
+struct sysfs_dirlist {
+	int count;
+	struct dirlist_entry *entries;
+	char *buf;
+};
+
+/**
+ * free_dirlist: frees a directory listing
+ * @dirlist: listing to free
+ */
+void free_dirlist(struct sysfs_dirlist *dirlist)
+{
+	if (dirlist) {
+		free(dirlist->entries);
+		free(dirlist->buf);
+		free(dirlist);
+	}
+}
+
+static int dirlist_entry_cmp(const void *a, const void *b)
+{
+	return strcmp(((const struct dirlist_entry *)a)->name,
+			((const struct dirlist_entry *)b)->name);
+}
+
+/**
+ * read_dirlist: lists the entries of a directory with their types
+ * @path: directory to list
+ * returns the sorted listing with success and NULL with error
+ */
+static struct sysfs_dirlist *read_dirlist(const char *path)
+{
+	struct sysfs_dirlist *dirlist;
+	struct dirent *dirent;
+	size_t len, used = 0, size = SYSFS_PATH_MAX;
+	int i, max = 32;
+	void *vbuf;
+	struct sysfs_dirstream *dir;
+
+	dir = dirstream_open(path);
+	if (!dir) {
+		dbg_printf("Error opening directory %s\n", path);
 		return NULL;
 	}
-	if (attr->method & SYSFS_METHOD_SHOW) {
-		if (sysfs_read_attribute(attr)) {
-			dbg_printf("Error reading attribute %s\n",	path);
-			sysfs_close_attribute(attr);
-			return NULL;
+	dirlist = (struct sysfs_dirlist *)calloc(1,
+					sizeof(struct sysfs_dirlist));
+	if (!dirlist)
+		goto fail;
+	dirlist->buf = (char *)malloc(size);
+	dirlist->entries = (struct dirlist_entry *)calloc(max,
+					sizeof(struct dirlist_entry));
+	if (!dirlist->buf || !dirlist->entries)
+		goto fail;
+
+	while ((dirent = dirstream_read(dir)) != NULL) {
+		if (0 == strcmp(dirent->d_name, "."))
+			continue;
+		if (0 == strcmp(dirent->d_name, ".."))
+			continue;
+		len = strlen(dirent->d_name) + 1;
+		if (used + len > size) {
+			size = 2 * size + len;
+			vbuf = realloc(dirlist->buf, size);
+			if (!vbuf)
+				goto fail;
+			dirlist->buf = (char *)vbuf;
+		}
+		if (dirlist->count == max) {
+			max *= 2;
+			vbuf = realloc(dirlist->entries,
+					max * sizeof(struct dirlist_entry));
+			if (!vbuf)
+				goto fail;
+			dirlist->entries = (struct dirlist_entry *)vbuf;
 		}
+		memcpy(dirlist->buf + used, dirent->d_name, len);
+		dirlist->entries[dirlist->count].offset = used;
+		dirlist->entries[dirlist->count].type = dirent->d_type;
+		dirlist->count++;
+		used += len;
 	}
+	dirstream_close(dir);
+
+	/* buf doesn't move any more */
+	for (i = 0; i < dirlist->count; i++)
+		dirlist->entries[i].name = dirlist->buf +
+						dirlist->entries[i].offset;
+	qsort(dirlist->entries, dirlist->count, sizeof(struct dirlist_entry),
+							dirlist_entry_cmp);
+	return dirlist;
+
+fail:
+	dbg_printf("Error listing directory %s\n", path);
+	dirstream_close(dir);
+	free_dirlist(dirlist);
+	return NULL;
+}
+
+/**
+ * dirlist_type: looks a name up in an object's directory listing
+ * @dirlist: the object's listing, may be NULL for objects without one
+ * @name: entry to look up
+ * returns the entry's d_type, DT_UNKNOWN if there is no listing yet or
+ * 	the filesystem didn't give the type, and -1 if the listing says
+ * 	there is no such entry
+ */
+int dirlist_type(struct sysfs_dirlist **dirlist, const char *name)
+{
+	struct dirlist_entry want, *entry;
+	int type = DT_UNKNOWN;
 
-	if (!((struct sysfs_device *)dev)->attrlist) {
-		((struct sysfs_device *)dev)->attrlist = dlist_new_with_delete
-			(sizeof(struct sysfs_attribute), sysfs_del_attribute);
+	if (!dirlist)
+		return DT_UNKNOWN;
+
+	want.name = name;
+	sysfs_lock();
+	if (*dirlist) {
+		entry = (struct dirlist_entry *)bsearch(&want,
+				(*dirlist)->entries, (*dirlist)->count,
+				sizeof(struct dirlist_entry), dirlist_entry_cmp);
+		type = entry ? entry->type : -1;
 	}
-	dlist_unshift_sorted(((struct sysfs_device *)dev)->attrlist,
-			attr, sort_list);
+	sysfs_unlock();
+	return type;
+}
 
-	return attr;
+/**
+ * dirlist_load: lists the object's directory after a lookup in it
+ * 	missed, unless that was done before
+ * @dirlist: the object's listing, may be NULL for objects without one
+ * @path: the object's directory
+ */
+void dirlist_load(struct sysfs_dirlist **dirlist, const char *path)
+{
+	struct sysfs_dirlist *new;
+
+	if (!dirlist)
+		return;
+
+	sysfs_lock();
+	new = *dirlist;
+	sysfs_unlock();
+	if (new)
+		return;
+
+	new = read_dirlist(path);
+	if (!new)
+		return;
+	sysfs_lock();
+	if (*dirlist)
+		free_dirlist(new);
+	else
+		*dirlist = new;
+	sysfs_unlock();
 }
 
 /*
- * get_attribute - given a sysfs_* struct and a name, return the
- * sysfs_attribute corresponding to "name"
+ * open_attribute - opens and reads the attribute "name" of a sysfs_*
+ * struct, without adding it to the struct's attrlist
  * returns sysfs_attribute on success and NULL on error
  */
-struct sysfs_attribute *get_attribute(void *dev, const char *name)
+static struct sysfs_attribute *open_attribute(void *dev, const char *name,
+					struct sysfs_dirlist **dirlist)
 {
 	struct sysfs_attribute *cur = NULL;
 	char path[SYSFS_PATH_MAX];
+	int type;
 
-	if (!dev || !name) {
-		errno = EINVAL;
+	/* an earlier miss may already have told us it isn't there */
+	type = dirlist_type(dirlist, name);
+	if (type != DT_UNKNOWN && type != DT_REG && type != DT_LNK) {
+		errno = ENOENT;
 		return NULL;
 	}
-
-	if (((struct sysfs_device *)dev)->attrlist) {
-		/* check if attr is already in the list */
-		cur = (struct sysfs_attribute *)dlist_find_custom
-			((((struct sysfs_device *)dev)->attrlist),
-			 	(void *)name, attr_name_equal);
-		if (cur)
-			return cur;
-	}
 	safestrcpymax(path, ((struct sysfs_device *)dev)->path,
 			SYSFS_PATH_MAX);
 	safestrcatmax(path, "/", SYSFS_PATH_MAX);
 	safestrcatmax(path, name, SYSFS_PATH_MAX);
 	if (!sysfs_path_is_file(path))
-		cur = add_attribute((void *)dev, path);
+		cur = read_new_attribute(path);
+	else
+		dirlist_load(dirlist, ((struct sysfs_device *)dev)->path);
+	return cur;
+}
+
+/*
+ * get_attribute - given a sysfs_* struct and a name, return the
+ * sysfs_attribute corresponding to "name"
+ * returns sysfs_attribute on success and NULL on error
+ */
+struct sysfs_attribute *get_attribute(void *dev, const char *name,
+					struct sysfs_dirlist **dirlist)
+{
+	struct sysfs_attribute *cur = NULL;
+
+	if (!dev || !name) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	/* check if attr is already in the list */
+	cur = find_attribute(dev, name);
+	if (cur)
+		return cur;
+	return attach_attribute(dev, open_attribute(dev, name, dirlist));
+}
+
+/*
+ * open_attribute_at - like open_attribute, but resolves "name" relative
+ * to an already open directory fd for the sysfs_* struct's path. This
+ * saves the path lookups when many attributes are read from one
+ * directory. A dfd of -1, for a directory listed from a snapshot, looks
+ * up by path.
+ * returns sysfs_attribute on success and NULL on error
+ */
+static struct sysfs_attribute *open_attribute_at(void *dev, int dfd,
+			const char *name, struct sysfs_dirlist **dirlist)
+{
+	struct sysfs_attribute *cur = NULL;
+	struct stat fileinfo;
+	int fd, type;
+
+	if (dfd < 0)
+		return open_attribute(dev, name, dirlist);
+
+	type = dirlist_type(dirlist, name);
+	if (type != DT_UNKNOWN && type != DT_REG) {
+		errno = ENOENT;
+		return NULL;
+	}
+	if (fstatat(dfd, name, &fileinfo, AT_SYMLINK_NOFOLLOW) != 0) {
+		dirlist_load(dirlist, ((struct sysfs_device *)dev)->path);
+		return NULL;
+	}
+	if (!S_ISREG(fileinfo.st_mode)) {
+		dirlist_load(dirlist, ((struct sysfs_device *)dev)->path);
+		errno = EINVAL;
+		return NULL;
+	}
+	cur = alloc_attribute();
+	if (!cur) {
+		dbg_printf("Error allocating attribute %s\n", name);
+		return NULL;
+	}
+	safestrcpy(cur->name, name);
+	safestrcpy(cur->path, ((struct sysfs_device *)dev)->path);
+	safestrcat(cur->path, "/");
+	safestrcat(cur->path, name);
+	if (fileinfo.st_mode & S_IRUSR)
+		cur->method |= SYSFS_METHOD_SHOW;
+	if (fileinfo.st_mode & S_IWUSR)
+		cur->method |= SYSFS_METHOD_STORE;
+	cur->attr_class = sysfs_get_attribute_class(name);
+
+	if (cur->method & SYSFS_METHOD_SHOW) {
+		fd = openat(dfd, name, O_RDONLY);
+		if (fd < 0 || read_attribute_fd(cur, fd)) {
+			dbg_printf("Error reading attribute %s\n", cur->path);
+			if (fd >= 0)
+				close(fd);
+			sysfs_close_attribute(cur);
+			return NULL;
+		}
+		close(fd);
+	}
 	return cur;
 }
 
+/*
+ * get_attribute_at - like get_attribute, but opens "name" relative to an
+ * already open directory fd, see open_attribute_at()
+ * returns sysfs_attribute on success and NULL on error
+ */
+struct sysfs_attribute *get_attribute_at(void *dev, int dfd, const char *name,
+					struct sysfs_dirlist **dirlist)
+{
+	struct sysfs_attribute *cur = NULL;
+
+	if (!dev || !name) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	/* check if attr is already in the list */
+	cur = find_attribute(dev, name);
+	if (cur)
+		return cur;
+	return attach_attribute(dev,
+			open_attribute_at(dev, dfd, name, dirlist));
+}
+
+/**
+ * get_dev_attributes_named: reads only the named attributes of the given
+ * 	sysfs_* struct into its attrlist, all at once. The directory is
+ * 	opened once and never scanned; names the object doesn't have are
+ * 	skipped.
+ * @dev: object whose attributes are needed
+ * @names: NULL terminated list of attribute names
+ * @dirlist: the object's directory listing, NULL if it keeps none
+ * returns dlist of attributes on success and NULL on failure
+ */
+struct dlist *get_dev_attributes_named(void *dev, const char * const *names,
+					struct sysfs_dirlist **dirlist)
+{
+	struct sysfs_attribute *attr;
+	struct dlist *fresh;
+	int dfd = -1;
+
+	if (!dev || !names) {
+		errno = EINVAL;
+		return NULL;
+	}
+	fresh = dlist_new_with_delete(sizeof(struct sysfs_attribute),
+						sysfs_del_attribute);
+	if (!fresh)
+		return NULL;
+	/* with a snapshot attached, lookups by path don't touch sysfs */
+	if (!snapshot_attached()) {
+		dfd = open(((struct sysfs_device *)dev)->path,
+					O_RDONLY | O_DIRECTORY);
+		if (dfd < 0) {
+			dbg_printf("Error opening directory %s\n",
+					((struct sysfs_device *)dev)->path);
+			dlist_destroy(fresh);
+			return NULL;
+		}
+	}
+	for (; *names; names++) {
+		if (find_attribute(dev, *names))
+			continue;
+		attr = open_attribute_at(dev, dfd, *names, dirlist);
+		if (attr)
+			dlist_push(fresh, attr);
+		else
+			dbg_printf("Attribute %s not present at %s\n", *names,
+					((struct sysfs_device *)dev)->path);
+	}
+	if (dfd >= 0)
+		close(dfd);
+	shared_list_merge(&((struct sysfs_device *)dev)->attrlist, fresh);
+	return shared_list_get(&((struct sysfs_device *)dev)->attrlist);
+}
+
+/**
+ * refresh_attributes: re-reads the attributes already in a sysfs_*
+ * 	struct's attrlist and drops those whose file is gone. Attributes
+ * 	that were never read are left to be read on demand, static ones
+ * 	that were are left alone.
+ * @dev: object whose attributes are to be refreshed
+ * returns 0 with success and -1 with error
+ */
+int refresh_attributes(void *dev)
+{
+	struct dlist *alist;
+	struct dl_node *node;
+	struct sysfs_attribute *attr;
+	void **gone;
+	unsigned long count = 0;
+	int ret;
+
+	if (!dev) {
+		errno = EINVAL;
+		return -1;
+	}
+	alist = shared_list_get(&((struct sysfs_device *)dev)->attrlist);
+	if (!alist)
+		return 0;
+	gone = (void **)calloc(alist->count + 1, sizeof(void *));
+	if (!gone)
+		return -1;
+	/*
+	 * alist is never changed, so the reads run without the lock, which
+	 * is only taken to swap in each value and to drop the gone ones
+	 */
+	dlist_for_each_nomark(alist, node) {
+		attr = (struct sysfs_attribute *)node->data;
+		if (!(attr->method & SYSFS_METHOD_SHOW))
+			continue;
+		/* a static value doesn't change while the object is there */
+		if (attr->attr_class == SYSFS_ATTR_STATIC && attr->value)
+			continue;
+		if (!sysfs_read_attribute(attr) || errno != ENOENT)
+			continue;
+		dbg_printf("Attribute %s is gone\n", attr->path);
+		gone[count++] = attr;
+	}
+	ret = drop_entries(&((struct sysfs_device *)dev)->attrlist, gone,
+								count);
+	free(gone);
+	return ret;
+}
+
+/**
+ * sysfs_get_list_attrs: reads the named attributes for every object in
+ * 	a list of libsysfs objects, such as the one returned by
+ * 	sysfs_get_bus_devices() or sysfs_get_class_devices()
+ * @list: list of sysfs_* structs
+ * @names: NULL terminated list of attribute names
+ * returns 0 with success and -1 with error.
+ */
+int sysfs_get_list_attrs(struct dlist *list, const char * const *names)
+{
+	struct dl_node *node;
+	void *dev;
+
+	if (!list || !names) {
+		errno = EINVAL;
+		return -1;
+	}
+	dlist_for_each_data_nomark(list, node, dev, void)
+		get_dev_attributes_named(dev, names, NULL);
+
+	return 0;
+}
+
 /**
  * read_dir_links: grabs links in a specific directory
  * @sysdir: sysfs directory to read
@@ -386,7 +1096,7 @@ struct sysfs_attribute *get_attribute(void *dev, const char *name)
  */
 struct dlist *read_dir_links(const char *path)
 {
-	DIR *dir = NULL;
+	struct sysfs_dirstream *dir = NULL;
 	struct dirent *dirent = NULL;
 	char file_path[SYSFS_PATH_MAX], *linkname;
 	struct dlist *linklist = NULL;
@@ -395,12 +1105,12 @@ struct dlist *read_dir_links(const char *path)
 		errno = EINVAL;
 		return NULL;
 	}
-	dir = opendir(path);
+	dir = dirstream_open(path);
 	if (!dir) {
 		dbg_printf("Error opening directory %s\n", path);
 		return NULL;
 	}
-	while ((dirent = readdir(dir)) != NULL) {
+	while ((dirent = dirstream_read(dir)) != NULL) {
 		if (0 == strcmp(dirent->d_name, "."))
 			 continue;
 		if (0 == strcmp(dirent->d_name, ".."))
@@ -415,7 +1125,7 @@ struct dlist *read_dir_links(const char *path)
 					(SYSFS_NAME_LEN, sysfs_del_name);
 				if (!linklist) {
 					dbg_printf("Error creating list\n");
-					closedir(dir);
+					dirstream_close(dir);
 					return NULL;
 				}
 			}
@@ -424,7 +1134,7 @@ struct dlist *read_dir_links(const char *path)
 			dlist_unshift_sorted(linklist, linkname, sort_char);
 		}
 	}
-	closedir(dir);
+	dirstream_close(dir);
 	return linklist;
 }
 
@@ -435,7 +1145,7 @@ static int add_subdirectory(struct sysfs_device *dev, char *path)
 	if (!path)
 		return -1;
 
-	newdev = sysfs_open_device_path(path);
+	newdev = sysfs_open_device_path_flags(path, 0);
 	if (newdev == NULL)
 		return -1;
 
@@ -454,7 +1164,7 @@ static int add_subdirectory(struct sysfs_device *dev, char *path)
  */
 struct sysfs_device *sysfs_read_dir_subdirs(const char *path)
 {
-	DIR *dir = NULL;
+	struct sysfs_dirstream *dir = NULL;
 	struct dirent *dirent = NULL;
 	char file_path[SYSFS_PATH_MAX];
 	struct sysfs_device *dev = NULL;
@@ -466,13 +1176,13 @@ struct sysfs_device *sysfs_read_dir_subdirs(const char *path)
 
 	dev = sysfs_open_device_path(path);
 
-	dir = opendir(path);
+	dir = dirstream_open(path);
 	if (!dir) {
 		dbg_printf("Error opening directory %s\n", path);
 		sysfs_close_device(dev);
 		return NULL;
 	}
-	while ((dirent = readdir(dir)) != NULL) {
+	while ((dirent = dirstream_read(dir)) != NULL) {
 		if (0 == strcmp(dirent->d_name, "."))
 			 continue;
 		if (0 == strcmp(dirent->d_name, ".."))
@@ -484,7 +1194,7 @@ struct sysfs_device *sysfs_read_dir_subdirs(const char *path)
 		if (!sysfs_path_is_dir(file_path))
 			add_subdirectory(dev, file_path);
 	}
-	closedir(dir);
+	dirstream_close(dir);
 	return dev;
 }
 
@@ -495,7 +1205,7 @@ struct sysfs_device *sysfs_read_dir_subdirs(const char *path)
  */
 struct dlist *read_dir_subdirs(const char *path)
 {
-	DIR *dir = NULL;
+	struct sysfs_dirstream *dir = NULL;
 	struct dirent *dirent = NULL;
 	char file_path[SYSFS_PATH_MAX], *dir_name;
 	struct dlist *dirlist = NULL;
@@ -504,12 +1214,12 @@ struct dlist *read_dir_subdirs(const char *path)
 		errno = EINVAL;
 		return NULL;
 	}
-	dir = opendir(path);
+	dir = dirstream_open(path);
 	if (!dir) {
 		dbg_printf("Error opening directory %s\n", path);
 		return NULL;
 	}
-	while ((dirent = readdir(dir)) != NULL) {
+	while ((dirent = dirstream_read(dir)) != NULL) {
 		if (0 == strcmp(dirent->d_name, "."))
 			 continue;
 		if (0 == strcmp(dirent->d_name, ".."))
@@ -524,7 +1234,7 @@ struct dlist *read_dir_subdirs(const char *path)
 					(SYSFS_NAME_LEN, sysfs_del_name);
 				if (!dirlist) {
 					dbg_printf("Error creating list\n");
-					closedir(dir);
+					dirstream_close(dir);
 					return NULL;
 				}
 			}
@@ -533,7 +1243,7 @@ struct dlist *read_dir_subdirs(const char *path)
 			dlist_unshift_sorted(dirlist, dir_name, sort_char);
 		}
 	}
-	closedir(dir);
+	dirstream_close(dir);
 	return dirlist;
 }
 
@@ -544,7 +1254,7 @@ struct dlist *read_dir_subdirs(const char *path)
  */
 struct dlist *get_attributes_list(struct dlist *alist, const char *path)
 {
-	DIR *dir = NULL;
+	struct sysfs_dirstream *dir = NULL;
 	struct dirent *dirent = NULL;
 	char file_path[SYSFS_PATH_MAX];
 
@@ -553,12 +1263,12 @@ struct dlist *get_attributes_list(struct dlist *alist, const char *path)
 		return NULL;
 	}
 
-	dir = opendir(path);
+	dir = dirstream_open(path);
 	if (!dir) {
 		dbg_printf("Error opening directory %s\n", path);
 		return NULL;
 	}
-	while ((dirent = readdir(dir)) != NULL) {
+	while ((dirent = dirstream_read(dir)) != NULL) {
 		if (0 == strcmp(dirent->d_name, "."))
 			 continue;
 		if (0 == strcmp(dirent->d_name, ".."))
@@ -574,14 +1284,14 @@ struct dlist *get_attributes_list(struct dlist *alist, const char *path)
 							sysfs_del_attribute);
 				if (!alist) {
 					dbg_printf("Error creating list\n");
-					closedir(dir);
+					dirstream_close(dir);
 					return NULL;
 				}
 			}
 			add_attribute_to_list(alist, file_path);
 		}
 	}
-	closedir(dir);
+	dirstream_close(dir);
 	return alist;
 }
 
@@ -592,9 +1302,9 @@ struct dlist *get_attributes_list(struct dlist *alist, const char *path)
  */
 struct dlist *get_dev_attributes_list(void *dev)
 {
-	DIR *dir = NULL;
+	struct sysfs_dirstream *dir = NULL;
 	struct dirent *dirent = NULL;
-	struct sysfs_attribute *attr = NULL;
+	struct dlist *fresh;
 	char file_path[SYSFS_PATH_MAX], path[SYSFS_PATH_MAX];
 
 	if (!dev) {
@@ -603,12 +1313,18 @@ struct dlist *get_dev_attributes_list(void *dev)
 	}
 	memset(path, 0, SYSFS_PATH_MAX);
 	safestrcpy(path, ((struct sysfs_device *)dev)->path);
-	dir = opendir(path);
+	dir = dirstream_open(path);
 	if (!dir) {
 		dbg_printf("Error opening directory %s\n", path);
 		return NULL;
 	}
-	while ((dirent = readdir(dir)) != NULL) {
+	fresh = dlist_new_with_delete(sizeof(struct sysfs_attribute),
+						sysfs_del_attribute);
+	if (!fresh) {
+		dirstream_close(dir);
+		return NULL;
+	}
+	while ((dirent = dirstream_read(dir)) != NULL) {
 		if (0 == strcmp(dirent->d_name, "."))
 			 continue;
 		if (0 == strcmp(dirent->d_name, ".."))
@@ -618,20 +1334,12 @@ struct dlist *get_dev_attributes_list(void *dev)
 		safestrcat(file_path, "/");
 		safestrcat(file_path, dirent->d_name);
 		if (!sysfs_path_is_file(file_path)) {
-			if (((struct sysfs_device *)dev)->attrlist) {
-				/* check if attr is already in the list */
-				attr = (struct sysfs_attribute *)
-				dlist_find_custom
-				((((struct sysfs_device *)dev)->attrlist),
-			 	(void *)dirent->d_name, attr_name_equal);
-				if (attr)
-					continue;
-				else
-					add_attribute(dev, file_path);
-			} else
-				attr = add_attribute(dev, file_path);
+			/* check if attr is already in the list */
+			if (!find_attribute(dev, dirent->d_name))
+				add_attribute_to_list(fresh, file_path);
 		}
 	}
-	closedir(dir);
-	return ((struct sysfs_device *)dev)->attrlist;
+	dirstream_close(dir);
+	shared_list_merge(&((struct sysfs_device *)dev)->attrlist, fresh);
+	return shared_list_get(&((struct sysfs_device *)dev)->attrlist);
 }
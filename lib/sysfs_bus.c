@@ -36,23 +36,6 @@ static void sysfs_close_drv(void *drv)
 	sysfs_close_driver((struct sysfs_driver *)drv);
 }
 
-/*
- * compares names.
- * @a: name looked for
- * @b: sysfs_device comparing being compared
- * returns 1 if a==b->name or 0 not equal
- */
-static int name_equal(void *a, void *b)
-{
-	if (!a || !b)
-		return 0;
-
-	if (strcmp(((char *)a), ((struct sysfs_device *)b)->name) == 0)
-		return 1;
-
-	return 0;
-}
-
 /**
  * sysfs_close_bus: close single bus
  * @bus: bus structure
@@ -60,16 +43,32 @@ static int name_equal(void *a, void *b)
 void sysfs_close_bus(struct sysfs_bus *bus)
 {
 	if (bus) {
-		if (bus->attrlist)
-			dlist_destroy(bus->attrlist);
-		if (bus->devices)
-			dlist_destroy(bus->devices);
-		if (bus->drivers)
-			dlist_destroy(bus->drivers);
+		if (sysfs_put_ref(bus))
+			return;
+		shared_list_destroy(bus->attrlist);
+		shared_list_destroy(bus->devices);
+		shared_list_destroy(bus->drivers);
 		free(bus);
 	}
 }
 
+/**
+ * sysfs_ref_bus: takes an extra reference on a bus, e.g. before
+ * 	handing it to another thread. Each reference is dropped by one
+ * 	sysfs_close_bus(), the last one frees the bus.
+ * @bus: bus to reference
+ * returns @bus with success and NULL with error
+ */
+struct sysfs_bus *sysfs_ref_bus(struct sysfs_bus *bus)
+{
+	if (!bus) {
+		errno = EINVAL;
+		return NULL;
+	}
+	sysfs_get_ref(bus);
+	return bus;
+}
+
 /**
  * alloc_bus: mallocs new bus structure
  * returns sysfs_bus_bus struct or NULL
@@ -79,6 +78,49 @@ static struct sysfs_bus *alloc_bus(void)
 	return (struct sysfs_bus *)calloc(1, sizeof(struct sysfs_bus));
 }
 
+/**
+ * add_bus_devices: opens the devices named in linklist that are not on
+ * 	the bus's device list yet and adds them, all at once
+ * @bus: bus to add devices to
+ * @path: the bus's devices directory
+ * @linklist: names of the links in path
+ */
+static void add_bus_devices(struct sysfs_bus *bus, const char *path,
+				struct dlist *linklist)
+{
+	struct sysfs_device *dev;
+	struct dlist *fresh = NULL;
+	char devpath[SYSFS_PATH_MAX], target[SYSFS_PATH_MAX];
+	char *curlink;
+	struct dl_node *node;
+
+	dlist_for_each_data_nomark(linklist, node, curlink, char) {
+		if (shared_list_find(&bus->devices, curlink))
+			continue;
+		safestrcpy(devpath, path);
+		safestrcat(devpath, "/");
+		safestrcat(devpath, curlink);
+		if (sysfs_get_link(devpath, target, SYSFS_PATH_MAX)) {
+			dbg_printf("Error getting link - %s\n", devpath);
+			continue;
+		}
+		/* the link based fields are looked up on first use */
+		dev = sysfs_open_device_path_flags(target, 0);
+		if (!dev) {
+			dbg_printf("Error opening device at %s\n", target);
+			continue;
+		}
+		if (!fresh)
+			fresh = dlist_new_with_delete
+				(sizeof(struct sysfs_device), sysfs_close_dev);
+		if (fresh)
+			dlist_push(fresh, dev);
+		else
+			sysfs_close_device(dev);
+	}
+	shared_list_merge(&bus->devices, fresh);
+}
+
 /**
  * sysfs_get_bus_devices: gets all devices for bus
  * @bus: bus to get devices for
@@ -86,16 +128,14 @@ static struct sysfs_bus *alloc_bus(void)
  */
 struct dlist *sysfs_get_bus_devices(struct sysfs_bus *bus)
 {
-	struct sysfs_device *dev;
 	struct dlist *linklist;
-	char path[SYSFS_PATH_MAX], devpath[SYSFS_PATH_MAX];
-	char target[SYSFS_PATH_MAX];
-	char *curlink;
+	char path[SYSFS_PATH_MAX];
 
 	if (!bus) {
 		errno = EINVAL;
 		return NULL;
 	}
+
 	memset(path, 0, SYSFS_PATH_MAX);
 	safestrcpy(path, bus->path);
 	safestrcat(path, "/");
@@ -103,36 +143,48 @@ struct dlist *sysfs_get_bus_devices(struct sysfs_bus *bus)
 
 	linklist = read_dir_links(path);
 	if (linklist) {
-		dlist_for_each_data(linklist, curlink, char) {
-			if (bus->devices) {
-				dev = (struct sysfs_device *)
-					dlist_find_custom(bus->devices,
-					(void *)curlink, name_equal);
-				if (dev)
-					continue;
-			}
-			safestrcpy(devpath, path);
-			safestrcat(devpath, "/");
-			safestrcat(devpath, curlink);
-			if (sysfs_get_link(devpath, target, SYSFS_PATH_MAX)) {
-				dbg_printf("Error getting link - %s\n", devpath);
-				continue;
-			}
-			dev = sysfs_open_device_path(target);
-			if (!dev) {
-				dbg_printf("Error opening device at %s\n",
-								target);
-				continue;
-			}
-			if (!bus->devices)
-				bus->devices = dlist_new_with_delete
-					(sizeof(struct sysfs_device),
-					 		sysfs_close_dev);
-			dlist_unshift_sorted(bus->devices, dev, sort_list);
-		}
+		add_bus_devices(bus, path, linklist);
 		sysfs_close_list(linklist);
 	}
-	return (bus->devices);
+	return shared_list_get(&bus->devices);
+}
+
+/**
+ * add_bus_drivers: opens the drivers named in dirlist that are not on
+ * 	the bus's driver list yet and adds them, all at once
+ * @bus: bus to add drivers to
+ * @path: the bus's drivers directory
+ * @dirlist: names of the subdirectories of path
+ */
+static void add_bus_drivers(struct sysfs_bus *bus, const char *path,
+				struct dlist *dirlist)
+{
+	struct sysfs_driver *drv;
+	struct dlist *fresh = NULL;
+	char drvpath[SYSFS_PATH_MAX];
+	char *curdir;
+	struct dl_node *node;
+
+	dlist_for_each_data_nomark(dirlist, node, curdir, char) {
+		if (shared_list_find(&bus->drivers, curdir))
+			continue;
+		safestrcpy(drvpath, path);
+		safestrcat(drvpath, "/");
+		safestrcat(drvpath, curdir);
+		drv = sysfs_open_driver_path(drvpath);
+		if (!drv) {
+			dbg_printf("Error opening driver at %s\n", drvpath);
+			continue;
+		}
+		if (!fresh)
+			fresh = dlist_new_with_delete
+				(sizeof(struct sysfs_driver), sysfs_close_drv);
+		if (fresh)
+			dlist_push(fresh, drv);
+		else
+			sysfs_close_driver(drv);
+	}
+	shared_list_merge(&bus->drivers, fresh);
 }
 
 /**
@@ -142,15 +194,14 @@ struct dlist *sysfs_get_bus_devices(struct sysfs_bus *bus)
  */
 struct dlist *sysfs_get_bus_drivers(struct sysfs_bus *bus)
 {
-	struct sysfs_driver *drv;
 	struct dlist *dirlist;
-	char path[SYSFS_PATH_MAX], drvpath[SYSFS_PATH_MAX];
-	char *curdir;
+	char path[SYSFS_PATH_MAX];
 
 	if (!bus) {
 		errno = EINVAL;
 		return NULL;
 	}
+
 	memset(path, 0, SYSFS_PATH_MAX);
 	safestrcpy(path, bus->path);
 	safestrcat(path, "/");
@@ -158,32 +209,71 @@ struct dlist *sysfs_get_bus_drivers(struct sysfs_bus *bus)
 
 	dirlist = read_dir_subdirs(path);
 	if (dirlist) {
-		dlist_for_each_data(dirlist, curdir, char) {
-			if (bus->drivers) {
-				drv = (struct sysfs_driver *)
-					dlist_find_custom(bus->drivers,
-					(void *)curdir, name_equal);
-				if (drv)
-					continue;
-			}
-			safestrcpy(drvpath, path);
-			safestrcat(drvpath, "/");
-			safestrcat(drvpath, curdir);
-			drv = sysfs_open_driver_path(drvpath);
-			if (!drv) {
-				dbg_printf("Error opening driver at %s\n",
-								drvpath);
-				continue;
-			}
-			if (!bus->drivers)
-				bus->drivers = dlist_new_with_delete
-					(sizeof(struct sysfs_driver),
-					 		sysfs_close_drv);
-			dlist_unshift_sorted(bus->drivers, drv, sort_list);
-		}
+		add_bus_drivers(bus, path, dirlist);
 		sysfs_close_list(dirlist);
 	}
-	return (bus->drivers);
+	return shared_list_get(&bus->drivers);
+}
+
+static int sysfs_refresh_dev(void *dev)
+{
+	return sysfs_refresh_device((struct sysfs_device *)dev);
+}
+
+static int sysfs_refresh_drv(void *drv)
+{
+	return sysfs_refresh_driver((struct sysfs_driver *)drv);
+}
+
+/**
+ * sysfs_refresh_bus: brings an open bus up to date with sysfs, e.g. after
+ * 	hotplug. The device and driver lists, where they were read, are
+ * 	matched by name against the bus's directories: entries that went
+ * 	away are dropped, new ones are opened and the rest are refreshed in
+ * 	place, so the cost follows the number of changes.
+ * @bus: bus to refresh
+ * returns 0 with success and -1 with error, errno is ENOENT if the bus
+ * 	is gone
+ */
+int sysfs_refresh_bus(struct sysfs_bus *bus)
+{
+	struct dlist *names;
+	char path[SYSFS_PATH_MAX];
+
+	if (!bus) {
+		errno = EINVAL;
+		return -1;
+	}
+	if (sysfs_path_is_dir(bus->path)) {
+		dbg_printf("Bus %s is gone\n", bus->path);
+		errno = ENOENT;
+		return -1;
+	}
+
+	refresh_attributes(bus);
+	if (shared_list_get(&bus->devices)) {
+		safestrcpy(path, bus->path);
+		safestrcat(path, "/");
+		safestrcat(path, SYSFS_DEVICES_NAME);
+		names = read_dir_links(path);
+		refresh_list(&bus->devices, names, sysfs_refresh_dev);
+		if (names) {
+			add_bus_devices(bus, path, names);
+			sysfs_close_list(names);
+		}
+	}
+	if (shared_list_get(&bus->drivers)) {
+		safestrcpy(path, bus->path);
+		safestrcat(path, "/");
+		safestrcat(path, SYSFS_DRIVERS_NAME);
+		names = read_dir_subdirs(path);
+		refresh_list(&bus->drivers, names, sysfs_refresh_drv);
+		if (names) {
+			add_bus_drivers(bus, path, names);
+			sysfs_close_list(names);
+		}
+	}
+	return 0;
 }
 
 /**
@@ -247,12 +337,9 @@ struct sysfs_device *sysfs_get_bus_device(struct sysfs_bus *bus,
 		return NULL;
 	}
 
-	if (bus->devices) {
-		dev = (struct sysfs_device *)dlist_find_custom
-			(bus->devices, (void *)id, name_equal);
-		if (dev)
-			return dev;
-	}
+	dev = (struct sysfs_device *)shared_list_find(&bus->devices, id);
+	if (dev)
+		return dev;
 	safestrcpy(devpath, bus->path);
 	safestrcat(devpath, "/");
 	safestrcat(devpath, SYSFS_DEVICES_NAME);
@@ -263,16 +350,13 @@ struct sysfs_device *sysfs_get_bus_device(struct sysfs_bus *bus,
 		return NULL;
 	}
 	if (!sysfs_get_link(devpath, target, SYSFS_PATH_MAX)) {
-		dev = sysfs_open_device_path(target);
+		dev = sysfs_open_device_path_flags(target, 0);
 		if (!dev) {
 			dbg_printf("Error opening device at %s\n", target);
 			return NULL;
 		}
-		if (!bus->devices)
-			bus->devices = dlist_new_with_delete
-					(sizeof(struct sysfs_device),
-					 		sysfs_close_dev);
-		dlist_unshift_sorted(bus->devices, dev, sort_list);
+		dev = (struct sysfs_device *)shared_list_add(&bus->devices,
+			dev, sizeof(struct sysfs_device), sysfs_close_dev);
 	}
 	return dev;
 }
@@ -294,12 +378,9 @@ struct sysfs_driver *sysfs_get_bus_driver(struct sysfs_bus *bus,
 		return NULL;
 	}
 
-	if (bus->drivers) {
-		drv = (struct sysfs_driver *)dlist_find_custom
-			(bus->drivers, (void *)drvname, name_equal);
-		if (drv)
-			return drv;
-	}
+	drv = (struct sysfs_driver *)shared_list_find(&bus->drivers, drvname);
+	if (drv)
+		return drv;
 	safestrcpy(drvpath, bus->path);
 	safestrcat(drvpath, "/");
 	safestrcat(drvpath, SYSFS_DRIVERS_NAME);
@@ -310,11 +391,7 @@ struct sysfs_driver *sysfs_get_bus_driver(struct sysfs_bus *bus,
 		dbg_printf("Error opening driver at %s\n", drvpath);
 		return NULL;
 	}
-	if (!bus->drivers)
-		bus->drivers = dlist_new_with_delete
-				(sizeof(struct sysfs_driver),
-				 		sysfs_close_drv);
-	dlist_unshift_sorted(bus->drivers, drv, sort_list);
-	return drv;
+	return (struct sysfs_driver *)shared_list_add(&bus->drivers, drv,
+			sizeof(struct sysfs_driver), sysfs_close_drv);
 }
 
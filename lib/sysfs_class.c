@@ -33,21 +33,81 @@
 void sysfs_close_class_device(struct sysfs_class_device *dev)
 {
 	if (dev) {
+		if (sysfs_put_ref(dev))
+			return;
 		if (dev->parent)
 			sysfs_close_class_device(dev->parent);
 		if (dev->sysdevice)
 			sysfs_close_device(dev->sysdevice);
-		if (dev->attrlist)
-			dlist_destroy(dev->attrlist);
+		shared_list_destroy(dev->attrlist);
+		purge_retired(&dev->uevent);
+		if (dev->uevent)
+			free_uevent(dev->uevent);
+		if (dev->dirlist)
+			free_dirlist(dev->dirlist);
 		free(dev);
 	}
 }
 
+/**
+ * sysfs_ref_class_device: takes an extra reference on a class device
+ * 	shared between threads. Every holder closes it once.
+ * @dev: class device to reference
+ * returns @dev with success and NULL with error
+ */
+struct sysfs_class_device *sysfs_ref_class_device
+	(struct sysfs_class_device *dev)
+{
+	if (!dev) {
+		errno = EINVAL;
+		return NULL;
+	}
+	sysfs_get_ref(dev);
+	return dev;
+}
+
+/**
+ * sysfs_refresh_class_device: brings an open class device up to date,
+ * 	see sysfs_refresh_device(). Its device is refreshed too.
+ * @dev: class device to refresh
+ * returns 0 with success and -1 with error, errno is ENOENT if the
+ * 	class device is gone
+ */
+int sysfs_refresh_class_device(struct sysfs_class_device *dev)
+{
+	if (!dev) {
+		errno = EINVAL;
+		return -1;
+	}
+	if (sysfs_path_is_dir(dev->path)) {
+		dbg_printf("Class device %s is gone\n", dev->path);
+		errno = ENOENT;
+		return -1;
+	}
+
+	if (dev->sysdevice)
+		sysfs_refresh_device(dev->sysdevice);
+	stale_uevent(&dev->uevent);
+	sysfs_lock();
+	if (dev->dirlist) {
+		free_dirlist(dev->dirlist);
+		dev->dirlist = NULL;
+	}
+	sysfs_unlock();
+	refresh_attributes(dev);
+	return 0;
+}
+
 static void sysfs_close_cls_dev(void *dev)
 {
 	sysfs_close_class_device((struct sysfs_class_device *)dev);
 }
 
+static int sysfs_refresh_cls_dev(void *dev)
+{
+	return sysfs_refresh_class_device((struct sysfs_class_device *)dev);
+}
+
 /**
  * sysfs_close_class: close the given class
  * @cls: sysfs_class to close
@@ -55,34 +115,28 @@ static void sysfs_close_cls_dev(void *dev)
 void sysfs_close_class(struct sysfs_class *cls)
 {
 	if (cls) {
-		if (cls->devices)
-			dlist_destroy(cls->devices);
-		if (cls->attrlist)
-			dlist_destroy(cls->attrlist);
+		if (sysfs_put_ref(cls))
+			return;
+		shared_list_destroy(cls->devices);
+		shared_list_destroy(cls->attrlist);
 		free(cls);
 	}
 }
 
-/*
- * pass this function to dlist_find_custom()
- * so it can compare device names
- *
- * return 1 if pathnames are equal, else 0
+/**
+ * sysfs_ref_class: takes an extra reference on a class, see
+ * 	sysfs_ref_class_device()
+ * @cls: class to reference
+ * returns @cls with success and NULL with error
  */
-static int cdev_name_equal(void *a, void *b)
+struct sysfs_class *sysfs_ref_class(struct sysfs_class *cls)
 {
-	char *str_a, *str_b;
-
-	if (!a || !b)
-		return 0;
-
-	str_a = (char *)a;
-	str_b = ((struct sysfs_class_device *)b)->name;
-
-	if (strncmp(str_a, str_b, SYSFS_NAME_LEN) == 0)
-		return 1;
-
-	return 0;
+	if (!cls) {
+		errno = EINVAL;
+		return NULL;
+	}
+	sysfs_get_ref(cls);
+	return cls;
 }
 
 static struct sysfs_class *alloc_class(void)
@@ -235,8 +289,11 @@ struct sysfs_class_device *sysfs_get_classdev_parent
 		return NULL;
 	}
 
-	if (clsdev->parent)
+	sysfs_lock();
+	if (clsdev->parent) {
+		sysfs_unlock();
 		return (clsdev->parent);
+	}
 
 	memset(abs_path, 0, SYSFS_PATH_MAX);
 	memset(tmp_path, 0, SYSFS_PATH_MAX);
@@ -253,11 +310,13 @@ struct sysfs_class_device *sysfs_get_classdev_parent
 	if ((strncmp(tmp_path, abs_path, strlen(abs_path))) == 0) {
 		dbg_printf("Class device %s doesn't have a parent\n",
 				clsdev->name);
+		sysfs_unlock();
 		return NULL;
 	}
 
 	clsdev->parent = sysfs_open_class_device_path(abs_path);
 
+	sysfs_unlock();
 	return clsdev->parent;
 }
 
@@ -338,6 +397,150 @@ struct sysfs_class_device *sysfs_open_class_device
 	return cdev;
 }
 
+/**
+ * get_devnum_dir: builds the path of /sys/dev/block or /sys/dev/char
+ * @type: SYSFS_DEVNUM_BLOCK or SYSFS_DEVNUM_CHAR
+ * @path: where to put the path
+ * @len: size of path
+ * returns 0 with success and -1 with error
+ */
+static int get_devnum_dir(int type, char *path, size_t len)
+{
+	if (type != SYSFS_DEVNUM_BLOCK && type != SYSFS_DEVNUM_CHAR) {
+		errno = EINVAL;
+		return -1;
+	}
+	if (sysfs_get_mnt_path(path, len)) {
+		dbg_printf("Sysfs not supported on this system\n");
+		return -1;
+	}
+	safestrcatmax(path, "/dev/", len);
+	safestrcatmax(path, type == SYSFS_DEVNUM_BLOCK ?
+				SYSFS_BLOCK_NAME : "char", len);
+	return 0;
+}
+
+/**
+ * open_devnum_at: opens the class device a /sys/dev link points at
+ * @dir: path of /sys/dev/block or /sys/dev/char
+ * @dfd: descriptor of dir
+ * @major: major number
+ * @minor: minor number
+ * returns struct sysfs_class_device with success and NULL with error
+ */
+static struct sysfs_class_device *open_devnum_at(const char *dir, int dfd,
+				unsigned int major, unsigned int minor)
+{
+	char name[SYSFS_NAME_LEN], linkpath[SYSFS_PATH_MAX];
+	char path[SYSFS_PATH_MAX];
+	ssize_t count;
+
+	snprintf(name, SYSFS_NAME_LEN, "%u:%u", major, minor);
+	count = readlinkat(dfd, name, linkpath, SYSFS_PATH_MAX - 1);
+	if (count < 0) {
+		dbg_printf("No device %s under %s\n", name, dir);
+		return NULL;
+	}
+	linkpath[count] = '\0';
+	if (resolve_link_target(dir, linkpath, path, SYSFS_PATH_MAX))
+		return NULL;
+
+	return sysfs_open_class_device_path(path);
+}
+
+/**
+ * sysfs_open_class_device_devnum: opens the class device with a device
+ * 	number through its /sys/dev link
+ * @type: SYSFS_DEVNUM_BLOCK or SYSFS_DEVNUM_CHAR
+ * @major: major number
+ * @minor: minor number
+ *
+ * NOTE:
+ * 	Call sysfs_close_class_device() to close the class device
+ */
+struct sysfs_class_device *sysfs_open_class_device_devnum(int type,
+				unsigned int major, unsigned int minor)
+{
+	char dir[SYSFS_PATH_MAX];
+	struct sysfs_class_device *cdev;
+	int dfd;
+
+	if (get_devnum_dir(type, dir, SYSFS_PATH_MAX))
+		return NULL;
+	dfd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (dfd < 0) {
+		dbg_printf("Error opening directory %s\n", dir);
+		return NULL;
+	}
+	cdev = open_devnum_at(dir, dfd, major, minor);
+	close(dfd);
+
+	return cdev;
+}
+
+/**
+ * sysfs_open_class_devices_devnum: opens the class devices for a batch of
+ * 	device numbers, reading each one's /sys/dev link relative to a
+ * 	descriptor opened once per type
+ * @devnums: device numbers to look up
+ * @clsdevs: filled with the class devices, NULL for numbers that have none
+ * 	or an invalid type
+ * @count: number of entries in devnums and clsdevs
+ * returns the number of class devices opened, -1 with error
+ *
+ * NOTE:
+ * 	Call sysfs_close_class_device() on each class device
+ */
+int sysfs_open_class_devices_devnum(const struct sysfs_devnum *devnums,
+		struct sysfs_class_device **clsdevs, int count)
+{
+	char dirs[2][SYSFS_PATH_MAX];
+	int dfds[2] = { -1, -1 };
+	int failed[2] = { 0, 0 };
+	int i, t, opened = 0;
+
+	if (!devnums || !clsdevs || count < 0) {
+		errno = EINVAL;
+		return -1;
+	}
+	for (i = 0; i < count; i++) {
+		clsdevs[i] = NULL;
+		if (devnums[i].type == SYSFS_DEVNUM_BLOCK)
+			t = 0;
+		else if (devnums[i].type == SYSFS_DEVNUM_CHAR)
+			t = 1;
+		else
+			continue;
+		/* a directory that couldn't be opened isn't tried again */
+		if (failed[t])
+			continue;
+		if (dfds[t] < 0) {
+			if (get_devnum_dir(devnums[i].type, dirs[t],
+						SYSFS_PATH_MAX)) {
+				failed[t] = 1;
+				continue;
+			}
+			dfds[t] = open(dirs[t],
+					O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+			if (dfds[t] < 0) {
+				dbg_printf("Error opening directory %s\n",
+								dirs[t]);
+				failed[t] = 1;
+				continue;
+			}
+		}
+		clsdevs[i] = open_devnum_at(dirs[t], dfds[t],
+				devnums[i].major, devnums[i].minor);
+		if (clsdevs[i])
+			opened++;
+	}
+	for (t = 0; t < 2; t++) {
+		if (dfds[t] >= 0)
+			close(dfds[t]);
+	}
+	return opened;
+}
+
 /**
  * sysfs_get_classdev_attr: searches class device's attributes by name
  * @clsdev: class device to look through
@@ -351,7 +554,7 @@ struct sysfs_attribute *sysfs_get_classdev_attr
 		errno = EINVAL;
 		return NULL;
 	}
-	return get_attribute(clsdev, (char *)name);
+	return get_attribute(clsdev, (char *)name, &clsdev->dirlist);
 }
 
 /**
@@ -368,6 +571,23 @@ struct dlist *sysfs_get_classdev_attributes(struct sysfs_class_device *clsdev)
 	return get_dev_attributes_list(clsdev);
 }
 
+/**
+ * sysfs_get_classdev_attrs: reads only the named class device attributes,
+ * 	without scanning the class device directory
+ * @clsdev: class device whose attributes are needed
+ * @names: NULL terminated list of attribute names
+ * returns dlist of attributes on success or NULL on error
+ */
+struct dlist *sysfs_get_classdev_attrs(struct sysfs_class_device *clsdev,
+				const char * const *names)
+{
+	if (!clsdev) {
+		errno = EINVAL;
+		return NULL;
+	}
+	return get_dev_attributes_named(clsdev, names, &clsdev->dirlist);
+}
+
 /**
  * sysfs_get_classdev_device: gets the sysfs_device associated with the
  * 	given sysfs_class_device
@@ -378,15 +598,25 @@ struct sysfs_device *sysfs_get_classdev_device
 		(struct sysfs_class_device *clsdev)
 {
 	char linkpath[SYSFS_PATH_MAX], devpath[SYSFS_PATH_MAX];
+	int type;
 
 	if (!clsdev) {
 		errno = EINVAL;
 		return NULL;
 	}
 
-	if (clsdev->sysdevice)
+	sysfs_lock();
+	if (clsdev->sysdevice) {
+		sysfs_unlock();
 		return clsdev->sysdevice;
+	}
 
+	/* virtual class devices have no device link, ask only once */
+	type = dirlist_type(&clsdev->dirlist, "device");
+	if (type != DT_UNKNOWN && type != DT_LNK) {
+		sysfs_unlock();
+		return NULL;
+	}
 	memset(linkpath, 0, SYSFS_PATH_MAX);
 	safestrcpy(linkpath, clsdev->path);
 	safestrcat(linkpath, "/device");
@@ -394,7 +624,9 @@ struct sysfs_device *sysfs_get_classdev_device
 		memset(devpath, 0, SYSFS_PATH_MAX);
 		if (!sysfs_get_link(linkpath, devpath, SYSFS_PATH_MAX))
 			clsdev->sysdevice = sysfs_open_device_path(devpath);
-	}
+	} else
+		dirlist_load(&clsdev->dirlist, clsdev->path);
+	sysfs_unlock();
 	return clsdev->sysdevice;
 }
 
@@ -469,12 +701,10 @@ struct sysfs_class_device *sysfs_get_class_device(struct sysfs_class *cls,
 		return NULL;
 	}
 
-	if (cls->devices) {
-		cdev = (struct sysfs_class_device *)dlist_find_custom
-			(cls->devices, (void *)name, cdev_name_equal);
-		if (cdev)
-			return cdev;
-	}
+	cdev = (struct sysfs_class_device *)shared_list_find(&cls->devices,
+								name);
+	if (cdev)
+		return cdev;
 
 	safestrcpy(path, cls->path);
 	safestrcat(path, "/");
@@ -484,13 +714,9 @@ struct sysfs_class_device *sysfs_get_class_device(struct sysfs_class *cls,
 		dbg_printf("Error opening class device at %s\n", path);
 		return NULL;
 	}
-	if (!cls->devices)
-		cls->devices = dlist_new_with_delete
-			(sizeof(struct sysfs_class_device),
-				 sysfs_close_cls_dev);
-
-	dlist_unshift_sorted(cls->devices, cdev, sort_list);
-	return cdev;
+	return (struct sysfs_class_device *)shared_list_add(&cls->devices,
+			cdev, sizeof(struct sysfs_class_device),
+			sysfs_close_cls_dev);
 }
 
 /**
@@ -500,31 +726,78 @@ static void add_cdevs_to_classlist(struct sysfs_class *cls, struct dlist *list)
 {
 	char path[SYSFS_PATH_MAX], *cdev_name;
 	struct sysfs_class_device *cdev = NULL;
+	struct dlist *fresh = NULL;
+	struct dl_node *node;
 
 	if (cls == NULL || list == NULL)
 		return;
 
-	dlist_for_each_data(list, cdev_name, char) {
-		if (cls->devices) {
-			cdev = (struct sysfs_class_device *)
-				dlist_find_custom(cls->devices,
-				(void *)cdev_name, cdev_name_equal);
-			if (cdev)
-				continue;
-		}
+	dlist_for_each_data_nomark(list, node, cdev_name, char) {
+		if (shared_list_find(&cls->devices, cdev_name))
+			continue;
 		safestrcpy(path, cls->path);
 		safestrcat(path, "/");
 		safestrcat(path, cdev_name);
 		cdev = sysfs_open_class_device_path(path);
 		if (cdev) {
-			if (!cls->devices)
-				cls->devices = dlist_new_with_delete
+			if (!fresh)
+				fresh = dlist_new_with_delete
 				(sizeof(struct sysfs_class_device),
 				 sysfs_close_cls_dev);
-			dlist_unshift_sorted(cls->devices, cdev,
-					sort_list);
+			if (fresh)
+				dlist_push(fresh, cdev);
+			else
+				sysfs_close_class_device(cdev);
+		}
+	}
+	shared_list_merge(&cls->devices, fresh);
+}
+
+/**
+ * sysfs_refresh_class: brings an open class up to date with sysfs. If its
+ * 	device list was read, class devices that went away are dropped,
+ * 	new ones are opened and the rest are refreshed in place, so the
+ * 	work done follows the number of changes.
+ * @cls: class to refresh
+ * returns 0 with success and -1 with error, errno is ENOENT if the class
+ * 	is gone
+ */
+int sysfs_refresh_class(struct sysfs_class *cls)
+{
+	struct dlist *names, *linklist;
+	char *name;
+
+	if (!cls) {
+		errno = EINVAL;
+		return -1;
+	}
+	if (sysfs_path_is_dir(cls->path)) {
+		dbg_printf("Class %s is gone\n", cls->path);
+		errno = ENOENT;
+		return -1;
+	}
+
+	refresh_attributes(cls);
+	if (shared_list_get(&cls->devices)) {
+		names = read_dir_subdirs(cls->path);
+		linklist = read_dir_links(cls->path);
+		if (!names) {
+			names = linklist;
+			linklist = NULL;
+		}
+		while (linklist && linklist->count) {
+			name = (char *)dlist_shift(linklist);
+			dlist_push(names, name);
+		}
+		sysfs_close_list(linklist);
+
+		refresh_list(&cls->devices, names, sysfs_refresh_cls_dev);
+		if (names) {
+			add_cdevs_to_classlist(cls, names);
+			sysfs_close_list(names);
 		}
 	}
+	return 0;
 }
 
 /**
@@ -560,5 +833,5 @@ struct dlist *sysfs_get_class_devices(struct sysfs_class *cls)
 		sysfs_close_list(linklist);
 	}
 
-	return cls->devices;
+	return shared_list_get(&cls->devices);
 }
@@ -27,29 +27,103 @@
 #include "sysfs.h"
 
 /**
- * get_dev_driver: fills in the dev->driver_name field
+ * get_dev_link_name: reads one of the device's links and copies the name
+ * 	it points at. Only the last path component is needed, so a single
+ * 	readlink() does instead of resolving the target.
+ * @dev: device the link belongs to
+ * @link: link name, e.g. "driver"
+ * @name: buffer to copy the name into, left untouched on error
+ * @len: size of name
  * Returns 0 on SUCCESS and -1 on error
  */
-static int get_dev_driver(struct sysfs_device *dev)
+static int get_dev_link_name(struct sysfs_device *dev, const char *link,
+				char *name, size_t len)
 {
-	char path[SYSFS_PATH_MAX], devpath[SYSFS_PATH_MAX];
-
-	if (!dev) {
-		errno = EINVAL;
+	char path[SYSFS_PATH_MAX], target[SYSFS_PATH_MAX];
+	ssize_t count;
+
+	safestrcpy(path, dev->path);
+	safestrcat(path, "/");
+	safestrcat(path, link);
+	count = snapshot_readlink(path, target, SYSFS_PATH_MAX);
+	if (count < 0)
 		return -1;
+	if (count > 0) {
+		count = readlink(path, target, SYSFS_PATH_MAX - 1);
+		if (count < 0)
+			return -1;
+		target[count] = '\0';
+	}
+
+	return sysfs_get_name_from_path(target, name, len);
+}
+
+/**
+ * read_dev_links: fills in the bus, driver_name and subsystem fields
+ * 	asked for in flags. The links are read without the lock, which is
+ * 	only taken to copy the names in.
+ * @dev: device to resolve
+ * @flags: SYSFS_OPEN_* fields wanted
+ * @again: look up fields that were looked up before too
+ */
+static void read_dev_links(struct sysfs_device *dev, unsigned int flags,
+				int again)
+{
+	char bus[SYSFS_NAME_LEN], driver[SYSFS_NAME_LEN];
+	char subsystem[SYSFS_NAME_LEN];
+
+	flags &= SYSFS_OPEN_ALL;
+	if (!again)
+		flags &= ~load_acquire(&dev->resolved);
+	if (!flags)
+		return;
+	if (flags & SYSFS_OPEN_BUS) {
+		if (get_dev_link_name(dev, "bus", bus, SYSFS_NAME_LEN)) {
+			dbg_printf("Could not get device bus\n");
+			bus[0] = '\0';
+		}
+	}
+	if (flags & SYSFS_OPEN_DRIVER) {
+		if (get_dev_link_name(dev, "driver", driver,
+						SYSFS_NAME_LEN)) {
+			dbg_printf("Could not get device %s's driver\n",
+								dev->bus_id);
+			safestrcpy(driver, SYSFS_UNKNOWN);
+		}
 	}
-	memset(path, 0, SYSFS_PATH_MAX);
-	memset(devpath, 0, SYSFS_PATH_MAX);
-	safestrcpymax(path, dev->path, SYSFS_PATH_MAX);
-	safestrcatmax(path, "/driver", SYSFS_PATH_MAX);
-	if (!sysfs_path_is_link(path)) {
-		if (!sysfs_get_link(path, devpath, SYSFS_PATH_MAX)) {
-			if (!sysfs_get_name_from_path(devpath,
-					dev->driver_name, SYSFS_NAME_LEN))
-				return 0;
+	if (flags & SYSFS_OPEN_SUBSYSTEM) {
+		if (get_dev_link_name(dev, "subsystem", subsystem,
+						SYSFS_NAME_LEN)) {
+			dbg_printf("Could not get device %s's subsystem\n",
+								dev->bus_id);
+			safestrcpy(subsystem, SYSFS_UNKNOWN);
 		}
 	}
-	return -1;
+
+	sysfs_lock();
+	/* another thread may have filled them in while we read */
+	if (!again)
+		flags &= ~dev->resolved;
+	if (flags & SYSFS_OPEN_BUS)
+		safestrcpy(dev->bus, bus);
+	if (flags & SYSFS_OPEN_DRIVER)
+		safestrcpy(dev->driver_name, driver);
+	if (flags & SYSFS_OPEN_SUBSYSTEM)
+		safestrcpy(dev->subsystem, subsystem);
+	store_release(&dev->resolved, dev->resolved | flags);
+	sysfs_unlock();
+}
+
+/**
+ * resolve_dev_links: fills in the bus, driver_name and subsystem fields
+ * 	asked for in flags that have not been looked up yet. Once filled
+ * 	in, bus and subsystem don't change.
+ * @dev: device to resolve
+ * @flags: SYSFS_OPEN_* fields wanted
+ */
+static void resolve_dev_links(struct sysfs_device *dev, unsigned int flags)
+{
+	read_dev_links(dev, flags, 0);
 }
 
 /**
@@ -60,52 +134,70 @@ static int get_dev_driver(struct sysfs_device *dev)
  */
 int sysfs_get_device_bus(struct sysfs_device *dev)
 {
-	char devpath[SYSFS_PATH_MAX], path[SYSFS_PATH_MAX];
-
 	if (!dev) {
 		errno = EINVAL;
 		return -1;
 	}
 
-	memset(path, 0, SYSFS_PATH_MAX);
-	memset(devpath, 0, SYSFS_PATH_MAX);
-	safestrcpymax(path, dev->path, SYSFS_PATH_MAX);
-	safestrcatmax(path, "/bus", SYSFS_PATH_MAX);
-	if (!sysfs_path_is_link(path)) {
-		if (!sysfs_get_link(path, devpath, SYSFS_PATH_MAX)) {
-			if (!sysfs_get_name_from_path(devpath,
-					dev->bus, SYSFS_NAME_LEN))
-				return 0;
-		}
+	resolve_dev_links(dev, SYSFS_OPEN_BUS);
+	if (dev->bus[0] == '\0') {
+		errno = ENOENT;
+		return -1;
 	}
-	return -1;
+	return 0;
 }
 
 /**
- * get_dev_subsystem: fills in the dev->subsystem field
- * Returns 0 on SUCCESS and -1 on error
+ * sysfs_get_device_bus_name: returns the name of the bus the device is on,
+ * 	looking it up on first use
+ * @dev: device to get the bus of
+ * returns the bus name, empty if the device has no bus link, and NULL
+ * 	with error
  */
-static int get_dev_subsystem(struct sysfs_device *dev)
+const char *sysfs_get_device_bus_name(struct sysfs_device *dev)
 {
-	char path[SYSFS_PATH_MAX], devpath[SYSFS_PATH_MAX];
+	if (!dev) {
+		errno = EINVAL;
+		return NULL;
+	}
+	resolve_dev_links(dev, SYSFS_OPEN_BUS);
+	return dev->bus;
+}
 
+/**
+ * sysfs_get_device_driver_name: returns the name of the driver bound to
+ * 	the device, looking it up on first use
+ * @dev: device to get the driver of
+ * returns the driver name, SYSFS_UNKNOWN if none is bound, and NULL with
+ * 	error
+ */
+const char *sysfs_get_device_driver_name(struct sysfs_device *dev)
+{
 	if (!dev) {
 		errno = EINVAL;
-		return -1;
+		return NULL;
 	}
-	memset(path, 0, SYSFS_PATH_MAX);
-	memset(devpath, 0, SYSFS_PATH_MAX);
-	safestrcpymax(path, dev->path, SYSFS_PATH_MAX);
-	safestrcatmax(path, "/subsystem", SYSFS_PATH_MAX);
-	if (!sysfs_path_is_link(path)) {
-		if (!sysfs_get_link(path, devpath, SYSFS_PATH_MAX)) {
-			if (!sysfs_get_name_from_path(devpath,
-					dev->subsystem, SYSFS_NAME_LEN))
-				return 0;
-		}
+	resolve_dev_links(dev, SYSFS_OPEN_DRIVER);
+	return dev->driver_name;
+}
+
+/**
+ * sysfs_get_device_subsystem: returns the name of the device's subsystem,
+ * 	looking it up on first use
+ * @dev: device to get the subsystem of
+ * returns the subsystem name, SYSFS_UNKNOWN if there is none, and NULL
+ * 	with error
+ */
+const char *sysfs_get_device_subsystem(struct sysfs_device *dev)
+{
+	if (!dev) {
+		errno = EINVAL;
+		return NULL;
 	}
-	return -1;
+	resolve_dev_links(dev, SYSFS_OPEN_SUBSYSTEM);
+	return dev->subsystem;
 }
+
 /**
  * sysfs_close_dev_tree: routine for dlist integration
  */
@@ -124,9 +216,10 @@ void sysfs_close_device_tree(struct sysfs_device *devroot)
 	if (devroot) {
 		if (devroot->children) {
 			struct sysfs_device *child = NULL;
+			struct dl_node *node;
 
-			dlist_for_each_data(devroot->children, child,
-					struct sysfs_device)
+			dlist_for_each_data_nomark(devroot->children, node,
+					child, struct sysfs_device)
 				sysfs_close_device_tree(child);
 		}
 		devroot->children = NULL;
@@ -141,16 +234,75 @@ void sysfs_close_device_tree(struct sysfs_device *devroot)
 void sysfs_close_device(struct sysfs_device *dev)
 {
 	if (dev) {
+		if (sysfs_put_ref(dev))
+			return;
 		if (dev->parent)
 			sysfs_close_device(dev->parent);
 		if (dev->children && dev->children->count)
 			dlist_destroy(dev->children);
-		if (dev->attrlist)
-			dlist_destroy(dev->attrlist);
+		shared_list_destroy(dev->attrlist);
+		purge_retired(&dev->uevent);
+		if (dev->uevent)
+			free_uevent(dev->uevent);
+		if (dev->dirlist)
+			free_dirlist(dev->dirlist);
 		free(dev);
 	}
 }
 
+/**
+ * sysfs_ref_device: takes an extra reference on a device. The device
+ * 	is freed by the sysfs_close_device() that drops the last one.
+ * @dev: device to reference
+ * returns @dev with success and NULL with error
+ */
+struct sysfs_device *sysfs_ref_device(struct sysfs_device *dev)
+{
+	if (!dev) {
+		errno = EINVAL;
+		return NULL;
+	}
+	sysfs_get_ref(dev);
+	return dev;
+}
+
+/**
+ * sysfs_refresh_device: brings an open device up to date with sysfs
+ * 	instead of closing and reopening it. The attributes already read
+ * 	are read again, the driver link is looked up again if it was
+ * 	before, the directory listing is dropped and the uevent is read
+ * 	again on next use. Uevents handed out before stay valid until the
+ * 	device is closed.
+ * @dev: device to refresh
+ * returns 0 with success and -1 with error, errno is ENOENT if the
+ * 	device is gone
+ */
+int sysfs_refresh_device(struct sysfs_device *dev)
+{
+	if (!dev) {
+		errno = EINVAL;
+		return -1;
+	}
+	if (sysfs_path_is_dir(dev->path)) {
+		dbg_printf("Device %s is gone\n", dev->path);
+		errno = ENOENT;
+		return -1;
+	}
+
+	/* drivers come and go, the bus and subsystem stay */
+	if (load_acquire(&dev->resolved) & SYSFS_OPEN_DRIVER)
+		read_dev_links(dev, SYSFS_OPEN_DRIVER, 1);
+	stale_uevent(&dev->uevent);
+	sysfs_lock();
+	if (dev->dirlist) {
+		free_dirlist(dev->dirlist);
+		dev->dirlist = NULL;
+	}
+	sysfs_unlock();
+	refresh_attributes(dev);
+	return 0;
+}
+
 /**
  * alloc_device: allocates and initializes device structure
  * returns struct sysfs_device
@@ -161,11 +313,15 @@ static struct sysfs_device *alloc_device(void)
 }
 
 /**
- * sysfs_open_device_path: opens and populates device structure
+ * sysfs_open_device_path_flags: opens a device, looking up only the link
+ * 	based fields named in flags. The others are filled in on first use
+ * 	by their accessors, sysfs_get_device_bus_name() and friends.
  * @path: path to device, this is the /sys/devices/ path
+ * @flags: SYSFS_OPEN_* fields to resolve now, 0 for none
  * returns sysfs_device structure with success or NULL with error
  */
-struct sysfs_device *sysfs_open_device_path(const char *path)
+struct sysfs_device *sysfs_open_device_path_flags(const char *path,
+						unsigned int flags)
 {
 	struct sysfs_device *dev;
 
@@ -201,21 +357,21 @@ struct sysfs_device *sysfs_open_device_path(const char *path)
 	 */
 	safestrcpy(dev->name, dev->bus_id);
 
-	if (sysfs_get_device_bus(dev))
-		dbg_printf("Could not get device bus\n");
-
-	if (get_dev_driver(dev)) {
-		dbg_printf("Could not get device %s's driver\n", dev->bus_id);
-		safestrcpy(dev->driver_name, SYSFS_UNKNOWN);
-	}
-
-	if (get_dev_subsystem(dev)) {
-		dbg_printf("Could not get device %s's subsystem\n", dev->bus_id);
-		safestrcpy(dev->subsystem, SYSFS_UNKNOWN);
-	}
+	if (flags)
+		resolve_dev_links(dev, flags);
 	return dev;
 }
 
+/**
+ * sysfs_open_device_path: opens and populates device structure
+ * @path: path to device, this is the /sys/devices/ path
+ * returns sysfs_device structure with success or NULL with error
+ */
+struct sysfs_device *sysfs_open_device_path(const char *path)
+{
+	return sysfs_open_device_path_flags(path, SYSFS_OPEN_ALL);
+}
+
 /**
  * sysfs_open_device_tree: opens root device and all of its children,
  *	creating a tree of devices. Only opens children.
@@ -228,6 +384,7 @@ struct sysfs_device *sysfs_open_device_tree(const char *path)
 	struct sysfs_device *rootdev = NULL, *new = NULL;
 	struct sysfs_device *cur = NULL;
 	struct sysfs_device *devlist;
+	struct dl_node *node;
 
 	if (path == NULL) {
 		errno = EINVAL;
@@ -241,7 +398,7 @@ struct sysfs_device *sysfs_open_device_tree(const char *path)
 
 	devlist = sysfs_read_dir_subdirs(path);
         if (devlist->children) {
-		dlist_for_each_data(devlist->children, cur,
+		dlist_for_each_data_nomark(devlist->children, node, cur,
 				struct sysfs_device) {
 			new = sysfs_open_device_tree(cur->path);
 			if (new == NULL) {
@@ -275,7 +432,7 @@ struct sysfs_attribute *sysfs_get_device_attr(struct sysfs_device *dev,
 		errno = EINVAL;
 		return NULL;
 	}
-	return get_attribute(dev, (char *)name);
+	return get_attribute(dev, (char *)name, &dev->dirlist);
 }
 
 /**
@@ -292,6 +449,23 @@ struct dlist *sysfs_get_device_attributes(struct sysfs_device *dev)
 	return get_dev_attributes_list(dev);
 }
 
+/**
+ * sysfs_get_device_attrs: reads only the named device attributes, without
+ * 	scanning the device directory
+ * @dev: device whose attributes are needed
+ * @names: NULL terminated list of attribute names
+ * returns dlist of attributes on success or NULL on error
+ */
+struct dlist *sysfs_get_device_attrs(struct sysfs_device *dev,
+				const char * const *names)
+{
+	if (!dev) {
+		errno = EINVAL;
+		return NULL;
+	}
+	return get_dev_attributes_named(dev, names, &dev->dirlist);
+}
+
 /**
  * get_device_absolute_path: looks up the bus the device is on, gets
  * 		absolute path to the device
@@ -384,8 +558,11 @@ struct sysfs_device *sysfs_get_device_parent(struct sysfs_device *dev)
 		return NULL;
 	}
 
-	if (dev->parent)
+	sysfs_lock();
+	if (dev->parent) {
+		sysfs_unlock();
 		return (dev->parent);
+	}
 
 	memset(ppath, 0, SYSFS_PATH_MAX);
 	memset(dpath, 0, SYSFS_PATH_MAX);
@@ -393,6 +570,7 @@ struct sysfs_device *sysfs_get_device_parent(struct sysfs_device *dev)
 	tmp = strrchr(ppath, '/');
 	if (!tmp) {
 		dbg_printf("Invalid path to device %s\n", ppath);
+		sysfs_unlock();
 		return NULL;
 	}
 	if (*(tmp + 1) == '\0') {
@@ -400,6 +578,7 @@ struct sysfs_device *sysfs_get_device_parent(struct sysfs_device *dev)
 		tmp = strrchr(tmp, '/');
 		if (tmp == NULL) {
 			dbg_printf("Invalid path to device %s\n", ppath);
+			sysfs_unlock();
 			return NULL;
 		}
 	}
@@ -408,6 +587,7 @@ struct sysfs_device *sysfs_get_device_parent(struct sysfs_device *dev)
 	/* Make sure we're at the top of the device tree */
 	if (sysfs_get_mnt_path(dpath, SYSFS_PATH_MAX) != 0) {
 		dbg_printf("Sysfs not supported on this system\n");
+		sysfs_unlock();
 		return NULL;
 	}
 	safestrcat(dpath, "/");
@@ -415,6 +595,7 @@ struct sysfs_device *sysfs_get_device_parent(struct sysfs_device *dev)
 
 	if (strcmp(dpath, ppath) == 0) {
 		dbg_printf("Device at %s does not have a parent\n", dev->path);
+		sysfs_unlock();
 		return NULL;
 	}
 
@@ -422,7 +603,9 @@ struct sysfs_device *sysfs_get_device_parent(struct sysfs_device *dev)
 	if (!dev->parent) {
 		dbg_printf("Error opening device %s's parent at %s\n",
 					dev->bus_id, ppath);
+		sysfs_unlock();
 		return NULL;
 	}
+	sysfs_unlock();
 	return (dev->parent);
 }
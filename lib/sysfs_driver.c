@@ -38,16 +38,34 @@ static void sysfs_close_driver_device(void *device)
 void sysfs_close_driver(struct sysfs_driver *driver)
 {
 	if (driver) {
-		if (driver->devices)
-			dlist_destroy(driver->devices);
-		if (driver->attrlist)
-			dlist_destroy(driver->attrlist);
+		if (sysfs_put_ref(driver))
+			return;
+		shared_list_destroy(driver->devices);
+		shared_list_destroy(driver->attrlist);
 		if (driver->module)
 			sysfs_close_module(driver->module);
+		if (driver->dirlist)
+			free_dirlist(driver->dirlist);
 		free(driver);
 	}
 }
 
+/**
+ * sysfs_ref_driver: takes an extra reference on a driver, to be dropped
+ * 	with sysfs_close_driver()
+ * @driver: driver to reference
+ * returns @driver with success and NULL with error
+ */
+struct sysfs_driver *sysfs_ref_driver(struct sysfs_driver *driver)
+{
+	if (!driver) {
+		errno = EINVAL;
+		return NULL;
+	}
+	sysfs_get_ref(driver);
+	return driver;
+}
+
 /**
  * alloc_driver: allocates and initializes driver
  * returns struct sysfs_driver with success and NULL with error.
@@ -99,7 +117,7 @@ struct sysfs_attribute *sysfs_get_driver_attr(struct sysfs_driver *drv,
 		errno = EINVAL;
 		return NULL;
 	}
-	return get_attribute(drv, (char *)name);
+	return get_attribute(drv, (char *)name, &drv->dirlist);
 }
 
 /**
@@ -116,6 +134,23 @@ struct dlist *sysfs_get_driver_attributes(struct sysfs_driver *drv)
 	return get_dev_attributes_list(drv);
 }
 
+/**
+ * sysfs_get_driver_attrs: reads only the named driver attributes, without
+ * 	scanning the driver directory
+ * @drv: driver whose attributes are needed
+ * @names: NULL terminated list of attribute names
+ * returns dlist of attributes on success or NULL on error
+ */
+struct dlist *sysfs_get_driver_attrs(struct sysfs_driver *drv,
+				const char * const *names)
+{
+	if (!drv) {
+		errno = EINVAL;
+		return NULL;
+	}
+	return get_dev_attributes_named(drv, names, &drv->dirlist);
+}
+
 /**
  * sysfs_open_driver_path: opens and initializes driver structure
  * @path: path to driver directory
@@ -220,50 +255,174 @@ struct sysfs_driver *sysfs_open_driver(const char *bus_name,
 }
 
 /**
- * sysfs_get_driver_devices: gets list of devices that use the driver
+ * get_driver_link_target: resolves one of the driver directory's device
+ * 	links. The driver directory is a real directory under
+ * 	/sys/bus/<bus>/drivers, so a relative target is resolved against
+ * 	drv->path by name, without looking at the components in between.
+ * @drv: driver the link belongs to
+ * @dfd: descriptor of the driver's directory, -1 if it was listed from
+ * 	a snapshot
+ * @name: link name
+ * @target: where to put the device's path
+ * @len: size of target
+ * returns 0 with success and -1 with error
+ */
+static int get_driver_link_target(struct sysfs_driver *drv, int dfd,
+				const char *name, char *target, size_t len)
+{
+	char linkpath[SYSFS_PATH_MAX];
+	ssize_t count;
+
+	if (dfd < 0) {
+		safestrcpy(linkpath, drv->path);
+		safestrcat(linkpath, "/");
+		safestrcat(linkpath, name);
+		return sysfs_get_link(linkpath, target, len);
+	}
+	count = readlinkat(dfd, name, linkpath, SYSFS_PATH_MAX - 1);
+	if (count < 0)
+		return -1;
+	linkpath[count] = '\0';
+
+	return resolve_link_target(drv->path, linkpath, target, len);
+}
+
+/**
+ * sysfs_get_driver_devices: gets list of devices that use the driver. The
+ * 	driver directory's links are followed in one pass; devices that
+ * 	can't be opened are left out of the list.
  * @drv: sysfs_driver whose device list is needed
  * Returns dlist of struct sysfs_device on success and NULL on failure
  */
 struct dlist *sysfs_get_driver_devices(struct sysfs_driver *drv)
 {
-	char *ln = NULL;
-	struct dlist *linklist = NULL;
+	struct sysfs_dirstream *dir;
+	struct dirent *dirent;
 	struct sysfs_device *dev = NULL;
+	struct dlist *fresh = NULL;
+	struct stat astats;
+	char target[SYSFS_PATH_MAX], linkpath[SYSFS_PATH_MAX];
+	int dfd;
 
 	if (!drv) {
 		errno = EINVAL;
 		return NULL;
 	}
 
-	linklist = read_dir_links(drv->path);
-	if (linklist) {
-		dlist_for_each_data(linklist, ln, char) {
+	dir = dirstream_open(drv->path);
+	if (!dir) {
+		dbg_printf("Error opening directory %s\n", drv->path);
+		return NULL;
+	}
+	dfd = dirstream_fd(dir);
 
-			if (!strncmp(ln, SYSFS_MODULE_NAME, strlen(ln)))
+	while ((dirent = dirstream_read(dir)) != NULL) {
+		if (dirent->d_type == DT_UNKNOWN) {
+			if (fstatat(dfd, dirent->d_name, &astats,
+					AT_SYMLINK_NOFOLLOW) != 0 ||
+					!S_ISLNK(astats.st_mode))
 				continue;
+		} else if (dirent->d_type != DT_LNK)
+			continue;
+		if (strcmp(dirent->d_name, SYSFS_MODULE_NAME) == 0)
+			continue;
+		if (shared_list_find(&drv->devices, dirent->d_name))
+			continue;
+
+		if (get_driver_link_target(drv, dfd, dirent->d_name, target,
+						SYSFS_PATH_MAX)) {
+			dbg_printf("Error getting link - %s\n", dirent->d_name);
+			continue;
+		}
+		/* the driver name is known, only look up the other links */
+		dev = sysfs_open_device_path_flags(target,
+				SYSFS_OPEN_BUS | SYSFS_OPEN_SUBSYSTEM);
+		if (!dev) {
+			/* drv->path goes through a symlink, do it the slow way */
+			safestrcpy(linkpath, drv->path);
+			safestrcat(linkpath, "/");
+			safestrcat(linkpath, dirent->d_name);
+			if (!sysfs_get_link(linkpath, target, SYSFS_PATH_MAX))
+				dev = sysfs_open_device_path_flags(target,
+					SYSFS_OPEN_BUS | SYSFS_OPEN_SUBSYSTEM);
+		}
+		if (!dev) {
+			dbg_printf("Error opening driver's device %s\n",
+							dirent->d_name);
+			continue;
+		}
+		safestrcpy(dev->driver_name, drv->name);
+		dev->resolved |= SYSFS_OPEN_DRIVER;
 
-			dev = sysfs_open_device(drv->bus, ln);
-			if (!dev) {
-				dbg_printf("Error opening driver's device\n");
-				sysfs_close_list(linklist);
-				return NULL;
+		if (!fresh) {
+			fresh = dlist_new_with_delete
+				(sizeof(struct sysfs_device),
+				 sysfs_close_driver_device);
+			if (!fresh) {
+				dbg_printf("Error creating device list\n");
+				sysfs_close_device(dev);
+				break;
 			}
-			if (!drv->devices) {
-				drv->devices = dlist_new_with_delete
-					(sizeof(struct sysfs_device),
-					 sysfs_close_driver_device);
-				if (!drv->devices) {
-					dbg_printf("Error creating device list\n");
-					sysfs_close_list(linklist);
-					sysfs_close_device(dev);
-					return NULL;
-				}
+		}
+		dlist_push(fresh, dev);
+	}
+	dirstream_close(dir);
+	shared_list_merge(&drv->devices, fresh);
+	return shared_list_get(&drv->devices);
+}
+
+static int sysfs_refresh_driver_device(void *device)
+{
+	return sysfs_refresh_device((struct sysfs_device *)device);
+}
+
+/**
+ * sysfs_refresh_driver: brings an open driver up to date with sysfs. Its
+ * 	attributes are read again and, if its device list was read,
+ * 	devices that were unbound are dropped and newly bound ones opened.
+ * @drv: driver to refresh
+ * returns 0 with success and -1 with error, errno is ENOENT if the
+ * 	driver is gone
+ */
+int sysfs_refresh_driver(struct sysfs_driver *drv)
+{
+	struct dlist *names;
+	struct dl_node *node;
+	char *name;
+	int bound = 0;
+
+	if (!drv) {
+		errno = EINVAL;
+		return -1;
+	}
+	if (sysfs_path_is_dir(drv->path)) {
+		dbg_printf("Driver %s is gone\n", drv->path);
+		errno = ENOENT;
+		return -1;
+	}
+
+	sysfs_lock();
+	if (drv->dirlist) {
+		free_dirlist(drv->dirlist);
+		drv->dirlist = NULL;
+	}
+	sysfs_unlock();
+	refresh_attributes(drv);
+	if (shared_list_get(&drv->devices)) {
+		names = read_dir_links(drv->path);
+		refresh_list(&drv->devices, names, sysfs_refresh_driver_device);
+		if (names) {
+			dlist_for_each_data_nomark(names, node, name, char) {
+				if (strcmp(name, SYSFS_MODULE_NAME) != 0)
+					bound = 1;
 			}
-			dlist_unshift_sorted(drv->devices, dev, sort_list);
+			sysfs_close_list(names);
 		}
-		sysfs_close_list(linklist);
+		/* only the new links are followed */
+		if (bound)
+			sysfs_get_driver_devices(drv);
 	}
-	return drv->devices;
+	return 0;
 }
 
 /**
@@ -280,6 +439,11 @@ struct sysfs_module *sysfs_get_driver_module(struct sysfs_driver *drv)
 		return NULL;
 	}
 
+	sysfs_lock();
+	if (drv->module) {
+		sysfs_unlock();
+		return drv->module;
+	}
 	memset(path, 0, SYSFS_PATH_MAX);
 	safestrcpy(path, drv->path);
 	safestrcat(path, "/");
@@ -289,5 +453,6 @@ struct sysfs_module *sysfs_get_driver_module(struct sysfs_driver *drv)
 		if (!sysfs_get_link(path, mod_path, SYSFS_PATH_MAX))
 			drv->module = sysfs_open_module_path(mod_path);
 	}
+	sysfs_unlock();
 	return drv->module;
 }
@@ -0,0 +1,666 @@
+/*
+ * sysfs_index.c
+ *
+ * Reverse indexes from devices and device numbers to class devices for
+ * libsysfs
+ *
+ * Copyright (C) IBM Corp. 2003-2005
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ */
+
+#include "config.h"
+
+#include "libsysfs.h"
+#include "sysfs.h"
+
+/* a class device seen while building the index */
+struct index_entry {
+	char *path;			/* real path of the class device */
+	char *devpath;			/* target of its device link, or NULL */
+	struct sysfs_class_device *clsdev;	/* opened on first lookup */
+	struct index_entry *next;	/* all entries, for freeing */
+};
+
+struct index_ref {
+	struct index_entry *entry;
+	struct index_ref *next;
+};
+
+/*
+ * Hash node. Path nodes are keyed by a device or class device path,
+ * devnum nodes by "b:major:minor" or "c:major:minor" and driver nodes by
+ * "bus:driver".
+ */
+struct index_node {
+	char *key;
+	struct index_entry *entry;	/* class device at this path/devnum */
+	struct index_ref *direct;	/* class devices whose device is here */
+	struct index_ref *below;	/* class devices anywhere below */
+	struct dlist *direct_list;	/* built on first lookup */
+	struct dlist *below_list;
+	char *module;			/* driver nodes: owning module */
+	struct index_node *next;
+};
+
+struct index_hash {
+	struct index_node **buckets;
+	unsigned int size;
+	unsigned int count;
+};
+
+struct sysfs_index {
+	char devices_path[SYSFS_PATH_MAX];	/* <mnt>/devices */
+	struct index_hash paths;
+	struct index_hash devnums;
+	struct index_hash drivers;
+	struct index_entry *entries;
+};
+
+static unsigned int index_hash_key(const char *key)
+{
+	unsigned int hash = 2166136261u;
+
+	while (*key) {
+		hash ^= (unsigned char)*key++;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+/**
+ * index_find: looks up a key
+ * @hash: table to search
+ * @key: key to look for
+ * returns the node or NULL if the key isn't there
+ */
+static struct index_node *index_find(struct index_hash *hash, const char *key)
+{
+	struct index_node *node;
+
+	if (!hash->size)
+		return NULL;
+	node = hash->buckets[index_hash_key(key) & (hash->size - 1)];
+	for (; node; node = node->next) {
+		if (strcmp(node->key, key) == 0)
+			return node;
+	}
+	return NULL;
+}
+
+/**
+ * index_grow: makes the table four times bigger once it holds twice as
+ * 	many nodes as it has buckets
+ * @hash: table to grow
+ * returns 0 with success and -1 with error
+ */
+static int index_grow(struct index_hash *hash)
+{
+	struct index_node **buckets, *node, *next;
+	unsigned int size, i, b;
+
+	if (hash->size && hash->count < hash->size * 2)
+		return 0;
+	size = hash->size ? hash->size * 4 : 256;
+	buckets = (struct index_node **)calloc(size,
+					sizeof(struct index_node *));
+	if (!buckets)
+		return -1;
+	for (i = 0; i < hash->size; i++) {
+		for (node = hash->buckets[i]; node; node = next) {
+			next = node->next;
+			b = index_hash_key(node->key) & (size - 1);
+			node->next = buckets[b];
+			buckets[b] = node;
+		}
+	}
+	free(hash->buckets);
+	hash->buckets = buckets;
+	hash->size = size;
+	return 0;
+}
+
+/**
+ * index_get: looks up a key, adding it if it isn't there yet
+ * @hash: table to search
+ * @key: key to look for
+ * returns the node or NULL with error
+ */
+static struct index_node *index_get(struct index_hash *hash, const char *key)
+{
+	struct index_node *node;
+	unsigned int b;
+
+	node = index_find(hash, key);
+	if (node)
+		return node;
+	if (index_grow(hash))
+		return NULL;
+	node = (struct index_node *)calloc(1, sizeof(struct index_node));
+	if (!node)
+		return NULL;
+	node->key = strdup(key);
+	if (!node->key) {
+		free(node);
+		return NULL;
+	}
+	b = index_hash_key(key) & (hash->size - 1);
+	node->next = hash->buckets[b];
+	hash->buckets[b] = node;
+	hash->count++;
+	return node;
+}
+
+static void index_no_delete(__attribute__((unused)) void *data)
+{
+}
+
+static void index_free_hash(struct index_hash *hash)
+{
+	struct index_node *node, *next;
+	struct index_ref *ref, *rnext;
+	unsigned int i;
+
+	for (i = 0; i < hash->size; i++) {
+		for (node = hash->buckets[i]; node; node = next) {
+			next = node->next;
+			for (ref = node->direct; ref; ref = rnext) {
+				rnext = ref->next;
+				free(ref);
+			}
+			for (ref = node->below; ref; ref = rnext) {
+				rnext = ref->next;
+				free(ref);
+			}
+			if (node->direct_list)
+				dlist_destroy(node->direct_list);
+			if (node->below_list)
+				dlist_destroy(node->below_list);
+			free(node->module);
+			free(node->key);
+			free(node);
+		}
+	}
+	free(hash->buckets);
+}
+
+/**
+ * index_add_ref: records that entry hangs off the device at path
+ * @index: index being built
+ * @path: device path
+ * @entry: class device entry
+ * @below: 0 if path is the entry's device, 1 if it is further up
+ * returns 0 with success and -1 with error
+ */
+static int index_add_ref(struct sysfs_index *index, const char *path,
+				struct index_entry *entry, int below)
+{
+	struct index_node *node;
+	struct index_ref *ref;
+
+	node = index_get(&index->paths, path);
+	if (!node)
+		return -1;
+	ref = (struct index_ref *)calloc(1, sizeof(struct index_ref));
+	if (!ref)
+		return -1;
+	ref->entry = entry;
+	if (below) {
+		ref->next = node->below;
+		node->below = ref;
+	} else {
+		ref->next = node->direct;
+		node->direct = ref;
+	}
+	return 0;
+}
+
+/**
+ * index_add_classdev: adds the class device at path, reading its device
+ * 	link and recording it with its device and every directory above it
+ * 	under /sys/devices
+ * @index: index being built
+ * @path: real path of the class device
+ * returns the entry or NULL with error
+ */
+static struct index_entry *index_add_classdev(struct sysfs_index *index,
+						const char *path)
+{
+	struct index_node *node;
+	struct index_entry *entry;
+	char link[SYSFS_PATH_MAX], linkpath[SYSFS_PATH_MAX];
+	char target[SYSFS_PATH_MAX], *s;
+	size_t len;
+	ssize_t count;
+
+	node = index_get(&index->paths, path);
+	if (!node)
+		return NULL;
+	if (node->entry)
+		return node->entry;
+
+	entry = (struct index_entry *)calloc(1, sizeof(struct index_entry));
+	if (!entry)
+		return NULL;
+	entry->path = strdup(path);
+	if (!entry->path) {
+		free(entry);
+		return NULL;
+	}
+	node->entry = entry;
+	entry->next = index->entries;
+	index->entries = entry;
+
+	safestrcpy(link, path);
+	safestrcat(link, "/device");
+	count = readlink(link, linkpath, SYSFS_PATH_MAX - 1);
+	if (count >= 0) {
+		linkpath[count] = '\0';
+		if (!resolve_link_target(path, linkpath, target,
+						SYSFS_PATH_MAX)) {
+			entry->devpath = strdup(target);
+			if (entry->devpath)
+				index_add_ref(index, entry->devpath, entry, 0);
+		}
+	}
+
+	len = strlen(index->devices_path);
+	if (strncmp(path, index->devices_path, len) != 0 || path[len] != '/')
+		return entry;
+	safestrcpy(target, path);
+	while ((s = strrchr(target, '/')) != NULL && s > target + len) {
+		*s = '\0';
+		index_add_ref(index, target, entry, 1);
+	}
+	return entry;
+}
+
+/**
+ * index_entry_path: works out the real path of a class directory entry
+ * @dir: class directory
+ * @dfd: descriptor of dir
+ * @dirent: entry, a link on current kernels and a directory on old ones
+ * @path: where to put the path
+ * returns 0 with success and -1 if the entry isn't a class device
+ */
+static int index_entry_path(const char *dir, int dfd, struct dirent *dirent,
+				char *path)
+{
+	char linkpath[SYSFS_PATH_MAX];
+	struct stat astats;
+	ssize_t count;
+	int type = dirent->d_type;
+
+	if (type == DT_UNKNOWN) {
+		if (fstatat(dfd, dirent->d_name, &astats, AT_SYMLINK_NOFOLLOW))
+			return -1;
+		if (S_ISLNK(astats.st_mode))
+			type = DT_LNK;
+		else if (S_ISDIR(astats.st_mode))
+			type = DT_DIR;
+	}
+	if (type == DT_DIR) {
+		if (dirent->d_name[0] == '.')
+			return -1;
+		safestrcpymax(path, dir, SYSFS_PATH_MAX);
+		safestrcatmax(path, "/", SYSFS_PATH_MAX);
+		safestrcatmax(path, dirent->d_name, SYSFS_PATH_MAX);
+		return 0;
+	}
+	if (type != DT_LNK)
+		return -1;
+	count = readlinkat(dfd, dirent->d_name, linkpath, SYSFS_PATH_MAX - 1);
+	if (count < 0)
+		return -1;
+	linkpath[count] = '\0';
+	return resolve_link_target(dir, linkpath, path, SYSFS_PATH_MAX);
+}
+
+/**
+ * index_scan_class: adds every class device in a class directory
+ * @index: index being built
+ * @dir: path of the class directory, e.g. /sys/class/net
+ */
+static void index_scan_class(struct sysfs_index *index, const char *dir)
+{
+	DIR *d;
+	struct dirent *dirent;
+	char path[SYSFS_PATH_MAX];
+
+	d = opendir(dir);
+	if (!d) {
+		dbg_printf("Error opening directory %s\n", dir);
+		return;
+	}
+	while ((dirent = readdir(d)) != NULL) {
+		if (index_entry_path(dir, dirfd(d), dirent, path))
+			continue;
+		if (!index_add_classdev(index, path))
+			dbg_printf("Error indexing %s\n", path);
+	}
+	closedir(d);
+}
+
+/**
+ * index_scan_classes: adds the class devices of every class
+ * @index: index being built
+ * @dir: path of the class root, i.e. /sys/class
+ */
+static void index_scan_classes(struct sysfs_index *index, const char *dir)
+{
+	DIR *d;
+	struct dirent *dirent;
+	char path[SYSFS_PATH_MAX];
+
+	d = opendir(dir);
+	if (!d) {
+		dbg_printf("Error opening directory %s\n", dir);
+		return;
+	}
+	while ((dirent = readdir(d)) != NULL) {
+		if (dirent->d_name[0] == '.')
+			continue;
+		if (dirent->d_type != DT_DIR && dirent->d_type != DT_UNKNOWN)
+			continue;
+		safestrcpy(path, dir);
+		safestrcat(path, "/");
+		safestrcat(path, dirent->d_name);
+		index_scan_class(index, path);
+	}
+	closedir(d);
+}
+
+/**
+ * index_scan_devnums: maps every "major:minor" link of /sys/dev/block or
+ * 	/sys/dev/char to its class device
+ * @index: index being built
+ * @dir: path of the devnum directory
+ * @type: 'b' or 'c'
+ */
+static void index_scan_devnums(struct sysfs_index *index, const char *dir,
+				char type)
+{
+	DIR *d;
+	struct dirent *dirent;
+	struct index_node *node;
+	struct index_entry *entry;
+	char path[SYSFS_PATH_MAX], key[SYSFS_NAME_LEN];
+	unsigned int major, minor;
+
+	d = opendir(dir);
+	if (!d) {
+		dbg_printf("Error opening directory %s\n", dir);
+		return;
+	}
+	while ((dirent = readdir(d)) != NULL) {
+		if (sscanf(dirent->d_name, "%u:%u", &major, &minor) != 2)
+			continue;
+		if (index_entry_path(dir, dirfd(d), dirent, path))
+			continue;
+		entry = index_add_classdev(index, path);
+		if (!entry)
+			continue;
+		snprintf(key, SYSFS_NAME_LEN, "%c:%u:%u", type, major, minor);
+		node = index_get(&index->devnums, key);
+		if (node)
+			node->entry = entry;
+	}
+	closedir(d);
+}
+
+/**
+ * index_scan_modules: maps "bus:driver" to the module owning the driver
+ * 	from the drivers links under /sys/module/<module>
+ * @index: index being built
+ * @dir: path of the module root, i.e. /sys/module
+ */
+static void index_scan_modules(struct sysfs_index *index, const char *dir)
+{
+	DIR *d, *drvdir;
+	struct dirent *dirent, *drvent;
+	struct index_node *node;
+	char path[SYSFS_PATH_MAX];
+
+	d = opendir(dir);
+	if (!d) {
+		dbg_printf("Error opening directory %s\n", dir);
+		return;
+	}
+	while ((dirent = readdir(d)) != NULL) {
+		if (dirent->d_name[0] == '.')
+			continue;
+		safestrcpy(path, dir);
+		safestrcat(path, "/");
+		safestrcat(path, dirent->d_name);
+		safestrcat(path, "/");
+		safestrcat(path, SYSFS_DRIVERS_NAME);
+		drvdir = opendir(path);
+		if (!drvdir)
+			continue;
+		while ((drvent = readdir(drvdir)) != NULL) {
+			if (drvent->d_name[0] == '.')
+				continue;
+			node = index_get(&index->drivers, drvent->d_name);
+			if (node && !node->module)
+				node->module = strdup(dirent->d_name);
+		}
+		closedir(drvdir);
+	}
+	closedir(d);
+}
+
+/**
+ * sysfs_close_index: frees an index and the class devices it handed out
+ * @index: index to close
+ */
+void sysfs_close_index(struct sysfs_index *index)
+{
+	struct index_entry *entry, *next;
+
+	if (!index)
+		return;
+	index_free_hash(&index->paths);
+	index_free_hash(&index->devnums);
+	index_free_hash(&index->drivers);
+	for (entry = index->entries; entry; entry = next) {
+		next = entry->next;
+		if (entry->clsdev)
+			sysfs_close_class_device(entry->clsdev);
+		free(entry->devpath);
+		free(entry->path);
+		free(entry);
+	}
+	free(index);
+}
+
+/**
+ * sysfs_open_index: builds the reverse indexes in one pass over
+ * 	/sys/class, /sys/block, /sys/dev/block, /sys/dev/char and the drivers
+ * 	of /sys/module. Only links are read; class devices are opened when
+ * 	a lookup first returns them.
+ * returns struct sysfs_index with success and NULL with error
+ */
+struct sysfs_index *sysfs_open_index(void)
+{
+	struct sysfs_index *index;
+	char mnt[SYSFS_PATH_MAX], path[SYSFS_PATH_MAX];
+
+	if (sysfs_get_mnt_path(mnt, SYSFS_PATH_MAX)) {
+		dbg_printf("Sysfs not supported on this system\n");
+		return NULL;
+	}
+	index = (struct sysfs_index *)calloc(1, sizeof(struct sysfs_index));
+	if (!index)
+		return NULL;
+	safestrcpy(index->devices_path, mnt);
+	safestrcat(index->devices_path, "/");
+	safestrcat(index->devices_path, SYSFS_DEVICES_NAME);
+
+	safestrcpy(path, mnt);
+	safestrcat(path, "/");
+	safestrcat(path, SYSFS_CLASS_NAME);
+	index_scan_classes(index, path);
+
+	safestrcpy(path, mnt);
+	safestrcat(path, "/");
+	safestrcat(path, SYSFS_BLOCK_NAME);
+	index_scan_class(index, path);
+
+	safestrcpy(path, mnt);
+	safestrcat(path, "/dev/block");
+	index_scan_devnums(index, path, 'b');
+
+	safestrcpy(path, mnt);
+	safestrcat(path, "/dev/char");
+	index_scan_devnums(index, path, 'c');
+
+	safestrcpy(path, mnt);
+	safestrcat(path, "/");
+	safestrcat(path, SYSFS_MODULE_NAME);
+	index_scan_modules(index, path);
+
+	if (!index->paths.count) {
+		dbg_printf("No class devices found under %s\n", mnt);
+		sysfs_close_index(index);
+		return NULL;
+	}
+	return index;
+}
+
+/**
+ * index_open_entry: opens the entry's class device on first use
+ * @entry: entry to open
+ * returns the class device or NULL with error
+ */
+static struct sysfs_class_device *index_open_entry(struct index_entry *entry)
+{
+	if (!entry->clsdev)
+		entry->clsdev = sysfs_open_class_device_path(entry->path);
+	return entry->clsdev;
+}
+
+/**
+ * sysfs_index_get_device_classdevs: returns the class devices of a device,
+ * 	e.g. the network interfaces of a PCI function
+ * @index: index to look in
+ * @devpath: path of the device, e.g. /sys/devices/pci0000:00/0000:00:19.0
+ * @flags: SYSFS_INDEX_BELOW for every class device below the device
+ * 	instead of only those whose device link points at it
+ * returns dlist of class devices owned by the index with success and
+ * 	NULL with error or if there are none
+ */
+struct dlist *sysfs_index_get_device_classdevs(struct sysfs_index *index,
+				const char *devpath, unsigned int flags)
+{
+	struct index_node *node;
+	struct index_ref *ref;
+	struct dlist **list;
+	struct sysfs_class_device *clsdev;
+	char path[SYSFS_PATH_MAX];
+
+	if (!index || !devpath) {
+		errno = EINVAL;
+		return NULL;
+	}
+	safestrcpy(path, devpath);
+	sysfs_remove_trailing_slash(path);
+	node = index_find(&index->paths, path);
+	if (!node)
+		return NULL;
+
+	sysfs_lock();
+	if (flags & SYSFS_INDEX_BELOW) {
+		list = &node->below_list;
+		ref = node->below;
+	} else {
+		list = &node->direct_list;
+		ref = node->direct;
+	}
+	if (!*list && ref) {
+		*list = dlist_new_with_delete(sizeof(struct sysfs_class_device),
+						index_no_delete);
+		for (; *list && ref; ref = ref->next) {
+			clsdev = index_open_entry(ref->entry);
+			if (clsdev)
+				dlist_unshift_sorted(*list, clsdev, sort_list);
+		}
+	}
+	sysfs_unlock();
+	return *list;
+}
+
+/**
+ * sysfs_index_get_devnum_classdev: returns the class device with a device
+ * 	number
+ * @index: index to look in
+ * @type: SYSFS_DEVNUM_BLOCK or SYSFS_DEVNUM_CHAR
+ * @major: major number
+ * @minor: minor number
+ * returns class device owned by the index with success and NULL with
+ * 	error or if there is none
+ */
+struct sysfs_class_device *sysfs_index_get_devnum_classdev
+	(struct sysfs_index *index, int type, unsigned int major,
+	 unsigned int minor)
+{
+	struct index_node *node;
+	struct sysfs_class_device *clsdev;
+	char key[SYSFS_NAME_LEN];
+
+	if (!index || (type != SYSFS_DEVNUM_BLOCK &&
+				type != SYSFS_DEVNUM_CHAR)) {
+		errno = EINVAL;
+		return NULL;
+	}
+	snprintf(key, SYSFS_NAME_LEN, "%c:%u:%u",
+		type == SYSFS_DEVNUM_BLOCK ? 'b' : 'c', major, minor);
+	node = index_find(&index->devnums, key);
+	if (!node || !node->entry)
+		return NULL;
+
+	sysfs_lock();
+	clsdev = index_open_entry(node->entry);
+	sysfs_unlock();
+	return clsdev;
+}
+
+/**
+ * sysfs_index_get_driver_module: returns the name of the module that
+ * 	registered a driver
+ * @index: index to look in
+ * @bus: bus the driver is on
+ * @driver: driver name
+ * returns module name with success and NULL with error or for drivers
+ * 	that are built in without a module entry
+ */
+const char *sysfs_index_get_driver_module(struct sysfs_index *index,
+				const char *bus, const char *driver)
+{
+	struct index_node *node;
+	char key[SYSFS_PATH_MAX];
+
+	if (!index || !bus || !driver) {
+		errno = EINVAL;
+		return NULL;
+	}
+	safestrcpy(key, bus);
+	safestrcat(key, ":");
+	safestrcat(key, driver);
+	node = index_find(&index->drivers, key);
+	if (!node)
+		return NULL;
+	return node->module;
+}
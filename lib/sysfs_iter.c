@@ -0,0 +1,537 @@
+/*
+ * sysfs_iter.c
+ *
+ * Streaming iterators over bus and class directories for libsysfs
+ *
+ * Copyright (C) IBM Corp. 2003-2005
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ */
+
+#include "config.h"
+
+#include <fnmatch.h>
+#include <regex.h>
+
+#include "libsysfs.h"
+#include "sysfs.h"
+
+/*
+ * Kinds of entries an iterator hands out. Each one knows which directory
+ * entries it wants and how to turn an entry into an object.
+ */
+enum sysfs_iter_type {
+	SYSFS_ITER_BUS_DEVICES,
+	SYSFS_ITER_BUS_DRIVERS,
+	SYSFS_ITER_CLASS_DEVICES,
+};
+
+/*
+ * A filter added with sysfs_iter_add_match(). Entries are checked against
+ * all of them before they are opened.
+ */
+struct sysfs_iter_match {
+	char key[SYSFS_NAME_LEN];	/* "name", a link or an attribute */
+	char *pattern;			/* glob */
+	regex_t regex;			/* with SYSFS_MATCH_REGEX */
+	unsigned int flags;
+};
+
+struct sysfs_iter {
+	char path[SYSFS_PATH_MAX];	/* directory being walked */
+	enum sysfs_iter_type type;
+	struct sysfs_dirstream *dir;	/* unsorted: live directory stream */
+	struct dlist *names;		/* sorted: names still to be opened */
+	void *cur;			/* object handed out last */
+	struct sysfs_iter_match *matches;
+	unsigned int match_count;
+};
+
+/**
+ * iter_close_cur: closes the object handed out by the previous _next() call
+ * @iter: iterator whose current object is to be closed
+ */
+static void iter_close_cur(struct sysfs_iter *iter)
+{
+	if (!iter->cur)
+		return;
+
+	switch (iter->type) {
+	case SYSFS_ITER_BUS_DEVICES:
+		sysfs_close_device((struct sysfs_device *)iter->cur);
+		break;
+	case SYSFS_ITER_BUS_DRIVERS:
+		sysfs_close_driver((struct sysfs_driver *)iter->cur);
+		break;
+	case SYSFS_ITER_CLASS_DEVICES:
+		sysfs_close_class_device((struct sysfs_class_device *)iter->cur);
+		break;
+	}
+	iter->cur = NULL;
+}
+
+/**
+ * iter_entry_type: classifies a directory entry as one the iterator walks -
+ * 	links for bus devices, directories for drivers and both for class
+ * 	devices. Uses d_type where the filesystem provides it so that no
+ * 	lstat() is needed per entry.
+ * @iter: iterator
+ * @dirent: entry to check
+ * returns DT_DIR or DT_LNK if the entry should be handed out, 0 otherwise
+ */
+static int iter_entry_type(struct sysfs_iter *iter, struct dirent *dirent)
+{
+	char path[SYSFS_PATH_MAX];
+	int type = dirent->d_type;
+
+	if (0 == strcmp(dirent->d_name, "."))
+		return 0;
+	if (0 == strcmp(dirent->d_name, ".."))
+		return 0;
+
+	if (type == DT_UNKNOWN) {
+		safestrcpy(path, iter->path);
+		safestrcat(path, "/");
+		safestrcat(path, dirent->d_name);
+		if (!sysfs_path_is_dir(path))
+			type = DT_DIR;
+		else if (!sysfs_path_is_link(path))
+			type = DT_LNK;
+	}
+
+	switch (iter->type) {
+	case SYSFS_ITER_BUS_DEVICES:
+		return type == DT_LNK ? type : 0;
+	case SYSFS_ITER_BUS_DRIVERS:
+		return type == DT_DIR ? type : 0;
+	case SYSFS_ITER_CLASS_DEVICES:
+		return (type == DT_DIR || type == DT_LNK) ? type : 0;
+	}
+	return 0;
+}
+
+/**
+ * iter_sorted_names: reads all wanted names under the iterator's directory
+ * 	in one pass and orders them the way the sysfs_get_bus_devices(),
+ * 	sysfs_get_bus_drivers() and sysfs_get_class_devices() lists are.
+ * @iter: iterator
+ * returns dlist of names on success (possibly empty) and NULL on error
+ */
+static struct dlist *iter_sorted_names(struct sysfs_iter *iter)
+{
+	struct sysfs_dirstream *dir;
+	struct dirent *dirent;
+	struct dlist *names;
+	char *name;
+	int type;
+
+	dir = dirstream_open(iter->path);
+	if (!dir) {
+		dbg_printf("Error opening directory %s\n", iter->path);
+		return NULL;
+	}
+	names = dlist_new(SYSFS_NAME_LEN);
+	if (!names) {
+		dbg_printf("Error creating list\n");
+		dirstream_close(dir);
+		return NULL;
+	}
+	while ((dirent = dirstream_read(dir)) != NULL) {
+		type = iter_entry_type(iter, dirent);
+		if (!type)
+			continue;
+		name = (char *)calloc(1, SYSFS_NAME_LEN);
+		if (!name)
+			continue;
+		safestrcpymax(name, dirent->d_name, SYSFS_NAME_LEN);
+		dlist_unshift_sorted(names, name, sort_list);
+	}
+	dirstream_close(dir);
+	return names;
+}
+
+/**
+ * iter_next_name: fetches the name of the next entry to be opened
+ * @iter: iterator
+ * @name: buffer of SYSFS_NAME_LEN to store the name in
+ * returns 0 on success and -1 once the directory is exhausted
+ */
+static int iter_next_name(struct sysfs_iter *iter, char *name)
+{
+	struct dirent *dirent;
+	char *n;
+
+	if (iter->names) {
+		if (iter->names->count == 0)
+			return -1;
+		n = dlist_shift(iter->names);
+		safestrcpymax(name, n, SYSFS_NAME_LEN);
+		free(n);
+		return 0;
+	}
+	while ((dirent = dirstream_read(iter->dir)) != NULL) {
+		if (iter_entry_type(iter, dirent)) {
+			safestrcpymax(name, dirent->d_name, SYSFS_NAME_LEN);
+			return 0;
+		}
+	}
+	return -1;
+}
+
+/**
+ * iter_open_entry: opens the object an entry of the iterator refers to
+ * @iter: iterator
+ * @name: entry name
+ * returns the opened object or NULL on error
+ */
+static void *iter_open_entry(struct sysfs_iter *iter, const char *name)
+{
+	char path[SYSFS_PATH_MAX], target[SYSFS_PATH_MAX];
+
+	safestrcpy(path, iter->path);
+	safestrcat(path, "/");
+	safestrcat(path, name);
+
+	switch (iter->type) {
+	case SYSFS_ITER_BUS_DEVICES:
+		if (sysfs_get_link(path, target, SYSFS_PATH_MAX)) {
+			dbg_printf("Error getting link - %s\n", path);
+			return NULL;
+		}
+		/* the link based fields are looked up on first use */
+		return sysfs_open_device_path_flags(target, 0);
+	case SYSFS_ITER_BUS_DRIVERS:
+		return sysfs_open_driver_path(path);
+	case SYSFS_ITER_CLASS_DEVICES:
+		return sysfs_open_class_device_path(path);
+	}
+	return NULL;
+}
+
+/**
+ * match_value: checks a value against one filter
+ * @match: filter
+ * @value: entry name, link target name or attribute value
+ * returns 1 if it matches and 0 if not
+ */
+static int match_value(struct sysfs_iter_match *match, const char *value)
+{
+	if (match->flags & SYSFS_MATCH_REGEX)
+		return regexec(&match->regex, value, 0, NULL, 0) == 0;
+	return fnmatch(match->pattern, value, 0) == 0;
+}
+
+/**
+ * match_entry_key: checks one filter on a link or attribute in the
+ * 	entry's directory. A link is matched by the name of what it points
+ * 	to, an attribute by its value without the trailing newline.
+ * @match: filter
+ * @path: entry path
+ * returns 1 if it matches and 0 if not or if there is no such key
+ */
+static int match_entry_key(struct sysfs_iter_match *match, const char *path)
+{
+	char keypath[SYSFS_PATH_MAX], target[SYSFS_PATH_MAX];
+	char name[SYSFS_NAME_LEN];
+	struct sysfs_attribute *attr;
+	int ret = 0;
+
+	safestrcpy(keypath, path);
+	safestrcat(keypath, "/");
+	safestrcat(keypath, match->key);
+
+	if (!sysfs_get_link(keypath, target, SYSFS_PATH_MAX)) {
+		if (sysfs_get_name_from_path(target, name, SYSFS_NAME_LEN))
+			return 0;
+		return match_value(match, name);
+	}
+	if (errno == ENOENT)
+		return 0;
+	attr = sysfs_open_attribute(keypath);
+	if (!attr)
+		return 0;
+	if (!sysfs_read_attribute(attr) && attr->value) {
+		if (attr->len > 0 && attr->value[attr->len - 1] == '\n')
+			attr->value[attr->len - 1] = '\0';
+		ret = match_value(match, attr->value);
+	}
+	sysfs_close_attribute(attr);
+	return ret;
+}
+
+/**
+ * iter_matches: checks an entry against the iterator's filters, the ones
+ * 	on its name first as they need no file to be read
+ * @iter: iterator
+ * @name: entry name
+ * returns 1 if all filters match and 0 if not
+ */
+static int iter_matches(struct sysfs_iter *iter, const char *name)
+{
+	char path[SYSFS_PATH_MAX];
+	unsigned int i;
+
+	for (i = 0; i < iter->match_count; i++) {
+		if (!strcmp(iter->matches[i].key, SYSFS_NAME_ATTRIBUTE) &&
+		    !match_value(&iter->matches[i], name))
+			return 0;
+	}
+	safestrcpy(path, iter->path);
+	safestrcat(path, "/");
+	safestrcat(path, name);
+	for (i = 0; i < iter->match_count; i++) {
+		if (strcmp(iter->matches[i].key, SYSFS_NAME_ATTRIBUTE) &&
+		    !match_entry_key(&iter->matches[i], path))
+			return 0;
+	}
+	return 1;
+}
+
+/**
+ * iter_next: hands out the next object, closing the previous one
+ * @iter: iterator
+ * returns next object or NULL when there are no more
+ */
+static void *iter_next(struct sysfs_iter *iter)
+{
+	char name[SYSFS_NAME_LEN];
+
+	if (!iter) {
+		errno = EINVAL;
+		return NULL;
+	}
+	iter_close_cur(iter);
+	while (!iter_next_name(iter, name)) {
+		if (iter->match_count && !iter_matches(iter, name))
+			continue;
+		iter->cur = iter_open_entry(iter, name);
+		if (iter->cur)
+			return iter->cur;
+		dbg_printf("Error opening %s/%s\n", iter->path, name);
+	}
+	return NULL;
+}
+
+/**
+ * sysfs_close_iter: closes the iterator and the object it last handed out
+ * @iter: iterator to close
+ */
+void sysfs_close_iter(struct sysfs_iter *iter)
+{
+	unsigned int i;
+
+	if (iter) {
+		iter_close_cur(iter);
+		if (iter->dir)
+			dirstream_close(iter->dir);
+		if (iter->names)
+			dlist_destroy(iter->names);
+		for (i = 0; i < iter->match_count; i++) {
+			if (iter->matches[i].flags & SYSFS_MATCH_REGEX)
+				regfree(&iter->matches[i].regex);
+			free(iter->matches[i].pattern);
+		}
+		free(iter->matches);
+		free(iter);
+	}
+}
+
+/**
+ * sysfs_iter_add_match: hands out only entries matching a pattern. The
+ * 	entries are checked as the directory is read, and those that don't
+ * 	match are never opened. All filters added must match.
+ * @iter: iterator, before its first _next() call
+ * @key: "name" for the entry name, else a link or attribute in the
+ * 	entry's directory, such as "driver" or "numa_node"
+ * @pattern: glob, or extended regular expression with SYSFS_MATCH_REGEX
+ * @flags: SYSFS_MATCH_GLOB or SYSFS_MATCH_REGEX
+ * returns 0 on success and -1 on error
+ */
+int sysfs_iter_add_match(struct sysfs_iter *iter, const char *key,
+		const char *pattern, unsigned int flags)
+{
+	struct sysfs_iter_match *matches, *match;
+
+	if (!iter || !key || !pattern || !*key || strchr(key, '/') ||
+	    strlen(key) >= SYSFS_NAME_LEN || (flags & ~SYSFS_MATCH_REGEX)) {
+		errno = EINVAL;
+		return -1;
+	}
+	matches = (struct sysfs_iter_match *)realloc(iter->matches,
+			(iter->match_count + 1) *
+			sizeof(struct sysfs_iter_match));
+	if (!matches) {
+		dbg_printf("realloc failed\n");
+		return -1;
+	}
+	iter->matches = matches;
+	match = &matches[iter->match_count];
+	memset(match, 0, sizeof(struct sysfs_iter_match));
+	safestrcpy(match->key, key);
+	match->flags = flags;
+	match->pattern = strdup(pattern);
+	if (!match->pattern) {
+		dbg_printf("strdup failed\n");
+		return -1;
+	}
+	if ((flags & SYSFS_MATCH_REGEX) && regcomp(&match->regex, pattern,
+				REG_EXTENDED | REG_NOSUB)) {
+		dbg_printf("Invalid regular expression %s\n", pattern);
+		free(match->pattern);
+		errno = EINVAL;
+		return -1;
+	}
+	iter->match_count++;
+	return 0;
+}
+
+/**
+ * open_iter: allocates an iterator walking "dir" under "path"
+ * @path: bus or class path
+ * @dir: subdirectory to walk, NULL to walk path itself
+ * @type: kind of objects to hand out
+ * @flags: SYSFS_ITER_* flags
+ * returns struct sysfs_iter with success and NULL with error
+ */
+static struct sysfs_iter *open_iter(const char *path, const char *dir,
+		enum sysfs_iter_type type, unsigned int flags)
+{
+	struct sysfs_iter *iter;
+
+	iter = (struct sysfs_iter *)calloc(1, sizeof(struct sysfs_iter));
+	if (!iter) {
+		dbg_printf("calloc failed\n");
+		return NULL;
+	}
+	iter->type = type;
+	safestrcpy(iter->path, path);
+	if (dir) {
+		safestrcat(iter->path, "/");
+		safestrcat(iter->path, dir);
+	}
+
+	if (flags & SYSFS_ITER_SORTED) {
+		iter->names = iter_sorted_names(iter);
+		if (!iter->names) {
+			free(iter);
+			return NULL;
+		}
+	} else {
+		iter->dir = dirstream_open(iter->path);
+		if (!iter->dir) {
+			dbg_printf("Error opening directory %s\n", iter->path);
+			free(iter);
+			return NULL;
+		}
+	}
+	return iter;
+}
+
+/**
+ * sysfs_open_bus_device_iter: opens an iterator over the bus' devices
+ * @bus: bus whose devices are to be walked
+ * @flags: SYSFS_ITER_SORTED to hand out devices in sorted order
+ * returns struct sysfs_iter with success and NULL with error
+ */
+struct sysfs_iter *sysfs_open_bus_device_iter(struct sysfs_bus *bus,
+		unsigned int flags)
+{
+	if (!bus) {
+		errno = EINVAL;
+		return NULL;
+	}
+	return open_iter(bus->path, SYSFS_DEVICES_NAME,
+			SYSFS_ITER_BUS_DEVICES, flags);
+}
+
+/**
+ * sysfs_bus_device_iter_next: opens the next device on the bus
+ * @iter: iterator from sysfs_open_bus_device_iter()
+ * returns sysfs_device, valid until the next call or until the iterator
+ * 	is closed, or NULL when there are no more devices
+ */
+struct sysfs_device *sysfs_bus_device_iter_next(struct sysfs_iter *iter)
+{
+	if (iter && iter->type != SYSFS_ITER_BUS_DEVICES) {
+		errno = EINVAL;
+		return NULL;
+	}
+	return (struct sysfs_device *)iter_next(iter);
+}
+
+/**
+ * sysfs_open_bus_driver_iter: opens an iterator over the bus' drivers
+ * @bus: bus whose drivers are to be walked
+ * @flags: SYSFS_ITER_SORTED to hand out drivers in sorted order
+ * returns struct sysfs_iter with success and NULL with error
+ */
+struct sysfs_iter *sysfs_open_bus_driver_iter(struct sysfs_bus *bus,
+		unsigned int flags)
+{
+	if (!bus) {
+		errno = EINVAL;
+		return NULL;
+	}
+	return open_iter(bus->path, SYSFS_DRIVERS_NAME,
+			SYSFS_ITER_BUS_DRIVERS, flags);
+}
+
+/**
+ * sysfs_bus_driver_iter_next: opens the next driver on the bus
+ * @iter: iterator from sysfs_open_bus_driver_iter()
+ * returns sysfs_driver, valid until the next call or until the iterator
+ * 	is closed, or NULL when there are no more drivers
+ */
+struct sysfs_driver *sysfs_bus_driver_iter_next(struct sysfs_iter *iter)
+{
+	if (iter && iter->type != SYSFS_ITER_BUS_DRIVERS) {
+		errno = EINVAL;
+		return NULL;
+	}
+	return (struct sysfs_driver *)iter_next(iter);
+}
+
+/**
+ * sysfs_open_class_device_iter: opens an iterator over the class' devices
+ * @cls: class whose devices are to be walked
+ * @flags: SYSFS_ITER_SORTED to hand out class devices in sorted order
+ * returns struct sysfs_iter with success and NULL with error
+ */
+struct sysfs_iter *sysfs_open_class_device_iter(struct sysfs_class *cls,
+		unsigned int flags)
+{
+	if (!cls) {
+		errno = EINVAL;
+		return NULL;
+	}
+	return open_iter(cls->path, NULL, SYSFS_ITER_CLASS_DEVICES, flags);
+}
+
+/**
+ * sysfs_class_device_iter_next: opens the next class device
+ * @iter: iterator from sysfs_open_class_device_iter()
+ * returns sysfs_class_device, valid until the next call or until the
+ * 	iterator is closed, or NULL when there are no more class devices
+ */
+struct sysfs_class_device *sysfs_class_device_iter_next
+		(struct sysfs_iter *iter)
+{
+	if (iter && iter->type != SYSFS_ITER_CLASS_DEVICES) {
+		errno = EINVAL;
+		return NULL;
+	}
+	return (struct sysfs_class_device *)iter_next(iter);
+}
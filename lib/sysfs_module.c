@@ -54,16 +54,33 @@ void sysfs_close_module(struct sysfs_module *module)
 	 * this single call
 	 */
 	if (module != NULL) {
-		if (module->attrlist != NULL)
-			dlist_destroy(module->attrlist);
-		if (module->parmlist != NULL)
-			dlist_destroy(module->parmlist);
-		if (module->sections != NULL)
-			dlist_destroy(module->sections);
+		if (sysfs_put_ref(module))
+			return;
+		shared_list_destroy(module->attrlist);
+		shared_list_destroy(module->parmlist);
+		shared_list_destroy(module->sections);
+		if (module->dirlist != NULL)
+			free_dirlist(module->dirlist);
 		free(module);
 	}
 }
 
+/**
+ * sysfs_ref_module: takes an extra reference on a module, to be dropped
+ * 	with sysfs_close_module()
+ * @module: module to reference
+ * returns @module with success and NULL with error
+ */
+struct sysfs_module *sysfs_ref_module(struct sysfs_module *module)
+{
+	if (!module) {
+		errno = EINVAL;
+		return NULL;
+	}
+	sysfs_get_ref(module);
+	return module;
+}
+
 /**
  * alloc_module: callocs and initializes new module struct.
  * returns sysfs_module or NULL.
@@ -173,6 +190,23 @@ struct dlist *sysfs_get_module_attributes(struct sysfs_module *module)
 	return get_dev_attributes_list(module);
 }
 
+/**
+ * sysfs_get_module_attrs: reads only the named module attributes, without
+ * 	scanning the module directory
+ * @module: module whose attributes are needed
+ * @names: NULL terminated list of attribute names
+ * returns dlist of attributes on success or NULL on error
+ */
+struct dlist *sysfs_get_module_attrs(struct sysfs_module *module,
+				const char * const *names)
+{
+	if (!module) {
+		errno = EINVAL;
+		return NULL;
+	}
+	return get_dev_attributes_named(module, names, &module->dirlist);
+}
+
 /**
  * sysfs_get_module_attr: searches module's attributes by name
  * @module: module to look through
@@ -187,7 +221,7 @@ struct sysfs_attribute *sysfs_get_module_attr
 		return NULL;
 	}
 
-	return get_attribute(module, (char *)name);
+	return get_attribute(module, (char *)name, &module->dirlist);
 }
 
 /**
@@ -203,12 +237,16 @@ struct dlist *sysfs_get_module_parms(struct sysfs_module *module)
 		errno = EINVAL;
 		return NULL;
 	}
+
 	memset(ppath, 0, SYSFS_PATH_MAX);
 	safestrcpy(ppath, module->path);
 	safestrcat(ppath,"/");
 	safestrcat(ppath, SYSFS_MOD_PARM_NAME);
 
-	return (get_attributes_list(module->parmlist, ppath));
+	if (!shared_list_get(&module->parmlist))
+		shared_list_merge(&module->parmlist,
+				get_attributes_list(NULL, ppath));
+	return shared_list_get(&module->parmlist);
 }
 
 /**
@@ -230,7 +268,10 @@ struct dlist *sysfs_get_module_sections(struct sysfs_module *module)
 	safestrcat(ppath,"/");
 	safestrcat(ppath, SYSFS_MOD_SECT_NAME);
 
-	return (get_attributes_list(module->sections, ppath));
+	if (!shared_list_get(&module->sections))
+		shared_list_merge(&module->sections,
+				get_attributes_list(NULL, ppath));
+	return shared_list_get(&module->sections);
 }
 
 /**
@@ -0,0 +1,518 @@
+/*
+ * sysfs_monitor.c
+ *
+ * Kernel uevent listener keeping open libsysfs objects up to date
+ *
+ * Copyright (C) IBM Corp. 2003-2005
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ */
+
+#include "config.h"
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+#ifdef HAVE_LINUX_NETLINK_H
+#include <linux/netlink.h>
+#endif
+
+#include "libsysfs.h"
+#include "sysfs.h"
+
+/* a kernel uevent is at most 2048 bytes of variables plus the header */
+#define MONITOR_BUFFER_SIZE	8192
+
+/* the kernel's uevent multicast group */
+#define MONITOR_KERNEL_GROUP	1
+
+struct sysfs_monitor {
+	int fd;
+	struct dlist *buses;		/* watched, each holds a reference */
+	struct dlist *classes;
+	char mnt_path[SYSFS_PATH_MAX];
+	char buf[MONITOR_BUFFER_SIZE];
+};
+
+static const char *event_actions[] = {
+	[SYSFS_EVENT_ADD] = "add",
+	[SYSFS_EVENT_REMOVE] = "remove",
+	[SYSFS_EVENT_CHANGE] = "change",
+	[SYSFS_EVENT_MOVE] = "move",
+	[SYSFS_EVENT_ONLINE] = "online",
+	[SYSFS_EVENT_OFFLINE] = "offline",
+	[SYSFS_EVENT_BIND] = "bind",
+	[SYSFS_EVENT_UNBIND] = "unbind",
+};
+
+static void sysfs_close_watched_bus(void *bus)
+{
+	sysfs_close_bus((struct sysfs_bus *)bus);
+}
+
+static void sysfs_close_watched_class(void *cls)
+{
+	sysfs_close_class((struct sysfs_class *)cls);
+}
+
+/**
+ * sysfs_open_monitor_fd: creates a monitor reading uevents from a socket
+ * 	the caller opened, e.g. a netlink socket set up differently or a
+ * 	socketpair() replaying recorded events. The monitor owns fd from
+ * 	then on and closes it in sysfs_close_monitor().
+ * @fd: datagram socket, one uevent per message
+ * returns struct sysfs_monitor with success and NULL with error
+ */
+struct sysfs_monitor *sysfs_open_monitor_fd(int fd)
+{
+	struct sysfs_monitor *mon;
+
+	if (fd < 0) {
+		errno = EINVAL;
+		return NULL;
+	}
+	mon = (struct sysfs_monitor *)calloc(1, sizeof(struct sysfs_monitor));
+	if (!mon) {
+		dbg_printf("calloc failed\n");
+		return NULL;
+	}
+	if (sysfs_get_mnt_path(mon->mnt_path, SYSFS_PATH_MAX)) {
+		dbg_printf("Sysfs not supported on this system\n");
+		free(mon);
+		return NULL;
+	}
+	mon->fd = fd;
+	return mon;
+}
+
+/**
+ * sysfs_open_monitor: opens a NETLINK_KOBJECT_UEVENT socket listening to
+ * 	the kernel's uevents
+ * returns struct sysfs_monitor with success and NULL with error, errno
+ * 	is ENOSYS if the library was built without netlink support
+ */
+struct sysfs_monitor *sysfs_open_monitor(void)
+{
+#ifdef HAVE_LINUX_NETLINK_H
+	struct sysfs_monitor *mon;
+	struct sockaddr_nl snl;
+	int fd, size = 1024 * 1024;
+
+	fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+						NETLINK_KOBJECT_UEVENT);
+	if (fd < 0) {
+		dbg_printf("Error opening uevent socket\n");
+		return NULL;
+	}
+	memset(&snl, 0, sizeof(struct sockaddr_nl));
+	snl.nl_family = AF_NETLINK;
+	snl.nl_groups = MONITOR_KERNEL_GROUP;
+	if (bind(fd, (struct sockaddr *)&snl, sizeof(struct sockaddr_nl))) {
+		dbg_printf("Error binding uevent socket\n");
+		close(fd);
+		return NULL;
+	}
+	/* coldplug bursts are large, a bigger buffer is only a hint */
+	setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+
+	mon = sysfs_open_monitor_fd(fd);
+	if (!mon)
+		close(fd);
+	return mon;
+#else
+	errno = ENOSYS;
+	return NULL;
+#endif
+}
+
+/**
+ * sysfs_close_monitor: closes the monitor's socket and drops its
+ * 	references to the watched objects
+ * @mon: monitor to close
+ */
+void sysfs_close_monitor(struct sysfs_monitor *mon)
+{
+	if (mon) {
+		if (mon->buses)
+			dlist_destroy(mon->buses);
+		if (mon->classes)
+			dlist_destroy(mon->classes);
+		close(mon->fd);
+		free(mon);
+	}
+}
+
+/**
+ * sysfs_monitor_get_fd: returns the descriptor to poll for uevents
+ * @mon: monitor
+ * returns the descriptor with success and -1 with error
+ */
+int sysfs_monitor_get_fd(struct sysfs_monitor *mon)
+{
+	if (!mon) {
+		errno = EINVAL;
+		return -1;
+	}
+	return mon->fd;
+}
+
+/**
+ * sysfs_monitor_watch_bus: has the monitor keep an open bus up to date.
+ * 	The monitor takes a reference on the bus, so the caller may close
+ * 	its own.
+ * @mon: monitor
+ * @bus: bus to watch
+ * returns 0 with success and -1 with error
+ */
+int sysfs_monitor_watch_bus(struct sysfs_monitor *mon, struct sysfs_bus *bus)
+{
+	if (!mon || !bus) {
+		errno = EINVAL;
+		return -1;
+	}
+	if (!mon->buses) {
+		mon->buses = dlist_new_with_delete(sizeof(struct sysfs_bus),
+						sysfs_close_watched_bus);
+		if (!mon->buses) {
+			dbg_printf("Error creating list\n");
+			return -1;
+		}
+	}
+	dlist_push(mon->buses, sysfs_ref_bus(bus));
+	return 0;
+}
+
+/**
+ * sysfs_monitor_watch_class: has the monitor keep an open class up to
+ * 	date, see sysfs_monitor_watch_bus()
+ * @mon: monitor
+ * @cls: class to watch
+ * returns 0 with success and -1 with error
+ */
+int sysfs_monitor_watch_class(struct sysfs_monitor *mon,
+				struct sysfs_class *cls)
+{
+	if (!mon || !cls) {
+		errno = EINVAL;
+		return -1;
+	}
+	if (!mon->classes) {
+		mon->classes = dlist_new_with_delete
+			(sizeof(struct sysfs_class), sysfs_close_watched_class);
+		if (!mon->classes) {
+			dbg_printf("Error creating list\n");
+			return -1;
+		}
+	}
+	dlist_push(mon->classes, sysfs_ref_class(cls));
+	return 0;
+}
+
+/**
+ * parse_event: splits a kernel uevent message into an event. The message
+ * 	is "action@devpath" followed by NUL separated KEY=value pairs.
+ * @mon: monitor, for the sysfs mount path
+ * @buf: NUL terminated message
+ * @len: message length
+ * @event: event to fill in
+ * returns 0 with success and -1 if this is not a kernel uevent
+ */
+static int parse_event(struct sysfs_monitor *mon, char *buf, size_t len,
+			struct sysfs_event *event)
+{
+	const char *action = NULL, *devpath = NULL, *old = NULL;
+	char *key, *end = buf + len;
+	unsigned int i;
+
+	/* udevd's own messages start with "libudev" and have no '@' */
+	if (!strchr(buf, '@'))
+		return -1;
+
+	memset(event, 0, sizeof(struct sysfs_event));
+	for (key = buf + strlen(buf) + 1; key < end; key += strlen(key) + 1) {
+		if (strncmp(key, "ACTION=", 7) == 0)
+			action = key + 7;
+		else if (strncmp(key, "DEVPATH=", 8) == 0)
+			devpath = key + 8;
+		else if (strncmp(key, "DEVPATH_OLD=", 12) == 0)
+			old = key + 12;
+		else if (strncmp(key, "SUBSYSTEM=", 10) == 0)
+			safestrcpy(event->subsystem, key + 10);
+		else if (strncmp(key, "DRIVER=", 7) == 0)
+			safestrcpy(event->driver, key + 7);
+		else if (strncmp(key, "SEQNUM=", 7) == 0)
+			event->seqnum = strtoull(key + 7, NULL, 10);
+	}
+	if (!action || !devpath) {
+		dbg_printf("Malformed uevent %s\n", buf);
+		return -1;
+	}
+
+	for (i = 0; i < sizeof(event_actions) / sizeof(char *); i++) {
+		if (event_actions[i] && strcmp(action, event_actions[i]) == 0)
+			event->action = (enum sysfs_event_action)i;
+	}
+	safestrcpy(event->path, mon->mnt_path);
+	safestrcat(event->path, devpath);
+	if (old) {
+		safestrcpy(event->old_path, mon->mnt_path);
+		safestrcat(event->old_path, old);
+	}
+	return 0;
+}
+
+static int name_is(void *data, void *name)
+{
+	return strcmp(((struct sysfs_device *)data)->name,
+					(const char *)name) == 0;
+}
+
+/**
+ * drop_entry: removes the object called name from a list of libsysfs
+ * 	objects. It is closed along with the list's owner, as callers
+ * 	may still hold it.
+ * @list: where the list of sysfs_* structs is published
+ * @name: name of the object to drop
+ */
+static void drop_entry(struct dlist **list, const char *name)
+{
+	shared_list_drop(list, name_is, (void *)name);
+}
+
+/**
+ * update_bus_devices: applies an event about one of the bus's devices
+ * @bus: watched bus the event's subsystem matches
+ * @event: the event
+ * @name: last component of the event's path
+ * @old: last component of the event's old path, NULL if it has none
+ */
+static void update_bus_devices(struct sysfs_bus *bus,
+		const struct sysfs_event *event, const char *name,
+		const char *old)
+{
+	struct sysfs_device *dev;
+	struct sysfs_driver *drv;
+	struct dlist *drivers;
+	struct dl_node *node;
+
+	if (shared_list_get(&bus->devices)) {
+		switch (event->action) {
+		case SYSFS_EVENT_ADD:
+			sysfs_get_bus_device(bus, name);
+			break;
+		case SYSFS_EVENT_REMOVE:
+			drop_entry(&bus->devices, name);
+			break;
+		case SYSFS_EVENT_MOVE:
+			if (old)
+				drop_entry(&bus->devices, old);
+			sysfs_get_bus_device(bus, name);
+			break;
+		default:
+			dev = (struct sysfs_device *)shared_list_find
+						(&bus->devices, name);
+			if (dev && sysfs_refresh_device(dev))
+				drop_entry(&bus->devices, name);
+			break;
+		}
+	}
+
+	drivers = shared_list_get(&bus->drivers);
+	if (!drivers || (event->action != SYSFS_EVENT_BIND &&
+				event->action != SYSFS_EVENT_UNBIND))
+		return;
+	/* the driver that got it and the one that had it */
+	dlist_for_each_data_nomark(drivers, node, drv, struct sysfs_driver) {
+		if (!shared_list_get(&drv->devices))
+			continue;
+		if (strcmp(drv->name, event->driver) == 0 ||
+				shared_list_find(&drv->devices, name))
+			sysfs_refresh_driver(drv);
+	}
+}
+
+/**
+ * update_bus_drivers: applies a "drivers" event to the bus it is under
+ * @bus: watched bus
+ * @event: the event
+ * @name: last component of the event's path, the driver name
+ */
+static void update_bus_drivers(struct sysfs_bus *bus,
+		const struct sysfs_event *event, const char *name)
+{
+	char prefix[SYSFS_PATH_MAX];
+	struct sysfs_driver *drv;
+
+	if (!shared_list_get(&bus->drivers))
+		return;
+	safestrcpy(prefix, bus->path);
+	safestrcat(prefix, "/");
+	safestrcat(prefix, SYSFS_DRIVERS_NAME);
+	safestrcat(prefix, "/");
+	if (strncmp(event->path, prefix, strlen(prefix)) != 0)
+		return;
+
+	switch (event->action) {
+	case SYSFS_EVENT_ADD:
+		sysfs_get_bus_driver(bus, name);
+		break;
+	case SYSFS_EVENT_REMOVE:
+		drop_entry(&bus->drivers, name);
+		break;
+	default:
+		drv = (struct sysfs_driver *)shared_list_find(&bus->drivers,
+								name);
+		if (drv && sysfs_refresh_driver(drv))
+			drop_entry(&bus->drivers, name);
+		break;
+	}
+}
+
+/**
+ * update_class_devices: applies an event about one of the class's devices
+ * @cls: watched class the event's subsystem matches
+ * @event: the event
+ * @name: last component of the event's path
+ * @old: last component of the event's old path, NULL if it has none
+ */
+static void update_class_devices(struct sysfs_class *cls,
+		const struct sysfs_event *event, const char *name,
+		const char *old)
+{
+	struct sysfs_class_device *cdev;
+
+	if (!shared_list_get(&cls->devices))
+		return;
+
+	switch (event->action) {
+	case SYSFS_EVENT_ADD:
+		sysfs_get_class_device(cls, name);
+		break;
+	case SYSFS_EVENT_REMOVE:
+		drop_entry(&cls->devices, name);
+		break;
+	case SYSFS_EVENT_MOVE:
+		if (old)
+			drop_entry(&cls->devices, old);
+		sysfs_get_class_device(cls, name);
+		break;
+	default:
+		cdev = (struct sysfs_class_device *)shared_list_find
+						(&cls->devices, name);
+		if (cdev && sysfs_refresh_class_device(cdev))
+			drop_entry(&cls->devices, name);
+		break;
+	}
+}
+
+/**
+ * apply_event: updates the watched objects an event is about
+ * @mon: monitor
+ * @event: parsed event
+ */
+static void apply_event(struct sysfs_monitor *mon,
+			const struct sysfs_event *event)
+{
+	char name[SYSFS_NAME_LEN], old[SYSFS_NAME_LEN];
+	struct sysfs_bus *bus;
+	struct sysfs_class *cls;
+	struct dl_node *node;
+	int has_old = 0;
+
+	if (sysfs_get_name_from_path(event->path, name, SYSFS_NAME_LEN))
+		return;
+	if (event->old_path[0] && !sysfs_get_name_from_path(event->old_path,
+						old, SYSFS_NAME_LEN))
+		has_old = 1;
+
+	/* the lists are swapped whole, readers elsewhere never wait on us */
+	if (mon->buses) {
+		dlist_for_each_data_nomark(mon->buses, node, bus,
+						struct sysfs_bus) {
+			if (strcmp(event->subsystem, SYSFS_DRIVERS_NAME) == 0)
+				update_bus_drivers(bus, event, name);
+			else if (strcmp(event->subsystem, bus->name) == 0)
+				update_bus_devices(bus, event, name,
+						has_old ? old : NULL);
+		}
+	}
+	if (mon->classes) {
+		dlist_for_each_data_nomark(mon->classes, node, cls,
+						struct sysfs_class) {
+			if (strcmp(event->subsystem, cls->name) == 0)
+				update_class_devices(cls, event, name,
+						has_old ? old : NULL);
+		}
+	}
+}
+
+/**
+ * sysfs_monitor_receive: reads the next pending uevent, if any, and
+ * 	updates the watched buses and classes accordingly. It never
+ * 	blocks, so it is meant to be called in a loop once the monitor's
+ * 	descriptor is readable. Messages that are not kernel uevents are
+ * 	skipped.
+ * @mon: monitor
+ * @event: filled in with the event
+ * returns 1 if an event was read, 0 if none is pending and -1 with error
+ */
+int sysfs_monitor_receive(struct sysfs_monitor *mon, struct sysfs_event *event)
+{
+	struct sockaddr_storage addr;
+	struct iovec iov;
+	struct msghdr msg;
+	ssize_t len;
+
+	if (!mon || !event) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	for (;;) {
+		memset(&msg, 0, sizeof(struct msghdr));
+		iov.iov_base = mon->buf;
+		iov.iov_len = MONITOR_BUFFER_SIZE - 1;
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		msg.msg_name = &addr;
+		msg.msg_namelen = sizeof(addr);
+		len = recvmsg(mon->fd, &msg, MSG_DONTWAIT);
+		if (len < 0) {
+			if (errno == EINTR)
+				continue;
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				return 0;
+			dbg_printf("Error reading uevent\n");
+			return -1;
+		}
+		if (len == 0)
+			return 0;
+		if (msg.msg_flags & MSG_TRUNC)
+			continue;
+#ifdef HAVE_LINUX_NETLINK_H
+		/* on the netlink socket only the kernel is to be believed */
+		if (msg.msg_namelen >= sizeof(struct sockaddr_nl) &&
+				addr.ss_family == AF_NETLINK &&
+				((struct sockaddr_nl *)&addr)->nl_pid != 0)
+			continue;
+#endif
+		mon->buf[len] = '\0';
+		if (parse_event(mon, mon->buf, len, event))
+			continue;
+		bump_generation();
+		apply_event(mon, event);
+		return 1;
+	}
+}
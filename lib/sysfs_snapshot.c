@@ -0,0 +1,1740 @@
+/*
+ * sysfs_snapshot.c
+ *
+ * Shared memory snapshots and cache files of sysfs for libsysfs
+ *
+ * Copyright (C) IBM Corp. 2003-2005
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ */
+
+#include "config.h"
+
+#include <stdint.h>
+#include <sched.h>
+#include <fnmatch.h>
+#include <time.h>
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+
+#include "libsysfs.h"
+#include "sysfs.h"
+
+#if defined(HAVE_SYS_MMAN_H) && defined(HAVE_SHM_OPEN)
+#define SNAPSHOT_SHM	1
+#endif
+
+/*
+ * A snapshot segment is a header, an array of entries and a string pool.
+ * Entries are sorted by their path relative to the sysfs mount point,
+ * with '/' sorting before any other character: every directory is then
+ * followed by its whole subtree, and its children are found by stepping
+ * over the subtrees with the skip counts.
+ *
+ * Values of SYSFS_ATTR_COUNTER attributes are left out, readers get them
+ * from sysfs when they ask.
+ *
+ * The publisher rewrites the segment in place. seq is odd while it does,
+ * readers copy out what they need and start over if seq moved meanwhile.
+ *
+ * A cache file holds the same image, written once, with the values of
+ * SYSFS_ATTR_STATIC attributes only. It is good for as long as the boot id
+ * is the one recorded in its header and the directories listing buses,
+ * classes, devices, drivers and modules hold the names they held then.
+ * Each of those directories carries a marker, the number of its names and
+ * a hash of them, in its entry's otherwise unused value and len.
+ */
+#define SNAPSHOT_MAGIC		0x53595346	/* "SYSF" */
+#define SNAPSHOT_VERSION	3
+
+#define SNAPSHOT_LIVE		0
+#define SNAPSHOT_MOVED		1	/* a larger segment took the name */
+#define SNAPSHOT_GONE		2	/* the publisher closed it */
+
+/* snapshot_entry flags */
+#define SNAPSHOT_VALUE		0x01	/* value holds what a read returned */
+#define SNAPSHOT_MARKER		0x02	/* value and len hold a marker */
+
+#define SNAPSHOT_TRIES		1000	/* reads racing the publisher */
+#define SNAPSHOT_LINKS		8	/* links followed in one lookup */
+#define SNAPSHOT_BOOT_ID	40
+
+#define CACHE_BOOT_ID		"/proc/sys/kernel/random/boot_id"
+
+struct snapshot_header {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t seq;
+	uint32_t state;
+	uint64_t generation;
+	uint64_t size;			/* bytes in use */
+	uint64_t strings;		/* offset of the string pool */
+	uint32_t count;			/* entries, right after the header */
+	uint32_t pad;
+	char boot_id[SNAPSHOT_BOOT_ID];
+	char mnt_path[SYSFS_PATH_MAX];
+};
+
+/* struct sysfs_attribute, or a directory or link, flattened */
+struct snapshot_entry {
+	uint32_t path;			/* string offsets */
+	uint32_t value;			/* value, or absolute link target */
+	uint32_t len;
+	uint32_t skip;			/* entries below a directory */
+	uint32_t order;			/* position in readdir() order */
+	uint16_t method;
+	uint8_t type;			/* DT_DIR, DT_LNK or DT_REG */
+	uint8_t flags;
+};
+
+/* directories a snapshot covers, in sorted order */
+static const char *snapshot_roots[] = {
+	SYSFS_BLOCK_NAME,
+	SYSFS_BUS_NAME,
+	SYSFS_CLASS_NAME,
+	"dev",
+	SYSFS_DEVICES_NAME,
+	SYSFS_MODULE_NAME,
+	NULL
+};
+
+/* directories a cache file is checked against, see marker_dir() */
+static const char *cache_marker_dirs[] = {
+	SYSFS_BLOCK_NAME,
+	SYSFS_BUS_NAME,
+	SYSFS_BUS_NAME "/*/" SYSFS_DEVICES_NAME,
+	SYSFS_BUS_NAME "/*/" SYSFS_DRIVERS_NAME,
+	SYSFS_BUS_NAME "/*/" SYSFS_DRIVERS_NAME "/*",
+	SYSFS_CLASS_NAME,
+	SYSFS_CLASS_NAME "/*",
+	"dev/block",
+	"dev/char",
+	SYSFS_MODULE_NAME,
+	NULL
+};
+
+/* publisher side */
+struct sysfs_snapshot {
+	char name[SYSFS_PATH_MAX];
+	char mnt_path[SYSFS_PATH_MAX];
+	struct snapshot_header *hdr;	/* mapped segment */
+	size_t size;
+
+	/* image of the next generation */
+	struct snapshot_entry *entries;
+	uint32_t count;
+	uint32_t max;
+	char *pool;
+	size_t used;
+	size_t pool_size;
+	char *page;			/* attribute read buffer */
+	long pgsize;
+	uint64_t generation;
+	int cache;			/* static values only */
+};
+
+/* a mapped segment on the reading side */
+struct snapshot_segment {
+	const struct snapshot_header *hdr;
+	size_t size;
+	struct snapshot_segment *retired;	/* segment this one replaced */
+	int cache;			/* a cache file, not a live segment */
+	int stale;
+	time_t checked;
+};
+
+/* one consistent-looking generation of a segment */
+struct snapshot_view {
+	const struct snapshot_entry *entries;
+	uint32_t count;
+	const char *pool;
+	size_t pool_size;
+	const char *mnt_path;
+};
+
+static struct snapshot_segment *attached;
+static int attach_checked;
+static char attached_name[SYSFS_PATH_MAX];
+static time_t reattach_time;
+
+/**
+ * path_cmp: compares relative paths in snapshot order, '/' before any
+ * 	other character
+ */
+static int path_cmp(const char *a, const char *b)
+{
+	unsigned char ca, cb;
+
+	for (;; a++, b++) {
+		ca = *a == '/' ? 1 : *a;
+		cb = *b == '/' ? 1 : *b;
+		if (ca != cb || !ca)
+			return ca - cb;
+	}
+}
+
+/* a directory entry, with where readdir() returned it */
+struct snapshot_name {
+	char *name;
+	uint32_t order;
+	unsigned char type;
+};
+
+static int name_cmp(const void *a, const void *b)
+{
+	return strcmp(((const struct snapshot_name *)a)->name,
+			((const struct snapshot_name *)b)->name);
+}
+
+static int order_cmp(const void *a, const void *b)
+{
+	uint32_t oa = ((const struct snapshot_name *)a)->order;
+	uint32_t ob = ((const struct snapshot_name *)b)->order;
+
+	return oa < ob ? -1 : oa > ob;
+}
+
+/**
+ * marker_dir: tells whether a cache file is checked against a directory
+ * @rel: path of the directory relative to the mount point
+ */
+static int marker_dir(const char *rel)
+{
+	const char **pattern;
+
+	for (pattern = cache_marker_dirs; *pattern; pattern++) {
+		if (fnmatch(*pattern, rel, FNM_PATHNAME) == 0)
+			return 1;
+	}
+	return 0;
+}
+
+/* FNV-1a hash of a name, summed over a directory so order doesn't matter */
+static uint32_t name_hash(const char *name)
+{
+	uint32_t hash = 2166136261u;
+
+	while (*name) {
+		hash ^= (unsigned char)*name++;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+#ifdef SNAPSHOT_SHM
+
+/**
+ * pool_add: copies a string into the image's string pool
+ * @snap: snapshot being built
+ * @str: string to copy, need not be NUL terminated
+ * @len: length of str
+ * returns the string's offset with success and -1 with error
+ */
+static long pool_add(struct sysfs_snapshot *snap, const char *str, size_t len)
+{
+	size_t off = snap->used;
+	char *vbuf;
+
+	if (snap->used + len + 1 > snap->pool_size) {
+		snap->pool_size = 2 * snap->pool_size + len + 1;
+		vbuf = (char *)realloc(snap->pool, snap->pool_size);
+		if (!vbuf)
+			return -1;
+		snap->pool = vbuf;
+	}
+	memcpy(snap->pool + off, str, len);
+	snap->pool[off + len] = '\0';
+	snap->used += len + 1;
+	if (off > UINT32_MAX)
+		return -1;
+	return (long)off;
+}
+
+/**
+ * add_entry: appends an entry to the image
+ * @snap: snapshot being built
+ * @path: path relative to the mount point
+ * @type: DT_DIR, DT_LNK or DT_REG
+ * returns the entry's index with success and -1 with error
+ */
+static long add_entry(struct sysfs_snapshot *snap, const char *path,
+			unsigned char type)
+{
+	struct snapshot_entry *entry;
+	long off;
+	void *vbuf;
+
+	if (snap->count == snap->max) {
+		snap->max = snap->max ? 2 * snap->max : 1024;
+		vbuf = realloc(snap->entries,
+				snap->max * sizeof(struct snapshot_entry));
+		if (!vbuf)
+			return -1;
+		snap->entries = (struct snapshot_entry *)vbuf;
+	}
+	off = pool_add(snap, path, strlen(path));
+	if (off < 0)
+		return -1;
+	entry = &snap->entries[snap->count];
+	memset(entry, 0, sizeof(struct snapshot_entry));
+	entry->path = off;
+	entry->type = type;
+	return snap->count++;
+}
+
+/**
+ * snapshot_link: records where a link points
+ * @snap: snapshot being built
+ * @entry: index of the link's entry
+ * @dir: absolute path of the directory holding the link
+ * @path: absolute path of the link
+ * returns 0 with success and -1 with error
+ */
+static int snapshot_link(struct sysfs_snapshot *snap, long entry,
+			const char *dir, const char *path)
+{
+	char linkpath[SYSFS_PATH_MAX], target[SYSFS_PATH_MAX];
+	ssize_t count;
+	long off;
+
+	count = readlink(path, linkpath, SYSFS_PATH_MAX - 1);
+	if (count < 0)
+		return 0;
+	linkpath[count] = '\0';
+	if (resolve_link_target(dir, linkpath, target, SYSFS_PATH_MAX))
+		return 0;
+	off = pool_add(snap, target, strlen(target));
+	if (off < 0)
+		return -1;
+	snap->entries[entry].value = off;
+	snap->entries[entry].len = strlen(target);
+	return 0;
+}
+
+/**
+ * snapshot_attribute: records an attribute's methods and, if it can be
+ * 	read, its value. Attributes that fail to read are kept without a
+ * 	value so that readers get the error from sysfs itself. So are those
+ * 	only their owner may read: the segment is readable by all, readers
+ * 	must get the kernel's own permission check for these. Counters
+ * 	would be out of date by the time they are read and aren't read at
+ * 	all.
+ * @snap: snapshot being built
+ * @entry: index of the attribute's entry
+ * @path: absolute path of the attribute
+ * returns 0 with success and -1 with error
+ */
+static int snapshot_attribute(struct sysfs_snapshot *snap, long entry,
+				const char *path)
+{
+	struct stat astats;
+	enum sysfs_attribute_class attr_class;
+	unsigned short method = 0;
+	ssize_t length;
+	long off;
+	int fd;
+
+	if (stat(path, &astats) != 0)
+		return 0;
+	if (astats.st_mode & S_IRUSR)
+		method |= SYSFS_METHOD_SHOW;
+	if (astats.st_mode & S_IWUSR)
+		method |= SYSFS_METHOD_STORE;
+	snap->entries[entry].method = method;
+	if (!(method & SYSFS_METHOD_SHOW) || !(astats.st_mode & S_IROTH))
+		return 0;
+	attr_class = sysfs_get_attribute_class(strrchr(path, '/') + 1);
+	if (attr_class == SYSFS_ATTR_COUNTER ||
+			(snap->cache && attr_class != SYSFS_ATTR_STATIC))
+		return 0;
+
+	fd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+	if (fd < 0)
+		return 0;
+	length = read(fd, snap->page, snap->pgsize);
+	close(fd);
+	if (length < 0)
+		return 0;
+	off = pool_add(snap, snap->page, length);
+	if (off < 0)
+		return -1;
+	snap->entries[entry].value = off;
+	snap->entries[entry].len = length;
+	snap->entries[entry].flags |= SNAPSHOT_VALUE;
+	return 0;
+}
+
+/**
+ * snapshot_dir: adds everything below a directory to the image, in
+ * 	snapshot order
+ * @snap: snapshot being built
+ * @dir_entry: index of the directory's own entry
+ * @path: absolute path of the directory, used as scratch space and
+ * 	restored on return
+ * @rel: offset of the part of path relative to the mount point
+ * returns 0 with success and -1 with error
+ */
+static int snapshot_dir(struct sysfs_snapshot *snap, long dir_entry,
+			char *path, size_t rel)
+{
+	DIR *dir;
+	struct dirent *dirent;
+	struct stat astats;
+	struct snapshot_name *names = NULL;
+	char dirpath[SYSFS_PATH_MAX];
+	int i, count = 0, max = 0, ret = 0;
+	unsigned char type;
+	size_t len = strlen(path);
+	uint32_t hash = 0;
+	long entry;
+	void *vbuf;
+
+	dir = opendir(path);
+	if (!dir) {
+		dbg_printf("Error opening directory %s\n", path);
+		return 0;
+	}
+	while ((dirent = readdir(dir)) != NULL) {
+		if (0 == strcmp(dirent->d_name, "."))
+			continue;
+		if (0 == strcmp(dirent->d_name, ".."))
+			continue;
+		if (count == max) {
+			max = max ? 2 * max : 32;
+			vbuf = realloc(names, max * sizeof(struct snapshot_name));
+			if (!vbuf) {
+				ret = -1;
+				break;
+			}
+			names = (struct snapshot_name *)vbuf;
+		}
+		names[count].name = strdup(dirent->d_name);
+		if (!names[count].name) {
+			ret = -1;
+			break;
+		}
+		names[count].order = count;
+		hash += name_hash(dirent->d_name);
+		count++;
+	}
+	closedir(dir);
+	if (snap->cache && ret == 0 && marker_dir(path + rel)) {
+		snap->entries[dir_entry].value = hash;
+		snap->entries[dir_entry].len = count;
+		snap->entries[dir_entry].flags |= SNAPSHOT_MARKER;
+	}
+	/*
+	 * The image is in name order, but lists built from a directory
+	 * depend on the order readdir() hands out names, keep that too.
+	 */
+	qsort(names, count, sizeof(struct snapshot_name), name_cmp);
+
+	safestrcpy(dirpath, path);
+	for (i = 0; i < count && ret == 0; i++) {
+		if (len + strlen(names[i].name) + 2 > SYSFS_PATH_MAX)
+			continue;
+		path[len] = '/';
+		strcpy(path + len + 1, names[i].name);
+		if (lstat(path, &astats) != 0)
+			continue;
+		if (S_ISDIR(astats.st_mode))
+			type = DT_DIR;
+		else if (S_ISLNK(astats.st_mode))
+			type = DT_LNK;
+		else if (S_ISREG(astats.st_mode))
+			type = DT_REG;
+		else
+			continue;
+		entry = add_entry(snap, path + rel, type);
+		if (entry < 0) {
+			ret = -1;
+			break;
+		}
+		snap->entries[entry].order = names[i].order;
+		if (type == DT_DIR) {
+			ret = snapshot_dir(snap, entry, path, rel);
+			snap->entries[entry].skip = snap->count - entry - 1;
+		} else if (type == DT_LNK)
+			ret = snapshot_link(snap, entry, dirpath, path);
+		else
+			ret = snapshot_attribute(snap, entry, path);
+	}
+	path[len] = '\0';
+	for (i = 0; i < count; i++)
+		free(names[i].name);
+	free(names);
+	return ret;
+}
+
+/**
+ * snapshot_begin_write: marks the segment as being rewritten
+ */
+static void snapshot_begin_write(struct snapshot_header *hdr)
+{
+	__atomic_store_n(&hdr->seq, hdr->seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+/**
+ * snapshot_end_write: publishes what was written to the segment
+ */
+static void snapshot_end_write(struct snapshot_header *hdr)
+{
+	__atomic_store_n(&hdr->seq, hdr->seq + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * unmap_writer: lets go of the publisher's segment, telling readers
+ * 	still mapping it why
+ * @snap: publisher
+ * @state: SNAPSHOT_MOVED or SNAPSHOT_GONE
+ */
+static void unmap_writer(struct sysfs_snapshot *snap, uint32_t state)
+{
+	if (!snap->hdr)
+		return;
+	snapshot_begin_write(snap->hdr);
+	snap->hdr->state = state;
+	snapshot_end_write(snap->hdr);
+	munmap(snap->hdr, snap->size);
+	snap->hdr = NULL;
+	snap->size = 0;
+}
+
+/**
+ * map_writer: creates a segment of at least size bytes under the
+ * 	snapshot's name, replacing the current one
+ * @snap: publisher
+ * @size: bytes needed
+ * returns 0 with success and -1 with error
+ */
+static int map_writer(struct sysfs_snapshot *snap, size_t size)
+{
+	struct snapshot_header *hdr;
+	void *addr;
+	int fd;
+
+	size = (size + snap->pgsize - 1) / snap->pgsize * snap->pgsize;
+	unmap_writer(snap, SNAPSHOT_MOVED);
+	shm_unlink(snap->name);
+	fd = shm_open(snap->name, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+	if (fd < 0) {
+		dbg_printf("Error creating segment %s\n", snap->name);
+		return -1;
+	}
+	if (fchmod(fd, 0644) || ftruncate(fd, size)) {
+		close(fd);
+		shm_unlink(snap->name);
+		return -1;
+	}
+	addr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (addr == MAP_FAILED) {
+		shm_unlink(snap->name);
+		return -1;
+	}
+	hdr = (struct snapshot_header *)addr;
+	hdr->seq = 1;
+	hdr->magic = SNAPSHOT_MAGIC;
+	hdr->version = SNAPSHOT_VERSION;
+	hdr->state = SNAPSHOT_LIVE;
+	safestrcpy(hdr->mnt_path, snap->mnt_path);
+	__atomic_store_n(&hdr->seq, 2, __ATOMIC_RELEASE);
+	snap->hdr = hdr;
+	snap->size = size;
+	return 0;
+}
+
+/**
+ * snapshot_build: walks the directories a snapshot covers into a new image
+ * @snap: snapshot to build
+ * returns 0 with success and -1 with error
+ */
+static int snapshot_build(struct sysfs_snapshot *snap)
+{
+	struct stat astats;
+	char path[SYSFS_PATH_MAX];
+	const char **root;
+	size_t rel;
+	long entry;
+
+	snap->count = 0;
+	snap->used = 0;
+	rel = strlen(snap->mnt_path) + 1;
+	for (root = snapshot_roots; *root; root++) {
+		safestrcpy(path, snap->mnt_path);
+		safestrcat(path, "/");
+		safestrcat(path, *root);
+		/* not through the library, it may have a snapshot attached */
+		if (lstat(path, &astats) != 0 || !S_ISDIR(astats.st_mode))
+			continue;
+		entry = add_entry(snap, path + rel, DT_DIR);
+		if (entry < 0 || snapshot_dir(snap, entry, path, rel))
+			return -1;
+		snap->entries[entry].skip = snap->count - entry - 1;
+	}
+	return 0;
+}
+
+/* offset of the string pool in an image of count entries */
+static size_t snapshot_strings(uint32_t count)
+{
+	size_t strings;
+
+	strings = sizeof(struct snapshot_header) +
+			count * sizeof(struct snapshot_entry);
+	return (strings + 7) & ~(size_t)7;
+}
+
+/**
+ * read_small: reads a short file into a NUL terminated buffer, dropping
+ * 	the trailing newline
+ * returns 0 with success and -1 with error
+ */
+static int read_small(const char *path, char *buf, size_t len)
+{
+	ssize_t count;
+	int fd;
+
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return -1;
+	count = read(fd, buf, len - 1);
+	close(fd);
+	if (count <= 0)
+		return -1;
+	if (buf[count - 1] == '\n')
+		count--;
+	buf[count] = '\0';
+	return 0;
+}
+
+/**
+ * read_boot_id: reads the id of this boot, which a cache file records
+ * @boot_id: set to the boot id, SNAPSHOT_BOOT_ID bytes
+ * returns 0 with success and -1 with error
+ */
+static int read_boot_id(char *boot_id)
+{
+	if (read_small(CACHE_BOOT_ID, boot_id, SNAPSHOT_BOOT_ID)) {
+		dbg_printf("Error reading boot id\n");
+		return -1;
+	}
+	return 0;
+}
+
+/* writes all of buf or fails */
+static int write_all(int fd, const void *buf, size_t len)
+{
+	const char *p = (const char *)buf;
+	ssize_t count;
+
+	while (len > 0) {
+		count = write(fd, p, len);
+		if (count < 0 && errno == EINTR)
+			continue;
+		if (count <= 0)
+			return -1;
+		p += count;
+		len -= count;
+	}
+	return 0;
+}
+
+/**
+ * write_cache: walks sysfs into a cache file, replacing it atomically
+ * @path: cache file
+ * returns 0 with success and -1 with error
+ */
+static int write_cache(const char *path)
+{
+	static const char zero[8];
+	struct sysfs_snapshot snap;
+	struct snapshot_header hdr;
+	char tmp[SYSFS_PATH_MAX];
+	size_t entries;
+	int fd, ret = -1;
+
+	memset(&snap, 0, sizeof(snap));
+	memset(&hdr, 0, sizeof(hdr));
+	if (strlen(path) + 8 > SYSFS_PATH_MAX) {
+		errno = EINVAL;
+		return -1;
+	}
+	if (sysfs_get_mnt_path(snap.mnt_path, SYSFS_PATH_MAX) ||
+			read_boot_id(hdr.boot_id))
+		return -1;
+	/* before the walk, so a process that can't write doesn't walk */
+	safestrcpy(tmp, path);
+	safestrcat(tmp, ".XXXXXX");
+	fd = mkstemp(tmp);
+	if (fd < 0) {
+		dbg_printf("Error creating cache file %s\n", tmp);
+		return -1;
+	}
+
+	snap.cache = 1;
+	snap.pgsize = getpagesize();
+	snap.page = (char *)malloc(snap.pgsize);
+	if (!snap.page || snapshot_build(&snap))
+		goto out;
+	entries = snap.count * sizeof(struct snapshot_entry);
+	hdr.magic = SNAPSHOT_MAGIC;
+	hdr.version = SNAPSHOT_VERSION;
+	hdr.seq = 2;
+	hdr.state = SNAPSHOT_LIVE;
+	hdr.generation = 1;
+	hdr.count = snap.count;
+	hdr.strings = snapshot_strings(snap.count);
+	hdr.size = hdr.strings + snap.used;
+	safestrcpy(hdr.mnt_path, snap.mnt_path);
+	/* a NUL after the pool, as at the end of a segment */
+	if (write_all(fd, &hdr, sizeof(hdr)) ||
+			write_all(fd, snap.entries, entries) ||
+			write_all(fd, zero, hdr.strings - sizeof(hdr) -
+								entries) ||
+			write_all(fd, snap.pool, snap.used) ||
+			write_all(fd, zero, 1) || fchmod(fd, 0644) ||
+			rename(tmp, path)) {
+		dbg_printf("Error writing cache file %s\n", path);
+		goto out;
+	}
+	ret = 0;
+out:
+	close(fd);
+	if (ret)
+		unlink(tmp);
+	free(snap.entries);
+	free(snap.pool);
+	free(snap.page);
+	return ret;
+}
+
+#endif /* SNAPSHOT_SHM */
+
+/**
+ * sysfs_open_snapshot: creates a shared memory segment to publish
+ * 	snapshots of sysfs in. The segment can be read, not written, by
+ * 	other users; it is empty until sysfs_publish_snapshot() is called.
+ * @name: segment name, SYSFS_SNAPSHOT_NAME if NULL
+ * returns struct sysfs_snapshot with success and NULL with error, errno
+ * 	is ENOSYS if the library was built without shared memory support
+ */
+struct sysfs_snapshot *sysfs_open_snapshot(const char *name)
+{
+#ifdef SNAPSHOT_SHM
+	struct sysfs_snapshot *snap;
+
+	snap = (struct sysfs_snapshot *)calloc(1,
+					sizeof(struct sysfs_snapshot));
+	if (!snap)
+		return NULL;
+	safestrcpy(snap->name, name ? name : SYSFS_SNAPSHOT_NAME);
+	snap->pgsize = getpagesize();
+	snap->page = (char *)malloc(snap->pgsize);
+	if (!snap->page || sysfs_get_mnt_path(snap->mnt_path,
+						SYSFS_PATH_MAX) ||
+			map_writer(snap, sizeof(struct snapshot_header) + 1)) {
+		dbg_printf("Error opening snapshot %s\n", snap->name);
+		free(snap->page);
+		free(snap);
+		return NULL;
+	}
+	return snap;
+#else
+	errno = ENOSYS;
+	return NULL;
+#endif
+}
+
+/**
+ * sysfs_close_snapshot: removes the segment and frees the publisher.
+ * 	Processes that have it attached go back to reading sysfs.
+ * @snap: snapshot to close
+ */
+void sysfs_close_snapshot(struct sysfs_snapshot *snap)
+{
+	if (!snap)
+		return;
+#ifdef SNAPSHOT_SHM
+	unmap_writer(snap, SNAPSHOT_GONE);
+	shm_unlink(snap->name);
+#endif
+	free(snap->entries);
+	free(snap->pool);
+	free(snap->page);
+	free(snap);
+}
+
+/**
+ * sysfs_publish_snapshot: walks the block, bus, class, dev, devices and
+ * 	module directories, reading every attribute, and publishes the
+ * 	result as the segment's next generation
+ * @snap: snapshot to publish
+ * returns 0 with success and -1 with error
+ */
+int sysfs_publish_snapshot(struct sysfs_snapshot *snap)
+{
+#ifdef SNAPSHOT_SHM
+	struct snapshot_header *hdr;
+	size_t strings, size;
+
+	if (!snap) {
+		errno = EINVAL;
+		return -1;
+	}
+	if (snapshot_build(snap))
+		return -1;
+
+	strings = snapshot_strings(snap->count);
+	size = strings + snap->used;
+	/* the last byte stays NUL, so no string runs off the mapping */
+	if (size + 1 > snap->size && map_writer(snap, size + size / 2 + 1))
+		return -1;
+
+	hdr = snap->hdr;
+	snapshot_begin_write(hdr);
+	memcpy(hdr + 1, snap->entries,
+			snap->count * sizeof(struct snapshot_entry));
+	memcpy((char *)hdr + strings, snap->pool, snap->used);
+	hdr->count = snap->count;
+	hdr->strings = strings;
+	hdr->size = size;
+	hdr->generation = ++snap->generation;
+	snapshot_end_write(hdr);
+	return 0;
+#else
+	errno = snap ? ENOSYS : EINVAL;
+	return -1;
+#endif
+}
+
+#ifdef SNAPSHOT_SHM
+
+/**
+ * map_fd: maps a segment or cache file read only and closes fd
+ * @fd: descriptor of the segment or file
+ * returns the segment with success and NULL with error
+ */
+static struct snapshot_segment *map_fd(int fd)
+{
+	struct snapshot_segment *seg;
+	struct stat astats;
+	void *addr;
+
+	if (fstat(fd, &astats) || (size_t)astats.st_size <=
+					sizeof(struct snapshot_header)) {
+		close(fd);
+		errno = EINVAL;
+		return NULL;
+	}
+	addr = mmap(NULL, astats.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (addr == MAP_FAILED)
+		return NULL;
+	seg = (struct snapshot_segment *)calloc(1,
+					sizeof(struct snapshot_segment));
+	if (!seg) {
+		munmap(addr, astats.st_size);
+		return NULL;
+	}
+	seg->hdr = (const struct snapshot_header *)addr;
+	seg->size = astats.st_size;
+	if (seg->hdr->magic != SNAPSHOT_MAGIC ||
+			seg->hdr->version != SNAPSHOT_VERSION) {
+		dbg_printf("Not a snapshot this library reads\n");
+		munmap(addr, seg->size);
+		free(seg);
+		errno = EINVAL;
+		return NULL;
+	}
+	return seg;
+}
+
+/**
+ * map_reader: maps a published segment read only
+ * @name: segment name
+ * returns the segment with success and NULL with error
+ */
+static struct snapshot_segment *map_reader(const char *name)
+{
+	int fd;
+
+	fd = shm_open(name, O_RDONLY | O_CLOEXEC, 0);
+	if (fd < 0) {
+		dbg_printf("No snapshot %s\n", name);
+		return NULL;
+	}
+	return map_fd(fd);
+}
+
+/**
+ * unmap_reader: unmaps a segment and the ones it replaced
+ */
+static void unmap_reader(struct snapshot_segment *seg)
+{
+	struct snapshot_segment *next;
+
+	for (; seg; seg = next) {
+		next = seg->retired;
+		munmap((void *)seg->hdr, seg->size);
+		free(seg);
+	}
+}
+
+/**
+ * snapshot_view: checks a generation's layout against the mapping
+ * @seg: segment being read
+ * @view: filled in
+ * returns 0 if the layout fits and -1 if it doesn't, which happens when
+ * 	the publisher is rewriting the segment
+ */
+static int snapshot_view(const struct snapshot_segment *seg,
+			struct snapshot_view *view)
+{
+	const struct snapshot_header *hdr = seg->hdr;
+	uint64_t size = hdr->size, strings = hdr->strings;
+	uint32_t count = hdr->count;
+
+	if (size >= seg->size || strings > size || sizeof(*hdr) +
+			(uint64_t)count * sizeof(struct snapshot_entry) >
+								strings)
+		return -1;
+	view->entries = (const struct snapshot_entry *)(hdr + 1);
+	view->count = count;
+	view->pool = (const char *)hdr + strings;
+	view->pool_size = size - strings;
+	view->mnt_path = hdr->mnt_path;
+	return 0;
+}
+
+/* string at a pool offset, "" for offsets that don't fit */
+static const char *view_string(const struct snapshot_view *view, uint32_t off)
+{
+	return off < view->pool_size ? view->pool + off : "";
+}
+
+/**
+ * marker_stale: tells whether a directory no longer holds the names it
+ * 	held when the cache file was written
+ * @view: cache file
+ * @entry: directory's entry, with a marker
+ */
+static int marker_stale(const struct snapshot_view *view,
+			const struct snapshot_entry *entry)
+{
+	char path[SYSFS_PATH_MAX];
+	struct dirent *dirent;
+	uint32_t hash = 0, count = 0;
+	DIR *dir;
+
+	safestrcpy(path, view->mnt_path);
+	safestrcat(path, "/");
+	safestrcat(path, view_string(view, entry->path));
+	dir = opendir(path);
+	if (!dir)
+		return 1;
+	while ((dirent = readdir(dir)) != NULL) {
+		if (0 == strcmp(dirent->d_name, "."))
+			continue;
+		if (0 == strcmp(dirent->d_name, ".."))
+			continue;
+		hash += name_hash(dirent->d_name);
+		count++;
+	}
+	closedir(dir);
+	return hash != entry->value || count != entry->len;
+}
+
+/**
+ * cache_stale: tells whether a cache file was written in another boot
+ * 	or before a bus, class, device, driver or module came or went. Only
+ * 	the directories listing those are read, not the whole tree.
+ * @seg: mapped cache file
+ */
+static int cache_stale(const struct snapshot_segment *seg)
+{
+	char mnt_path[SYSFS_PATH_MAX], boot_id[SNAPSHOT_BOOT_ID];
+	struct snapshot_view view;
+	uint32_t i;
+
+	if (sysfs_get_mnt_path(mnt_path, SYSFS_PATH_MAX) ||
+			read_boot_id(boot_id) ||
+			strncmp(boot_id, seg->hdr->boot_id, SNAPSHOT_BOOT_ID) ||
+			strncmp(mnt_path, seg->hdr->mnt_path, SYSFS_PATH_MAX) ||
+			snapshot_view(seg, &view))
+		return 1;
+	for (i = 0; i < view.count; i++) {
+		if ((view.entries[i].flags & SNAPSHOT_MARKER) &&
+				view.entries[i].type == DT_DIR &&
+				marker_stale(&view, &view.entries[i]))
+			return 1;
+	}
+	return 0;
+}
+
+/**
+ * map_cache: maps a cache file that is still good
+ * @path: cache file
+ * returns the segment with success and NULL with error, errno is ESTALE
+ * 	if the file is out of date
+ */
+static struct snapshot_segment *map_cache(const char *path)
+{
+	struct snapshot_segment *seg;
+	int fd;
+
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		dbg_printf("No cache file %s\n", path);
+		return NULL;
+	}
+	seg = map_fd(fd);
+	if (!seg)
+		return NULL;
+	seg->cache = 1;
+	if (cache_stale(seg)) {
+		dbg_printf("Cache file %s is out of date\n", path);
+		unmap_reader(seg);
+		errno = ESTALE;
+		return NULL;
+	}
+	seg->checked = time(NULL);
+	return seg;
+}
+
+/**
+ * cache_check: checks an attached cache file again, at most once a
+ * 	second. Once out of date it stays unused, sysfs is read instead.
+ * @seg: attached cache file
+ * returns 0 if the file can be used and 1 if not
+ */
+static int cache_check(struct snapshot_segment *seg)
+{
+	time_t now;
+
+	if (__atomic_load_n(&seg->stale, __ATOMIC_ACQUIRE))
+		return 1;
+	now = time(NULL);
+	if (now == __atomic_load_n(&seg->checked, __ATOMIC_RELAXED))
+		return 0;
+	__atomic_store_n(&seg->checked, now, __ATOMIC_RELAXED);
+	if (!cache_stale(seg))
+		return 0;
+	dbg_printf("Attached cache file went out of date\n");
+	__atomic_store_n(&seg->stale, 1, __ATOMIC_RELEASE);
+	return 1;
+}
+
+/**
+ * snapshot_reattach: maps the segment that replaced a moved or closed
+ * 	one, at most once a second. Other threads may still be reading
+ * 	the old segment, so it stays mapped until the snapshot is detached.
+ * @seg: segment found not to be live
+ */
+static void snapshot_reattach(struct snapshot_segment *seg)
+{
+	struct snapshot_segment *new;
+	time_t now = time(NULL);
+
+	sysfs_lock();
+	if (attached != seg || now == reattach_time) {
+		sysfs_unlock();
+		return;
+	}
+	reattach_time = now;
+	new = map_reader(attached_name);
+	if (new) {
+		new->retired = seg;
+		__atomic_store_n(&attached, new, __ATOMIC_RELEASE);
+	}
+	sysfs_unlock();
+}
+
+/**
+ * attach_from_env: attaches the snapshot named by SYSFS_SNAPSHOT the
+ * 	first time the library looks for one. Without it, the cache file
+ * 	named by SYSFS_CACHE is attached if it is still good; writing it is
+ * 	left to sysfs_write_cache() and sysfsd.
+ */
+static void attach_from_env(void)
+{
+	struct snapshot_segment *seg = NULL;
+	const char *name;
+
+	/* mapped without the lock, checking a cache file reads sysfs */
+	name = getenv(SYSFS_SNAPSHOT_ENV);
+	if (name && *name)
+		seg = map_reader(name);
+	else {
+		name = getenv(SYSFS_CACHE_ENV);
+		if (name && *name)
+			seg = map_cache(name);
+	}
+
+	sysfs_lock();
+	if (!attach_checked) {
+		if (seg)
+			safestrcpy(attached_name, name);
+		__atomic_store_n(&attached, seg, __ATOMIC_RELEASE);
+		__atomic_store_n(&attach_checked, 1, __ATOMIC_RELEASE);
+		seg = NULL;
+	}
+	sysfs_unlock();
+	/* another thread got there first */
+	unmap_reader(seg);
+}
+
+/**
+ * view_find: binary search for a path relative to the mount point
+ * returns the entry's index, -1 if there is none
+ */
+static long view_find(const struct snapshot_view *view, const char *rel)
+{
+	long lo = 0, hi = view->count, mid;
+	int cmp;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		cmp = path_cmp(view_string(view, view->entries[mid].path), rel);
+		if (cmp == 0)
+			return mid;
+		if (cmp < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return -1;
+}
+
+/**
+ * view_resolve: finds the entry for an absolute path, following the
+ * 	links on the way as the kernel would
+ * @view: generation to look in
+ * @path: absolute path
+ * @follow: also follow a link at the end of path
+ * returns the entry's index, -1 if there is no such entry and -2 if the
+ * 	snapshot doesn't cover the path
+ */
+static long view_resolve(const struct snapshot_view *view, const char *path,
+			int follow)
+{
+	char buf[SYSFS_PATH_MAX], tmp[SYSFS_PATH_MAX];
+	const struct snapshot_entry *entry;
+	const char *target;
+	char *comp, *end;
+	size_t mlen = strlen(view->mnt_path);
+	int links = 0;
+	long idx;
+
+	if (strncmp(path, view->mnt_path, mlen) || path[mlen] != '/')
+		return -2;
+	safestrcpy(buf, path + mlen + 1);
+	idx = view_find(view, buf);
+	if (idx >= 0 && (!follow || view->entries[idx].type != DT_LNK))
+		return idx;
+
+	comp = buf;
+	for (;;) {
+		end = strchr(comp, '/');
+		if (end)
+			*end = '\0';
+		if (*comp == '\0' || 0 == strcmp(comp, ".") ||
+					0 == strcmp(comp, ".."))
+			return -2;
+		idx = view_find(view, buf);
+		if (idx < 0)
+			return comp == buf ? -2 : -1;
+		entry = &view->entries[idx];
+		if (entry->type == DT_LNK && (end || follow)) {
+			target = view_string(view, entry->value);
+			if (++links > SNAPSHOT_LINKS ||
+					strncmp(target, view->mnt_path, mlen) ||
+					target[mlen] != '/')
+				return -2;
+			safestrcpy(tmp, target + mlen + 1);
+			if (end) {
+				safestrcat(tmp, "/");
+				safestrcat(tmp, end + 1);
+			}
+			safestrcpy(buf, tmp);
+			comp = buf;
+			continue;
+		}
+		if (!end)
+			return idx;
+		if (entry->type != DT_DIR)
+			return -1;
+		*end = '/';
+		comp = end + 1;
+	}
+}
+
+/**
+ * snapshot_query: runs a lookup against the attached snapshot until it
+ * 	gets through without the publisher writing in between
+ * @query: lookup, copies its answer into arg and returns like the
+ * 	snapshot_* functions below
+ * @arg: lookup's arguments and answer
+ * returns what query returned, or 1 if there is no snapshot to ask
+ */
+static int snapshot_query(int (*query)(const struct snapshot_view *, void *),
+			void *arg)
+{
+	struct snapshot_segment *seg;
+	struct snapshot_view view;
+	uint32_t seq;
+	int tries, ret;
+
+	if (!__atomic_load_n(&attach_checked, __ATOMIC_ACQUIRE))
+		attach_from_env();
+	seg = __atomic_load_n(&attached, __ATOMIC_ACQUIRE);
+	if (!seg)
+		return 1;
+
+	for (tries = 0; tries < SNAPSHOT_TRIES; tries++) {
+		seq = __atomic_load_n(&seg->hdr->seq, __ATOMIC_ACQUIRE);
+		if (seq & 1) {
+			sched_yield();
+			continue;
+		}
+		if (seg->cache && cache_check(seg))
+			return 1;
+		if (seg->hdr->state != SNAPSHOT_LIVE) {
+			snapshot_reattach(seg);
+			return 1;
+		}
+		ret = snapshot_view(seg, &view) ? 2 : query(&view, arg);
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		if (__atomic_load_n(&seg->hdr->seq, __ATOMIC_RELAXED) == seq &&
+								ret != 2)
+			return ret;
+	}
+	return 1;
+}
+
+#else
+
+static int snapshot_query(int (*query)(const struct snapshot_view *, void *),
+			void *arg)
+{
+	(void)query;
+	(void)arg;
+	return 1;
+}
+
+#endif /* SNAPSHOT_SHM */
+
+#ifdef SNAPSHOT_SHM
+
+/**
+ * attach_segment: answers lookups from seg from now on
+ */
+static void attach_segment(struct snapshot_segment *seg, const char *name)
+{
+	struct snapshot_segment *old;
+
+	sysfs_lock();
+	old = attached;
+	safestrcpy(attached_name, name);
+	__atomic_store_n(&attached, seg, __ATOMIC_RELEASE);
+	__atomic_store_n(&attach_checked, 1, __ATOMIC_RELEASE);
+	sysfs_unlock();
+	unmap_reader(old);
+}
+
+#endif /* SNAPSHOT_SHM */
+
+/**
+ * sysfs_attach_snapshot: answers lookups from a published snapshot
+ * 	instead of sysfs from now on. Attaching is also done at the first
+ * 	lookup if SYSFS_SNAPSHOT names a segment.
+ * @name: segment name, SYSFS_SNAPSHOT_NAME if NULL
+ * returns 0 with success and -1 with error
+ */
+int sysfs_attach_snapshot(const char *name)
+{
+#ifdef SNAPSHOT_SHM
+	struct snapshot_segment *seg;
+
+	if (!name)
+		name = SYSFS_SNAPSHOT_NAME;
+	seg = map_reader(name);
+	if (!seg)
+		return -1;
+	attach_segment(seg, name);
+	return 0;
+#else
+	(void)name;
+	errno = ENOSYS;
+	return -1;
+#endif
+}
+
+/**
+ * sysfs_write_cache: walks sysfs and saves its layout and the values of
+ * 	attributes that don't change, such as vendor, device and class, to
+ * 	a cache file. The file is replaced atomically and readable by all.
+ * @path: cache file, SYSFS_CACHE_PATH if NULL
+ * returns 0 with success and -1 with error
+ */
+int sysfs_write_cache(const char *path)
+{
+#ifdef SNAPSHOT_SHM
+	return write_cache(path ? path : SYSFS_CACHE_PATH);
+#else
+	(void)path;
+	errno = ENOSYS;
+	return -1;
+#endif
+}
+
+/**
+ * sysfs_attach_cache: answers lookups from a cache file instead of sysfs
+ * 	from now on, until a bus, class, device, driver or module comes or
+ * 	goes. Other attributes are
+ * 	read from sysfs. Attaching is also done at the first lookup if
+ * 	SYSFS_CACHE names a file. sysfs_detach_snapshot() detaches it.
+ * @path: cache file, SYSFS_CACHE_PATH if NULL
+ * returns 0 with success and -1 with error, errno is ESTALE if the file
+ * 	is out of date
+ */
+int sysfs_attach_cache(const char *path)
+{
+#ifdef SNAPSHOT_SHM
+	struct snapshot_segment *seg;
+
+	if (!path)
+		path = SYSFS_CACHE_PATH;
+	seg = map_cache(path);
+	if (!seg)
+		return -1;
+	attach_segment(seg, path);
+	return 0;
+#else
+	(void)path;
+	errno = ENOSYS;
+	return -1;
+#endif
+}
+
+/**
+ * sysfs_detach_snapshot: goes back to reading sysfs, from an attached
+ * 	snapshot or cache file. No other thread may be using the library
+ * 	while it is detached.
+ */
+void sysfs_detach_snapshot(void)
+{
+#ifdef SNAPSHOT_SHM
+	struct snapshot_segment *old;
+
+	sysfs_lock();
+	old = attached;
+	__atomic_store_n(&attached, NULL, __ATOMIC_RELEASE);
+	__atomic_store_n(&attach_checked, 1, __ATOMIC_RELEASE);
+	sysfs_unlock();
+	unmap_reader(old);
+#endif
+}
+
+#ifdef SNAPSHOT_SHM
+
+struct stat_query {
+	const char *path;
+	int follow;
+	int type;
+	unsigned short method;
+};
+
+static int query_stat(const struct snapshot_view *view, void *arg)
+{
+	struct stat_query *q = (struct stat_query *)arg;
+	long idx;
+
+	idx = view_resolve(view, q->path, q->follow);
+	if (idx == -2)
+		return 1;
+	if (idx < 0)
+		return -1;
+	q->type = view->entries[idx].type;
+	q->method = view->entries[idx].method;
+	return 0;
+}
+
+struct link_query {
+	const char *path;
+	char *target;
+	size_t len;
+	int type;
+};
+
+static int query_link(const struct snapshot_view *view, void *arg)
+{
+	struct link_query *q = (struct link_query *)arg;
+	long idx;
+
+	idx = view_resolve(view, q->path, 0);
+	if (idx == -2)
+		return 1;
+	if (idx < 0)
+		return -1;
+	q->type = view->entries[idx].type;
+	if (q->type == DT_LNK && view->entries[idx].len == 0)
+		return 1;
+	if (q->type == DT_LNK)
+		safestrcpymax(q->target,
+			view_string(view, view->entries[idx].value), q->len);
+	return 0;
+}
+
+struct read_query {
+	const char *path;
+	char *value;
+	size_t max;
+	size_t len;
+	int type;
+};
+
+static int query_read(const struct snapshot_view *view, void *arg)
+{
+	struct read_query *q = (struct read_query *)arg;
+	const struct snapshot_entry *entry;
+	long idx;
+
+	idx = view_resolve(view, q->path, 1);
+	if (idx == -2)
+		return 1;
+	if (idx < 0)
+		return -1;
+	entry = &view->entries[idx];
+	q->type = entry->type;
+	if (q->type != DT_REG)
+		return 0;
+	if (!(entry->flags & SNAPSHOT_VALUE) || entry->len > q->max ||
+			entry->value + (size_t)entry->len > view->pool_size)
+		return 1;
+	memcpy(q->value, view->pool + entry->value, entry->len);
+	q->len = entry->len;
+	return 0;
+}
+
+struct list_query {
+	const char *path;
+	char *buf;
+	size_t used;
+	size_t size;
+	struct snapshot_name *names;	/* name holds an offset into buf */
+	int count;
+	int max;
+	int nomem;
+};
+
+static int query_list(const struct snapshot_view *view, void *arg)
+{
+	struct list_query *q = (struct list_query *)arg;
+	const struct snapshot_entry *entry;
+	const char *name;
+	uint64_t i, end;
+	size_t len;
+	long idx;
+	void *vbuf;
+
+	idx = view_resolve(view, q->path, 1);
+	if (idx == -2)
+		return 1;
+	if (idx < 0)
+		return -1;
+	if (view->entries[idx].type != DT_DIR) {
+		errno = ENOTDIR;
+		return -1;
+	}
+	q->count = 0;
+	q->used = 0;
+	end = (uint64_t)idx + 1 + view->entries[idx].skip;
+	if (end > view->count)
+		return 2;
+	for (i = idx + 1; i < end; i += (uint64_t)entry->skip + 1) {
+		entry = &view->entries[i];
+		name = strrchr(view_string(view, entry->path), '/');
+		if (!name)
+			return 2;
+		len = strlen(++name) + 1;
+		if (q->used + len > q->size) {
+			q->size = 2 * q->size + len;
+			vbuf = realloc(q->buf, q->size);
+			if (!vbuf)
+				goto nomem;
+			q->buf = (char *)vbuf;
+		}
+		if (q->count == q->max) {
+			q->max = 2 * q->max + 16;
+			vbuf = realloc(q->names,
+					q->max * sizeof(struct snapshot_name));
+			if (!vbuf)
+				goto nomem;
+			q->names = (struct snapshot_name *)vbuf;
+		}
+		memcpy(q->buf + q->used, name, len);
+		q->names[q->count].name = (char *)q->used;
+		q->names[q->count].order = entry->order;
+		q->names[q->count].type = entry->type;
+		q->count++;
+		q->used += len;
+	}
+	return 0;
+
+nomem:
+	q->nomem = 1;
+	return 1;
+}
+
+#endif /* SNAPSHOT_SHM */
+
+/**
+ * snapshot_stat: looks a path up in the attached snapshot
+ * @path: absolute path
+ * @follow: follow a link at the end of path, as stat() does
+ * @type: set to the entry's d_type
+ * @method: set to an attribute's SYSFS_METHOD_* flags, may be NULL
+ * returns 0 if the snapshot has the path, -1 with errno ENOENT if it
+ * 	says there is no such path and 1 if it can't tell
+ */
+int snapshot_stat(const char *path, int follow, int *type,
+		unsigned short *method)
+{
+#ifdef SNAPSHOT_SHM
+	struct stat_query q;
+	int ret;
+
+	q.path = path;
+	q.follow = follow;
+	ret = snapshot_query(query_stat, &q);
+	if (ret < 0)
+		errno = ENOENT;
+	if (ret)
+		return ret;
+	*type = q.type;
+	if (method)
+		*method = q.method;
+	return 0;
+#else
+	(void)path;
+	(void)follow;
+	(void)type;
+	(void)method;
+	return 1;
+#endif
+}
+
+/**
+ * snapshot_readlink: reads a link from the attached snapshot
+ * @path: absolute path of the link
+ * @target: where to put the absolute path the link points at
+ * @len: size of target
+ * returns 0 with success, -1 with error and 1 if the snapshot can't tell
+ */
+int snapshot_readlink(const char *path, char *target, size_t len)
+{
+#ifdef SNAPSHOT_SHM
+	struct link_query q;
+	int ret;
+
+	q.path = path;
+	q.target = target;
+	q.len = len;
+	ret = snapshot_query(query_link, &q);
+	if (ret < 0)
+		errno = ENOENT;
+	if (ret)
+		return ret;
+	if (q.type != DT_LNK) {
+		errno = EINVAL;
+		return -1;
+	}
+	return 0;
+#else
+	(void)path;
+	(void)target;
+	(void)len;
+	return 1;
+#endif
+}
+
+/**
+ * snapshot_read: reads an attribute's value from the attached snapshot
+ * @path: absolute path of the attribute
+ * @value: set to a malloc()ed, NUL terminated copy of the value
+ * @len: set to the value's length
+ * returns 0 with success, -1 with error and 1 if the snapshot can't tell
+ */
+int snapshot_read(const char *path, char **value, size_t *len)
+{
+#ifdef SNAPSHOT_SHM
+	struct read_query q;
+	char *vbuf;
+	int ret;
+
+	q.path = path;
+	q.max = getpagesize();
+	q.value = (char *)malloc(q.max + 1);
+	if (!q.value)
+		return 1;
+	ret = snapshot_query(query_read, &q);
+	if (ret == 0 && q.type != DT_REG) {
+		errno = q.type == DT_DIR ? EISDIR : EINVAL;
+		ret = -1;
+	} else if (ret < 0)
+		errno = ENOENT;
+	if (ret) {
+		free(q.value);
+		return ret;
+	}
+	q.value[q.len] = '\0';
+	vbuf = (char *)realloc(q.value, q.len + 1);
+	*value = vbuf ? vbuf : q.value;
+	*len = q.len;
+	return 0;
+#else
+	(void)path;
+	(void)value;
+	(void)len;
+	return 1;
+#endif
+}
+
+/**
+ * snapshot_attached: tells whether lookups may be answered from a snapshot
+ */
+int snapshot_attached(void)
+{
+#ifdef SNAPSHOT_SHM
+	if (!__atomic_load_n(&attach_checked, __ATOMIC_ACQUIRE))
+		attach_from_env();
+	return __atomic_load_n(&attached, __ATOMIC_ACQUIRE) != NULL;
+#else
+	return 0;
+#endif
+}
+
+/*
+ * Directory listing for the rest of the library: from the attached
+ * snapshot when it covers the directory, from sysfs otherwise.
+ */
+struct sysfs_dirstream {
+	DIR *dir;			/* NULL when listed from a snapshot */
+	char *buf;			/* the listing's names */
+	struct snapshot_name *names;
+	int count;
+	int pos;
+	struct dirent dirent;
+};
+
+/**
+ * dirstream_open: opens a directory for dirstream_read()
+ * @path: directory to list
+ * returns the stream with success and NULL with error
+ */
+struct sysfs_dirstream *dirstream_open(const char *path)
+{
+	struct sysfs_dirstream *ds;
+#ifdef SNAPSHOT_SHM
+	struct list_query q;
+	int i, ret;
+#endif
+
+	ds = (struct sysfs_dirstream *)calloc(1,
+					sizeof(struct sysfs_dirstream));
+	if (!ds)
+		return NULL;
+#ifdef SNAPSHOT_SHM
+	memset(&q, 0, sizeof(q));
+	q.path = path;
+	ret = snapshot_query(query_list, &q);
+	if (ret <= 0) {
+		if (ret < 0) {
+			if (errno != ENOTDIR)
+				errno = ENOENT;
+			free(q.buf);
+			free(q.names);
+			free(ds);
+			return NULL;
+		}
+		for (i = 0; i < q.count; i++)
+			q.names[i].name = q.buf + (size_t)q.names[i].name;
+		qsort(q.names, q.count, sizeof(struct snapshot_name),
+							order_cmp);
+		ds->buf = q.buf;
+		ds->names = q.names;
+		ds->count = q.count;
+		return ds;
+	}
+	free(q.buf);
+	free(q.names);
+	if (q.nomem) {
+		free(ds);
+		errno = ENOMEM;
+		return NULL;
+	}
+#endif
+	ds->dir = opendir(path);
+	if (!ds->dir) {
+		free(ds);
+		return NULL;
+	}
+	return ds;
+}
+
+/**
+ * dirstream_read: returns the next entry, like readdir()
+ */
+struct dirent *dirstream_read(struct sysfs_dirstream *ds)
+{
+	struct snapshot_name *name;
+
+	if (ds->dir)
+		return readdir(ds->dir);
+	if (ds->pos == ds->count)
+		return NULL;
+	name = &ds->names[ds->pos++];
+	safestrcpy(ds->dirent.d_name, name->name);
+	ds->dirent.d_type = name->type;
+	ds->dirent.d_ino = ds->pos;
+	return &ds->dirent;
+}
+
+/**
+ * dirstream_fd: returns the descriptor of a directory read from sysfs,
+ * 	-1 for one listed from a snapshot
+ */
+int dirstream_fd(struct sysfs_dirstream *ds)
+{
+	return ds->dir ? dirfd(ds->dir) : -1;
+}
+
+/**
+ * dirstream_close: closes a stream from dirstream_open()
+ */
+void dirstream_close(struct sysfs_dirstream *ds)
+{
+	if (!ds)
+		return;
+	if (ds->dir)
+		closedir(ds->dir);
+	free(ds->buf);
+	free(ds->names);
+	free(ds);
+}
@@ -0,0 +1,261 @@
+/*
+ * sysfs_uevent.c
+ *
+ * Parsed uevent files for libsysfs
+ *
+ * Copyright (C) IBM Corp. 2003-2005
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ */
+
+#include "config.h"
+
+#include "libsysfs.h"
+#include "sysfs.h"
+
+/**
+ * free_uevent: frees a parsed uevent file
+ * @uevent: uevent to free
+ */
+void free_uevent(struct sysfs_uevent *uevent)
+{
+	if (uevent) {
+		free(uevent->vars);
+		free(uevent->buf);
+		free(uevent);
+	}
+}
+
+static void release_uevent(void *uevent)
+{
+	free_uevent((struct sysfs_uevent *)uevent);
+}
+
+/**
+ * stale_uevent: marks an object's uevent to be read again on next use.
+ * 	The old one is kept, callers may still hold it.
+ * @slot: the object's uevent pointer
+ */
+void stale_uevent(struct sysfs_uevent **slot)
+{
+	sysfs_lock();
+	if (*slot)
+		(*slot)->stale = 1;
+	sysfs_unlock();
+}
+
+static int uevent_var_cmp(const void *a, const void *b)
+{
+	return strcmp(((const struct sysfs_uevent_var *)a)->key,
+			((const struct sysfs_uevent_var *)b)->key);
+}
+
+/**
+ * read_uevent_file: reads a whole uevent file into a NUL terminated buffer,
+ * 	from the attached snapshot or cache file like any other attribute
+ * @path: path of the uevent file
+ * @len: set to the number of bytes read
+ * returns the buffer with success and NULL with error
+ */
+static char *read_uevent_file(const char *path, size_t *len)
+{
+	char *buf, *vbuf;
+	size_t size = SYSFS_PATH_MAX * 4;
+	ssize_t count;
+	int fd, ret;
+
+	ret = snapshot_read(path, &buf, len);
+	if (ret <= 0)
+		return ret ? NULL : buf;
+
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		dbg_printf("Error opening %s\n", path);
+		return NULL;
+	}
+	buf = (char *)malloc(size);
+	*len = 0;
+	while (buf) {
+		count = read(fd, buf + *len, size - *len - 1);
+		if (count <= 0) {
+			if (count < 0) {
+				free(buf);
+				buf = NULL;
+			}
+			break;
+		}
+		*len += count;
+		if (*len + 1 < size)
+			continue;
+		size *= 2;
+		vbuf = (char *)realloc(buf, size);
+		if (!vbuf)
+			free(buf);
+		buf = vbuf;
+	}
+	close(fd);
+	if (buf)
+		buf[*len] = '\0';
+	return buf;
+}
+
+/**
+ * parse_uevent: splits a uevent buffer into its KEY=value lines, in
+ * 	place. Each '=' and newline is replaced by a NUL so that keys and
+ * 	values can also be used as C strings.
+ * @uevent: uevent whose buf and len are set
+ * returns 0 with success and -1 with error
+ */
+static int parse_uevent(struct sysfs_uevent *uevent)
+{
+	struct sysfs_uevent_var *var;
+	char *line, *end, *eq;
+	int lines = 0;
+
+	for (line = uevent->buf; *line; line++) {
+		if (*line == '\n')
+			lines++;
+	}
+	uevent->vars = (struct sysfs_uevent_var *)calloc(lines + 1,
+					sizeof(struct sysfs_uevent_var));
+	if (!uevent->vars)
+		return -1;
+
+	for (line = uevent->buf; *line; line = end) {
+		end = strchr(line, '\n');
+		if (end)
+			*end++ = '\0';
+		else
+			end = line + strlen(line);
+		eq = strchr(line, '=');
+		if (!eq || eq == line)
+			continue;
+		*eq = '\0';
+		var = &uevent->vars[uevent->count++];
+		var->key = line;
+		var->key_len = eq - line;
+		var->value = eq + 1;
+		var->value_len = strlen(eq + 1);
+	}
+	qsort(uevent->vars, uevent->count, sizeof(struct sysfs_uevent_var),
+							uevent_var_cmp);
+	return 0;
+}
+
+/**
+ * get_uevent: reads and parses the uevent file of a device or class
+ * 	device the first time it is asked for, or after a refresh, and
+ * 	keeps it in *slot. A version read before a refresh is freed once
+ * 	no thread can be using it, see retire_data().
+ * @path: the object's directory
+ * @slot: the object's uevent pointer
+ * returns the parsed uevent with success and NULL with error
+ */
+static struct sysfs_uevent *get_uevent(const char *path,
+					struct sysfs_uevent **slot)
+{
+	struct sysfs_uevent *uevent, *old;
+	char file[SYSFS_PATH_MAX];
+
+	/* this thread holds what is returned from here on */
+	reader_online();
+	sysfs_lock();
+	uevent = *slot;
+	if (uevent && !uevent->stale) {
+		sysfs_unlock();
+		return uevent;
+	}
+	sysfs_unlock();
+
+	uevent = (struct sysfs_uevent *)calloc(1, sizeof(struct sysfs_uevent));
+	if (!uevent)
+		return NULL;
+	safestrcpy(file, path);
+	safestrcat(file, "/uevent");
+	uevent->buf = read_uevent_file(file, &uevent->len);
+	if (!uevent->buf || parse_uevent(uevent)) {
+		free_uevent(uevent);
+		return NULL;
+	}
+
+	/* another thread may have parsed it in the meantime */
+	sysfs_lock();
+	if (*slot && (!(*slot)->stale || ((*slot)->len == uevent->len &&
+			!memcmp((*slot)->buf, uevent->buf, uevent->len)))) {
+		free_uevent(uevent);
+		uevent = *slot;
+		uevent->stale = 0;
+	} else {
+		old = *slot;
+		*slot = uevent;
+		if (old)
+			retire_data(slot, old, release_uevent, 0);
+	}
+	sysfs_unlock();
+	return uevent;
+}
+
+/**
+ * sysfs_get_device_uevent: returns the device's uevent variables, reading
+ * 	the uevent file once and keeping the result with the device
+ * @dev: device to get the uevent of
+ * returns struct sysfs_uevent with success and NULL with error
+ */
+struct sysfs_uevent *sysfs_get_device_uevent(struct sysfs_device *dev)
+{
+	if (!dev) {
+		errno = EINVAL;
+		return NULL;
+	}
+	return get_uevent(dev->path, &dev->uevent);
+}
+
+/**
+ * sysfs_get_classdev_uevent: returns the class device's uevent variables,
+ * 	see sysfs_get_device_uevent()
+ * @clsdev: class device to get the uevent of
+ * returns struct sysfs_uevent with success and NULL with error
+ */
+struct sysfs_uevent *sysfs_get_classdev_uevent
+		(struct sysfs_class_device *clsdev)
+{
+	if (!clsdev) {
+		errno = EINVAL;
+		return NULL;
+	}
+	return get_uevent(clsdev->path, &clsdev->uevent);
+}
+
+/**
+ * sysfs_uevent_find: looks up one uevent variable by key
+ * @uevent: parsed uevent
+ * @key: variable name, e.g. "MODALIAS"
+ * returns the variable with success and NULL if it is not set
+ */
+const struct sysfs_uevent_var *sysfs_uevent_find
+		(const struct sysfs_uevent *uevent, const char *key)
+{
+	struct sysfs_uevent_var want;
+
+	if (!uevent || !key) {
+		errno = EINVAL;
+		return NULL;
+	}
+	want.key = key;
+	return (const struct sysfs_uevent_var *)bsearch(&want, uevent->vars,
+			uevent->count, sizeof(struct sysfs_uevent_var),
+			uevent_var_cmp);
+}
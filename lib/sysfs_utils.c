@@ -26,6 +26,41 @@
 #include "libsysfs.h"
 #include "sysfs.h"
 #include <mntent.h>
+#include <limits.h>
+#ifdef SYSFS_THREAD_SAFE
+#include <pthread.h>
+
+static pthread_mutex_t sysfs_mutex;
+static pthread_once_t sysfs_mutex_once = PTHREAD_ONCE_INIT;
+
+static void sysfs_mutex_init(void)
+{
+	pthread_mutexattr_t attr;
+
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutex_init(&sysfs_mutex, &attr);
+	pthread_mutexattr_destroy(&attr);
+}
+
+/**
+ * sysfs_lock: takes the library lock that serializes updates to shared
+ * 	objects, see sysfs.h. The lock is recursive.
+ */
+void sysfs_lock(void)
+{
+	pthread_once(&sysfs_mutex_once, sysfs_mutex_init);
+	pthread_mutex_lock(&sysfs_mutex);
+}
+
+/**
+ * sysfs_unlock: releases the library lock
+ */
+void sysfs_unlock(void)
+{
+	pthread_mutex_unlock(&sysfs_mutex);
+}
+#endif /* SYSFS_THREAD_SAFE */
 
 /**
  * sysfs_remove_trailing_slash: Removes any trailing '/' in the given path
@@ -56,6 +91,7 @@ int sysfs_remove_trailing_slash(char *path)
 int sysfs_get_mnt_path(char *mnt_path, size_t len)
 {
 	static char sysfs_path[SYSFS_PATH_MAX] = "";
+	char path[SYSFS_PATH_MAX];
 	const char *sysfs_path_env;
 	FILE *mnt;
 	struct mntent *mntent;
@@ -65,27 +101,33 @@ int sysfs_get_mnt_path(char *mnt_path, size_t len)
 		return -1;
 
 	/* evaluate only at the first call */
-	if (sysfs_path[0] == '\0') {
-		/* possible overrride of real mount path */
-		sysfs_path_env = getenv(SYSFS_PATH_ENV);
-		if (sysfs_path_env != NULL) {
-			safestrcpymax(mnt_path, sysfs_path_env, len);
-			sysfs_remove_trailing_slash(mnt_path);
-		} else {
-			safestrcpymax(mnt_path, SYSFS_MNT_PATH, len);
-		}
+	sysfs_lock();
+	if (sysfs_path[0] != '\0') {
+		safestrcpymax(mnt_path, sysfs_path, len);
+		sysfs_unlock();
+		return 0;
+	}
+	/* possible overrride of real mount path */
+	sysfs_path_env = getenv(SYSFS_PATH_ENV);
+	if (sysfs_path_env != NULL) {
+		safestrcpy(path, sysfs_path_env);
+		sysfs_remove_trailing_slash(path);
+	} else {
+		safestrcpy(path, SYSFS_MNT_PATH);
 	}
+	safestrcpymax(mnt_path, path, len);
 
 	/* check that mount point is indeed mounted */
 	ret = -1;
 	mnt = setmntent(SYSFS_PROC_MNTS, "r");
 	if (mnt == NULL) {
 		dbg_printf("Error getting mount information\n");
+		sysfs_unlock();
 		return -1;
 	}
 	while ((mntent = getmntent(mnt)) != NULL) {
 		if (strcmp(mntent->mnt_type, SYSFS_FSTYPE_NAME) == 0 &&
-		    strcmp(mntent->mnt_dir, mnt_path) == 0) {
+		    strcmp(mntent->mnt_dir, path) == 0) {
 			ret = 0;
 			break;
 		}
@@ -94,6 +136,9 @@ int sysfs_get_mnt_path(char *mnt_path, size_t len)
 
 	if (ret < 0)
 		errno = ENOENT;
+	else
+		safestrcpy(sysfs_path, path);
+	sysfs_unlock();
 
 	return ret;
 }
@@ -133,6 +178,47 @@ int sysfs_get_name_from_path(const char *path, char *name, size_t len)
 	return 0;
 }
 
+/**
+ * resolve_link_target: turns the contents of a link into an absolute path
+ * 	by name: a relative target is resolved against the directory the
+ * 	link lives in, without lstat()ing the components in between. Only
+ * 	valid if that directory is reached without going through a symlink,
+ * 	sysfs_get_link() is the general version.
+ * @dir: absolute path of the directory holding the link
+ * @linkpath: what readlink() returned, modified
+ * @target: where to put the resolved path
+ * @len: size of target
+ * returns 0 with success and -1 with error
+ */
+int resolve_link_target(const char *dir, char *linkpath, char *target,
+			size_t len)
+{
+	char *comp, *next, *s;
+
+	if (*linkpath == '/') {
+		safestrcpymax(target, linkpath, len);
+		return 0;
+	}
+	safestrcpymax(target, dir, len);
+	for (comp = linkpath; comp; comp = next) {
+		next = strchr(comp, '/');
+		if (next)
+			*next++ = '\0';
+		if (*comp == '\0' || strcmp(comp, ".") == 0)
+			continue;
+		if (strcmp(comp, "..") == 0) {
+			s = strrchr(target, '/');
+			if (!s || s == target)
+				return -1;
+			*s = '\0';
+			continue;
+		}
+		safestrcatmax(target, "/", len);
+		safestrcatmax(target, comp, len);
+	}
+	return 0;
+}
+
 /**
  * sysfs_get_link: returns link source
  * @path: symbolic link's path
@@ -150,6 +236,9 @@ int sysfs_get_link(const char *path, char *target, size_t len)
 		errno = EINVAL;
 		return -1;
 	}
+	count = snapshot_readlink(path, target, len);
+	if (count <= 0)
+		return count;
 
 	count = readlink(path, linkpath, SYSFS_PATH_MAX);
 	if (count < 0)
@@ -255,6 +344,687 @@ void sysfs_close_list(struct dlist *list)
 		dlist_destroy(list);
 }
 
+/*
+ * Lists, values and uevents that were replaced are freed once no thread
+ * can still be using them. Each thread the library hands one of them to
+ * is a reader, registered with the epoch it was at when it last said,
+ * with sysfs_thread_quiescent(), that it holds none of them; a reader
+ * that has said so is offline until it is handed something again.
+ * Whatever is retired at epoch e goes once every reader has been
+ * quiescent since, or has exited. Until then it is kept, at the latest
+ * until the object it belongs to is closed.
+ */
+#define EPOCH_OFFLINE	ULONG_MAX
+
+struct reader {
+	struct reader *next;
+	unsigned long seen;		/* epoch when last quiescent */
+};
+
+static unsigned long epoch = 1;
+static struct reader *readers;		/* changed under the lock */
+static int readers_lost;		/* a reader couldn't be registered */
+
+/* replaced values and uevents, oldest first */
+struct limbo {
+	struct limbo *next;
+	unsigned long epoch;
+	const void *owner;
+	void *data;
+	void (*release)(void *);
+};
+
+static struct limbo *limbo_head;
+static struct limbo **limbo_tail = &limbo_head;
+
+#ifdef SYSFS_THREAD_SAFE
+static pthread_key_t reader_key;
+static pthread_once_t reader_once = PTHREAD_ONCE_INIT;
+
+/* unregisters a thread that exits */
+static void reader_exit(void *arg)
+{
+	struct reader *r = (struct reader *)arg, **p;
+
+	sysfs_lock();
+	for (p = &readers; *p; p = &(*p)->next) {
+		if (*p == r) {
+			*p = r->next;
+			break;
+		}
+	}
+	sysfs_unlock();
+	free(r);
+}
+
+static void reader_key_init(void)
+{
+	if (pthread_key_create(&reader_key, reader_exit))
+		readers_lost = 1;
+}
+
+/**
+ * this_reader: returns the calling thread's reader
+ * @create: registers the thread if it isn't yet
+ * returns the reader, NULL if there is none
+ */
+static struct reader *this_reader(int create)
+{
+	struct reader *r;
+
+	pthread_once(&reader_once, reader_key_init);
+	if (readers_lost)
+		return NULL;
+	r = (struct reader *)pthread_getspecific(reader_key);
+	if (r || !create)
+		return r;
+	r = (struct reader *)calloc(1, sizeof(struct reader));
+	sysfs_lock();
+	if (!r || pthread_setspecific(reader_key, r)) {
+		/* what is handed out can't be tracked, keep it all */
+		readers_lost = 1;
+		sysfs_unlock();
+		free(r);
+		return NULL;
+	}
+	r->seen = __atomic_load_n(&epoch, __ATOMIC_SEQ_CST);
+	r->next = readers;
+	readers = r;
+	sysfs_unlock();
+	return r;
+}
+#else
+static struct reader *this_reader(int create)
+{
+	static struct reader self;
+
+	if (!readers && create) {
+		self.seen = epoch;
+		readers = &self;
+	}
+	return readers;
+}
+#endif /* SYSFS_THREAD_SAFE */
+
+/**
+ * reader_online: registers the calling thread as holding what the
+ * 	library is about to hand it
+ */
+void reader_online(void)
+{
+	struct reader *r = this_reader(1);
+
+	if (r && __atomic_load_n(&r->seen, __ATOMIC_RELAXED) ==
+							EPOCH_OFFLINE) {
+		__atomic_store_n(&r->seen,
+			__atomic_load_n(&epoch, __ATOMIC_SEQ_CST),
+			__ATOMIC_SEQ_CST);
+		__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	}
+}
+
+/*
+ * Ends the epoch of what was just replaced, returning it. Called with the
+ * lock held, after the replacement is in place.
+ */
+static unsigned long retire_epoch(void)
+{
+	return __atomic_fetch_add(&epoch, 1, __ATOMIC_SEQ_CST);
+}
+
+/*
+ * Returns the epoch before which all that was retired is unused, leaving
+ * out @skip. Called with the lock held.
+ */
+static unsigned long grace_epoch(const struct reader *skip)
+{
+	unsigned long min = EPOCH_OFFLINE, seen;
+	struct reader *r;
+
+	if (readers_lost)
+		return 0;
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	for (r = readers; r; r = r->next) {
+		if (r == skip)
+			continue;
+		seen = __atomic_load_n(&r->seen, __ATOMIC_SEQ_CST);
+		if (seen < min)
+			min = seen;
+	}
+	return min;
+}
+
+/* Frees what is no longer used in limbo. Called with the lock held. */
+static void reclaim_limbo(void)
+{
+	struct limbo *l;
+	unsigned long grace;
+
+	if (!limbo_head)
+		return;
+	grace = grace_epoch(NULL);
+	while ((l = limbo_head) && l->epoch < grace) {
+		limbo_head = l->next;
+		if (!limbo_head)
+			limbo_tail = &limbo_head;
+		l->release(l->data);
+		free(l);
+	}
+}
+
+/**
+ * retire_data: frees what an object no longer points to once no reader
+ * 	can be using it. Called with the lock held, after @data was
+ * 	replaced.
+ * @owner: object @data belonged to, see purge_retired()
+ * @data: what was replaced
+ * @release: frees @data
+ * @self_done: the calling thread doesn't use @data any more
+ */
+void retire_data(const void *owner, void *data, void (*release)(void *),
+		int self_done)
+{
+	struct limbo *l;
+	unsigned long e = retire_epoch();
+
+	if (grace_epoch(self_done ? this_reader(0) : NULL) > e) {
+		release(data);
+		reclaim_limbo();
+		return;
+	}
+	l = (struct limbo *)calloc(1, sizeof(struct limbo));
+	if (!l) {
+		dbg_printf("Can't keep track of replaced data, leaving it\n");
+		return;
+	}
+	l->epoch = e;
+	l->owner = owner;
+	l->data = data;
+	l->release = release;
+	*limbo_tail = l;
+	limbo_tail = &l->next;
+	reclaim_limbo();
+}
+
+/**
+ * purge_retired: frees what was retired from @owner, which is being
+ * 	closed, whether or not readers are done with it
+ */
+void purge_retired(const void *owner)
+{
+	struct limbo **p, *l;
+
+	if (!__atomic_load_n(&limbo_head, __ATOMIC_RELAXED))
+		return;
+	sysfs_lock();
+	p = &limbo_head;
+	while ((l = *p)) {
+		if (l->owner != owner) {
+			p = &l->next;
+			continue;
+		}
+		*p = l->next;
+		l->release(l->data);
+		free(l);
+	}
+	limbo_tail = p;
+	sysfs_unlock();
+}
+
+/**
+ * sysfs_thread_quiescent: tells the library the calling thread holds no
+ * 	list, attribute value or uevent it was handed, so that those that
+ * 	were replaced since can be freed
+ */
+void sysfs_thread_quiescent(void)
+{
+	struct reader *r = this_reader(0);
+
+	if (!r)
+		return;
+	__atomic_store_n(&r->seen, EPOCH_OFFLINE, __ATOMIC_SEQ_CST);
+	sysfs_lock();
+	reclaim_limbo();
+	sysfs_unlock();
+}
+
+/*
+ * A shared list is a plain dlist with room to keep what it replaced.
+ * The dlist comes first, so dlist_destroy() and friends work on it as is.
+ */
+struct retired {
+	struct retired *next;
+	unsigned long epoch;		/* 0 until the replacement is in */
+	struct dlist *list;		/* old version, only its nodes go */
+	void *data;			/* dropped entry, freed by del_func */
+};
+
+struct shared_list {
+	struct dlist list;
+	struct retired *retired;	/* newest first */
+	struct retired *oldest;
+};
+
+/**
+ * shared_list_new: allocates an empty shared list
+ * @size: size of an entry
+ * @del_func: frees one entry
+ * returns the new list or NULL with error
+ */
+struct dlist *shared_list_new(size_t size, void (*del_func)(void *))
+{
+	struct shared_list *shared;
+
+	shared = (struct shared_list *)calloc(1, sizeof(struct shared_list));
+	if (!shared)
+		return NULL;
+	shared->list.data_size = size;
+	shared->list.del_func = del_func;
+	shared->list.head = &shared->list.headnode;
+	return &shared->list;
+}
+
+/**
+ * shared_list_get: returns the list currently published at @list
+ */
+struct dlist *shared_list_get(struct dlist **list)
+{
+	reader_online();
+	return load_acquire(list);
+}
+
+/**
+ * shared_list_find: looks an entry up by name in the list published at
+ * 	@list. Entries all start with their name.
+ * returns the entry or NULL if there is none
+ */
+void *shared_list_find(struct dlist **list, const char *name)
+{
+	struct dlist *cur = shared_list_get(list);
+	struct dl_node *node;
+
+	if (!cur || !name)
+		return NULL;
+	dlist_for_each_nomark(cur, node) {
+		if (!strcmp(((struct sysfs_attribute *)node->data)->name,
+					name))
+			return node->data;
+	}
+	return NULL;
+}
+
+static void retire(struct dlist *list, struct retired *r, struct dlist *old,
+		void *data)
+{
+	r->epoch = 0;
+	r->list = old;
+	r->data = data;
+	r->next = ((struct shared_list *)list)->retired;
+	((struct shared_list *)list)->retired = r;
+	if (!r->next)
+		((struct shared_list *)list)->oldest = r;
+}
+
+/* Frees a copy that was never published, leaving the entries alone. */
+static void shared_list_abort(struct dlist *copy)
+{
+	while (copy->count)
+		dlist_pop(copy);
+	free(copy);
+}
+
+static void release_retired(struct dlist *list, struct retired *r)
+{
+	if (r->list)
+		shared_list_abort(r->list);
+	if (r->data)
+		list->del_func(r->data);
+	free(r);
+}
+
+/*
+ * Stamps what @list just replaced with the epoch that ends, and frees
+ * what no reader can be using any more. Called with the lock held.
+ */
+static void reclaim_list(struct dlist *list)
+{
+	struct shared_list *shared = (struct shared_list *)list;
+	struct retired **p = &shared->retired, *r, *last = NULL;
+	unsigned long e = 0, grace;
+
+	/* the newly retired are at the front */
+	for (r = *p; r && !r->epoch; r = r->next) {
+		if (!e)
+			e = retire_epoch();
+		r->epoch = e;
+	}
+	grace = grace_epoch(NULL);
+	if (!shared->oldest || shared->oldest->epoch >= grace)
+		return;
+	while (*p && (*p)->epoch >= grace) {
+		last = *p;
+		p = &last->next;
+	}
+	while ((r = *p)) {
+		*p = r->next;
+		release_retired(list, r);
+	}
+	shared->oldest = last;
+}
+
+/*
+ * Makes a private copy of @list to change, with the same entries. Called
+ * with the lock held.
+ */
+static struct dlist *shared_list_copy(struct dlist *list, size_t size,
+		void (*del_func)(void *))
+{
+	struct dlist *copy;
+	struct dl_node *node;
+
+	if (list) {
+		size = list->data_size;
+		del_func = list->del_func;
+	}
+	copy = shared_list_new(size, del_func);
+	if (!copy || !list)
+		return copy;
+	dlist_for_each_nomark(list, node)
+		dlist_push(copy, node->data);
+	return copy;
+}
+
+/*
+ * Replaces the list at @list with @copy. The old one is kept, using @r,
+ * for those still walking it. Called with the lock held.
+ */
+static void shared_list_publish(struct dlist **list, struct dlist *copy,
+		struct retired *r)
+{
+	struct dlist *old = *list;
+
+	if (old) {
+		((struct shared_list *)copy)->retired =
+				((struct shared_list *)old)->retired;
+		((struct shared_list *)copy)->oldest =
+				((struct shared_list *)old)->oldest;
+		((struct shared_list *)old)->retired = NULL;
+		retire(copy, r, old, NULL);
+	} else
+		free(r);
+	store_release(list, copy);
+	reclaim_list(copy);
+}
+
+/**
+ * shared_list_add: adds one freshly opened entry to the list at @list,
+ * 	creating it if needed. If another entry of the same name got
+ * 	there first, @data is freed and that one is returned.
+ * @list: where the list is published
+ * @data: entry to add
+ * @size: size of an entry
+ * @del_func: frees one entry
+ * returns the entry now in the list, NULL with error (@data is freed)
+ */
+void *shared_list_add(struct dlist **list, void *data, size_t size,
+		void (*del_func)(void *))
+{
+	struct dlist *copy = NULL;
+	struct retired *r;
+	void *found;
+
+	r = (struct retired *)calloc(1, sizeof(struct retired));
+	sysfs_lock();
+	found = shared_list_find(list, ((struct sysfs_attribute *)data)->name);
+	if (!found && r)
+		copy = shared_list_copy(*list, size, del_func);
+	if (copy) {
+		dlist_unshift_sorted(copy, data, sort_list);
+		shared_list_publish(list, copy, r);
+		sysfs_unlock();
+		return data;
+	}
+	sysfs_unlock();
+	free(r);
+	del_func(data);
+	return found;
+}
+
+/**
+ * shared_list_merge: moves the freshly opened entries of @fresh into the
+ * 	list at @list, creating it if needed, in one go. Entries whose
+ * 	name is there already are freed. @fresh is destroyed either way.
+ * @list: where the list is published
+ * @fresh: plain list of new entries, its del_func frees one
+ * returns 0 with success and -1 with error
+ */
+int shared_list_merge(struct dlist **list, struct dlist *fresh)
+{
+	struct dlist *copy = NULL;
+	struct retired *r;
+	void *data;
+	int added = 0;
+
+	if (!fresh)
+		return 0;
+	r = (struct retired *)calloc(1, sizeof(struct retired));
+	sysfs_lock();
+	if (r)
+		copy = shared_list_copy(*list, fresh->data_size,
+						fresh->del_func);
+	if (copy) {
+		while (fresh->count) {
+			data = dlist_shift(fresh);
+			if (shared_list_find(&copy,
+				((struct sysfs_attribute *)data)->name))
+				fresh->del_func(data);
+			else {
+				dlist_unshift_sorted(copy, data, sort_list);
+				added++;
+			}
+		}
+		if (added) {
+			shared_list_publish(list, copy, r);
+			r = NULL;
+		} else
+			shared_list_abort(copy);
+	}
+	sysfs_unlock();
+	free(r);
+	dlist_destroy(fresh);
+	return copy ? 0 : -1;
+}
+
+/**
+ * shared_list_drop: takes the entries @dead() picks out of the list at
+ * 	@list. They are kept while readers may still hold them, see
+ * 	retire_data().
+ * @list: where the list is published
+ * @dead: returns 1 for an entry to drop
+ * @arg: handed to @dead
+ * returns 0 with success and -1 with error
+ */
+int shared_list_drop(struct dlist **list, int (*dead)(void *, void *),
+		void *arg)
+{
+	struct dlist *copy;
+	struct dl_node *node, *next;
+	struct retired *r;
+	int dropped = 0;
+
+	r = (struct retired *)calloc(1, sizeof(struct retired));
+	if (!r)
+		return -1;
+	sysfs_lock();
+	copy = shared_list_copy(*list, 0, NULL);
+	if (!copy || !*list) {
+		sysfs_unlock();
+		free(r);
+		if (copy)
+			shared_list_abort(copy);
+		return copy ? 0 : -1;
+	}
+	for (node = copy->head->next; node && node != copy->head;
+							node = next) {
+		struct retired *gone;
+
+		next = node->next;
+		if (!dead(node->data, arg))
+			continue;
+		gone = (struct retired *)calloc(1, sizeof(struct retired));
+		if (!gone)
+			continue;
+		retire(*list, gone, NULL, node->data);
+		_dlist_remove(copy, node, 1);
+		dropped++;
+	}
+	if (dropped) {
+		shared_list_publish(list, copy, r);
+		r = NULL;
+	} else
+		shared_list_abort(copy);
+	sysfs_unlock();
+	free(r);
+	return 0;
+}
+
+/**
+ * shared_list_destroy: frees a shared list along with all it replaced,
+ * 	when the object that holds it is closed
+ */
+void shared_list_destroy(struct dlist *list)
+{
+	struct retired *r, *next;
+
+	if (!list)
+		return;
+	for (r = ((struct shared_list *)list)->retired; r; r = next) {
+		next = r->next;
+		release_retired(list, r);
+	}
+	dlist_destroy(list);
+}
+
+struct refresh_name {
+	const char *name;
+	struct dl_node *node;		/* in the names list */
+	int matched;
+};
+
+static int refresh_name_cmp(const void *a, const void *b)
+{
+	return strcmp(((const struct refresh_name *)a)->name,
+			((const struct refresh_name *)b)->name);
+}
+
+static int ptr_cmp(const void *a, const void *b)
+{
+	const void *pa = *(const void * const *)a;
+	const void *pb = *(const void * const *)b;
+
+	return pa < pb ? -1 : pa > pb;
+}
+
+struct ptr_set {
+	void **ptrs;			/* sorted */
+	unsigned long count;
+};
+
+static int ptr_in_set(void *data, void *arg)
+{
+	struct ptr_set *set = (struct ptr_set *)arg;
+
+	return bsearch(&data, set->ptrs, set->count, sizeof(void *),
+			ptr_cmp) != NULL;
+}
+
+/**
+ * drop_entries: drops @count entries, in @gone, from the list at @list
+ * returns 0 with success and -1 with error
+ */
+int drop_entries(struct dlist **list, void **gone, unsigned long count)
+{
+	struct ptr_set set;
+
+	if (!count)
+		return 0;
+	qsort(gone, count, sizeof(void *), ptr_cmp);
+	set.ptrs = gone;
+	set.count = count;
+	return shared_list_drop(list, ptr_in_set, &set);
+}
+
+/**
+ * refresh_list: brings a list of libsysfs objects in line with the names
+ * 	now found in sysfs. Objects whose name is gone, or that refresh()
+ * 	fails on, are dropped from the list; the others are refreshed in
+ * 	place. Names that matched are removed from @names, which leaves
+ * 	only the new ones for the caller to open.
+ * @list: where the list of sysfs_* structs, each starting with its name,
+ * 	is published
+ * @names: list of names, may be NULL if none were found
+ * @refresh: refreshes one object, returns 0 if it is still there
+ * returns 0 with success and -1 with error
+ */
+int refresh_list(struct dlist **list, struct dlist *names,
+		int (*refresh)(void *))
+{
+	struct refresh_name *sorted = NULL, want, *found;
+	struct dlist *cur;
+	struct dl_node *node;
+	void **gone;
+	unsigned long dead = 0;
+	int i, count = 0, ret;
+
+	cur = list ? shared_list_get(list) : NULL;
+	if (!cur || !refresh) {
+		errno = EINVAL;
+		return -1;
+	}
+	gone = (void **)calloc(cur->count + 1, sizeof(void *));
+	if (!gone)
+		return -1;
+	if (names && names->count) {
+		sorted = (struct refresh_name *)calloc(names->count,
+						sizeof(struct refresh_name));
+		if (!sorted) {
+			free(gone);
+			return -1;
+		}
+		dlist_for_each_nomark(names, node) {
+			sorted[count].name = (const char *)node->data;
+			sorted[count].node = node;
+			count++;
+		}
+		qsort(sorted, count, sizeof(struct refresh_name),
+						refresh_name_cmp);
+	}
+
+	/* cur is never changed, the refreshes run without the lock */
+	dlist_for_each_nomark(cur, node) {
+		want.name = ((struct sysfs_device *)node->data)->name;
+		found = NULL;
+		if (count)
+			found = (struct refresh_name *)bsearch(&want, sorted,
+					count, sizeof(struct refresh_name),
+					refresh_name_cmp);
+		if (found && !found->matched && !refresh(node->data)) {
+			found->matched = 1;
+			continue;
+		}
+		gone[dead++] = node->data;
+	}
+	ret = drop_entries(list, gone, dead);
+
+	for (i = 0; i < count; i++) {
+		if (sorted[i].matched)
+			names->del_func(_dlist_remove(names, sorted[i].node, 1));
+	}
+	free(sorted);
+	free(gone);
+	return ret;
+}
+
 /**
  * sysfs_open_directory_list: gets a list of all directories under "path"
  * @path: path to read
@@ -291,11 +1061,15 @@ struct dlist *sysfs_open_link_list(const char *path)
 int sysfs_path_is_dir(const char *path)
 {
 	struct stat astats;
+	int ret, type;
 
 	if (!path) {
 		errno = EINVAL;
 		return 1;
 	}
+	ret = snapshot_stat(path, 0, &type, NULL);
+	if (ret <= 0)
+		return (ret == 0 && type == DT_DIR) ? 0 : 1;
 	if ((lstat(path, &astats)) != 0) {
 		dbg_printf("stat() failed\n");
 		return 1;
@@ -314,11 +1088,15 @@ int sysfs_path_is_dir(const char *path)
 int sysfs_path_is_link(const char *path)
 {
 	struct stat astats;
+	int ret, type;
 
 	if (!path) {
 		errno = EINVAL;
 		return 1;
 	}
+	ret = snapshot_stat(path, 0, &type, NULL);
+	if (ret <= 0)
+		return (ret == 0 && type == DT_LNK) ? 0 : 1;
 	if ((lstat(path, &astats)) != 0) {
 		dbg_printf("stat() failed\n");
 		return 1;
@@ -337,11 +1115,15 @@ int sysfs_path_is_link(const char *path)
 int sysfs_path_is_file(const char *path)
 {
 	struct stat astats;
+	int ret, type;
 
 	if (!path) {
 		errno = EINVAL;
 		return 1;
 	}
+	ret = snapshot_stat(path, 1, &type, NULL);
+	if (ret <= 0)
+		return (ret == 0 && type == DT_REG) ? 0 : 1;
 	if ((stat(path, &astats)) != 0) {
 		dbg_printf("stat() failed\n");
 		return 1;
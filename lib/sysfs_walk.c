@@ -0,0 +1,273 @@
+/*
+ * sysfs_walk.c
+ *
+ * Visitor based walk of a sysfs device tree for libsysfs
+ *
+ * Copyright (C) IBM Corp. 2003-2005
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ */
+
+#include "config.h"
+
+#include "libsysfs.h"
+#include "sysfs.h"
+
+static int sort_char(void *new, void *old)
+{
+	return ((strncmp((char *)new, (char *)old,
+			strlen((char *)new))) < 0 ? 1 : 0);
+}
+
+/**
+ * sysfs_del_name: free function for the list of subdirectories
+ * @name: memory area to be freed
+ */
+static void sysfs_del_name(void *name)
+{
+	free(name);
+}
+
+/**
+ * walk_entry_type: returns the type of a directory entry, falling back to
+ * 	lstat() only when the filesystem does not fill in d_type
+ * @path: directory the entry lives in
+ * @dirent: entry to check
+ * returns DT_DIR, DT_REG, DT_LNK or DT_UNKNOWN
+ */
+static int walk_entry_type(const char *path, struct dirent *dirent)
+{
+	char file_path[SYSFS_PATH_MAX];
+	struct stat astats;
+
+	if (dirent->d_type != DT_UNKNOWN)
+		return dirent->d_type;
+
+	safestrcpy(file_path, path);
+	safestrcat(file_path, "/");
+	safestrcat(file_path, dirent->d_name);
+	if (lstat(file_path, &astats) != 0)
+		return DT_UNKNOWN;
+	if (S_ISDIR(astats.st_mode))
+		return DT_DIR;
+	if (S_ISREG(astats.st_mode))
+		return DT_REG;
+	if (S_ISLNK(astats.st_mode))
+		return DT_LNK;
+	return DT_UNKNOWN;
+}
+
+/**
+ * walk_project: reads the attributes named in the projection list into
+ * 	the node's attrlist. Attributes the node doesn't have are skipped.
+ * @node: node to fill
+ * @dfd: descriptor of the node's directory, -1 if it has none
+ * @attrs: NULL terminated list of attribute names
+ */
+static void walk_project(struct sysfs_walk_node *node, int dfd,
+				const char * const *attrs)
+{
+	for (; *attrs; attrs++) {
+		if (!get_attribute_at(node, dfd, *attrs, NULL))
+			dbg_printf("Attribute %s not present at %s\n",
+					*attrs, node->path);
+	}
+}
+
+/**
+ * walk_release_node: frees what was attached to a node during its visit
+ * @node: node to clean up
+ */
+static void walk_release_node(struct sysfs_walk_node *node)
+{
+	if (node->attrlist) {
+		shared_list_destroy(node->attrlist);
+		node->attrlist = NULL;
+	}
+	if (node->device) {
+		sysfs_close_device(node->device);
+		node->device = NULL;
+	}
+}
+
+/**
+ * walk_dir: visits the directory at path and then its subdirectories
+ * @path: directory to visit
+ * @depth: depth of path below the walk's root
+ * @visitor: callback
+ * @opts: walk options, never NULL here
+ * @data: caller's cookie for the visitor
+ * returns SYSFS_WALK_STOP if the walk is to end, SYSFS_WALK_CONTINUE
+ * 	otherwise
+ */
+static int walk_dir(const char *path, int depth, sysfs_walk_fn visitor,
+			const struct sysfs_walk_opts *opts, void *data)
+{
+	struct sysfs_dirstream *dir = NULL;
+	struct dirent *dirent = NULL;
+	struct dlist *subdirs = NULL;
+	struct dl_node *cur = NULL;
+	struct sysfs_walk_node node;
+	char sub_path[SYSFS_PATH_MAX], *dir_name;
+	int is_device = 0, ret = SYSFS_WALK_CONTINUE;
+
+	dir = dirstream_open(path);
+	if (!dir) {
+		dbg_printf("Error opening directory %s\n", path);
+		return SYSFS_WALK_CONTINUE;
+	}
+	/*
+	 * One pass over the directory tells us both whether this is a
+	 * device (it has a uevent file) and where to descend next.
+	 */
+	while ((dirent = dirstream_read(dir)) != NULL) {
+		if (0 == strcmp(dirent->d_name, "."))
+			continue;
+		if (0 == strcmp(dirent->d_name, ".."))
+			continue;
+		switch (walk_entry_type(path, dirent)) {
+		case DT_REG:
+			if (0 == strcmp(dirent->d_name, "uevent"))
+				is_device = 1;
+			break;
+		case DT_DIR:
+			if (opts->max_depth > 0 && depth >= opts->max_depth)
+				break;
+			if (!subdirs) {
+				subdirs = dlist_new_with_delete
+					(SYSFS_NAME_LEN, sysfs_del_name);
+				if (!subdirs) {
+					dbg_printf("Error creating list\n");
+					dirstream_close(dir);
+					return SYSFS_WALK_CONTINUE;
+				}
+			}
+			dir_name = (char *)calloc(1, SYSFS_NAME_LEN);
+			if (!dir_name)
+				break;
+			safestrcpymax(dir_name, dirent->d_name, SYSFS_NAME_LEN);
+			dlist_unshift_sorted(subdirs, dir_name, sort_char);
+			break;
+		default:
+			break;
+		}
+	}
+
+	if (is_device || (opts->flags & SYSFS_WALK_ALL_DIRS)) {
+		memset(&node, 0, sizeof(struct sysfs_walk_node));
+		sysfs_get_name_from_path(path, node.name, SYSFS_NAME_LEN);
+		safestrcpy(node.path, path);
+		node.depth = depth;
+		node.is_device = is_device;
+		if (opts->attrs)
+			walk_project(&node, dirstream_fd(dir), opts->attrs);
+		ret = visitor(&node, data);
+		walk_release_node(&node);
+	}
+	dirstream_close(dir);
+
+	if (ret == SYSFS_WALK_CONTINUE && subdirs) {
+		dlist_for_each_data_nomark(subdirs, cur, dir_name, char) {
+			safestrcpy(sub_path, path);
+			safestrcat(sub_path, "/");
+			safestrcat(sub_path, dir_name);
+			if (walk_dir(sub_path, depth + 1, visitor, opts, data)
+					== SYSFS_WALK_STOP) {
+				ret = SYSFS_WALK_STOP;
+				break;
+			}
+		}
+	}
+	if (subdirs)
+		dlist_destroy(subdirs);
+
+	return ret == SYSFS_WALK_STOP ? SYSFS_WALK_STOP : SYSFS_WALK_CONTINUE;
+}
+
+/**
+ * sysfs_walk: walks the sysfs tree below root depth first, calling the
+ * 	visitor for every device directory (one that has a uevent file) in
+ * 	sorted order. Directories that are not devices are descended into
+ * 	but not reported unless SYSFS_WALK_ALL_DIRS is set. Symbolic links
+ * 	are never followed.
+ * @root: absolute path of the directory to start at, e.g. /sys/devices
+ * @visitor: called once per node, returns SYSFS_WALK_CONTINUE to go on,
+ * 	SYSFS_WALK_SKIP to leave out the node's subdirectories or
+ * 	SYSFS_WALK_STOP to end the walk
+ * @opts: attributes to read for each node, depth limit and flags. May be
+ * 	NULL for none of these
+ * @data: passed through to the visitor
+ * returns 0 when the whole tree was walked, 1 when the visitor stopped
+ * 	the walk and -1 with error.
+ */
+int sysfs_walk(const char *root, sysfs_walk_fn visitor,
+		const struct sysfs_walk_opts *opts, void *data)
+{
+	struct sysfs_walk_opts defaults;
+	char path[SYSFS_PATH_MAX];
+
+	if (!root || !visitor) {
+		errno = EINVAL;
+		return -1;
+	}
+	if (!opts) {
+		memset(&defaults, 0, sizeof(struct sysfs_walk_opts));
+		opts = &defaults;
+	}
+	safestrcpy(path, root);
+	sysfs_remove_trailing_slash(path);
+	if (sysfs_path_is_dir(path)) {
+		dbg_printf("Invalid path to walk: %s\n", path);
+		return -1;
+	}
+
+	if (walk_dir(path, 0, visitor, opts, data) == SYSFS_WALK_STOP)
+		return 1;
+
+	return 0;
+}
+
+/**
+ * sysfs_walk_node_attr: returns one of the node's attributes, reading it
+ * 	if it was not part of the walk's projection list
+ * @node: node being visited
+ * @name: attribute name
+ * returns sysfs_attribute reference with success or NULL with error
+ */
+struct sysfs_attribute *sysfs_walk_node_attr(struct sysfs_walk_node *node,
+						const char *name)
+{
+	return get_attribute(node, name, NULL);
+}
+
+/**
+ * sysfs_walk_node_device: opens the node as a sysfs_device on first use.
+ * 	The device belongs to the node and is closed once the visitor
+ * 	returns.
+ * @node: node being visited
+ * returns struct sysfs_device * with success and NULL with error
+ */
+struct sysfs_device *sysfs_walk_node_device(struct sysfs_walk_node *node)
+{
+	if (!node) {
+		errno = EINVAL;
+		return NULL;
+	}
+	if (!node->device)
+		node->device = sysfs_open_device_path_flags(node->path, 0);
+
+	return node->device;
+}
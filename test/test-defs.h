@@ -80,20 +80,34 @@ extern int test_sysfs_close_list(int flag);
 extern int test_sysfs_close_attribute(int flag);
 extern int test_sysfs_open_attribute(int flag);
 extern int test_sysfs_read_attribute(int flag);
+extern int test_sysfs_read_attribute_fd(int flag);
+extern int test_sysfs_read_attribute_at(int flag);
 extern int test_sysfs_write_attribute(int flag);
+extern int test_sysfs_get_list_attrs(int flag);
+extern int test_sysfs_get_attribute_class(int flag);
+extern int test_sysfs_set_attribute_class(int flag);
+extern int test_sysfs_get_generation(int flag);
 extern int test_sysfs_close_driver(int flag);
 extern int test_sysfs_open_driver(int flag);
 extern int test_sysfs_open_driver_path(int flag);
 extern int test_sysfs_get_driver_attr(int flag);
 extern int test_sysfs_get_driver_attributes(int flag);
+extern int test_sysfs_get_driver_attrs(int flag);
 extern int test_sysfs_get_driver_devices(int flag);
 extern int test_sysfs_get_driver_module(int flag);
 extern int test_sysfs_close_device(int flag);
 extern int test_sysfs_open_device(int flag);
 extern int test_sysfs_get_device_parent(int flag);
 extern int test_sysfs_open_device_path(int flag);
+extern int test_sysfs_open_device_path_flags(int flag);
+extern int test_sysfs_get_device_bus_name(int flag);
+extern int test_sysfs_get_device_driver_name(int flag);
+extern int test_sysfs_get_device_subsystem(int flag);
+extern int test_sysfs_get_device_uevent(int flag);
+extern int test_sysfs_uevent_find(int flag);
 extern int test_sysfs_get_device_attr(int flag);
 extern int test_sysfs_get_device_attributes(int flag);
+extern int test_sysfs_get_device_attrs(int flag);
 extern int test_sysfs_close_bus(int flag);
 extern int test_sysfs_open_bus(int flag);
 extern int test_sysfs_get_bus_device(int flag);
@@ -103,13 +117,17 @@ extern int test_sysfs_get_bus_devices(int flag);
 extern int test_sysfs_close_class_device(int flag);
 extern int test_sysfs_open_class_device_path(int flag);
 extern int test_sysfs_open_class_device(int flag);
+extern int test_sysfs_open_class_device_devnum(int flag);
+extern int test_sysfs_open_class_devices_devnum(int flag);
 extern int test_sysfs_get_classdev_device(int flag);
 extern int test_sysfs_get_classdev_parent(int flag);
+extern int test_sysfs_get_classdev_uevent(int flag);
 extern int test_sysfs_close_class(int flag);
 extern int test_sysfs_open_class(int flag);
 extern int test_sysfs_get_class_devices(int flag);
 extern int test_sysfs_get_class_device(int flag);
 extern int test_sysfs_get_classdev_attributes(int flag);
+extern int test_sysfs_get_classdev_attrs(int flag);
 extern int test_sysfs_get_classdev_attr(int flag);
 extern int test_sysfs_open_classdev_attr(int flag);
 extern int test_sysfs_close_module(int flag);
@@ -117,9 +135,52 @@ extern int test_sysfs_open_module_path(int flag);
 extern int test_sysfs_open_module(int flag);
 extern int test_sysfs_get_module_attr(int flag);
 extern int test_sysfs_get_module_attributes(int flag);
+extern int test_sysfs_get_module_attrs(int flag);
 extern int test_sysfs_get_module_parms(int flag);
 extern int test_sysfs_get_module_sections(int flag);
 extern int test_sysfs_get_module_parm(int flag);
 extern int test_sysfs_get_module_section(int flag);
+extern int test_sysfs_close_iter(int flag);
+extern int test_sysfs_open_bus_device_iter(int flag);
+extern int test_sysfs_bus_device_iter_next(int flag);
+extern int test_sysfs_open_bus_driver_iter(int flag);
+extern int test_sysfs_bus_driver_iter_next(int flag);
+extern int test_sysfs_open_class_device_iter(int flag);
+extern int test_sysfs_class_device_iter_next(int flag);
+extern int test_sysfs_iter_add_match(int flag);
+extern int test_sysfs_walk(int flag);
+extern int test_sysfs_walk_node_attr(int flag);
+extern int test_sysfs_walk_node_device(int flag);
+extern int test_sysfs_ref_bus(int flag);
+extern int test_sysfs_ref_class(int flag);
+extern int test_sysfs_ref_device(int flag);
+extern int test_sysfs_ref_class_device(int flag);
+extern int test_sysfs_ref_driver(int flag);
+extern int test_sysfs_ref_module(int flag);
+extern int test_sysfs_thread_quiescent(int flag);
+extern int test_sysfs_refresh_bus(int flag);
+extern int test_sysfs_refresh_class(int flag);
+extern int test_sysfs_refresh_class_device(int flag);
+extern int test_sysfs_refresh_device(int flag);
+extern int test_sysfs_refresh_driver(int flag);
+extern int test_sysfs_close_index(int flag);
+extern int test_sysfs_open_index(int flag);
+extern int test_sysfs_index_get_device_classdevs(int flag);
+extern int test_sysfs_index_get_devnum_classdev(int flag);
+extern int test_sysfs_index_get_driver_module(int flag);
+extern int test_sysfs_open_monitor(int flag);
+extern int test_sysfs_open_monitor_fd(int flag);
+extern int test_sysfs_close_monitor(int flag);
+extern int test_sysfs_monitor_get_fd(int flag);
+extern int test_sysfs_monitor_watch_bus(int flag);
+extern int test_sysfs_monitor_watch_class(int flag);
+extern int test_sysfs_monitor_receive(int flag);
+extern int test_sysfs_open_snapshot(int flag);
+extern int test_sysfs_close_snapshot(int flag);
+extern int test_sysfs_publish_snapshot(int flag);
+extern int test_sysfs_attach_snapshot(int flag);
+extern int test_sysfs_detach_snapshot(int flag);
+extern int test_sysfs_write_cache(int flag);
+extern int test_sysfs_attach_cache(int flag);
 
 #endif /* _TESTER_H_ */
@@ -46,19 +46,33 @@ char *function_name[] = {
 	"sysfs_close_attribute",
 	"sysfs_open_attribute",
 	"sysfs_read_attribute",
+	"sysfs_read_attribute_fd",
+	"sysfs_read_attribute_at",
 	"sysfs_write_attribute",
+	"sysfs_get_list_attrs",
+	"sysfs_get_attribute_class",
+	"sysfs_set_attribute_class",
+	"sysfs_get_generation",
 	"sysfs_close_driver",
 	"sysfs_open_driver",
 	"sysfs_open_driver_path",
 	"sysfs_get_driver_attr",
 	"sysfs_get_driver_attributes",
+	"sysfs_get_driver_attrs",
 	"sysfs_get_driver_devices",
 	"sysfs_close_device",
 	"sysfs_open_device",
 	"sysfs_get_device_parent",
 	"sysfs_open_device_path",
+	"sysfs_open_device_path_flags",
+	"sysfs_get_device_bus_name",
+	"sysfs_get_device_driver_name",
+	"sysfs_get_device_subsystem",
+	"sysfs_get_device_uevent",
+	"sysfs_uevent_find",
 	"sysfs_get_device_attr",
 	"sysfs_get_device_attributes",
+	"sysfs_get_device_attrs",
 	"sysfs_close_bus",
 	"sysfs_open_bus",
 	"sysfs_get_bus_device",
@@ -68,23 +82,70 @@ char *function_name[] = {
 	"sysfs_close_class_device",
 	"sysfs_open_class_device_path",
 	"sysfs_open_class_device",
+	"sysfs_open_class_device_devnum",
+	"sysfs_open_class_devices_devnum",
 	"sysfs_get_classdev_device",
 	"sysfs_get_classdev_parent",
+	"sysfs_get_classdev_uevent",
 	"sysfs_close_class",
 	"sysfs_open_class",
 	"sysfs_get_class_devices",
 	"sysfs_get_class_device",
 	"sysfs_get_classdev_attributes",
+	"sysfs_get_classdev_attrs",
 	"sysfs_get_classdev_attr",
 	"sysfs_close_module",
 	"sysfs_open_module_path",
 	"sysfs_open_module",
 	"sysfs_get_module_attr",
 	"sysfs_get_module_attributes",
+	"sysfs_get_module_attrs",
 	"sysfs_get_module_parms",
 	"sysfs_get_module_sections",
 	"sysfs_get_module_parm",
 	"sysfs_get_module_section",
+	"sysfs_close_iter",
+	"sysfs_open_bus_device_iter",
+	"sysfs_bus_device_iter_next",
+	"sysfs_open_bus_driver_iter",
+	"sysfs_bus_driver_iter_next",
+	"sysfs_open_class_device_iter",
+	"sysfs_class_device_iter_next",
+	"sysfs_iter_add_match",
+	"sysfs_walk",
+	"sysfs_walk_node_attr",
+	"sysfs_walk_node_device",
+	"sysfs_ref_bus",
+	"sysfs_ref_class",
+	"sysfs_ref_device",
+	"sysfs_ref_class_device",
+	"sysfs_ref_driver",
+	"sysfs_ref_module",
+	"sysfs_thread_quiescent",
+	"sysfs_refresh_bus",
+	"sysfs_refresh_class",
+	"sysfs_refresh_class_device",
+	"sysfs_refresh_device",
+	"sysfs_refresh_driver",
+	"sysfs_close_index",
+	"sysfs_open_index",
+	"sysfs_index_get_device_classdevs",
+	"sysfs_index_get_devnum_classdev",
+	"sysfs_index_get_driver_module",
+	"sysfs_open_monitor",
+	"sysfs_open_monitor_fd",
+	"sysfs_close_monitor",
+	"sysfs_monitor_get_fd",
+	"sysfs_monitor_watch_bus",
+	"sysfs_monitor_watch_class",
+	"sysfs_monitor_receive",
+	"sysfs_open_snapshot",
+	"sysfs_close_snapshot",
+	"sysfs_publish_snapshot",
+	"sysfs_attach_snapshot",
+	"sysfs_detach_snapshot",
+	"sysfs_write_cache",
+	"sysfs_attach_cache",
 };
 
 int (*func_table[])(int) = {
@@ -101,19 +162,33 @@ int (*func_table[])(int) = {
 	test_sysfs_close_attribute,
 	test_sysfs_open_attribute,
 	test_sysfs_read_attribute,
+	test_sysfs_read_attribute_fd,
+	test_sysfs_read_attribute_at,
 	test_sysfs_write_attribute,
+	test_sysfs_get_list_attrs,
+	test_sysfs_get_attribute_class,
+	test_sysfs_set_attribute_class,
+	test_sysfs_get_generation,
 	test_sysfs_close_driver,
 	test_sysfs_open_driver,
 	test_sysfs_open_driver_path,
 	test_sysfs_get_driver_attr,
 	test_sysfs_get_driver_attributes,
+	test_sysfs_get_driver_attrs,
 	test_sysfs_get_driver_devices,
 	test_sysfs_close_device,
 	test_sysfs_open_device,
 	test_sysfs_get_device_parent,
 	test_sysfs_open_device_path,
+	test_sysfs_open_device_path_flags,
+	test_sysfs_get_device_bus_name,
+	test_sysfs_get_device_driver_name,
+	test_sysfs_get_device_subsystem,
+	test_sysfs_get_device_uevent,
+	test_sysfs_uevent_find,
 	test_sysfs_get_device_attr,
 	test_sysfs_get_device_attributes,
+	test_sysfs_get_device_attrs,
 	test_sysfs_close_bus,
 	test_sysfs_open_bus,
 	test_sysfs_get_bus_device,
@@ -123,23 +198,70 @@ int (*func_table[])(int) = {
 	test_sysfs_close_class_device,
 	test_sysfs_open_class_device_path,
 	test_sysfs_open_class_device,
+	test_sysfs_open_class_device_devnum,
+	test_sysfs_open_class_devices_devnum,
 	test_sysfs_get_classdev_device,
 	test_sysfs_get_classdev_parent,
+	test_sysfs_get_classdev_uevent,
 	test_sysfs_close_class,
 	test_sysfs_open_class,
 	test_sysfs_get_class_devices,
 	test_sysfs_get_class_device,
 	test_sysfs_get_classdev_attributes,
+	test_sysfs_get_classdev_attrs,
 	test_sysfs_get_classdev_attr,
 	test_sysfs_close_module,
 	test_sysfs_open_module_path,
 	test_sysfs_open_module,
 	test_sysfs_get_module_attr,
 	test_sysfs_get_module_attributes,
+	test_sysfs_get_module_attrs,
 	test_sysfs_get_module_parms,
 	test_sysfs_get_module_sections,
 	test_sysfs_get_module_parm,
 	test_sysfs_get_module_section,
+	test_sysfs_close_iter,
+	test_sysfs_open_bus_device_iter,
+	test_sysfs_bus_device_iter_next,
+	test_sysfs_open_bus_driver_iter,
+	test_sysfs_bus_driver_iter_next,
+	test_sysfs_open_class_device_iter,
+	test_sysfs_class_device_iter_next,
+	test_sysfs_iter_add_match,
+	test_sysfs_walk,
+	test_sysfs_walk_node_attr,
+	test_sysfs_walk_node_device,
+	test_sysfs_ref_bus,
+	test_sysfs_ref_class,
+	test_sysfs_ref_device,
+	test_sysfs_ref_class_device,
+	test_sysfs_ref_driver,
+	test_sysfs_ref_module,
+	test_sysfs_thread_quiescent,
+	test_sysfs_refresh_bus,
+	test_sysfs_refresh_class,
+	test_sysfs_refresh_class_device,
+	test_sysfs_refresh_device,
+	test_sysfs_refresh_driver,
+	test_sysfs_close_index,
+	test_sysfs_open_index,
+	test_sysfs_index_get_device_classdevs,
+	test_sysfs_index_get_devnum_classdev,
+	test_sysfs_index_get_driver_module,
+	test_sysfs_open_monitor,
+	test_sysfs_open_monitor_fd,
+	test_sysfs_close_monitor,
+	test_sysfs_monitor_get_fd,
+	test_sysfs_monitor_watch_bus,
+	test_sysfs_monitor_watch_class,
+	test_sysfs_monitor_receive,
+	test_sysfs_open_snapshot,
+	test_sysfs_close_snapshot,
+	test_sysfs_publish_snapshot,
+	test_sysfs_attach_snapshot,
+	test_sysfs_detach_snapshot,
+	test_sysfs_write_cache,
+	test_sysfs_attach_cache,
 };
 
 char *dir_paths[] = {
@@ -28,8 +28,19 @@
  * extern struct sysfs_attribute *sysfs_open_attribute
  * 					(const char *path);
  * extern int sysfs_read_attribute(struct sysfs_attribute *sysattr);
+ * extern int sysfs_read_attribute_fd(struct sysfs_attribute *sysattr,
+ * 		int fd);
+ * extern ssize_t sysfs_read_attribute_at(struct sysfs_attribute *sysattr,
+ * 		void *buf, size_t len, off_t offset);
  * extern int sysfs_write_attribute(struct sysfs_attribute *sysattr,
  * 		const char *new_value, size_t len);
+ * extern int sysfs_get_list_attrs(struct dlist *list,
+ * 		const char * const *names);
+ * extern enum sysfs_attribute_class sysfs_get_attribute_class
+ * 					(const char *name);
+ * extern int sysfs_set_attribute_class(const char *pattern,
+ * 		enum sysfs_attribute_class attr_class);
+ * extern unsigned int sysfs_get_generation(void);
  ****************************************************************************
  */
 
@@ -194,6 +205,165 @@ int test_sysfs_read_attribute(int flag)
 	return 0;
 }
 
+/**
+ * extern int sysfs_read_attribute_fd(struct sysfs_attribute *sysattr,
+ * 		int fd);
+ *
+ * flag:
+ * 	0:	sysattr -> valid, fd -> valid, read twice
+ * 	1:	sysattr -> valid, fd -> -1
+ * 	2:	sysattr -> NULL, fd -> valid
+ */
+int test_sysfs_read_attribute_fd(int flag)
+{
+	struct sysfs_attribute *sysattr = NULL;
+	int fd, ret = 0;
+
+	fd = open(val_file_path, O_RDONLY);
+	if (fd < 0) {
+		dbg_print("%s: failed opening %s\n",
+				__FUNCTION__, val_file_path);
+		return 0;
+	}
+	switch (flag) {
+	case 0:
+	case 1:
+		sysattr = sysfs_open_attribute(val_file_path);
+		if (sysattr == NULL) {
+			dbg_print("%s: failed opening attribute at %s\n",
+					__FUNCTION__, val_file_path);
+			close(fd);
+			return 0;
+		}
+		break;
+	case 2:
+		sysattr = NULL;
+		break;
+	default:
+		close(fd);
+		return -1;
+	}
+
+	switch (flag) {
+	case 0:
+		/* the descriptor is to be good for more than one read */
+		ret = sysfs_read_attribute_fd(sysattr, fd);
+		if (ret == 0)
+			ret = sysfs_read_attribute_fd(sysattr, fd);
+		if (ret != 0 || sysattr->len == 0)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else {
+			dbg_print("%s: SUCCEEDED with flag = %d\n\n",
+						__FUNCTION__, flag);
+			show_attribute(sysattr);
+			dbg_print("\n");
+		}
+		break;
+	case 1:
+	case 2:
+		ret = sysfs_read_attribute_fd(sysattr, flag == 1 ? -1 : fd);
+		if (ret == 0)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+						__FUNCTION__, flag);
+		break;
+	default:
+		break;
+	}
+
+	if (sysattr != NULL)
+		sysfs_close_attribute(sysattr);
+	close(fd);
+
+	return 0;
+}
+
+/**
+ * extern ssize_t sysfs_read_attribute_at(struct sysfs_attribute *sysattr,
+ * 		void *buf, size_t len, off_t offset);
+ *
+ * flag:
+ * 	0:	sysattr -> valid, buf -> valid, offset -> 1
+ * 	1:	sysattr -> valid, buf -> valid, offset -> past the end
+ * 	2:	sysattr -> valid, buf -> NULL
+ * 	3:	sysattr -> NULL, buf -> valid
+ */
+int test_sysfs_read_attribute_at(int flag)
+{
+	struct sysfs_attribute *sysattr = NULL;
+	char buf[4];
+	ssize_t ret = 0;
+	size_t want;
+
+	switch (flag) {
+	case 0:
+	case 1:
+	case 2:
+		sysattr = sysfs_open_attribute(val_file_path);
+		if (sysattr == NULL || sysfs_read_attribute(sysattr) != 0) {
+			dbg_print("%s: failed reading attribute at %s\n",
+					__FUNCTION__, val_file_path);
+			if (sysattr)
+				sysfs_close_attribute(sysattr);
+			return 0;
+		}
+		break;
+	case 3:
+		sysattr = NULL;
+		break;
+	default:
+		return -1;
+	}
+
+	switch (flag) {
+	case 0:
+		/* the same bytes as the whole value holds there */
+		want = sysattr->len > 1 ? sysattr->len - 1 : 0;
+		if (want > sizeof(buf))
+			want = sizeof(buf);
+		ret = sysfs_read_attribute_at(sysattr, buf, sizeof(buf), 1);
+		if (ret != (ssize_t)want ||
+				memcmp(buf, sysattr->value + 1, want))
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+						__FUNCTION__, flag);
+		break;
+	case 1:
+		ret = sysfs_read_attribute_at(sysattr, buf, sizeof(buf),
+				sysattr->len + 4096);
+		if (ret != 0)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+						__FUNCTION__, flag);
+		break;
+	case 2:
+	case 3:
+		ret = sysfs_read_attribute_at(sysattr, flag == 2 ? NULL : buf,
+				sizeof(buf), 0);
+		if (ret != -1)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+						__FUNCTION__, flag);
+		break;
+	default:
+		break;
+	}
+
+	if (sysattr != NULL)
+		sysfs_close_attribute(sysattr);
+
+	return 0;
+}
+
 /**
  * extern int sysfs_write_attribute(struct sysfs_attribute *sysattr,
  * 			const char *new_value, size_t len);
@@ -318,3 +488,233 @@ int test_sysfs_write_attribute(int flag)
 
 	return 0;
 }
+
+/**
+ * extern int sysfs_get_list_attrs(struct dlist *list,
+ * 		const char * const *names);
+ *
+ * flag:
+ * 	0:	list -> valid, names -> valid
+ * 	1:	list -> valid, names -> NULL
+ * 	2:	list -> NULL, names -> valid
+ */
+int test_sysfs_get_list_attrs(int flag)
+{
+	struct sysfs_bus *bus = NULL;
+	struct sysfs_device *dev = NULL;
+	struct sysfs_attribute *attr = NULL;
+	struct dlist *list = NULL;
+	const char *valid[] = { val_dev_attr, NULL };
+	const char * const *names = NULL;
+	int ret, found = 0;
+
+	switch (flag) {
+	case 0:
+	case 1:
+		bus = sysfs_open_bus(val_bus_name);
+		if (bus == NULL) {
+			dbg_print("%s: failed opening bus %s\n",
+					__FUNCTION__, val_bus_name);
+			return 0;
+		}
+		list = sysfs_get_bus_devices(bus);
+		if (list == NULL) {
+			dbg_print("%s: failed getting devices on bus %s\n",
+					__FUNCTION__, val_bus_name);
+			sysfs_close_bus(bus);
+			return 0;
+		}
+		if (flag == 0)
+			names = valid;
+		break;
+	case 2:
+		names = valid;
+		break;
+	default:
+		return -1;
+	}
+	errno = 0;
+	ret = sysfs_get_list_attrs(list, names);
+
+	switch (flag) {
+	case 0:
+		dlist_for_each_data(list, dev, struct sysfs_device) {
+			if (strcmp(dev->bus_id, val_bus_id) != 0)
+				continue;
+			if (dev->attrlist && dev->attrlist->count == 1) {
+				dlist_start(dev->attrlist);
+				attr = (struct sysfs_attribute *)
+					dlist_next(dev->attrlist);
+				if (strcmp(attr->name, val_dev_attr) == 0)
+					found = 1;
+			}
+		}
+		if (ret != 0 || !found)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+					__FUNCTION__, flag, errno);
+		else {
+			dbg_print("%s: SUCCEEDED with flag = %d\n\n",
+					__FUNCTION__, flag);
+			show_attribute(attr);
+			dbg_print("\n");
+		}
+		break;
+	case 1:
+	case 2:
+		if (ret != -1 || errno != EINVAL)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+					__FUNCTION__, flag, errno);
+		else
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+					__FUNCTION__, flag);
+		break;
+	default:
+		break;
+	}
+	if (bus != NULL)
+		sysfs_close_bus(bus);
+	return 0;
+}
+
+/**
+ * extern enum sysfs_attribute_class sysfs_get_attribute_class
+ * 					(const char *name);
+ *
+ * flag:
+ * 	0:	name -> static attribute
+ * 	1:	name -> counter
+ * 	2:	name -> config attribute matching a counter pattern
+ * 	3:	name -> NULL
+ */
+int test_sysfs_get_attribute_class(int flag)
+{
+	enum sysfs_attribute_class expected, ret;
+	const char *name = NULL;
+
+	switch (flag) {
+	case 0:
+		name = "vendor";
+		expected = SYSFS_ATTR_STATIC;
+		break;
+	case 1:
+		name = "rx_bytes";
+		expected = SYSFS_ATTR_COUNTER;
+		break;
+	case 2:
+		name = "tx_queue_len";
+		expected = SYSFS_ATTR_CONFIG;
+		break;
+	case 3:
+		name = NULL;
+		expected = SYSFS_ATTR_CONFIG;
+		break;
+	default:
+		return -1;
+	}
+	ret = sysfs_get_attribute_class(name);
+
+	if (ret != expected)
+		dbg_print("%s: FAILED with flag = %d class = %d\n",
+				__FUNCTION__, flag, ret);
+	else
+		dbg_print("%s: SUCCEEDED with flag = %d\n",
+				__FUNCTION__, flag);
+	return 0;
+}
+
+/**
+ * extern int sysfs_set_attribute_class(const char *pattern,
+ * 		enum sysfs_attribute_class attr_class);
+ *
+ * flag:
+ * 	0:	pattern -> valid, attr_class -> valid
+ * 	1:	pattern -> NULL, attr_class -> valid
+ * 	2:	pattern -> more than one '*', attr_class -> valid
+ * 	3:	pattern -> valid, attr_class -> invalid
+ */
+int test_sysfs_set_attribute_class(int flag)
+{
+	enum sysfs_attribute_class attr_class = SYSFS_ATTR_STATIC;
+	const char *pattern = NULL;
+	int ret;
+
+	switch (flag) {
+	case 0:
+		pattern = "testsuite_*";
+		break;
+	case 1:
+		pattern = NULL;
+		break;
+	case 2:
+		pattern = "test*suite*";
+		break;
+	case 3:
+		pattern = "testsuite_*";
+		attr_class = (enum sysfs_attribute_class)7;
+		break;
+	default:
+		return -1;
+	}
+	errno = 0;
+	ret = sysfs_set_attribute_class(pattern, attr_class);
+
+	switch (flag) {
+	case 0:
+		if (ret != 0 || sysfs_get_attribute_class("testsuite_attr") !=
+							SYSFS_ATTR_STATIC)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+					__FUNCTION__, flag, errno);
+		else
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+					__FUNCTION__, flag);
+		break;
+	case 1:
+	case 2:
+	case 3:
+		if (ret != -1 || errno != EINVAL)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+					__FUNCTION__, flag, errno);
+		else
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+					__FUNCTION__, flag);
+		break;
+	default:
+		break;
+	}
+	return 0;
+}
+
+/**
+ * extern unsigned int sysfs_get_generation(void);
+ *
+ * flag:
+ * 	0:	an attribute read is to record the current generation
+ */
+int test_sysfs_get_generation(int flag)
+{
+	struct sysfs_attribute *attr = NULL;
+	unsigned int gen;
+
+	switch (flag) {
+	case 0:
+		attr = sysfs_open_attribute(val_file_path);
+		if (attr == NULL) {
+			dbg_print("%s: failed opening attribute at %s\n",
+					__FUNCTION__, val_file_path);
+			return 0;
+		}
+		break;
+	default:
+		return -1;
+	}
+	gen = sysfs_get_generation();
+
+	if (sysfs_read_attribute(attr) != 0 || attr->generation != gen)
+		dbg_print("%s: FAILED with flag = %d errno = %d\n",
+				__FUNCTION__, flag, errno);
+	else
+		dbg_print("%s: SUCCEEDED with flag = %d\n",
+				__FUNCTION__, flag);
+	sysfs_close_attribute(attr);
+	return 0;
+}
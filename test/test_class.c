@@ -29,10 +29,17 @@
  * 					(const char *path);
  * extern struct sysfs_class_device *sysfs_open_class_device
  * 	(const char *classname, const char *name);
+ * extern struct sysfs_class_device *sysfs_open_class_device_devnum(int type,
+ * 		unsigned int major, unsigned int minor);
+ * extern int sysfs_open_class_devices_devnum
+ * 	(const struct sysfs_devnum *devnums,
+ * 	 struct sysfs_class_device **clsdevs, int count);
  * extern struct sysfs_device *sysfs_get_classdev_device
  * 				(struct sysfs_class_device *clsdev);
  * extern struct sysfs_class_device *sysfs_get_classdev_parent
  *				(struct sysfs_class_device *clsdev);
+ * extern struct sysfs_uevent *sysfs_get_classdev_uevent
+ * 				(struct sysfs_class_device *clsdev);
  * extern void sysfs_close_class(struct sysfs_class *cls);
  * extern struct sysfs_class *sysfs_open_class(const char *name);
  * extern struct dlist *sysfs_get_class_devices(struct sysfs_class *cls);
@@ -40,6 +47,8 @@
  * 			(struct sysfs_class *cls, char *name);
  * extern struct dlist *sysfs_get_classdev_attributes
  * 				(struct sysfs_class_device *cdev);
+ * extern struct dlist *sysfs_get_classdev_attrs
+ * 		(struct sysfs_class_device *clsdev, const char * const *names);
  * extern struct sysfs_attribute *sysfs_get_classdev_attr
  * 	(struct sysfs_class_device *clsdev, const char *name);
  *****************************************************************************
@@ -49,6 +58,7 @@
 
 #include "test-defs.h"
 #include <errno.h>
+#include <sys/sysmacros.h>
 
 /**
  * this test the function:
@@ -243,6 +253,152 @@ int test_sysfs_open_class_device(int flag)
 	return 0;
 }
 
+/**
+ * extern struct sysfs_class_device *sysfs_open_class_device_devnum(int type,
+ * 		unsigned int major, unsigned int minor);
+ *
+ * flag:
+ * 	0:	type -> char, devnum -> /dev/null's
+ * 	1:	type -> invalid, devnum -> /dev/null's
+ * 	2:	type -> char, devnum -> not present
+ */
+int test_sysfs_open_class_device_devnum(int flag)
+{
+	struct sysfs_class_device *clsdev = NULL;
+	struct stat astats;
+	unsigned int major = 0, minor = 0;
+	int type = SYSFS_DEVNUM_CHAR;
+
+	if (stat("/dev/null", &astats) != 0) {
+		dbg_print("%s: failed stat on /dev/null\n", __FUNCTION__);
+		return 0;
+	}
+
+	switch (flag) {
+	case 0:
+		major = major(astats.st_rdev);
+		minor = minor(astats.st_rdev);
+		break;
+	case 1:
+		type = 0;
+		major = major(astats.st_rdev);
+		minor = minor(astats.st_rdev);
+		break;
+	case 2:
+		major = 4095;
+		minor = 1048575;
+		break;
+	default:
+		return -1;
+	}
+	clsdev = sysfs_open_class_device_devnum(type, major, minor);
+
+	switch (flag) {
+	case 0:
+		if (clsdev == NULL || strcmp(clsdev->name, "null") != 0)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else {
+			dbg_print("%s: SUCCEEDED with flag = %d\n\n",
+						__FUNCTION__, flag);
+			show_class_device(clsdev);
+			dbg_print("\n");
+		}
+		break;
+	case 1:
+	case 2:
+		if (clsdev == NULL)
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+						__FUNCTION__, flag);
+		else
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		break;
+	default:
+		break;
+	}
+	if (clsdev != NULL)
+		sysfs_close_class_device(clsdev);
+
+	return 0;
+}
+
+/**
+ * extern int sysfs_open_class_devices_devnum
+ * 	(const struct sysfs_devnum *devnums,
+ * 	 struct sysfs_class_device **clsdevs, int count);
+ *
+ * flag:
+ * 	0:	devnums -> /dev/null's and one not present
+ * 	1:	devnums -> NULL
+ * 	2:	devnums -> /dev/null's and /dev/null's with an invalid type
+ */
+int test_sysfs_open_class_devices_devnum(int flag)
+{
+	struct sysfs_devnum devnums[2];
+	struct sysfs_class_device *clsdevs[2] = { NULL, NULL };
+	struct stat astats;
+	int ret, i;
+
+	if (stat("/dev/null", &astats) != 0) {
+		dbg_print("%s: failed stat on /dev/null\n", __FUNCTION__);
+		return 0;
+	}
+	devnums[0].type = SYSFS_DEVNUM_CHAR;
+	devnums[0].major = major(astats.st_rdev);
+	devnums[0].minor = minor(astats.st_rdev);
+	devnums[1].type = SYSFS_DEVNUM_BLOCK;
+	devnums[1].major = 4095;
+	devnums[1].minor = 1048575;
+
+	switch (flag) {
+	case 0:
+		ret = sysfs_open_class_devices_devnum(devnums, clsdevs, 2);
+		break;
+	case 1:
+		ret = sysfs_open_class_devices_devnum(NULL, clsdevs, 2);
+		break;
+	case 2:
+		devnums[1] = devnums[0];
+		devnums[1].type = SYSFS_DEVNUM_CHAR + 1;
+		ret = sysfs_open_class_devices_devnum(devnums, clsdevs, 2);
+		break;
+	default:
+		return -1;
+	}
+
+	switch (flag) {
+	case 0:
+	case 2:
+		if (ret != 1 || clsdevs[0] == NULL || clsdevs[1] != NULL)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else {
+			dbg_print("%s: SUCCEEDED with flag = %d\n\n",
+						__FUNCTION__, flag);
+			show_class_device(clsdevs[0]);
+			dbg_print("\n");
+		}
+		break;
+	case 1:
+		if (ret == -1)
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+						__FUNCTION__, flag);
+		else
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		break;
+	default:
+		break;
+	}
+	for (i = 0; i < 2; i++) {
+		if (clsdevs[i] != NULL)
+			sysfs_close_class_device(clsdevs[i]);
+	}
+
+	return 0;
+}
+
 /**
  * extern struct sysfs_device *sysfs_get_classdev_device
  * 				(struct sysfs_class_device *clsdev);
@@ -372,6 +528,68 @@ int test_sysfs_get_classdev_parent(int flag)
 	return 0;
 }
 
+/**
+ * extern struct sysfs_uevent *sysfs_get_classdev_uevent
+ * 				(struct sysfs_class_device *clsdev);
+ *
+ * flag:
+ * 	0:	clsdev -> valid, asked twice
+ * 	1:	clsdev -> NULL
+ */
+int test_sysfs_get_classdev_uevent(int flag)
+{
+	struct sysfs_class_device *clsdev = NULL;
+	struct sysfs_uevent *uevent = NULL;
+	int i;
+
+	switch (flag) {
+	case 0:
+		clsdev = sysfs_open_class_device_path(val_class_dev_path);
+		if (clsdev == NULL) {
+			dbg_print("%s: failed opening class device at %s\n",
+					__FUNCTION__, val_class_dev_path);
+			return 0;
+		}
+		break;
+	case 1:
+		clsdev = NULL;
+		break;
+	default:
+		return -1;
+	}
+	uevent = sysfs_get_classdev_uevent(clsdev);
+
+	switch (flag) {
+	case 0:
+		if (uevent == NULL || uevent->count == 0 ||
+				sysfs_get_classdev_uevent(clsdev) != uevent)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else {
+			dbg_print("%s: SUCCEEDED with flag = %d\n\n",
+						__FUNCTION__, flag);
+			for (i = 0; i < uevent->count; i++)
+				dbg_print("%s=%s\n", uevent->vars[i].key,
+						uevent->vars[i].value);
+			dbg_print("\n");
+		}
+		break;
+	case 1:
+		if (uevent == NULL)
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+						__FUNCTION__, flag);
+		else
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		break;
+	default:
+		break;
+	}
+	if (clsdev != NULL)
+		sysfs_close_class_device(clsdev);
+	return 0;
+}
+
 /**
  * extern void sysfs_close_class(struct sysfs_class *cls);
  *
@@ -690,6 +908,93 @@ int test_sysfs_get_classdev_attributes(int flag)
 	return 0;
 }
 
+/**
+ * extern struct dlist *sysfs_get_classdev_attrs
+ * 		(struct sysfs_class_device *clsdev, const char * const *names);
+ *
+ * flag:
+ * 	0:	clsdev -> valid, names -> valid
+ * 	1:	clsdev -> valid, names -> invalid
+ * 	2:	clsdev -> valid, names -> NULL
+ * 	3:	clsdev -> NULL, names -> valid
+ */
+int test_sysfs_get_classdev_attrs(int flag)
+{
+	struct sysfs_class_device *clsdev = NULL;
+	struct sysfs_attribute *attr = NULL;
+	struct dlist *list = NULL;
+	const char *valid[] = { val_class_dev_attr, NULL };
+	const char *invalid[] = { inval_name, NULL };
+	const char * const *names = NULL;
+
+	switch (flag) {
+	case 0:
+	case 1:
+	case 2:
+		clsdev = sysfs_open_class_device_path(val_class_dev_path);
+		if (clsdev == NULL) {
+			dbg_print("%s: failed opening class device at %s\n",
+					__FUNCTION__, val_class_dev_path);
+			return 0;
+		}
+		if (flag == 0)
+			names = valid;
+		else if (flag == 1)
+			names = invalid;
+		break;
+	case 3:
+		names = valid;
+		break;
+	default:
+		return -1;
+	}
+	errno = 0;
+	list = sysfs_get_classdev_attrs(clsdev, names);
+
+	switch (flag) {
+	case 0:
+		if (list == NULL || list->count != 1) {
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+					__FUNCTION__, flag, errno);
+			break;
+		}
+		dlist_start(list);
+		attr = (struct sysfs_attribute *)dlist_next(list);
+		if (strcmp(attr->name, val_class_dev_attr) != 0) {
+			dbg_print("%s: FAILED with flag = %d, got %s\n",
+					__FUNCTION__, flag, attr->name);
+			break;
+		}
+		dbg_print("%s: SUCCEEDED with flag = %d\n\n",
+					__FUNCTION__, flag);
+		show_attribute_list(list);
+		dbg_print("\n");
+		break;
+	case 1:
+		if (list != NULL)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+					__FUNCTION__, flag, errno);
+		else
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+					__FUNCTION__, flag);
+		break;
+	case 2:
+	case 3:
+		if (list != NULL || errno != EINVAL)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+					__FUNCTION__, flag, errno);
+		else
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+					__FUNCTION__, flag);
+		break;
+	default:
+		break;
+	}
+	if (clsdev != NULL)
+		sysfs_close_class_device(clsdev);
+	return 0;
+}
+
 /**
  * extern struct sysfs_attribute *sysfs_get_classdev_attr
  * 	(struct sysfs_class_device *clsdev, const char *name);
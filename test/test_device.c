@@ -31,10 +31,21 @@
  * 					(struct sysfs_device *dev);
  * extern struct sysfs_device *sysfs_open_device_path
  * 					(const char *path);
+ * extern struct sysfs_device *sysfs_open_device_path_flags
+ * 			(const char *path, unsigned int flags);
+ * extern const char *sysfs_get_device_bus_name(struct sysfs_device *dev);
+ * extern const char *sysfs_get_device_driver_name
+ * 					(struct sysfs_device *dev);
+ * extern const char *sysfs_get_device_subsystem(struct sysfs_device *dev);
+ * extern struct sysfs_uevent *sysfs_get_device_uevent(struct sysfs_device *dev);
+ * extern const struct sysfs_uevent_var *sysfs_uevent_find
+ * 		(const struct sysfs_uevent *uevent, const char *key);
  * extern struct sysfs_attribute *sysfs_get_device_attr
  * 			(struct sysfs_device *dev, const char *name);
  * extern struct dlist *sysfs_get_device_attributes
  * 					(struct sysfs_device *device);
+ * extern struct dlist *sysfs_get_device_attrs
+ * 		(struct sysfs_device *dev, const char * const *names);
  ******************************************************************************
  */
 
@@ -296,6 +307,388 @@ int test_sysfs_open_device_path(int flag)
 	return 0;
 }
 
+/**
+ * extern struct sysfs_device *sysfs_open_device_path_flags
+ * 			(const char *path, unsigned int flags);
+ *
+ * flag:
+ * 	0:	path -> valid, flags -> 0
+ * 	1:	path -> valid, flags -> SYSFS_OPEN_ALL
+ * 	2:	path -> invalid, flags -> SYSFS_OPEN_ALL
+ * 	3:	path -> NULL, flags -> 0
+ */
+int test_sysfs_open_device_path_flags(int flag)
+{
+	struct sysfs_device *dev = NULL;
+	char *path = NULL;
+	unsigned int flags = 0;
+
+	switch (flag) {
+	case 0:
+		path = val_dev_path;
+		flags = 0;
+		break;
+	case 1:
+		path = val_dev_path;
+		flags = SYSFS_OPEN_ALL;
+		break;
+	case 2:
+		path = inval_path;
+		flags = SYSFS_OPEN_ALL;
+		break;
+	case 3:
+		path = NULL;
+		flags = 0;
+		break;
+	default:
+		return -1;
+	}
+	dev = sysfs_open_device_path_flags(path, flags);
+
+	switch (flag) {
+	case 0:
+		if (dev == NULL || dev->driver_name[0] != '\0' ||
+				dev->subsystem[0] != '\0')
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+						__FUNCTION__, flag);
+		break;
+	case 1:
+		if (dev == NULL || dev->driver_name[0] == '\0' ||
+				dev->subsystem[0] == '\0')
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else {
+			dbg_print("%s: SUCCEEDED with flag = %d\n\n",
+						__FUNCTION__, flag);
+			show_device(dev);
+			dbg_print("\n");
+		}
+		break;
+	case 2:
+	case 3:
+		if (dev == NULL)
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+						__FUNCTION__, flag);
+		else
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+	default:
+		break;
+	}
+	if (dev != NULL)
+		sysfs_close_device(dev);
+	return 0;
+}
+
+/**
+ * extern const char *sysfs_get_device_bus_name(struct sysfs_device *dev);
+ *
+ * flag:
+ * 	0:	dev -> valid, opened without resolving the bus
+ * 	1:	dev -> NULL
+ */
+int test_sysfs_get_device_bus_name(int flag)
+{
+	struct sysfs_device *dev = NULL, *full = NULL;
+	const char *name = NULL;
+
+	switch (flag) {
+	case 0:
+		dev = sysfs_open_device_path_flags(val_dev_path, 0);
+		full = sysfs_open_device_path(val_dev_path);
+		if (dev == NULL || full == NULL) {
+			dbg_print("%s: failed opening device at %s\n",
+						__FUNCTION__, val_dev_path);
+			goto out;
+		}
+		break;
+	case 1:
+		dev = NULL;
+		break;
+	default:
+		return -1;
+	}
+	name = sysfs_get_device_bus_name(dev);
+
+	switch (flag) {
+	case 0:
+		if (name == NULL || strcmp(name, full->bus) != 0)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else {
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+						__FUNCTION__, flag);
+			dbg_print("bus is %s\n", name);
+		}
+		break;
+	case 1:
+		if (name == NULL)
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+						__FUNCTION__, flag);
+		else
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		break;
+	default:
+		break;
+	}
+out:
+	if (dev != NULL)
+		sysfs_close_device(dev);
+	if (full != NULL)
+		sysfs_close_device(full);
+	return 0;
+}
+
+/**
+ * extern const char *sysfs_get_device_driver_name(struct sysfs_device *dev);
+ *
+ * flag:
+ * 	0:	dev -> valid, opened without resolving the driver
+ * 	1:	dev -> NULL
+ */
+int test_sysfs_get_device_driver_name(int flag)
+{
+	struct sysfs_device *dev = NULL, *full = NULL;
+	const char *name = NULL;
+
+	switch (flag) {
+	case 0:
+		dev = sysfs_open_device_path_flags(val_dev_path, 0);
+		full = sysfs_open_device_path(val_dev_path);
+		if (dev == NULL || full == NULL) {
+			dbg_print("%s: failed opening device at %s\n",
+						__FUNCTION__, val_dev_path);
+			goto out;
+		}
+		break;
+	case 1:
+		dev = NULL;
+		break;
+	default:
+		return -1;
+	}
+	name = sysfs_get_device_driver_name(dev);
+
+	switch (flag) {
+	case 0:
+		if (name == NULL || strcmp(name, full->driver_name) != 0)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else {
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+						__FUNCTION__, flag);
+			dbg_print("driver is %s\n", name);
+		}
+		break;
+	case 1:
+		if (name == NULL)
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+						__FUNCTION__, flag);
+		else
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		break;
+	default:
+		break;
+	}
+out:
+	if (dev != NULL)
+		sysfs_close_device(dev);
+	if (full != NULL)
+		sysfs_close_device(full);
+	return 0;
+}
+
+/**
+ * extern const char *sysfs_get_device_subsystem(struct sysfs_device *dev);
+ *
+ * flag:
+ * 	0:	dev -> valid, opened without resolving the subsystem
+ * 	1:	dev -> NULL
+ */
+int test_sysfs_get_device_subsystem(int flag)
+{
+	struct sysfs_device *dev = NULL, *full = NULL;
+	const char *name = NULL;
+
+	switch (flag) {
+	case 0:
+		dev = sysfs_open_device_path_flags(val_dev_path, 0);
+		full = sysfs_open_device_path(val_dev_path);
+		if (dev == NULL || full == NULL) {
+			dbg_print("%s: failed opening device at %s\n",
+						__FUNCTION__, val_dev_path);
+			goto out;
+		}
+		break;
+	case 1:
+		dev = NULL;
+		break;
+	default:
+		return -1;
+	}
+	name = sysfs_get_device_subsystem(dev);
+
+	switch (flag) {
+	case 0:
+		if (name == NULL || strcmp(name, full->subsystem) != 0)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else {
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+						__FUNCTION__, flag);
+			dbg_print("subsystem is %s\n", name);
+		}
+		break;
+	case 1:
+		if (name == NULL)
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+						__FUNCTION__, flag);
+		else
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		break;
+	default:
+		break;
+	}
+out:
+	if (dev != NULL)
+		sysfs_close_device(dev);
+	if (full != NULL)
+		sysfs_close_device(full);
+	return 0;
+}
+
+/**
+ * extern struct sysfs_uevent *sysfs_get_device_uevent(struct sysfs_device *dev);
+ *
+ * flag:
+ * 	0:	dev -> valid, asked twice
+ * 	1:	dev -> NULL
+ */
+int test_sysfs_get_device_uevent(int flag)
+{
+	struct sysfs_device *dev = NULL;
+	struct sysfs_uevent *uevent = NULL;
+	int i;
+
+	switch (flag) {
+	case 0:
+		dev = sysfs_open_device_path(val_dev_path);
+		if (dev == NULL) {
+			dbg_print("%s: failed opening device at %s\n",
+						__FUNCTION__, val_dev_path);
+			return 0;
+		}
+		break;
+	case 1:
+		dev = NULL;
+		break;
+	default:
+		return -1;
+	}
+	uevent = sysfs_get_device_uevent(dev);
+
+	switch (flag) {
+	case 0:
+		if (uevent == NULL || uevent->count == 0 ||
+				sysfs_get_device_uevent(dev) != uevent)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else {
+			dbg_print("%s: SUCCEEDED with flag = %d\n\n",
+						__FUNCTION__, flag);
+			for (i = 0; i < uevent->count; i++)
+				dbg_print("%s=%s\n", uevent->vars[i].key,
+						uevent->vars[i].value);
+			dbg_print("\n");
+		}
+		break;
+	case 1:
+		if (uevent == NULL)
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+						__FUNCTION__, flag);
+		else
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		break;
+	default:
+		break;
+	}
+	if (dev != NULL)
+		sysfs_close_device(dev);
+	return 0;
+}
+
+/**
+ * extern const struct sysfs_uevent_var *sysfs_uevent_find
+ * 		(const struct sysfs_uevent *uevent, const char *key);
+ *
+ * flag:
+ * 	0:	uevent -> valid, key -> every key of the uevent
+ * 	1:	uevent -> valid, key -> invalid
+ * 	2:	uevent -> valid, key -> NULL
+ * 	3:	uevent -> NULL, key -> valid
+ */
+int test_sysfs_uevent_find(int flag)
+{
+	struct sysfs_device *dev = NULL;
+	struct sysfs_uevent *uevent = NULL;
+	const struct sysfs_uevent_var *var = NULL;
+	int i, found = 0;
+
+	dev = sysfs_open_device_path(val_dev_path);
+	if (dev)
+		uevent = sysfs_get_device_uevent(dev);
+	if (uevent == NULL || uevent->count == 0) {
+		dbg_print("%s: failed reading uevent of %s\n",
+					__FUNCTION__, val_dev_path);
+		sysfs_close_device(dev);
+		return 0;
+	}
+
+	switch (flag) {
+	case 0:
+		for (i = 0; i < uevent->count; i++) {
+			var = sysfs_uevent_find(uevent, uevent->vars[i].key);
+			if (var == &uevent->vars[i])
+				found++;
+		}
+		if (found != uevent->count)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+						__FUNCTION__, flag);
+		break;
+	case 1:
+	case 2:
+	case 3:
+		if (flag == 1)
+			var = sysfs_uevent_find(uevent, inval_name);
+		else if (flag == 2)
+			var = sysfs_uevent_find(uevent, NULL);
+		else
+			var = sysfs_uevent_find(NULL, uevent->vars[0].key);
+		if (var == NULL)
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+						__FUNCTION__, flag);
+		else
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		break;
+	default:
+		sysfs_close_device(dev);
+		return -1;
+	}
+	sysfs_close_device(dev);
+	return 0;
+}
+
 /**
  * extern struct sysfs_attribute *sysfs_get_device_attr
  * 		(struct sysfs_device *dev, const char *name);
@@ -307,6 +700,7 @@ int test_sysfs_open_device_path(int flag)
  * 	3:	dev -> NULL, name -> valid
  * 	4:	dev -> NULL, name -> invalid
  * 	5:	dev -> NULL, name -> NULL
+ * 	6:	dev -> valid, name -> invalid twice, then valid
  */
 int test_sysfs_get_device_attr(int flag)
 {
@@ -346,6 +740,24 @@ int test_sysfs_get_device_attr(int flag)
 		dev = NULL;
 		name = NULL;
 		break;
+	case 6:
+		path = val_dev_path;
+		dev = sysfs_open_device_path(path);
+		if (dev == NULL) {
+			dbg_print("%s: failed to open device at %s\n",
+					__FUNCTION__, path);
+			return 0;
+		}
+		/* the second miss is answered from the directory listing */
+		if (sysfs_get_device_attr(dev, inval_name) != NULL ||
+				sysfs_get_device_attr(dev, inval_name) != NULL) {
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+			sysfs_close_device(dev);
+			return 0;
+		}
+		name = val_dev_attr;
+		break;
 	default:
 		return -1;
 	}
@@ -353,6 +765,7 @@ int test_sysfs_get_device_attr(int flag)
 
 	switch (flag) {
 	case 0:
+	case 6:
 		if (attr == NULL) {
 			if (errno == EACCES)
 				dbg_print("%s: attribute %s does not support READ\n",
@@ -460,3 +873,90 @@ int test_sysfs_get_device_attributes(int flag)
 		sysfs_close_device(device);
 	return 0;
 }
+
+/**
+ * extern struct dlist *sysfs_get_device_attrs
+ * 		(struct sysfs_device *dev, const char * const *names);
+ *
+ * flag:
+ * 	0:	dev -> valid, names -> valid
+ * 	1:	dev -> valid, names -> invalid
+ * 	2:	dev -> valid, names -> NULL
+ * 	3:	dev -> NULL, names -> valid
+ */
+int test_sysfs_get_device_attrs(int flag)
+{
+	struct sysfs_device *dev = NULL;
+	struct sysfs_attribute *attr = NULL;
+	struct dlist *list = NULL;
+	const char *valid[] = { val_dev_attr, NULL };
+	const char *invalid[] = { inval_name, NULL };
+	const char * const *names = NULL;
+
+	switch (flag) {
+	case 0:
+	case 1:
+	case 2:
+		dev = sysfs_open_device_path(val_dev_path);
+		if (dev == NULL) {
+			dbg_print("%s: failed opening device at %s\n",
+					__FUNCTION__, val_dev_path);
+			return 0;
+		}
+		if (flag == 0)
+			names = valid;
+		else if (flag == 1)
+			names = invalid;
+		break;
+	case 3:
+		names = valid;
+		break;
+	default:
+		return -1;
+	}
+	errno = 0;
+	list = sysfs_get_device_attrs(dev, names);
+
+	switch (flag) {
+	case 0:
+		if (list == NULL || list->count != 1) {
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+					__FUNCTION__, flag, errno);
+			break;
+		}
+		dlist_start(list);
+		attr = (struct sysfs_attribute *)dlist_next(list);
+		if (strcmp(attr->name, val_dev_attr) != 0) {
+			dbg_print("%s: FAILED with flag = %d, got %s\n",
+					__FUNCTION__, flag, attr->name);
+			break;
+		}
+		dbg_print("%s: SUCCEEDED with flag = %d\n\n",
+					__FUNCTION__, flag);
+		show_attribute_list(list);
+		dbg_print("\n");
+		break;
+	case 1:
+		if (list != NULL)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+					__FUNCTION__, flag, errno);
+		else
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+					__FUNCTION__, flag);
+		break;
+	case 2:
+	case 3:
+		if (list != NULL || errno != EINVAL)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+					__FUNCTION__, flag, errno);
+		else
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+					__FUNCTION__, flag);
+		break;
+	default:
+		break;
+	}
+	if (dev != NULL)
+		sysfs_close_device(dev);
+	return 0;
+}
@@ -33,6 +33,8 @@
  * 		(struct sysfs_driver *drv, const char *name);
  * extern struct dlist *sysfs_get_driver_attributes
  * 					(struct sysfs_driver *driver);
+ * extern struct dlist *sysfs_get_driver_attrs
+ * 		(struct sysfs_driver *drv, const char * const *names);
  * extern struct dlist *sysfs_get_driver_devices(struct sysfs_driver *driver);
  ******************************************************************************
  */
@@ -405,6 +407,93 @@ int test_sysfs_get_driver_attributes(int flag)
 	return 0;
 }
 
+/**
+ * extern struct dlist *sysfs_get_driver_attrs
+ * 		(struct sysfs_driver *drv, const char * const *names);
+ *
+ * flag:
+ * 	0:	drv -> valid, names -> valid
+ * 	1:	drv -> valid, names -> invalid
+ * 	2:	drv -> valid, names -> NULL
+ * 	3:	drv -> NULL, names -> valid
+ */
+int test_sysfs_get_driver_attrs(int flag)
+{
+	struct sysfs_driver *drv = NULL;
+	struct sysfs_attribute *attr = NULL;
+	struct dlist *list = NULL;
+	const char *valid[] = { val_drv_attr_name, NULL };
+	const char *invalid[] = { inval_name, NULL };
+	const char * const *names = NULL;
+
+	switch (flag) {
+	case 0:
+	case 1:
+	case 2:
+		drv = sysfs_open_driver_path(val_drv_path);
+		if (drv == NULL) {
+			dbg_print("%s: failed opening driver at %s\n",
+					__FUNCTION__, val_drv_path);
+			return 0;
+		}
+		if (flag == 0)
+			names = valid;
+		else if (flag == 1)
+			names = invalid;
+		break;
+	case 3:
+		names = valid;
+		break;
+	default:
+		return -1;
+	}
+	errno = 0;
+	list = sysfs_get_driver_attrs(drv, names);
+
+	switch (flag) {
+	case 0:
+		if (list == NULL || list->count != 1) {
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+					__FUNCTION__, flag, errno);
+			break;
+		}
+		dlist_start(list);
+		attr = (struct sysfs_attribute *)dlist_next(list);
+		if (strcmp(attr->name, val_drv_attr_name) != 0) {
+			dbg_print("%s: FAILED with flag = %d, got %s\n",
+					__FUNCTION__, flag, attr->name);
+			break;
+		}
+		dbg_print("%s: SUCCEEDED with flag = %d\n\n",
+					__FUNCTION__, flag);
+		show_attribute_list(list);
+		dbg_print("\n");
+		break;
+	case 1:
+		if (list != NULL)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+					__FUNCTION__, flag, errno);
+		else
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+					__FUNCTION__, flag);
+		break;
+	case 2:
+	case 3:
+		if (list != NULL || errno != EINVAL)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+					__FUNCTION__, flag, errno);
+		else
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+					__FUNCTION__, flag);
+		break;
+	default:
+		break;
+	}
+	if (drv != NULL)
+		sysfs_close_driver(drv);
+	return 0;
+}
+
 /**
  * extern struct dlist *sysfs_get_driver_devices(struct sysfs_driver *driver);
  *
@@ -0,0 +1,335 @@
+/*
+ * test_index.c
+ *
+ * Tests for the reverse indexes for the libsysfs testsuite
+ *
+ * Copyright (C) IBM Corp. 2004-2005
+ *
+ *      This program is free software; you can redistribute it and/or modify it
+ *      under the terms of the GNU General Public License as published by the
+ *      Free Software Foundation version 2 of the License.
+ *
+ *      This program is distributed in the hope that it will be useful, but
+ *      WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *      General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License along
+ *      with this program; if not, write to the Free Software Foundation, Inc.,
+ *      675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+/**
+ ******************************************************************************
+ * this will test the reverse index functions provided by libsysfs.
+ *
+ * extern void sysfs_close_index(struct sysfs_index *index);
+ * extern struct sysfs_index *sysfs_open_index(void);
+ * extern struct dlist *sysfs_index_get_device_classdevs
+ * 	(struct sysfs_index *index, const char *devpath, unsigned int flags);
+ * extern struct sysfs_class_device *sysfs_index_get_devnum_classdev
+ * 	(struct sysfs_index *index, int type, unsigned int major,
+ * 	 unsigned int minor);
+ * extern const char *sysfs_index_get_driver_module(struct sysfs_index *index,
+ * 		const char *bus, const char *driver);
+ ******************************************************************************
+ */
+
+#include "config.h"
+
+#include "test-defs.h"
+#include <errno.h>
+#include <sys/sysmacros.h>
+
+/**
+ * extern void sysfs_close_index(struct sysfs_index *index);
+ *
+ * flag:
+ * 	0:	index -> valid
+ * 	1:	index -> NULL
+ */
+int test_sysfs_close_index(int flag)
+{
+	struct sysfs_index *index = NULL;
+
+	switch (flag) {
+	case 0:
+		index = sysfs_open_index();
+		if (index == NULL) {
+			dbg_print("%s: sysfs_open_index() failed\n",
+							__FUNCTION__);
+			return 0;
+		}
+		break;
+	case 1:
+		index = NULL;
+		break;
+	default:
+		return -1;
+	}
+	sysfs_close_index(index);
+
+	dbg_print("%s: returns void\n", __FUNCTION__);
+	return 0;
+}
+
+/**
+ * extern struct sysfs_index *sysfs_open_index(void);
+ *
+ * flag:
+ * 	0:	no arguments
+ */
+int test_sysfs_open_index(int flag)
+{
+	struct sysfs_index *index = NULL;
+
+	switch (flag) {
+	case 0:
+		break;
+	default:
+		return -1;
+	}
+	index = sysfs_open_index();
+
+	if (index == NULL)
+		dbg_print("%s: FAILED with flag = %d errno = %d\n",
+					__FUNCTION__, flag, errno);
+	else
+		dbg_print("%s: SUCCEEDED with flag = %d\n",
+					__FUNCTION__, flag);
+
+	sysfs_close_index(index);
+	return 0;
+}
+
+/**
+ * extern struct dlist *sysfs_index_get_device_classdevs
+ * 	(struct sysfs_index *index, const char *devpath, unsigned int flags);
+ *
+ * flag:
+ * 	0:	index -> valid, devpath -> val_class_dev_path's device
+ * 	1:	index -> valid, devpath -> its parent, SYSFS_INDEX_BELOW
+ * 	2:	index -> valid, devpath -> invalid
+ * 	3:	index -> valid, devpath -> NULL
+ * 	4:	index -> NULL, devpath -> valid
+ */
+int test_sysfs_index_get_device_classdevs(int flag)
+{
+	struct sysfs_index *index = NULL;
+	struct sysfs_class_device *clsdev = NULL, *cur = NULL;
+	struct sysfs_device *dev = NULL;
+	struct dlist *list = NULL;
+	struct dl_node *node;
+	char devpath[SYSFS_PATH_MAX], *path = NULL, *s;
+	unsigned int flags = 0;
+	int found = 0;
+
+	clsdev = sysfs_open_class_device_path(val_class_dev_path);
+	if (clsdev)
+		dev = sysfs_get_classdev_device(clsdev);
+	if (dev == NULL) {
+		dbg_print("%s: failed getting device of %s\n",
+					__FUNCTION__, val_class_dev_path);
+		sysfs_close_class_device(clsdev);
+		return 0;
+	}
+	strcpy(devpath, dev->path);
+	index = sysfs_open_index();
+
+	switch (flag) {
+	case 0:
+		path = devpath;
+		break;
+	case 1:
+		s = strrchr(devpath, '/');
+		if (s)
+			*s = '\0';
+		path = devpath;
+		flags = SYSFS_INDEX_BELOW;
+		break;
+	case 2:
+		path = inval_path;
+		break;
+	case 3:
+		path = NULL;
+		break;
+	case 4:
+		sysfs_close_index(index);
+		index = NULL;
+		path = devpath;
+		break;
+	default:
+		sysfs_close_index(index);
+		sysfs_close_class_device(clsdev);
+		return -1;
+	}
+	list = sysfs_index_get_device_classdevs(index, path, flags);
+
+	switch (flag) {
+	case 0:
+	case 1:
+		if (list) {
+			dlist_for_each_data_nomark(list, node, cur,
+					struct sysfs_class_device) {
+				if (strcmp(cur->name, clsdev->name) == 0)
+					found = 1;
+			}
+		}
+		if (!found)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else {
+			dbg_print("%s: SUCCEEDED with flag = %d\n\n",
+						__FUNCTION__, flag);
+			show_class_device_list(list);
+			dbg_print("\n");
+		}
+		break;
+	case 2:
+	case 3:
+	case 4:
+		if (list == NULL)
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+						__FUNCTION__, flag);
+		else
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		break;
+	default:
+		break;
+	}
+	sysfs_close_index(index);
+	sysfs_close_class_device(clsdev);
+	return 0;
+}
+
+/**
+ * extern struct sysfs_class_device *sysfs_index_get_devnum_classdev
+ * 	(struct sysfs_index *index, int type, unsigned int major,
+ * 	 unsigned int minor);
+ *
+ * flag:
+ * 	0:	index -> valid, type -> char, devnum -> /dev/null's
+ * 	1:	index -> valid, type -> invalid
+ * 	2:	index -> NULL, type -> char
+ */
+int test_sysfs_index_get_devnum_classdev(int flag)
+{
+	struct sysfs_index *index = NULL;
+	struct sysfs_class_device *clsdev = NULL;
+	struct stat astats;
+	int type = SYSFS_DEVNUM_CHAR;
+
+	if (stat("/dev/null", &astats) != 0) {
+		dbg_print("%s: failed stat on /dev/null\n", __FUNCTION__);
+		return 0;
+	}
+
+	switch (flag) {
+	case 0:
+		index = sysfs_open_index();
+		break;
+	case 1:
+		index = sysfs_open_index();
+		type = 0;
+		break;
+	case 2:
+		index = NULL;
+		break;
+	default:
+		return -1;
+	}
+	clsdev = sysfs_index_get_devnum_classdev(index, type,
+			major(astats.st_rdev), minor(astats.st_rdev));
+
+	switch (flag) {
+	case 0:
+		if (clsdev == NULL || strcmp(clsdev->name, "null") != 0)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else {
+			dbg_print("%s: SUCCEEDED with flag = %d\n\n",
+						__FUNCTION__, flag);
+			show_class_device(clsdev);
+			dbg_print("\n");
+		}
+		break;
+	case 1:
+	case 2:
+		if (clsdev == NULL)
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+						__FUNCTION__, flag);
+		else
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		break;
+	default:
+		break;
+	}
+	sysfs_close_index(index);
+	return 0;
+}
+
+/**
+ * extern const char *sysfs_index_get_driver_module(struct sysfs_index *index,
+ * 		const char *bus, const char *driver);
+ *
+ * flag:
+ * 	0:	index -> valid, bus -> valid, driver -> valid
+ * 	1:	index -> valid, bus -> valid, driver -> NULL
+ * 	2:	index -> NULL, bus -> valid, driver -> valid
+ */
+int test_sysfs_index_get_driver_module(int flag)
+{
+	struct sysfs_index *index = NULL;
+	struct sysfs_driver *drv = NULL;
+	struct sysfs_module *module = NULL;
+	const char *name = NULL, *driver = val_drv_name;
+
+	switch (flag) {
+	case 0:
+		index = sysfs_open_index();
+		drv = sysfs_open_driver(val_drv_bus_name, val_drv_name);
+		if (drv)
+			module = sysfs_get_driver_module(drv);
+		break;
+	case 1:
+		index = sysfs_open_index();
+		driver = NULL;
+		break;
+	case 2:
+		index = NULL;
+		break;
+	default:
+		return -1;
+	}
+	name = sysfs_index_get_driver_module(index, val_drv_bus_name, driver);
+
+	switch (flag) {
+	case 0:
+		/* built in drivers may have no module to find */
+		if (module ? (name == NULL || strcmp(name, module->name) != 0)
+				: name != NULL)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else
+			dbg_print("%s: SUCCEEDED with flag = %d, module %s\n",
+				__FUNCTION__, flag, name ? name : "none");
+		break;
+	case 1:
+	case 2:
+		if (name == NULL)
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+						__FUNCTION__, flag);
+		else
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		break;
+	default:
+		break;
+	}
+	sysfs_close_driver(drv);
+	sysfs_close_index(index);
+	return 0;
+}
@@ -0,0 +1,658 @@
+/*
+ * test_iter.c
+ *
+ * Tests for iterator related functions for the libsysfs testsuite
+ *
+ * Copyright (C) IBM Corp. 2004-2005
+ *
+ *      This program is free software; you can redistribute it and/or modify it
+ *      under the terms of the GNU General Public License as published by the
+ *      Free Software Foundation version 2 of the License.
+ *
+ *      This program is distributed in the hope that it will be useful, but
+ *      WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *      General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License along
+ *      with this program; if not, write to the Free Software Foundation, Inc.,
+ *      675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+/**
+ ******************************************************************************
+ * this will test the iterator related functions provided by libsysfs.
+ *
+ * extern void sysfs_close_iter(struct sysfs_iter *iter);
+ * extern struct sysfs_iter *sysfs_open_bus_device_iter
+ * 				(struct sysfs_bus *bus, unsigned int flags);
+ * extern struct sysfs_device *sysfs_bus_device_iter_next
+ * 				(struct sysfs_iter *iter);
+ * extern struct sysfs_iter *sysfs_open_bus_driver_iter
+ * 				(struct sysfs_bus *bus, unsigned int flags);
+ * extern struct sysfs_driver *sysfs_bus_driver_iter_next
+ * 				(struct sysfs_iter *iter);
+ * extern struct sysfs_iter *sysfs_open_class_device_iter
+ * 				(struct sysfs_class *cls, unsigned int flags);
+ * extern struct sysfs_class_device *sysfs_class_device_iter_next
+ * 				(struct sysfs_iter *iter);
+ * extern int sysfs_iter_add_match(struct sysfs_iter *iter, const char *key,
+ * 				const char *pattern, unsigned int flags);
+ ******************************************************************************
+ */
+
+#include "config.h"
+
+#include "test-defs.h"
+#include <errno.h>
+
+/**
+ * extern void sysfs_close_iter(struct sysfs_iter *iter);
+ *
+ * flags:
+ * 	0 -> iter -> valid
+ * 	1 -> iter -> null.
+ */
+int test_sysfs_close_iter(int flag)
+{
+	struct sysfs_bus *bus = NULL;
+	struct sysfs_iter *iter = NULL;
+
+	switch (flag) {
+	case 0:
+		bus = sysfs_open_bus(val_bus_name);
+		if (bus == NULL) {
+			dbg_print("%s: sysfs_open_bus() failed\n",__FUNCTION__);
+			return 0;
+		}
+		iter = sysfs_open_bus_device_iter(bus, 0);
+		if (iter == NULL) {
+			dbg_print("%s: sysfs_open_bus_device_iter() failed\n",
+					__FUNCTION__);
+			sysfs_close_bus(bus);
+			return 0;
+		}
+		/* close with an object still handed out */
+		sysfs_bus_device_iter_next(iter);
+		break;
+	case 1:
+		iter = NULL;
+		break;
+	default:
+		return -1;
+	}
+	sysfs_close_iter(iter);
+	if (bus != NULL)
+		sysfs_close_bus(bus);
+
+	dbg_print("%s: returns void\n", __FUNCTION__);
+	return 0;
+}
+
+/**
+ * extern struct sysfs_iter *sysfs_open_bus_device_iter
+ * 				(struct sysfs_bus *bus, unsigned int flags);
+ *
+ * flag:
+ * 	0 	: bus -> valid, flags -> SYSFS_ITER_SORTED
+ * 	1 	: bus -> valid, flags -> 0
+ * 	2 	: bus -> NULL
+ */
+int test_sysfs_open_bus_device_iter(int flag)
+{
+	struct sysfs_bus *bus = NULL;
+	struct sysfs_iter *iter = NULL;
+	unsigned int flags = 0;
+
+	switch (flag) {
+	case 0:
+		flags = SYSFS_ITER_SORTED;
+		/* FALLTHRU */
+	case 1:
+		bus = sysfs_open_bus(val_bus_name);
+		if (bus == NULL) {
+			dbg_print("%s: sysfs_open_bus() failed\n",__FUNCTION__);
+			return 0;
+		}
+		break;
+	case 2:
+		bus = NULL;
+		break;
+	default:
+		return -1;
+	}
+	iter = sysfs_open_bus_device_iter(bus, flags);
+
+	switch (flag) {
+	case 0:
+	case 1:
+		if (iter == NULL)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+					__FUNCTION__, flag);
+		break;
+	case 2:
+		if (iter != NULL)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+					__FUNCTION__, flag);
+		break;
+	default:
+		break;
+	}
+	if (iter != NULL)
+		sysfs_close_iter(iter);
+	if (bus != NULL)
+		sysfs_close_bus(bus);
+
+	return 0;
+}
+
+/**
+ * extern struct sysfs_device *sysfs_bus_device_iter_next
+ * 				(struct sysfs_iter *iter);
+ *
+ * flag:
+ * 	0 	: iter -> valid, sorted
+ * 	1 	: iter -> valid, unsorted
+ * 	2 	: iter -> NULL
+ */
+int test_sysfs_bus_device_iter_next(int flag)
+{
+	struct sysfs_bus *bus = NULL;
+	struct sysfs_iter *iter = NULL;
+	struct sysfs_device *dev = NULL;
+	int found = 0;
+
+	switch (flag) {
+	case 0:
+	case 1:
+		bus = sysfs_open_bus(val_bus_name);
+		if (bus == NULL) {
+			dbg_print("%s: sysfs_open_bus() failed\n",__FUNCTION__);
+			return 0;
+		}
+		iter = sysfs_open_bus_device_iter(bus,
+				flag == 0 ? SYSFS_ITER_SORTED : 0);
+		if (iter == NULL) {
+			dbg_print("%s: sysfs_open_bus_device_iter() failed\n",
+					__FUNCTION__);
+			sysfs_close_bus(bus);
+			return 0;
+		}
+		break;
+	case 2:
+		iter = NULL;
+		break;
+	default:
+		return -1;
+	}
+
+	switch (flag) {
+	case 0:
+	case 1:
+		dbg_print("%s: devices with flag = %d\n\n",
+				__FUNCTION__, flag);
+		while ((dev = sysfs_bus_device_iter_next(iter)) != NULL) {
+			if (strcmp(dev->bus_id, val_bus_id) == 0)
+				found = 1;
+			show_device(dev);
+		}
+		if (!found)
+			dbg_print("%s: FAILED with flag = %d, %s not found\n",
+					__FUNCTION__, flag, val_bus_id);
+		else
+			dbg_print("\n%s: SUCCEEDED with flag = %d\n",
+					__FUNCTION__, flag);
+		break;
+	case 2:
+		dev = sysfs_bus_device_iter_next(iter);
+		if (dev != NULL)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+					__FUNCTION__, flag);
+		break;
+	default:
+		break;
+	}
+	if (iter != NULL)
+		sysfs_close_iter(iter);
+	if (bus != NULL)
+		sysfs_close_bus(bus);
+
+	return 0;
+}
+
+/**
+ * extern struct sysfs_iter *sysfs_open_bus_driver_iter
+ * 				(struct sysfs_bus *bus, unsigned int flags);
+ *
+ * flag:
+ * 	0 	: bus -> valid
+ * 	1 	: bus -> NULL
+ */
+int test_sysfs_open_bus_driver_iter(int flag)
+{
+	struct sysfs_bus *bus = NULL;
+	struct sysfs_iter *iter = NULL;
+
+	switch (flag) {
+	case 0:
+		bus = sysfs_open_bus(val_drv_bus_name);
+		if (bus == NULL) {
+			dbg_print("%s: sysfs_open_bus() failed\n",__FUNCTION__);
+			return 0;
+		}
+		break;
+	case 1:
+		bus = NULL;
+		break;
+	default:
+		return -1;
+	}
+	iter = sysfs_open_bus_driver_iter(bus, SYSFS_ITER_SORTED);
+
+	switch (flag) {
+	case 0:
+		if (iter == NULL)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+					__FUNCTION__, flag);
+		break;
+	case 1:
+		if (iter != NULL)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+					__FUNCTION__, flag);
+		break;
+	default:
+		break;
+	}
+	if (iter != NULL)
+		sysfs_close_iter(iter);
+	if (bus != NULL)
+		sysfs_close_bus(bus);
+
+	return 0;
+}
+
+/**
+ * extern struct sysfs_driver *sysfs_bus_driver_iter_next
+ * 				(struct sysfs_iter *iter);
+ *
+ * flag:
+ * 	0 	: iter -> valid
+ * 	1 	: iter -> bus device iterator
+ * 	2 	: iter -> NULL
+ */
+int test_sysfs_bus_driver_iter_next(int flag)
+{
+	struct sysfs_bus *bus = NULL;
+	struct sysfs_iter *iter = NULL;
+	struct sysfs_driver *drv = NULL;
+	int found = 0;
+
+	switch (flag) {
+	case 0:
+	case 1:
+		bus = sysfs_open_bus(val_drv_bus_name);
+		if (bus == NULL) {
+			dbg_print("%s: sysfs_open_bus() failed\n",__FUNCTION__);
+			return 0;
+		}
+		if (flag == 0)
+			iter = sysfs_open_bus_driver_iter(bus,
+					SYSFS_ITER_SORTED);
+		else
+			iter = sysfs_open_bus_device_iter(bus,
+					SYSFS_ITER_SORTED);
+		if (iter == NULL) {
+			dbg_print("%s: opening the iterator failed\n",
+					__FUNCTION__);
+			sysfs_close_bus(bus);
+			return 0;
+		}
+		break;
+	case 2:
+		iter = NULL;
+		break;
+	default:
+		return -1;
+	}
+
+	switch (flag) {
+	case 0:
+		dbg_print("%s: drivers with flag = %d\n\n",
+				__FUNCTION__, flag);
+		while ((drv = sysfs_bus_driver_iter_next(iter)) != NULL) {
+			if (strcmp(drv->name, val_drv_name) == 0)
+				found = 1;
+			show_driver(drv);
+		}
+		if (!found)
+			dbg_print("%s: FAILED with flag = %d, %s not found\n",
+					__FUNCTION__, flag, val_drv_name);
+		else
+			dbg_print("\n%s: SUCCEEDED with flag = %d\n",
+					__FUNCTION__, flag);
+		break;
+	case 1:
+	case 2:
+		drv = sysfs_bus_driver_iter_next(iter);
+		if (drv != NULL)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+					__FUNCTION__, flag);
+		break;
+	default:
+		break;
+	}
+	if (iter != NULL)
+		sysfs_close_iter(iter);
+	if (bus != NULL)
+		sysfs_close_bus(bus);
+
+	return 0;
+}
+
+/**
+ * extern struct sysfs_iter *sysfs_open_class_device_iter
+ * 				(struct sysfs_class *cls, unsigned int flags);
+ *
+ * flag:
+ * 	0 	: class -> valid
+ * 	1 	: class -> NULL
+ */
+int test_sysfs_open_class_device_iter(int flag)
+{
+	struct sysfs_class *cls = NULL;
+	struct sysfs_iter *iter = NULL;
+
+	switch (flag) {
+	case 0:
+		cls = sysfs_open_class(val_class);
+		if (cls == NULL) {
+			dbg_print("%s: sysfs_open_class() failed\n",
+					__FUNCTION__);
+			return 0;
+		}
+		break;
+	case 1:
+		cls = NULL;
+		break;
+	default:
+		return -1;
+	}
+	iter = sysfs_open_class_device_iter(cls, SYSFS_ITER_SORTED);
+
+	switch (flag) {
+	case 0:
+		if (iter == NULL)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+					__FUNCTION__, flag);
+		break;
+	case 1:
+		if (iter != NULL)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+					__FUNCTION__, flag);
+		break;
+	default:
+		break;
+	}
+	if (iter != NULL)
+		sysfs_close_iter(iter);
+	if (cls != NULL)
+		sysfs_close_class(cls);
+
+	return 0;
+}
+
+/**
+ * extern struct sysfs_class_device *sysfs_class_device_iter_next
+ * 				(struct sysfs_iter *iter);
+ *
+ * flag:
+ * 	0 	: iter -> valid
+ * 	1 	: iter -> NULL
+ */
+int test_sysfs_class_device_iter_next(int flag)
+{
+	struct sysfs_class *cls = NULL;
+	struct sysfs_iter *iter = NULL;
+	struct sysfs_class_device *cdev = NULL;
+	int found = 0;
+
+	switch (flag) {
+	case 0:
+		cls = sysfs_open_class(val_class);
+		if (cls == NULL) {
+			dbg_print("%s: sysfs_open_class() failed\n",
+					__FUNCTION__);
+			return 0;
+		}
+		iter = sysfs_open_class_device_iter(cls, SYSFS_ITER_SORTED);
+		if (iter == NULL) {
+			dbg_print("%s: sysfs_open_class_device_iter() failed\n",
+					__FUNCTION__);
+			sysfs_close_class(cls);
+			return 0;
+		}
+		break;
+	case 1:
+		iter = NULL;
+		break;
+	default:
+		return -1;
+	}
+
+	switch (flag) {
+	case 0:
+		dbg_print("%s: class devices with flag = %d\n\n",
+				__FUNCTION__, flag);
+		while ((cdev = sysfs_class_device_iter_next(iter)) != NULL) {
+			if (strcmp(cdev->name, val_class_dev) == 0)
+				found = 1;
+			show_class_device(cdev);
+		}
+		if (!found)
+			dbg_print("%s: FAILED with flag = %d, %s not found\n",
+					__FUNCTION__, flag, val_class_dev);
+		else
+			dbg_print("\n%s: SUCCEEDED with flag = %d\n",
+					__FUNCTION__, flag);
+		break;
+	case 1:
+		cdev = sysfs_class_device_iter_next(iter);
+		if (cdev != NULL)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+					__FUNCTION__, flag);
+		break;
+	default:
+		break;
+	}
+	if (iter != NULL)
+		sysfs_close_iter(iter);
+	if (cls != NULL)
+		sysfs_close_class(cls);
+
+	return 0;
+}
+
+/**
+ * extern int sysfs_iter_add_match(struct sysfs_iter *iter, const char *key,
+ * 				const char *pattern, unsigned int flags);
+ *
+ * flag:
+ * 	0 	: bus device iterator, key -> "name", pattern -> bus id
+ * 	1 	: bus device iterator, key -> "driver", pattern -> driver
+ * 	2 	: class device iterator, key -> attribute, regex -> "."
+ * 	3 	: bus device iterator, key -> "name", pattern -> invalid name
+ * 	4 	: bus device iterator, regex -> invalid
+ * 	5 	: iter -> NULL
+ */
+int test_sysfs_iter_add_match(int flag)
+{
+	struct sysfs_bus *bus = NULL;
+	struct sysfs_class *cls = NULL;
+	struct sysfs_iter *iter = NULL;
+	struct sysfs_device *dev = NULL;
+	struct sysfs_class_device *cdev = NULL;
+	const char *driver;
+	int ret = 0, found = 0, others = 0;
+
+	switch (flag) {
+	case 0:
+	case 3:
+	case 4:
+		bus = sysfs_open_bus(val_bus_name);
+		break;
+	case 1:
+		bus = sysfs_open_bus(val_drv_bus_name);
+		break;
+	case 2:
+		cls = sysfs_open_class(val_class);
+		if (cls == NULL) {
+			dbg_print("%s: sysfs_open_class() failed\n",
+					__FUNCTION__);
+			return 0;
+		}
+		iter = sysfs_open_class_device_iter(cls, SYSFS_ITER_SORTED);
+		break;
+	case 5:
+		iter = NULL;
+		break;
+	default:
+		return -1;
+	}
+	if (flag != 2 && flag != 5) {
+		if (bus == NULL) {
+			dbg_print("%s: sysfs_open_bus() failed\n",__FUNCTION__);
+			return 0;
+		}
+		iter = sysfs_open_bus_device_iter(bus, SYSFS_ITER_SORTED);
+	}
+	if (flag != 5 && iter == NULL) {
+		dbg_print("%s: opening the iterator failed\n", __FUNCTION__);
+		goto out;
+	}
+
+	switch (flag) {
+	case 0:
+		ret = sysfs_iter_add_match(iter, "name", val_bus_id,
+				SYSFS_MATCH_GLOB);
+		break;
+	case 1:
+		ret = sysfs_iter_add_match(iter, "driver", val_drv_name,
+				SYSFS_MATCH_GLOB);
+		break;
+	case 2:
+		ret = sysfs_iter_add_match(iter, val_class_dev_attr, ".",
+				SYSFS_MATCH_REGEX);
+		break;
+	case 3:
+		ret = sysfs_iter_add_match(iter, "name", inval_name,
+				SYSFS_MATCH_GLOB);
+		break;
+	case 4:
+		ret = sysfs_iter_add_match(iter, "name", "(",
+				SYSFS_MATCH_REGEX);
+		break;
+	case 5:
+		ret = sysfs_iter_add_match(iter, "name", "*",
+				SYSFS_MATCH_GLOB);
+		break;
+	default:
+		break;
+	}
+
+	switch (flag) {
+	case 0:
+	case 1:
+	case 3:
+		if (ret != 0) {
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+			break;
+		}
+		while ((dev = sysfs_bus_device_iter_next(iter)) != NULL) {
+			if (flag == 1) {
+				driver = sysfs_get_device_driver_name(dev);
+				if (!driver || strcmp(driver, val_drv_name))
+					others++;
+				else if (!strcmp(dev->bus_id, val_drv_dev_name))
+					found = 1;
+			} else if (flag == 0 &&
+					!strcmp(dev->bus_id, val_bus_id))
+				found = 1;
+			else
+				others++;
+			show_device(dev);
+		}
+		if (others || found != (flag != 3))
+			dbg_print("%s: FAILED with flag = %d, %d others\n",
+					__FUNCTION__, flag, others);
+		else
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+					__FUNCTION__, flag);
+		break;
+	case 2:
+		if (ret != 0) {
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+			break;
+		}
+		while ((cdev = sysfs_class_device_iter_next(iter)) != NULL) {
+			if (strcmp(cdev->name, val_class_dev) == 0)
+				found = 1;
+		}
+		if (!found)
+			dbg_print("%s: FAILED with flag = %d, %s not found\n",
+					__FUNCTION__, flag, val_class_dev);
+		else
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+					__FUNCTION__, flag);
+		break;
+	case 4:
+	case 5:
+		if (ret != -1 || errno != EINVAL)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+					__FUNCTION__, flag);
+		break;
+	default:
+		break;
+	}
+out:
+	if (iter != NULL)
+		sysfs_close_iter(iter);
+	if (bus != NULL)
+		sysfs_close_bus(bus);
+	if (cls != NULL)
+		sysfs_close_class(cls);
+
+	return 0;
+}
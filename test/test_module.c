@@ -30,6 +30,8 @@
  * extern struct sysfs_module *sysfs_open_module(const char *name);
  * extern struct dlist *sysfs_get_module_attributes
  *	(struct sysfs_module *module);
+ * extern struct dlist *sysfs_get_module_attrs
+ * 		(struct sysfs_module *module, const char * const *names);
  * extern struct sysfs_attribute *sysfs_get_module_attr
  *              (struct sysfs_module *module, const char *name);
  * extern struct dlist *sysfs_get_module_parms(struct sysfs_module *module);
@@ -369,6 +371,93 @@ int test_sysfs_get_module_attributes(int flag)
 	return 0;
 }
 
+/**
+ * extern struct dlist *sysfs_get_module_attrs
+ * 		(struct sysfs_module *module, const char * const *names);
+ *
+ * flag:
+ * 	0:	module -> valid, names -> valid
+ * 	1:	module -> valid, names -> invalid
+ * 	2:	module -> valid, names -> NULL
+ * 	3:	module -> NULL, names -> valid
+ */
+int test_sysfs_get_module_attrs(int flag)
+{
+	struct sysfs_module *module = NULL;
+	struct sysfs_attribute *attr = NULL;
+	struct dlist *list = NULL;
+	const char *valid[] = { val_mod_attr_name, NULL };
+	const char *invalid[] = { inval_name, NULL };
+	const char * const *names = NULL;
+
+	switch (flag) {
+	case 0:
+	case 1:
+	case 2:
+		module = sysfs_open_module_path(val_mod_path);
+		if (module == NULL) {
+			dbg_print("%s: failed opening module at %s\n",
+					__FUNCTION__, val_mod_path);
+			return 0;
+		}
+		if (flag == 0)
+			names = valid;
+		else if (flag == 1)
+			names = invalid;
+		break;
+	case 3:
+		names = valid;
+		break;
+	default:
+		return -1;
+	}
+	errno = 0;
+	list = sysfs_get_module_attrs(module, names);
+
+	switch (flag) {
+	case 0:
+		if (list == NULL || list->count != 1) {
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+					__FUNCTION__, flag, errno);
+			break;
+		}
+		dlist_start(list);
+		attr = (struct sysfs_attribute *)dlist_next(list);
+		if (strcmp(attr->name, val_mod_attr_name) != 0) {
+			dbg_print("%s: FAILED with flag = %d, got %s\n",
+					__FUNCTION__, flag, attr->name);
+			break;
+		}
+		dbg_print("%s: SUCCEEDED with flag = %d\n\n",
+					__FUNCTION__, flag);
+		show_attribute_list(list);
+		dbg_print("\n");
+		break;
+	case 1:
+		if (list != NULL)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+					__FUNCTION__, flag, errno);
+		else
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+					__FUNCTION__, flag);
+		break;
+	case 2:
+	case 3:
+		if (list != NULL || errno != EINVAL)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+					__FUNCTION__, flag, errno);
+		else
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+					__FUNCTION__, flag);
+		break;
+	default:
+		break;
+	}
+	if (module != NULL)
+		sysfs_close_module(module);
+	return 0;
+}
+
 /**
  * sysfs_get_module_parms: Get modules list of parameters
  * @module: sysfs_module whose parmameter list is required
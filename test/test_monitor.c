@@ -0,0 +1,569 @@
+/*
+ * test_monitor.c
+ *
+ * Tests for the kernel uevent monitor for the libsysfs testsuite
+ *
+ * Copyright (C) IBM Corp. 2004-2005
+ *
+ *      This program is free software; you can redistribute it and/or modify it
+ *      under the terms of the GNU General Public License as published by the
+ *      Free Software Foundation version 2 of the License.
+ *
+ *      This program is distributed in the hope that it will be useful, but
+ *      WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *      General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License along
+ *      with this program; if not, write to the Free Software Foundation, Inc.,
+ *      675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+/**
+ ******************************************************************************
+ * this will test the uevent monitor functions provided by libsysfs. Events
+ * are replayed through a socketpair instead of the kernel's netlink socket.
+ *
+ * extern struct sysfs_monitor *sysfs_open_monitor(void);
+ * extern struct sysfs_monitor *sysfs_open_monitor_fd(int fd);
+ * extern void sysfs_close_monitor(struct sysfs_monitor *mon);
+ * extern int sysfs_monitor_get_fd(struct sysfs_monitor *mon);
+ * extern int sysfs_monitor_watch_bus(struct sysfs_monitor *mon,
+ * 		struct sysfs_bus *bus);
+ * extern int sysfs_monitor_watch_class(struct sysfs_monitor *mon,
+ * 		struct sysfs_class *cls);
+ * extern int sysfs_monitor_receive(struct sysfs_monitor *mon,
+ * 		struct sysfs_event *event);
+ ******************************************************************************
+ */
+
+#include "config.h"
+
+#include "test-defs.h"
+#include <errno.h>
+#include <sys/socket.h>
+
+/* the writing end of the last replay socketpair */
+static int replay_fd = -1;
+
+/* opens a monitor reading from a socketpair, see replay_event() */
+static struct sysfs_monitor *open_replay_monitor(void)
+{
+	struct sysfs_monitor *mon;
+	int sv[2];
+
+	if (socketpair(AF_UNIX, SOCK_DGRAM, 0, sv))
+		return NULL;
+	mon = sysfs_open_monitor_fd(sv[0]);
+	if (!mon) {
+		close(sv[0]);
+		close(sv[1]);
+		return NULL;
+	}
+	replay_fd = sv[1];
+	return mon;
+}
+
+static void close_replay_monitor(struct sysfs_monitor *mon)
+{
+	sysfs_close_monitor(mon);
+	if (replay_fd >= 0)
+		close(replay_fd);
+	replay_fd = -1;
+}
+
+/*
+ * sends a uevent the way the kernel formats it
+ * @action: e.g. "add"
+ * @path: absolute path of the object in sysfs
+ * @subsystem: SUBSYSTEM of the event
+ */
+static void replay_event(const char *action, const char *path,
+				const char *subsystem)
+{
+	char msg[1024], mnt[SYSFS_PATH_MAX];
+	const char *devpath = path;
+	int len;
+
+	if (!sysfs_get_mnt_path(mnt, SYSFS_PATH_MAX) &&
+			strncmp(path, mnt, strlen(mnt)) == 0)
+		devpath = path + strlen(mnt);
+	len = snprintf(msg, sizeof(msg), "%s@%s", action, devpath) + 1;
+	len += snprintf(msg + len, sizeof(msg) - len, "ACTION=%s", action) + 1;
+	len += snprintf(msg + len, sizeof(msg) - len, "DEVPATH=%s",
+							devpath) + 1;
+	len += snprintf(msg + len, sizeof(msg) - len, "SUBSYSTEM=%s",
+							subsystem) + 1;
+	len += snprintf(msg + len, sizeof(msg) - len, "SEQNUM=42") + 1;
+	if (send(replay_fd, msg, len, 0) != len)
+		dbg_print("Error replaying %s event\n", action);
+}
+
+/* returns 1 if an object in the list is called name */
+static int monitor_list_has(struct dlist *list, const char *name)
+{
+	struct sysfs_device *dev;
+	struct dl_node *node;
+
+	dlist_for_each_data_nomark(list, node, dev, struct sysfs_device) {
+		if (strcmp(dev->name, name) == 0)
+			return 1;
+	}
+	return 0;
+}
+
+/**
+ * extern struct sysfs_monitor *sysfs_open_monitor(void);
+ *
+ * flag:
+ * 	0 	: netlink socket
+ */
+int test_sysfs_open_monitor(int flag)
+{
+	struct sysfs_monitor *mon = NULL;
+
+	switch (flag) {
+	case 0:
+		break;
+	default:
+		return -1;
+	}
+	mon = sysfs_open_monitor();
+
+	switch (flag) {
+	case 0:
+		if (mon == NULL || sysfs_monitor_get_fd(mon) < 0)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+						__FUNCTION__, flag);
+		break;
+	default:
+		break;
+	}
+	if (mon != NULL)
+		sysfs_close_monitor(mon);
+
+	return 0;
+}
+
+/**
+ * extern struct sysfs_monitor *sysfs_open_monitor_fd(int fd);
+ *
+ * flag:
+ * 	0 	: fd -> socketpair
+ * 	1 	: fd -> -1
+ */
+int test_sysfs_open_monitor_fd(int flag)
+{
+	struct sysfs_monitor *mon = NULL;
+
+	switch (flag) {
+	case 0:
+		mon = open_replay_monitor();
+		break;
+	case 1:
+		mon = sysfs_open_monitor_fd(-1);
+		break;
+	default:
+		return -1;
+	}
+
+	switch (flag) {
+	case 0:
+		if (mon == NULL)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+						__FUNCTION__, flag);
+		break;
+	case 1:
+		if (mon != NULL || errno != EINVAL)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+						__FUNCTION__, flag);
+		break;
+	default:
+		break;
+	}
+	if (mon != NULL)
+		close_replay_monitor(mon);
+
+	return 0;
+}
+
+/**
+ * extern void sysfs_close_monitor(struct sysfs_monitor *mon);
+ *
+ * flag:
+ * 	0 	: mon -> valid, watching a bus
+ * 	1 	: mon -> NULL
+ */
+int test_sysfs_close_monitor(int flag)
+{
+	struct sysfs_monitor *mon = NULL;
+	struct sysfs_bus *bus = NULL;
+
+	switch (flag) {
+	case 0:
+		mon = open_replay_monitor();
+		if (mon == NULL) {
+			dbg_print("%s: failed opening monitor\n", __FUNCTION__);
+			return 0;
+		}
+		bus = sysfs_open_bus(val_bus_name);
+		if (bus == NULL) {
+			dbg_print("%s: failed opening bus\n", __FUNCTION__);
+			close_replay_monitor(mon);
+			return 0;
+		}
+		sysfs_monitor_watch_bus(mon, bus);
+		sysfs_close_bus(bus);
+		break;
+	case 1:
+		mon = NULL;
+		break;
+	default:
+		return -1;
+	}
+	close_replay_monitor(mon);
+
+	dbg_print("%s: returns void\n", __FUNCTION__);
+	return 0;
+}
+
+/**
+ * extern int sysfs_monitor_get_fd(struct sysfs_monitor *mon);
+ *
+ * flag:
+ * 	0 	: mon -> valid
+ * 	1 	: mon -> NULL
+ */
+int test_sysfs_monitor_get_fd(int flag)
+{
+	struct sysfs_monitor *mon = NULL;
+	int fd;
+
+	switch (flag) {
+	case 0:
+		mon = open_replay_monitor();
+		if (mon == NULL) {
+			dbg_print("%s: failed opening monitor\n", __FUNCTION__);
+			return 0;
+		}
+		break;
+	case 1:
+		mon = NULL;
+		break;
+	default:
+		return -1;
+	}
+	fd = sysfs_monitor_get_fd(mon);
+
+	switch (flag) {
+	case 0:
+		if (fd < 0)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+						__FUNCTION__, flag);
+		break;
+	case 1:
+		if (fd != -1 || errno != EINVAL)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+						__FUNCTION__, flag);
+		break;
+	default:
+		break;
+	}
+	if (mon != NULL)
+		close_replay_monitor(mon);
+
+	return 0;
+}
+
+/**
+ * extern int sysfs_monitor_watch_bus(struct sysfs_monitor *mon,
+ * 		struct sysfs_bus *bus);
+ *
+ * flag:
+ * 	0 	: mon -> valid, bus -> valid
+ * 	1 	: mon -> valid, bus -> NULL
+ * 	2 	: mon -> NULL, bus -> valid
+ */
+int test_sysfs_monitor_watch_bus(int flag)
+{
+	struct sysfs_monitor *mon = NULL;
+	struct sysfs_bus *bus = NULL;
+	int ret;
+
+	if (flag > 2)
+		return -1;
+	if (flag != 2) {
+		mon = open_replay_monitor();
+		if (mon == NULL) {
+			dbg_print("%s: failed opening monitor\n", __FUNCTION__);
+			return 0;
+		}
+	}
+	if (flag != 1) {
+		bus = sysfs_open_bus(val_bus_name);
+		if (bus == NULL) {
+			dbg_print("%s: failed opening bus\n", __FUNCTION__);
+			if (mon != NULL)
+				close_replay_monitor(mon);
+			return 0;
+		}
+	}
+	ret = sysfs_monitor_watch_bus(mon, bus);
+
+	switch (flag) {
+	case 0:
+		if (ret != 0)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+						__FUNCTION__, flag);
+		break;
+	case 1:
+	case 2:
+		if (ret != -1 || errno != EINVAL)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+						__FUNCTION__, flag);
+		break;
+	default:
+		break;
+	}
+	if (bus != NULL)
+		sysfs_close_bus(bus);
+	if (mon != NULL)
+		close_replay_monitor(mon);
+
+	return 0;
+}
+
+/**
+ * extern int sysfs_monitor_watch_class(struct sysfs_monitor *mon,
+ * 		struct sysfs_class *cls);
+ *
+ * flag:
+ * 	0 	: mon -> valid, cls -> valid
+ * 	1 	: mon -> valid, cls -> NULL
+ * 	2 	: mon -> NULL, cls -> valid
+ */
+int test_sysfs_monitor_watch_class(int flag)
+{
+	struct sysfs_monitor *mon = NULL;
+	struct sysfs_class *cls = NULL;
+	int ret;
+
+	if (flag > 2)
+		return -1;
+	if (flag != 2) {
+		mon = open_replay_monitor();
+		if (mon == NULL) {
+			dbg_print("%s: failed opening monitor\n", __FUNCTION__);
+			return 0;
+		}
+	}
+	if (flag != 1) {
+		cls = sysfs_open_class(val_class);
+		if (cls == NULL) {
+			dbg_print("%s: failed opening class\n", __FUNCTION__);
+			if (mon != NULL)
+				close_replay_monitor(mon);
+			return 0;
+		}
+	}
+	ret = sysfs_monitor_watch_class(mon, cls);
+
+	switch (flag) {
+	case 0:
+		if (ret != 0)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+						__FUNCTION__, flag);
+		break;
+	case 1:
+	case 2:
+		if (ret != -1 || errno != EINVAL)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+						__FUNCTION__, flag);
+		break;
+	default:
+		break;
+	}
+	if (cls != NULL)
+		sysfs_close_class(cls);
+	if (mon != NULL)
+		close_replay_monitor(mon);
+
+	return 0;
+}
+
+/* replays remove and add of val_dev_path on a watched bus */
+static int monitor_replay_bus(struct sysfs_monitor *mon)
+{
+	struct sysfs_event event;
+	struct sysfs_bus *bus;
+	int ret = -1;
+
+	bus = sysfs_open_bus(val_bus_name);
+	if (bus == NULL || sysfs_get_bus_devices(bus) == NULL ||
+			sysfs_monitor_watch_bus(mon, bus))
+		goto out;
+	if (!monitor_list_has(bus->devices, val_bus_id))
+		goto out;
+
+	replay_event("remove", val_dev_path, val_bus_name);
+	if (sysfs_monitor_receive(mon, &event) != 1 ||
+			event.action != SYSFS_EVENT_REMOVE ||
+			strcmp(event.path, val_dev_path) != 0 ||
+			event.seqnum != 42 ||
+			monitor_list_has(bus->devices, val_bus_id))
+		goto out;
+
+	replay_event("add", val_dev_path, val_bus_name);
+	if (sysfs_monitor_receive(mon, &event) != 1 ||
+			event.action != SYSFS_EVENT_ADD ||
+			!monitor_list_has(bus->devices, val_bus_id))
+		goto out;
+
+	if (sysfs_monitor_receive(mon, &event) == 0)
+		ret = 0;
+out:
+	if (bus != NULL)
+		sysfs_close_bus(bus);
+	return ret;
+}
+
+/* replays a change of val_class_dev on a watched class */
+static int monitor_replay_class(struct sysfs_monitor *mon)
+{
+	struct sysfs_event event;
+	struct sysfs_class *cls;
+	int ret = -1;
+
+	cls = sysfs_open_class(val_class);
+	if (cls == NULL || sysfs_get_class_devices(cls) == NULL ||
+			sysfs_monitor_watch_class(mon, cls))
+		goto out;
+
+	replay_event("change", val_class_dev_path, val_class);
+	if (sysfs_monitor_receive(mon, &event) == 1 &&
+			event.action == SYSFS_EVENT_CHANGE &&
+			strcmp(event.subsystem, val_class) == 0 &&
+			monitor_list_has(cls->devices, val_class_dev))
+		ret = 0;
+out:
+	if (cls != NULL)
+		sysfs_close_class(cls);
+	return ret;
+}
+
+/* replays a udevd message and a malformed one, both are skipped */
+static int monitor_replay_junk(struct sysfs_monitor *mon)
+{
+	struct sysfs_event event;
+	static const char udevd[] = "libudev\0ACTION=add";
+	static const char junk[] = "add@/devices/nowhere\0SUBSYSTEM=none";
+
+	if (send(replay_fd, udevd, sizeof(udevd), 0) < 0 ||
+			send(replay_fd, junk, sizeof(junk), 0) < 0)
+		return -1;
+	return sysfs_monitor_receive(mon, &event);
+}
+
+/**
+ * extern int sysfs_monitor_receive(struct sysfs_monitor *mon,
+ * 		struct sysfs_event *event);
+ *
+ * flag:
+ * 	0 	: mon -> valid, remove and add of a device on a watched bus
+ * 	1 	: mon -> valid, change of a class device on a watched class
+ * 	2 	: mon -> valid, only messages that are not kernel uevents
+ * 	3 	: mon -> NULL
+ */
+int test_sysfs_monitor_receive(int flag)
+{
+	struct sysfs_monitor *mon = NULL;
+	struct sysfs_event event;
+	int ret;
+
+	switch (flag) {
+	case 0:
+	case 1:
+	case 2:
+		mon = open_replay_monitor();
+		if (mon == NULL) {
+			dbg_print("%s: failed opening monitor\n", __FUNCTION__);
+			return 0;
+		}
+		break;
+	case 3:
+		mon = NULL;
+		break;
+	default:
+		return -1;
+	}
+
+	switch (flag) {
+	case 0:
+		ret = monitor_replay_bus(mon);
+		break;
+	case 1:
+		ret = monitor_replay_class(mon);
+		break;
+	case 2:
+		ret = monitor_replay_junk(mon);
+		break;
+	default:
+		ret = sysfs_monitor_receive(mon, &event);
+		break;
+	}
+
+	switch (flag) {
+	case 0:
+	case 1:
+	case 2:
+		if (ret != 0)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+						__FUNCTION__, flag);
+		break;
+	case 3:
+		if (ret != -1 || errno != EINVAL)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+						__FUNCTION__, flag);
+		break;
+	default:
+		break;
+	}
+	if (mon != NULL)
+		close_replay_monitor(mon);
+
+	return 0;
+}
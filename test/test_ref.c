@@ -0,0 +1,436 @@
+/*
+ * test_ref.c
+ *
+ * Tests for object reference counting for the libsysfs testsuite
+ *
+ * Copyright (C) IBM Corp. 2004-2005
+ *
+ *      This program is free software; you can redistribute it and/or modify it
+ *      under the terms of the GNU General Public License as published by the
+ *      Free Software Foundation version 2 of the License.
+ *
+ *      This program is distributed in the hope that it will be useful, but
+ *      WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *      General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License along
+ *      with this program; if not, write to the Free Software Foundation, Inc.,
+ *      675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+/**
+ ******************************************************************************
+ * this will test the reference counting functions provided by libsysfs.
+ *
+ * extern struct sysfs_bus *sysfs_ref_bus(struct sysfs_bus *bus);
+ * extern struct sysfs_class *sysfs_ref_class(struct sysfs_class *cls);
+ * extern struct sysfs_device *sysfs_ref_device(struct sysfs_device *dev);
+ * extern struct sysfs_class_device *sysfs_ref_class_device
+ * 	(struct sysfs_class_device *dev);
+ * extern struct sysfs_driver *sysfs_ref_driver(struct sysfs_driver *driver);
+ * extern struct sysfs_module *sysfs_ref_module(struct sysfs_module *module);
+ * extern void sysfs_thread_quiescent(void);
+ ******************************************************************************
+ */
+
+#include "config.h"
+
+#include "test-defs.h"
+#include <errno.h>
+
+/**
+ * extern struct sysfs_bus *sysfs_ref_bus(struct sysfs_bus *bus);
+ *
+ * flag:
+ * 	0 	: bus -> valid, still usable after the first close
+ * 	1 	: bus -> NULL
+ */
+int test_sysfs_ref_bus(int flag)
+{
+	struct sysfs_bus *bus = NULL, *ret = NULL;
+	char path[SYSFS_PATH_MAX];
+
+	switch (flag) {
+	case 0:
+		bus = sysfs_open_bus(val_bus_name);
+		if (bus == NULL) {
+			dbg_print("%s: failed opening bus\n", __FUNCTION__);
+			return 0;
+		}
+		break;
+	case 1:
+		bus = NULL;
+		break;
+	default:
+		return -1;
+	}
+	ret = sysfs_ref_bus(bus);
+
+	switch (flag) {
+	case 0:
+		strcpy(path, bus->path);
+		sysfs_close_bus(bus);
+		if (ret != bus || strcmp(ret->path, path) != 0)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else {
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+						__FUNCTION__, flag);
+			dbg_print("bus at %s\n", ret->path);
+		}
+		sysfs_close_bus(ret);
+		break;
+	case 1:
+		if (ret != NULL)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+						__FUNCTION__, flag);
+		break;
+	default:
+		break;
+	}
+
+	return 0;
+}
+
+/**
+ * extern struct sysfs_class *sysfs_ref_class(struct sysfs_class *cls);
+ *
+ * flag:
+ * 	0 	: cls -> valid, still usable after the first close
+ * 	1 	: cls -> NULL
+ */
+int test_sysfs_ref_class(int flag)
+{
+	struct sysfs_class *cls = NULL, *ret = NULL;
+	char path[SYSFS_PATH_MAX];
+
+	switch (flag) {
+	case 0:
+		cls = sysfs_open_class(val_class);
+		if (cls == NULL) {
+			dbg_print("%s: failed opening class\n", __FUNCTION__);
+			return 0;
+		}
+		break;
+	case 1:
+		cls = NULL;
+		break;
+	default:
+		return -1;
+	}
+	ret = sysfs_ref_class(cls);
+
+	switch (flag) {
+	case 0:
+		strcpy(path, cls->path);
+		sysfs_close_class(cls);
+		if (ret != cls || strcmp(ret->path, path) != 0)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else {
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+						__FUNCTION__, flag);
+			dbg_print("class at %s\n", ret->path);
+		}
+		sysfs_close_class(ret);
+		break;
+	case 1:
+		if (ret != NULL)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+						__FUNCTION__, flag);
+		break;
+	default:
+		break;
+	}
+
+	return 0;
+}
+
+/**
+ * extern struct sysfs_device *sysfs_ref_device(struct sysfs_device *dev);
+ *
+ * flag:
+ * 	0 	: dev -> valid, still usable after the first close
+ * 	1 	: dev -> NULL
+ */
+int test_sysfs_ref_device(int flag)
+{
+	struct sysfs_device *dev = NULL, *ret = NULL;
+	char path[SYSFS_PATH_MAX];
+
+	switch (flag) {
+	case 0:
+		dev = sysfs_open_device_path(val_dev_path);
+		if (dev == NULL) {
+			dbg_print("%s: failed opening device\n", __FUNCTION__);
+			return 0;
+		}
+		break;
+	case 1:
+		dev = NULL;
+		break;
+	default:
+		return -1;
+	}
+	ret = sysfs_ref_device(dev);
+
+	switch (flag) {
+	case 0:
+		strcpy(path, dev->path);
+		sysfs_close_device(dev);
+		if (ret != dev || strcmp(ret->path, path) != 0)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else {
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+						__FUNCTION__, flag);
+			dbg_print("device at %s\n", ret->path);
+		}
+		sysfs_close_device(ret);
+		break;
+	case 1:
+		if (ret != NULL)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+						__FUNCTION__, flag);
+		break;
+	default:
+		break;
+	}
+
+	return 0;
+}
+
+/**
+ * extern struct sysfs_class_device *sysfs_ref_class_device
+ * 	(struct sysfs_class_device *dev);
+ *
+ * flag:
+ * 	0 	: dev -> valid, still usable after the first close
+ * 	1 	: dev -> NULL
+ */
+int test_sysfs_ref_class_device(int flag)
+{
+	struct sysfs_class_device *dev = NULL, *ret = NULL;
+	char path[SYSFS_PATH_MAX];
+
+	switch (flag) {
+	case 0:
+		dev = sysfs_open_class_device_path(val_class_dev_path);
+		if (dev == NULL) {
+			dbg_print("%s: failed opening class device\n", __FUNCTION__);
+			return 0;
+		}
+		break;
+	case 1:
+		dev = NULL;
+		break;
+	default:
+		return -1;
+	}
+	ret = sysfs_ref_class_device(dev);
+
+	switch (flag) {
+	case 0:
+		strcpy(path, dev->path);
+		sysfs_close_class_device(dev);
+		if (ret != dev || strcmp(ret->path, path) != 0)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else {
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+						__FUNCTION__, flag);
+			dbg_print("class device at %s\n", ret->path);
+		}
+		sysfs_close_class_device(ret);
+		break;
+	case 1:
+		if (ret != NULL)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+						__FUNCTION__, flag);
+		break;
+	default:
+		break;
+	}
+
+	return 0;
+}
+
+/**
+ * extern struct sysfs_driver *sysfs_ref_driver(struct sysfs_driver *driver);
+ *
+ * flag:
+ * 	0 	: driver -> valid, still usable after the first close
+ * 	1 	: driver -> NULL
+ */
+int test_sysfs_ref_driver(int flag)
+{
+	struct sysfs_driver *driver = NULL, *ret = NULL;
+	char path[SYSFS_PATH_MAX];
+
+	switch (flag) {
+	case 0:
+		driver = sysfs_open_driver_path(val_drv_path);
+		if (driver == NULL) {
+			dbg_print("%s: failed opening driver\n", __FUNCTION__);
+			return 0;
+		}
+		break;
+	case 1:
+		driver = NULL;
+		break;
+	default:
+		return -1;
+	}
+	ret = sysfs_ref_driver(driver);
+
+	switch (flag) {
+	case 0:
+		strcpy(path, driver->path);
+		sysfs_close_driver(driver);
+		if (ret != driver || strcmp(ret->path, path) != 0)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else {
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+						__FUNCTION__, flag);
+			dbg_print("driver at %s\n", ret->path);
+		}
+		sysfs_close_driver(ret);
+		break;
+	case 1:
+		if (ret != NULL)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+						__FUNCTION__, flag);
+		break;
+	default:
+		break;
+	}
+
+	return 0;
+}
+
+/**
+ * extern struct sysfs_module *sysfs_ref_module(struct sysfs_module *module);
+ *
+ * flag:
+ * 	0 	: module -> valid, still usable after the first close
+ * 	1 	: module -> NULL
+ */
+int test_sysfs_ref_module(int flag)
+{
+	struct sysfs_module *module = NULL, *ret = NULL;
+	char path[SYSFS_PATH_MAX];
+
+	switch (flag) {
+	case 0:
+		module = sysfs_open_module(val_mod_name);
+		if (module == NULL) {
+			dbg_print("%s: failed opening module\n", __FUNCTION__);
+			return 0;
+		}
+		break;
+	case 1:
+		module = NULL;
+		break;
+	default:
+		return -1;
+	}
+	ret = sysfs_ref_module(module);
+
+	switch (flag) {
+	case 0:
+		strcpy(path, module->path);
+		sysfs_close_module(module);
+		if (ret != module || strcmp(ret->path, path) != 0)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else {
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+						__FUNCTION__, flag);
+			dbg_print("module at %s\n", ret->path);
+		}
+		sysfs_close_module(ret);
+		break;
+	case 1:
+		if (ret != NULL)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+						__FUNCTION__, flag);
+		break;
+	default:
+		break;
+	}
+
+	return 0;
+}
+
+/**
+ * extern void sysfs_thread_quiescent(void);
+ *
+ * flag:
+ * 	0 	: attribute read before and after -> value still there
+ * 	1 	: nothing handed out yet, called twice
+ */
+int test_sysfs_thread_quiescent(int flag)
+{
+	struct sysfs_attribute *attr = NULL;
+
+	switch (flag) {
+	case 0:
+		attr = sysfs_open_attribute(val_file_path);
+		if (attr == NULL || sysfs_read_attribute(attr) != 0) {
+			dbg_print("%s: failed reading attribute at %s\n",
+					__FUNCTION__, val_file_path);
+			sysfs_close_attribute(attr);
+			return 0;
+		}
+		break;
+	case 1:
+		sysfs_thread_quiescent();
+		break;
+	default:
+		return -1;
+	}
+	sysfs_thread_quiescent();
+
+	switch (flag) {
+	case 0:
+		if (sysfs_read_attribute(attr) != 0 || attr->value == NULL)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else {
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+						__FUNCTION__, flag);
+			show_attribute(attr);
+		}
+		sysfs_close_attribute(attr);
+		break;
+	case 1:
+		dbg_print("%s: SUCCEEDED with flag = %d\n",
+					__FUNCTION__, flag);
+		break;
+	default:
+		break;
+	}
+
+	return 0;
+}
@@ -0,0 +1,432 @@
+/*
+ * test_refresh.c
+ *
+ * Tests for refreshing open objects for the libsysfs testsuite
+ *
+ * Copyright (C) IBM Corp. 2004-2005
+ *
+ *      This program is free software; you can redistribute it and/or modify it
+ *      under the terms of the GNU General Public License as published by the
+ *      Free Software Foundation version 2 of the License.
+ *
+ *      This program is distributed in the hope that it will be useful, but
+ *      WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *      General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License along
+ *      with this program; if not, write to the Free Software Foundation, Inc.,
+ *      675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+/**
+ ******************************************************************************
+ * this will test the refresh functions provided by libsysfs.
+ *
+ * extern int sysfs_refresh_bus(struct sysfs_bus *bus);
+ * extern int sysfs_refresh_class(struct sysfs_class *cls);
+ * extern int sysfs_refresh_class_device(struct sysfs_class_device *dev);
+ * extern int sysfs_refresh_device(struct sysfs_device *dev);
+ * extern int sysfs_refresh_driver(struct sysfs_driver *drv);
+ ******************************************************************************
+ */
+
+#include "config.h"
+
+#include "test-defs.h"
+#include <errno.h>
+
+/* returns 1 if an object in the list is called name */
+static int list_has_name(struct dlist *list, const char *name)
+{
+	struct sysfs_device *dev;
+	struct dl_node *node;
+
+	dlist_for_each_data_nomark(list, node, dev, struct sysfs_device) {
+		if (strcmp(dev->name, name) == 0)
+			return 1;
+	}
+	return 0;
+}
+
+/*
+ * renames the first object of the list, to the refresh it looks like one
+ * object went away and another one turned up
+ */
+static void rename_first(struct dlist *list)
+{
+	struct sysfs_device *dev;
+
+	dlist_start(list);
+	dev = (struct sysfs_device *)dlist_next(list);
+	if (dev)
+		strcpy(dev->name, inval_name);
+}
+
+/* reports the result of a refresh that is expected to fail */
+static void check_refresh_error(const char *func, int flag, int ret,
+					int err)
+{
+	if (ret != -1 || errno != err)
+		dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						func, flag, errno);
+	else
+		dbg_print("%s: SUCCEEDED with flag = %d\n", func, flag);
+}
+
+/**
+ * extern int sysfs_refresh_bus(struct sysfs_bus *bus);
+ *
+ * flag:
+ * 	0 	: bus -> valid, one device replaced since the list was read
+ * 	1 	: bus -> gone
+ * 	2 	: bus -> NULL
+ */
+int test_sysfs_refresh_bus(int flag)
+{
+	struct sysfs_bus *bus = NULL;
+	struct dlist *devlist = NULL;
+	unsigned long count = 0;
+	int ret;
+
+	switch (flag) {
+	case 0:
+	case 1:
+		bus = sysfs_open_bus(val_bus_name);
+		if (bus == NULL) {
+			dbg_print("%s: failed opening bus\n", __FUNCTION__);
+			return 0;
+		}
+		devlist = sysfs_get_bus_devices(bus);
+		if (devlist == NULL) {
+			dbg_print("%s: failed to get devices\n", __FUNCTION__);
+			sysfs_close_bus(bus);
+			return 0;
+		}
+		count = devlist->count;
+		if (flag == 0)
+			rename_first(devlist);
+		else
+			strcpy(bus->path, inval_path);
+		break;
+	case 2:
+		bus = NULL;
+		break;
+	default:
+		return -1;
+	}
+	ret = sysfs_refresh_bus(bus);
+
+	switch (flag) {
+	case 0:
+		if (ret != 0 || bus->devices->count != count ||
+				list_has_name(bus->devices, inval_name))
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else {
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+						__FUNCTION__, flag);
+			show_device_list(bus->devices);
+		}
+		break;
+	case 1:
+		check_refresh_error(__FUNCTION__, flag, ret, ENOENT);
+		break;
+	case 2:
+		check_refresh_error(__FUNCTION__, flag, ret, EINVAL);
+		break;
+	default:
+		break;
+	}
+	if (bus != NULL)
+		sysfs_close_bus(bus);
+
+	return 0;
+}
+
+/**
+ * extern int sysfs_refresh_class(struct sysfs_class *cls);
+ *
+ * flag:
+ * 	0 	: cls -> valid, one class device replaced since the list was read
+ * 	1 	: cls -> gone
+ * 	2 	: cls -> NULL
+ */
+int test_sysfs_refresh_class(int flag)
+{
+	struct sysfs_class *cls = NULL;
+	struct dlist *devlist = NULL;
+	unsigned long count = 0;
+	int ret;
+
+	switch (flag) {
+	case 0:
+	case 1:
+		cls = sysfs_open_class(val_class);
+		if (cls == NULL) {
+			dbg_print("%s: failed opening class\n", __FUNCTION__);
+			return 0;
+		}
+		devlist = sysfs_get_class_devices(cls);
+		if (devlist == NULL) {
+			dbg_print("%s: failed to get class devices\n",
+						__FUNCTION__);
+			sysfs_close_class(cls);
+			return 0;
+		}
+		count = devlist->count;
+		if (flag == 0)
+			rename_first(devlist);
+		else
+			strcpy(cls->path, inval_path);
+		break;
+	case 2:
+		cls = NULL;
+		break;
+	default:
+		return -1;
+	}
+	ret = sysfs_refresh_class(cls);
+
+	switch (flag) {
+	case 0:
+		if (ret != 0 || cls->devices->count != count ||
+				list_has_name(cls->devices, inval_name))
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else {
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+						__FUNCTION__, flag);
+			show_class_device_list(cls->devices);
+		}
+		break;
+	case 1:
+		check_refresh_error(__FUNCTION__, flag, ret, ENOENT);
+		break;
+	case 2:
+		check_refresh_error(__FUNCTION__, flag, ret, EINVAL);
+		break;
+	default:
+		break;
+	}
+	if (cls != NULL)
+		sysfs_close_class(cls);
+
+	return 0;
+}
+
+/**
+ * extern int sysfs_refresh_class_device(struct sysfs_class_device *dev);
+ *
+ * flag:
+ * 	0 	: dev -> valid, with an attribute read
+ * 	1 	: dev -> gone
+ * 	2 	: dev -> NULL
+ */
+int test_sysfs_refresh_class_device(int flag)
+{
+	struct sysfs_class_device *dev = NULL;
+	struct sysfs_attribute *attr = NULL;
+	int ret;
+
+	switch (flag) {
+	case 0:
+	case 1:
+		dev = sysfs_open_class_device_path(val_class_dev_path);
+		if (dev == NULL) {
+			dbg_print("%s: failed opening class device\n",
+						__FUNCTION__);
+			return 0;
+		}
+		if (flag == 0) {
+			attr = sysfs_get_classdev_attr(dev,
+						val_class_dev_attr);
+			if (attr == NULL) {
+				dbg_print("%s: failed to get attribute\n",
+						__FUNCTION__);
+				sysfs_close_class_device(dev);
+				return 0;
+			}
+		} else
+			strcpy(dev->path, inval_path);
+		break;
+	case 2:
+		dev = NULL;
+		break;
+	default:
+		return -1;
+	}
+	ret = sysfs_refresh_class_device(dev);
+
+	switch (flag) {
+	case 0:
+		if (ret != 0 || sysfs_get_classdev_attr(dev,
+					val_class_dev_attr) != attr)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else {
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+						__FUNCTION__, flag);
+			show_attribute(attr);
+		}
+		break;
+	case 1:
+		check_refresh_error(__FUNCTION__, flag, ret, ENOENT);
+		break;
+	case 2:
+		check_refresh_error(__FUNCTION__, flag, ret, EINVAL);
+		break;
+	default:
+		break;
+	}
+	if (dev != NULL)
+		sysfs_close_class_device(dev);
+
+	return 0;
+}
+
+/**
+ * extern int sysfs_refresh_device(struct sysfs_device *dev);
+ *
+ * flag:
+ * 	0 	: dev -> valid, with an attribute and the driver read
+ * 	1 	: dev -> gone
+ * 	2 	: dev -> NULL
+ */
+int test_sysfs_refresh_device(int flag)
+{
+	struct sysfs_device *dev = NULL;
+	struct sysfs_attribute *attr = NULL;
+	struct sysfs_uevent *uevent = NULL;
+	char driver[SYSFS_NAME_LEN];
+	int ret;
+
+	switch (flag) {
+	case 0:
+	case 1:
+		dev = sysfs_open_device_path(val_dev_path);
+		if (dev == NULL) {
+			dbg_print("%s: failed opening device\n", __FUNCTION__);
+			return 0;
+		}
+		if (flag == 0) {
+			attr = sysfs_get_device_attr(dev, val_dev_attr);
+			if (attr == NULL) {
+				dbg_print("%s: failed to get attribute\n",
+						__FUNCTION__);
+				sysfs_close_device(dev);
+				return 0;
+			}
+			strcpy(driver, dev->driver_name);
+			uevent = sysfs_get_device_uevent(dev);
+		} else
+			strcpy(dev->path, inval_path);
+		break;
+	case 2:
+		dev = NULL;
+		break;
+	default:
+		return -1;
+	}
+	ret = sysfs_refresh_device(dev);
+
+	switch (flag) {
+	case 0:
+		/* the uevent read before is kept, the file didn't change */
+		if (ret != 0 || strcmp(dev->driver_name, driver) != 0 ||
+				sysfs_get_device_attr(dev, val_dev_attr) != attr ||
+				(uevent != NULL &&
+				 sysfs_get_device_uevent(dev) != uevent))
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else {
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+						__FUNCTION__, flag);
+			show_device(dev);
+		}
+		break;
+	case 1:
+		check_refresh_error(__FUNCTION__, flag, ret, ENOENT);
+		break;
+	case 2:
+		check_refresh_error(__FUNCTION__, flag, ret, EINVAL);
+		break;
+	default:
+		break;
+	}
+	if (dev != NULL)
+		sysfs_close_device(dev);
+
+	return 0;
+}
+
+/**
+ * extern int sysfs_refresh_driver(struct sysfs_driver *drv);
+ *
+ * flag:
+ * 	0 	: drv -> valid, one device replaced since the list was read
+ * 	1 	: drv -> gone
+ * 	2 	: drv -> NULL
+ */
+int test_sysfs_refresh_driver(int flag)
+{
+	struct sysfs_driver *drv = NULL;
+	struct dlist *devlist = NULL;
+	unsigned long count = 0;
+	int ret;
+
+	switch (flag) {
+	case 0:
+	case 1:
+		drv = sysfs_open_driver_path(val_drv_path);
+		if (drv == NULL) {
+			dbg_print("%s: failed opening driver\n", __FUNCTION__);
+			return 0;
+		}
+		devlist = sysfs_get_driver_devices(drv);
+		if (devlist == NULL) {
+			dbg_print("%s: failed to get devices\n", __FUNCTION__);
+			sysfs_close_driver(drv);
+			return 0;
+		}
+		count = devlist->count;
+		if (flag == 0)
+			rename_first(devlist);
+		else
+			strcpy(drv->path, inval_path);
+		break;
+	case 2:
+		drv = NULL;
+		break;
+	default:
+		return -1;
+	}
+	ret = sysfs_refresh_driver(drv);
+
+	switch (flag) {
+	case 0:
+		if (ret != 0 || drv->devices->count != count ||
+				list_has_name(drv->devices, inval_name))
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else {
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+						__FUNCTION__, flag);
+			show_device_list(drv->devices);
+		}
+		break;
+	case 1:
+		check_refresh_error(__FUNCTION__, flag, ret, ENOENT);
+		break;
+	case 2:
+		check_refresh_error(__FUNCTION__, flag, ret, EINVAL);
+		break;
+	default:
+		break;
+	}
+	if (drv != NULL)
+		sysfs_close_driver(drv);
+
+	return 0;
+}
@@ -0,0 +1,457 @@
+/*
+ * test_snapshot.c
+ *
+ * Tests for shared sysfs snapshots for the libsysfs testsuite
+ *
+ * Copyright (C) IBM Corp. 2004-2005
+ *
+ *      This program is free software; you can redistribute it and/or modify it
+ *      under the terms of the GNU General Public License as published by the
+ *      Free Software Foundation version 2 of the License.
+ *
+ *      This program is distributed in the hope that it will be useful, but
+ *      WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *      General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License along
+ *      with this program; if not, write to the Free Software Foundation, Inc.,
+ *      675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+/**
+ ******************************************************************************
+ * this will test the snapshot functions provided by libsysfs. The tests
+ * publish their own segment rather than the one sysfsd would use.
+ *
+ * extern struct sysfs_snapshot *sysfs_open_snapshot(const char *name);
+ * extern void sysfs_close_snapshot(struct sysfs_snapshot *snap);
+ * extern int sysfs_publish_snapshot(struct sysfs_snapshot *snap);
+ * extern int sysfs_attach_snapshot(const char *name);
+ * extern void sysfs_detach_snapshot(void);
+ * extern int sysfs_write_cache(const char *path);
+ * extern int sysfs_attach_cache(const char *path);
+ ******************************************************************************
+ */
+
+#include "config.h"
+
+#include "test-defs.h"
+#include <errno.h>
+
+#define test_snapshot_name	"/libsysfs-testsuite"
+#define inval_snapshot_name	"/libsysfs/invalid"
+#define test_cache_path		"/tmp/libsysfs-testsuite.cache"
+#define inval_cache_path	"/libsysfs/invalid/cache"
+
+/* reports the result of a call that is expected to fail with err */
+static void check_snapshot_error(const char *func, int flag, int failed,
+					int err)
+{
+	if (!failed || errno != err)
+		dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						func, flag, errno);
+	else
+		dbg_print("%s: SUCCEEDED with flag = %d\n", func, flag);
+}
+
+/*
+ * reads the test device's attribute and the number of devices on its
+ * bus, so that results with and without a snapshot can be compared
+ */
+static int read_device_state(char *value, size_t len, int *count)
+{
+	struct sysfs_device *dev;
+	struct sysfs_attribute *attr;
+	struct sysfs_bus *bus;
+	struct dlist *devlist;
+	int ret = -1;
+
+	dev = sysfs_open_device_path(val_dev_path);
+	if (dev == NULL)
+		return -1;
+	attr = sysfs_get_device_attr(dev, val_dev_attr);
+	if (attr != NULL && attr->value != NULL) {
+		strncpy(value, attr->value, len - 1);
+		value[len - 1] = '\0';
+		ret = 0;
+	}
+	sysfs_close_device(dev);
+
+	bus = sysfs_open_bus(val_bus_name);
+	if (bus == NULL)
+		return -1;
+	devlist = sysfs_get_bus_devices(bus);
+	*count = devlist ? devlist->count : 0;
+	sysfs_close_bus(bus);
+	return ret;
+}
+
+/**
+ * extern struct sysfs_snapshot *sysfs_open_snapshot(const char *name);
+ *
+ * flag:
+ * 	0 	: name -> valid
+ * 	1 	: name -> invalid
+ */
+int test_sysfs_open_snapshot(int flag)
+{
+	struct sysfs_snapshot *snap = NULL;
+	const char *name = NULL;
+
+	switch (flag) {
+	case 0:
+		name = test_snapshot_name;
+		break;
+	case 1:
+		name = inval_snapshot_name;
+		break;
+	default:
+		return -1;
+	}
+	snap = sysfs_open_snapshot(name);
+
+	switch (flag) {
+	case 0:
+		if (snap == NULL)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+						__FUNCTION__, flag);
+		break;
+	case 1:
+		if (snap != NULL)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+						__FUNCTION__, flag);
+		break;
+	default:
+		break;
+	}
+	if (snap != NULL)
+		sysfs_close_snapshot(snap);
+
+	return 0;
+}
+
+/**
+ * extern void sysfs_close_snapshot(struct sysfs_snapshot *snap);
+ *
+ * flag:
+ * 	0 	: snap -> valid, the segment is to be gone afterwards
+ * 	1 	: snap -> NULL
+ */
+int test_sysfs_close_snapshot(int flag)
+{
+	struct sysfs_snapshot *snap = NULL;
+	int ret;
+
+	switch (flag) {
+	case 0:
+		snap = sysfs_open_snapshot(test_snapshot_name);
+		if (snap == NULL) {
+			dbg_print("%s: failed opening snapshot\n",
+						__FUNCTION__);
+			return 0;
+		}
+		break;
+	case 1:
+		snap = NULL;
+		break;
+	default:
+		return -1;
+	}
+	sysfs_close_snapshot(snap);
+
+	switch (flag) {
+	case 0:
+		ret = sysfs_attach_snapshot(test_snapshot_name);
+		check_snapshot_error(__FUNCTION__, flag, ret == -1, ENOENT);
+		if (ret == 0)
+			sysfs_detach_snapshot();
+		break;
+	case 1:
+		dbg_print("%s: SUCCEEDED with flag = %d\n",
+						__FUNCTION__, flag);
+		break;
+	default:
+		break;
+	}
+
+	return 0;
+}
+
+/**
+ * extern int sysfs_publish_snapshot(struct sysfs_snapshot *snap);
+ *
+ * flag:
+ * 	0 	: snap -> valid, published twice
+ * 	1 	: snap -> NULL
+ */
+int test_sysfs_publish_snapshot(int flag)
+{
+	struct sysfs_snapshot *snap = NULL;
+	int ret;
+
+	switch (flag) {
+	case 0:
+		snap = sysfs_open_snapshot(test_snapshot_name);
+		if (snap == NULL) {
+			dbg_print("%s: failed opening snapshot\n",
+						__FUNCTION__);
+			return 0;
+		}
+		ret = sysfs_publish_snapshot(snap);
+		if (ret == 0)
+			ret = sysfs_publish_snapshot(snap);
+		break;
+	case 1:
+		ret = sysfs_publish_snapshot(NULL);
+		break;
+	default:
+		return -1;
+	}
+
+	switch (flag) {
+	case 0:
+		if (ret != 0)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+						__FUNCTION__, flag);
+		break;
+	case 1:
+		check_snapshot_error(__FUNCTION__, flag, ret == -1, EINVAL);
+		break;
+	default:
+		break;
+	}
+	if (snap != NULL)
+		sysfs_close_snapshot(snap);
+
+	return 0;
+}
+
+/**
+ * extern int sysfs_attach_snapshot(const char *name);
+ *
+ * flag:
+ * 	0 	: name -> published snapshot, answers are to match sysfs
+ * 	1 	: name -> no such segment
+ */
+int test_sysfs_attach_snapshot(int flag)
+{
+	struct sysfs_snapshot *snap = NULL;
+	char value[SYSFS_PATH_MAX], shared[SYSFS_PATH_MAX];
+	int count = 0, shared_count = -1, ret;
+
+	switch (flag) {
+	case 0:
+		snap = sysfs_open_snapshot(test_snapshot_name);
+		if (snap == NULL || sysfs_publish_snapshot(snap) ||
+				read_device_state(value, sizeof(value),
+								&count)) {
+			dbg_print("%s: failed publishing snapshot\n",
+						__FUNCTION__);
+			sysfs_close_snapshot(snap);
+			return 0;
+		}
+		break;
+	case 1:
+		break;
+	default:
+		return -1;
+	}
+	ret = sysfs_attach_snapshot(test_snapshot_name);
+
+	switch (flag) {
+	case 0:
+		if (ret == 0 && read_device_state(shared, sizeof(shared),
+							&shared_count) == 0 &&
+				strcmp(value, shared) == 0 &&
+				count == shared_count)
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+						__FUNCTION__, flag);
+		else
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		break;
+	case 1:
+		check_snapshot_error(__FUNCTION__, flag, ret == -1, ENOENT);
+		break;
+	default:
+		break;
+	}
+	if (ret == 0)
+		sysfs_detach_snapshot();
+	if (snap != NULL)
+		sysfs_close_snapshot(snap);
+
+	return 0;
+}
+
+/**
+ * extern void sysfs_detach_snapshot(void);
+ *
+ * flag:
+ * 	0 	: attached, sysfs is to be read again after the publisher
+ * 		  is gone
+ */
+int test_sysfs_detach_snapshot(int flag)
+{
+	struct sysfs_snapshot *snap = NULL;
+	char value[SYSFS_PATH_MAX];
+	int count = 0;
+
+	switch (flag) {
+	case 0:
+		snap = sysfs_open_snapshot(test_snapshot_name);
+		if (snap == NULL || sysfs_publish_snapshot(snap) ||
+				sysfs_attach_snapshot(test_snapshot_name)) {
+			dbg_print("%s: failed attaching snapshot\n",
+						__FUNCTION__);
+			sysfs_close_snapshot(snap);
+			return 0;
+		}
+		break;
+	default:
+		return -1;
+	}
+	sysfs_detach_snapshot();
+	sysfs_close_snapshot(snap);
+
+	switch (flag) {
+	case 0:
+		if (read_device_state(value, sizeof(value), &count))
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+						__FUNCTION__, flag);
+		break;
+	default:
+		break;
+	}
+
+	return 0;
+}
+
+/**
+ * extern int sysfs_write_cache(const char *path);
+ *
+ * flag:
+ * 	0 	: path -> valid
+ * 	1 	: path -> in a directory that doesn't exist
+ */
+int test_sysfs_write_cache(int flag)
+{
+	const char *path = NULL;
+	int ret;
+
+	switch (flag) {
+	case 0:
+		path = test_cache_path;
+		break;
+	case 1:
+		path = inval_cache_path;
+		break;
+	default:
+		return -1;
+	}
+	ret = sysfs_write_cache(path);
+
+	switch (flag) {
+	case 0:
+		if (ret != 0)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+						__FUNCTION__, flag);
+		break;
+	case 1:
+		check_snapshot_error(__FUNCTION__, flag, ret == -1, ENOENT);
+		break;
+	default:
+		break;
+	}
+	unlink(test_cache_path);
+
+	return 0;
+}
+
+/**
+ * extern int sysfs_attach_cache(const char *path);
+ *
+ * flag:
+ * 	0 	: path -> written cache, answers are to match sysfs
+ * 	1 	: path -> no such file
+ * 	2 	: path -> not a cache file
+ */
+int test_sysfs_attach_cache(int flag)
+{
+	char value[SYSFS_PATH_MAX], cached[SYSFS_PATH_MAX];
+	int count = 0, cached_count = -1, ret;
+	FILE *fp;
+
+	unlink(test_cache_path);
+	switch (flag) {
+	case 0:
+		if (sysfs_write_cache(test_cache_path) ||
+				read_device_state(value, sizeof(value),
+								&count)) {
+			dbg_print("%s: failed writing cache\n",
+						__FUNCTION__);
+			unlink(test_cache_path);
+			return 0;
+		}
+		break;
+	case 1:
+		break;
+	case 2:
+		fp = fopen(test_cache_path, "w");
+		if (fp == NULL) {
+			dbg_print("%s: failed creating file\n",
+						__FUNCTION__);
+			return 0;
+		}
+		fprintf(fp, "%*s\n", SYSFS_PATH_MAX * 2, "not a cache");
+		fclose(fp);
+		break;
+	default:
+		return -1;
+	}
+	ret = sysfs_attach_cache(test_cache_path);
+
+	switch (flag) {
+	case 0:
+		if (ret == 0 && read_device_state(cached, sizeof(cached),
+							&cached_count) == 0 &&
+				strcmp(value, cached) == 0 &&
+				count == cached_count)
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+						__FUNCTION__, flag);
+		else
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		break;
+	case 1:
+		check_snapshot_error(__FUNCTION__, flag, ret == -1, ENOENT);
+		break;
+	case 2:
+		check_snapshot_error(__FUNCTION__, flag, ret == -1, EINVAL);
+		break;
+	default:
+		break;
+	}
+	if (ret == 0)
+		sysfs_detach_snapshot();
+	unlink(test_cache_path);
+
+	return 0;
+}
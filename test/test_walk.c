@@ -0,0 +1,301 @@
+/*
+ * test_walk.c
+ *
+ * Tests for the device tree walk for the libsysfs testsuite
+ *
+ * Copyright (C) IBM Corp. 2004-2005
+ *
+ *      This program is free software; you can redistribute it and/or modify it
+ *      under the terms of the GNU General Public License as published by the
+ *      Free Software Foundation version 2 of the License.
+ *
+ *      This program is distributed in the hope that it will be useful, but
+ *      WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *      General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License along
+ *      with this program; if not, write to the Free Software Foundation, Inc.,
+ *      675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+/**
+ ******************************************************************************
+ * this will test the device tree walk functions provided by libsysfs.
+ *
+ * extern int sysfs_walk(const char *root, sysfs_walk_fn visitor,
+ * 		const struct sysfs_walk_opts *opts, void *data);
+ * extern struct sysfs_attribute *sysfs_walk_node_attr
+ * 		(struct sysfs_walk_node *node, const char *name);
+ * extern struct sysfs_device *sysfs_walk_node_device
+ * 		(struct sysfs_walk_node *node);
+ ******************************************************************************
+ */
+
+#include "config.h"
+
+#include "test-defs.h"
+#include <errno.h>
+
+struct walk_result {
+	int nodes;		/* nodes visited */
+	int found;		/* val_dev_path seen with the expected data */
+};
+
+static const char * const walk_attrs[] = { val_dev_attr, NULL };
+
+/* counts nodes and checks the projection for val_dev_path */
+static int walk_check_projection(struct sysfs_walk_node *node, void *data)
+{
+	struct walk_result *res = (struct walk_result *)data;
+	struct sysfs_attribute *attr;
+
+	res->nodes++;
+	if (strcmp(node->path, val_dev_path) != 0)
+		return SYSFS_WALK_CONTINUE;
+
+	if (node->attrlist && node->attrlist->count == 1) {
+		dlist_start(node->attrlist);
+		attr = (struct sysfs_attribute *)dlist_next(node->attrlist);
+		if (attr && strcmp(attr->name, val_dev_attr) == 0) {
+			show_attribute(attr);
+			res->found = 1;
+		}
+	}
+	return SYSFS_WALK_CONTINUE;
+}
+
+/* stops the walk at the first node */
+static int walk_stop(struct sysfs_walk_node *node, void *data)
+{
+	struct walk_result *res = (struct walk_result *)data;
+
+	res->nodes++;
+	dbg_print("Stopping at %s\n", node->path);
+	return SYSFS_WALK_STOP;
+}
+
+/* prunes every node, so only the root is visited */
+static int walk_skip(__attribute__((unused)) struct sysfs_walk_node *node,
+			void *data)
+{
+	struct walk_result *res = (struct walk_result *)data;
+
+	res->nodes++;
+	return SYSFS_WALK_SKIP;
+}
+
+/* reads val_dev_attr on demand at val_dev_path */
+static int walk_get_attr(struct sysfs_walk_node *node, void *data)
+{
+	struct walk_result *res = (struct walk_result *)data;
+	struct sysfs_attribute *attr;
+
+	res->nodes++;
+	if (strcmp(node->path, val_dev_path) != 0)
+		return SYSFS_WALK_CONTINUE;
+
+	attr = sysfs_walk_node_attr(node, val_dev_attr);
+	if (attr) {
+		show_attribute(attr);
+		res->found = 1;
+	}
+	if (sysfs_walk_node_attr(node, inval_name) != NULL)
+		res->found = -1;
+	if (sysfs_walk_node_attr(node, NULL) != NULL)
+		res->found = -1;
+	return SYSFS_WALK_STOP;
+}
+
+/* opens val_dev_path as a device */
+static int walk_get_device(struct sysfs_walk_node *node, void *data)
+{
+	struct walk_result *res = (struct walk_result *)data;
+	struct sysfs_device *dev;
+
+	res->nodes++;
+	if (strcmp(node->path, val_dev_path) != 0)
+		return SYSFS_WALK_CONTINUE;
+
+	dev = sysfs_walk_node_device(node);
+	if (dev && strcmp(dev->path, val_dev_path) == 0 &&
+			sysfs_walk_node_device(node) == dev) {
+		show_device(dev);
+		res->found = 1;
+	}
+	return SYSFS_WALK_STOP;
+}
+
+/**
+ * extern int sysfs_walk(const char *root, sysfs_walk_fn visitor,
+ * 		const struct sysfs_walk_opts *opts, void *data);
+ *
+ * flag:
+ * 	0 	: root -> valid, projection of val_dev_attr
+ * 	1 	: root -> valid, visitor stops at once
+ * 	2 	: root -> valid, visitor prunes every node
+ * 	3 	: root -> invalid
+ * 	4 	: root -> NULL
+ */
+int test_sysfs_walk(int flag)
+{
+	struct sysfs_walk_opts opts;
+	struct walk_result res;
+	sysfs_walk_fn visitor = NULL;
+	const char *root = NULL;
+	int ret;
+
+	memset(&opts, 0, sizeof(struct sysfs_walk_opts));
+	memset(&res, 0, sizeof(struct walk_result));
+	switch (flag) {
+	case 0:
+		root = val_root_dev_path;
+		visitor = walk_check_projection;
+		opts.attrs = walk_attrs;
+		break;
+	case 1:
+		root = val_root_dev_path;
+		visitor = walk_stop;
+		break;
+	case 2:
+		root = val_root_dev_path;
+		visitor = walk_skip;
+		opts.flags = SYSFS_WALK_ALL_DIRS;
+		break;
+	case 3:
+		root = inval_path;
+		visitor = walk_stop;
+		break;
+	case 4:
+		root = NULL;
+		visitor = walk_stop;
+		break;
+	default:
+		return -1;
+	}
+	ret = sysfs_walk(root, visitor, &opts, &res);
+
+	switch (flag) {
+	case 0:
+		if (ret != 0 || !res.found)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else
+			dbg_print("%s: SUCCEEDED with flag = %d, %d nodes\n",
+					__FUNCTION__, flag, res.nodes);
+		break;
+	case 1:
+		if (ret != 1 || res.nodes != 1)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+					__FUNCTION__, flag);
+		break;
+	case 2:
+		if (ret != 0 || res.nodes != 1)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+					__FUNCTION__, flag);
+		break;
+	case 3:
+	case 4:
+		if (ret != -1 || res.nodes != 0)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+					__FUNCTION__, flag);
+		break;
+	default:
+		break;
+	}
+
+	return 0;
+}
+
+/**
+ * extern struct sysfs_attribute *sysfs_walk_node_attr
+ * 		(struct sysfs_walk_node *node, const char *name);
+ *
+ * flag:
+ * 	0 	: node -> valid, name -> valid, invalid and NULL
+ * 	1 	: node -> NULL
+ */
+int test_sysfs_walk_node_attr(int flag)
+{
+	struct sysfs_attribute *attr = NULL;
+	struct walk_result res;
+	int ret;
+
+	memset(&res, 0, sizeof(struct walk_result));
+	switch (flag) {
+	case 0:
+		ret = sysfs_walk(val_root_dev_path, walk_get_attr, NULL, &res);
+		if (ret != 1 || res.found != 1)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+					__FUNCTION__, flag);
+		break;
+	case 1:
+		attr = sysfs_walk_node_attr(NULL, val_dev_attr);
+		if (attr != NULL)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+					__FUNCTION__, flag);
+		break;
+	default:
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * extern struct sysfs_device *sysfs_walk_node_device
+ * 		(struct sysfs_walk_node *node);
+ *
+ * flag:
+ * 	0 	: node -> valid
+ * 	1 	: node -> NULL
+ */
+int test_sysfs_walk_node_device(int flag)
+{
+	struct sysfs_device *dev = NULL;
+	struct walk_result res;
+	int ret;
+
+	memset(&res, 0, sizeof(struct walk_result));
+	switch (flag) {
+	case 0:
+		ret = sysfs_walk(val_root_dev_path, walk_get_device, NULL,
+									&res);
+		if (ret != 1 || res.found != 1)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+					__FUNCTION__, flag);
+		break;
+	case 1:
+		dev = sysfs_walk_node_device(NULL);
+		if (dev != NULL)
+			dbg_print("%s: FAILED with flag = %d errno = %d\n",
+						__FUNCTION__, flag, errno);
+		else
+			dbg_print("%s: SUCCEEDED with flag = %d\n",
+					__FUNCTION__, flag);
+		break;
+	default:
+		return -1;
+	}
+
+	return 0;
+}